@@ -41,31 +41,65 @@ const String units = "imperial";
 #define ONECALLKEY "58f369e1efbff0ef7c1d8dce59ef4be2"
   
 #ifdef FREDERICKSBURG
-#define WEATHER_CITY 4761951 //<---------------Fredericksburg VA 
+#define WEATHER_LAT "38.3222" //<---------------Fredericksburg VA gauge
+#define WEATHER_LON "-77.5181"
 #define USGS_STATION "01668000"
 #define NWIS_STATION "fdbv2"
 #define FORECAST_LABEL "Rappahannock Forecast"
 #define CURRENT_LABEL  "Rappahannock Conditions"
+#define STAGE_GAUGE_FEET 15  // full scale of the stage dial
 #else
-#define WEATHER_CITY 4760084 //<---------------Great Falls VA 
+#define WEATHER_LAT "38.9494" //<---------------Little Falls gauge
+#define WEATHER_LON "-77.1278"
 #define USGS_STATION "01646500"
 #define NWIS_STATION "brkm2"
 #define FORECAST_LABEL "Little Falls Forecast"
 #define CURRENT_LABEL  "Little Falls Conditions"
+#define STAGE_GAUGE_FEET 8
 #endif
 
+// Play level names and colours for the gauge, made with tools/make_levels.py
+#define PLAY_LEVELS_FILE "/levels/" USGS_STATION ".bin"
+
+// Where each source is fetched from: scheme, host and any path prefix, no trailing slash.
+// To replay recorded responses with faults injected, run tools/upstream_sim.py
+// and point these at it, e.g. "http://192.168.1.20:8080/usgs".
+#define USGS_BASE_URL        "https://waterservices.usgs.gov"
+#define NWS_BASE_URL         "https://water.weather.gov"
+#define OPENWEATHER_BASE_URL "https://api.openweathermap.org"
+
+// Uncomment to serve the latest parsed models to other displays at http://<this display>/model.json and /model.bin
+//#define MODEL_CACHE_SERVER
+
+// Uncomment to fetch river data from another display's cache instead of USGS and NWS
+//#define MODEL_CACHE_PEER "192.168.1.50"
+
+// Uncomment to push fresh readings to the other displays on this multicast group, and apply theirs.
+// Every display in the fleet needs the same key, at least 16 characters; peer push
+// will not start with the placeholder.
+//#define PEER_PUSH
+#define PEER_PUSH_GROUP IPAddress(239, 77, 46, 50)
+#define PEER_PUSH_PORT  4650
+#define PEER_PUSH_KEY   "change-this-fleet-key"
+
+// Radio power save between the network wake windows. WIFI_PS_MAX_MODEM sleeps
+// longest; the model cache server and peer pushes then answer more slowly.
+#define NET_IDLE_POWER_SAVE WIFI_PS_MAX_MODEM
+
+// Time server for the clock. tools/ntp_standin.py serves a local one for testing.
+#define SNTP_SERVER "pool.ntp.org"
 
 // For language codes see https://openweathermap.org/current#multi
 const String language = "en"; // Default language = en = English
 
 // Short day of week abbreviations used in 4 day forecast (change to your language)
-const String shortDOW [8] = {"???", "SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT"};
+const char* const shortDOW [8] = {"???", "SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT"};
 
 // Change the labels to your language here:
 const char sunStr[]        = "Sun";
 const char cloudStr[]      = "Cloud";
 const char humidityStr[]   = "Humidity";
-const String moonPhase [8] = {"New", "Waxing", "1st qtr", "Waxing", "Full", "Waning", "Last qtr", "Waning"};
+const char* const moonPhase [8] = {"New", "Waxing", "1st qtr", "Waxing", "Full", "Waning", "Last qtr", "Waning"};
 
 // End of user settings
 //////////////////////////////
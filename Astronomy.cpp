@@ -0,0 +1,148 @@
+#include "Astronomy.h"
+#include <math.h>
+
+#define PI_D 3.14159265358979323846
+#define RAD (PI_D / 180.0)
+#define SMALL_FLOAT (1e-12)
+
+#define UNIX_EPOCH_JD 2440587.5
+#define J2000_JD      2451545.0
+
+Astronomy::Astronomy(double latitude, double longitude) {
+  this->latitude = latitude;
+  this->longitude = longitude;
+}
+
+// Howard Hinnant's days_from_civil
+int32_t Astronomy::daysFromCivil(int year, int month, int day) {
+  year -= month <= 2;
+  int32_t era = (year >= 0 ? year : year - 399) / 400;
+  uint32_t yoe = (uint32_t)(year - era * 400);
+  uint32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int32_t)doe - 719468;
+}
+
+const Ephemeris* Astronomy::forDate(int year, int month, int day, int utcOffsetMinutes) {
+  int32_t days = daysFromCivil(year, month, day);
+  if (!this->cache.valid || this->cache.day != days) {
+    compute(days, utcOffsetMinutes);
+  }
+  return &this->cache;
+}
+
+void Astronomy::restore(const Ephemeris* e) {
+  this->cache = *e;
+}
+
+static double normalize(double degrees) {
+  degrees = fmod(degrees, 360.0);
+  return degrees < 0 ? degrees + 360.0 : degrees;
+}
+
+static uint32_t unixFromJulian(double jd) {
+  return (uint32_t)((jd - UNIX_EPOCH_JD) * 86400.0 + 0.5);
+}
+
+/***************************************************************************************
+**                          Moon phase (voidware)
+***************************************************************************************/
+// Adapted by Bodmer from code here:
+// http://www.voidware.com/moon_phase.htm
+// j is days since 1980-01-00 (JD 2444238.5)
+
+static double sun_position(double j)
+{
+  double n, x, e, l, dl, v;
+  int i;
+
+  n = 360 / 365.2422 * j;
+  i = n / 360;
+  n = n - i * 360.0;
+  x = n - 3.762863;
+  if (x < 0) x += 360;
+  x *= RAD;
+  e = x;
+  do {
+    dl = e - .016718 * sin(e) - x;
+    e = e - dl / (1 - .016718 * cos(e));
+  } while (fabs(dl) >= SMALL_FLOAT);
+  v = 360 / PI_D * atan(1.01686011182 * tan(e / 2));
+  l = v + 282.596403;
+  i = l / 360;
+  l = l - i * 360.0;
+  return l;
+}
+
+static double moon_position(double j, double ls)
+{
+  double ms, l, mm, n, ev, sms, ae, ec;
+  int i;
+
+  /* ls = sun_position(j) */
+  ms = 0.985647332099 * j - 3.762863;
+  if (ms < 0) ms += 360.0;
+  l = 13.176396 * j + 64.975464;
+  i = l / 360;
+  l = l - i * 360.0;
+  if (l < 0) l += 360.0;
+  mm = l - 0.1114041 * j - 349.383063;
+  i = mm / 360;
+  mm -= i * 360.0;
+  n = 151.950429 - 0.0529539 * j;
+  i = n / 360;
+  n -= i * 360.0;
+  ev = 1.2739 * sin((2 * (l - ls) - mm) * RAD);
+  sms = sin(ms * RAD);
+  ae = 0.1858 * sms;
+  mm += ev - ae - 0.37 * sms;
+  ec = 6.2886 * sin(mm * RAD);
+  l += ev + ec - ae + 0.214 * sin(2 * mm * RAD);
+  l = 0.6583 * sin(2 * (l - ls) * RAD) + l;
+  return l;
+}
+
+/***************************************************************************************
+**                          Sunrise equation
+***************************************************************************************/
+void Astronomy::compute(int32_t day, int utcOffsetMinutes) {
+  Ephemeris* e = &this->cache;
+  e->day = day;
+
+  // Mean solar noon at this longitude on the date, in days since J2000
+  double n = day - (J2000_JD - UNIX_EPOCH_JD - 0.5);
+  double jStar = n - this->longitude / 360.0;
+  double m = normalize(357.5291 + 0.98560028 * jStar);
+  double c = 1.9148 * sin(m * RAD) + 0.0200 * sin(2 * m * RAD) + 0.0003 * sin(3 * m * RAD);
+  double lambda = normalize(m + c + 180.0 + 102.9372);
+  double transit = J2000_JD + jStar + 0.0053 * sin(m * RAD) - 0.0069 * sin(2 * lambda * RAD);
+  double sinDecl = sin(lambda * RAD) * sin(23.4397 * RAD);
+  double cosDecl = cos(asin(sinDecl));
+  double sinLat = sin(this->latitude * RAD);
+  double cosLat = cos(this->latitude * RAD);
+
+  // Half the day arc from noon to the sun crossing the given altitude, or none
+  double hourAngle[2];
+  const double altitudes[2] = { ASTRONOMY_SUNRISE_ALTITUDE, ASTRONOMY_CIVIL_ALTITUDE };
+  for (int i = 0; i < 2; i++) {
+    double cosOmega = (sin(altitudes[i] * RAD) - sinLat * sinDecl) / (cosLat * cosDecl);
+    hourAngle[i] = (cosOmega < -1.0 || cosOmega > 1.0) ? -1.0 : acos(cosOmega) / RAD;
+  }
+  e->sunrise   = hourAngle[0] < 0 ? 0 : unixFromJulian(transit - hourAngle[0] / 360.0);
+  e->sunset    = hourAngle[0] < 0 ? 0 : unixFromJulian(transit + hourAngle[0] / 360.0);
+  e->civilDawn = hourAngle[1] < 0 ? 0 : unixFromJulian(transit - hourAngle[1] / 360.0);
+  e->civilDusk = hourAngle[1] < 0 ? 0 : unixFromJulian(transit + hourAngle[1] / 360.0);
+
+  // The moon at local noon
+  double noon = UNIX_EPOCH_JD + day + 0.5 - utcOffsetMinutes / 1440.0;
+  double j = noon - 2444238.5;
+  double ls = sun_position(j);
+  double lm = moon_position(j, ls);
+  double t = lm - ls;
+  if (t < 0) t += 360;
+
+  e->moonPhase = (int)((t + 22.5) / 45) & 0x7;
+  e->moonIcon = ((int)((t + 7.5) / 15) + 23) % 24;
+  e->illumination = (uint8_t)(100.0 * ((1.0 - cos(t * RAD)) / 2) + 0.5);
+  e->valid = true;
+}
@@ -0,0 +1,52 @@
+#ifndef _RIVER_WEATHER_ASTRONOMY_H_FILE
+#define _RIVER_WEATHER_ASTRONOMY_H_FILE
+
+#include <stdint.h>
+
+/*
+ * Sun and moon times for the gauge, computed on the display instead of taken
+ * from the weather forecast. The sun uses the sunrise equation (about a minute
+ * of error at these latitudes), the moon the voidware phase model the sketch
+ * has always used. Everything is worked out once per local date and kept
+ * until the date changes, so a redraw costs a comparison.
+ */
+
+#define ASTRONOMY_SUNRISE_ALTITUDE -0.833   // refraction plus the sun's radius
+#define ASTRONOMY_CIVIL_ALTITUDE   -6.0
+
+typedef struct Ephemeris {
+  int32_t  day;           // local date as days since 1970-01-01
+  uint32_t civilDawn;     // Unix seconds, 0 when the sun never gets that high or low
+  uint32_t sunrise;
+  uint32_t sunset;
+  uint32_t civilDusk;
+  uint8_t  moonIcon;      // 0-23, /moon/moonphase_L<n>.bmp
+  uint8_t  moonPhase;     // 0-7, index into moonPhase[]
+  uint8_t  illumination;  // percent of the disc lit
+  bool     valid;
+} Ephemeris;
+
+class Astronomy {
+  public:
+    Astronomy(double latitude, double longitude);
+
+    // The ephemeris for a local date, utcOffsetMinutes is the zone offset on that date
+    const Ephemeris* forDate(int year, int month, int day, int utcOffsetMinutes);
+
+    // Whatever was computed or restored last, for the model cache
+    const Ephemeris* current() const { return &this->cache; }
+    // Take a peer's ephemeris, it is kept until the local date moves past it
+    void restore(const Ephemeris* e);
+
+    // Days since 1970-01-01 of a proleptic Gregorian date
+    static int32_t daysFromCivil(int year, int month, int day);
+
+  private:
+    void compute(int32_t day, int utcOffsetMinutes);
+
+    double    latitude;
+    double    longitude;
+    Ephemeris cache = {};
+};
+
+#endif
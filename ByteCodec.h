@@ -0,0 +1,135 @@
+#ifndef _RIVER_WEATHER_BYTE_CODEC_H_FILE
+#define _RIVER_WEATHER_BYTE_CODEC_H_FILE
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Little endian writer/reader over a caller supplied buffer.
+ * Both latch an error flag instead of overrunning, so a run of put/get calls
+ * can be checked once at the end.
+ */
+class ByteWriter {
+  public:
+    ByteWriter(uint8_t* buf, size_t cap) : buf(buf), cap(cap) {}
+
+    void put8(uint8_t v) {
+      if (!reserve(1)) return;
+      buf[len++] = v;
+    }
+    void put16(uint16_t v) {
+      put8((uint8_t)v);
+      put8((uint8_t)(v >> 8));
+    }
+    void put32(uint32_t v) {
+      put16((uint16_t)v);
+      put16((uint16_t)(v >> 16));
+    }
+    void putFloat(float v) {
+      uint32_t bits;
+      memcpy(&bits, &v, sizeof(bits));
+      put32(bits);
+    }
+    // Length prefixed, at most 255 bytes
+    void putStr(const char* s) {
+      size_t n = s ? strlen(s) : 0;
+      if (n > 255) n = 255;
+      put8((uint8_t)n);
+      putBytes(s, n);
+    }
+    void putBytes(const void* p, size_t n) {
+      if (!reserve(n)) return;
+      memcpy(buf + len, p, n);
+      len += n;
+    }
+
+    size_t   length() const { return len; }
+    bool     ok() const { return !overflow; }
+    uint8_t* data() const { return buf; }
+
+  private:
+    bool reserve(size_t n) {
+      if (overflow || len + n > cap) {
+        overflow = true;
+        return false;
+      }
+      return true;
+    }
+
+    uint8_t* buf;
+    size_t   cap;
+    size_t   len = 0;
+    bool     overflow = false;
+};
+
+class ByteReader {
+  public:
+    ByteReader(const uint8_t* buf, size_t len) : buf(buf), len(len) {}
+
+    uint8_t get8() {
+      if (!available(1)) return 0;
+      return buf[pos++];
+    }
+    uint16_t get16() {
+      uint16_t lo = get8();
+      return lo | ((uint16_t)get8() << 8);
+    }
+    uint32_t get32() {
+      uint32_t lo = get16();
+      return lo | ((uint32_t)get16() << 16);
+    }
+    float getFloat() {
+      uint32_t bits = get32();
+      float v;
+      memcpy(&v, &bits, sizeof(v));
+      return v;
+    }
+    // Copies a length prefixed string into out, truncating to fit, always terminated
+    void getStr(char* out, size_t outLen) {
+      size_t n = get8();
+      if (!available(n)) {
+        if (outLen) out[0] = '\0';
+        return;
+      }
+      size_t copy = n < outLen ? n : outLen - 1;
+      memcpy(out, buf + pos, copy);
+      out[copy] = '\0';
+      pos += n;
+    }
+    void getBytes(void* out, size_t n) {
+      if (!available(n)) return;
+      memcpy(out, buf + pos, n);
+      pos += n;
+    }
+
+    // For a decoder that read a length it cannot honour, the rest is unreadable
+    void fail() { underflow = true; }
+
+    bool   ok() const { return !underflow; }
+    size_t remaining() const { return len - pos; }
+
+  private:
+    bool available(size_t n) {
+      if (underflow || pos + n > len) {
+        underflow = true;
+        return false;
+      }
+      return true;
+    }
+
+    const uint8_t* buf;
+    size_t         len;
+    size_t         pos = 0;
+    bool           underflow = false;
+};
+
+// FNV-1a, used for ETags and change detection
+static inline uint32_t fnv1a32(const uint8_t* p, size_t n, uint32_t hash = 2166136261UL) {
+  while (n--) {
+    hash ^= *p++;
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+#endif
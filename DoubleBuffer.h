@@ -0,0 +1,35 @@
+#ifndef _RIVER_WEATHER_DOUBLE_BUFFER_H_FILE
+#define _RIVER_WEATHER_DOUBLE_BUFFER_H_FILE
+
+#include <stdint.h>
+#include <atomic>
+
+/*
+ * Two copies of a model: readers use front(), a single writer fills back()
+ * and makes it current with publish(). A parse that fails or is abandoned
+ * half way never shows up in front(). After publish() the old front becomes
+ * the back buffer, so the writer must fill it completely again.
+ */
+template <typename T>
+class DoubleBuffer {
+  public:
+    DoubleBuffer() : models(), frontIndex(0), generation(0) {}
+
+    const T* front() const { return &this->models[this->frontIndex.load(std::memory_order_acquire)]; }
+    T* back() { return &this->models[this->frontIndex.load(std::memory_order_relaxed) ^ 1]; }
+
+    void publish() {
+      this->frontIndex.store(this->frontIndex.load(std::memory_order_relaxed) ^ 1, std::memory_order_release);
+      this->generation++;
+    }
+
+    // Bumped by every publish, lets a reader tell whether anything changed
+    uint32_t published() const { return this->generation; }
+
+  private:
+    T                    models[2];
+    std::atomic<uint8_t> frontIndex;
+    uint32_t             generation;
+};
+
+#endif
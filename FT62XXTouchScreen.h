@@ -17,6 +17,8 @@
   #define FT62XX_REG_FIRMVERS 0xA6    //!< Firmware version
   #define FT62XX_REG_CHIPID 0xA3      //!< Chip selecting
   #define FT62XX_REG_VENDID 0xA8      //!< FocalTech's panel ID
+  #define FT62XX_REG_GMODE 0xA4       //!< Interrupt mode
+  #define FT62XX_GMODE_POLLING 0x00   //!< INT held low for as long as a finger is down
   
   #define FT62XX_VENDID 0x11  //!< FocalTech's panel ID
   #define FT6206_CHIPID 0x06  //!< Chip selecting
@@ -35,8 +37,14 @@
       FT62XXTouchScreen(uint16_t displayHeight, uint8_t sda, uint8_t scl) : m_displayHeight(displayHeight), m_sda(sda), m_scl(scl) {
       }
       
-      bool begin() {
+      // Pass the pin wired to the FT62XX INT line to use touching() instead of polling over I2C
+      bool begin(int8_t intPin = -1) {
         Wire.begin(m_sda, m_scl);
+        m_intPin = intPin;
+        if (m_intPin >= 0) {
+          pinMode(m_intPin, INPUT);
+          writeByteToTouch(FT62XX_REG_GMODE, FT62XX_GMODE_POLLING);
+        }
         #ifdef TOUCHSCREEN_DEBUG
           Serial.print("Vend ID: 0x");
           Serial.println(readByteFromTouch(FT62XX_REG_VENDID), HEX);
@@ -72,9 +80,19 @@
         return true;
       }
 
+      // Cheap check of the INT line, no I2C traffic. Falls back to a read when no pin is set.
+      bool touching() {
+        if (m_intPin >= 0) {
+          return digitalRead(m_intPin) == LOW;
+        }
+        return read().touched != 0;
+      }
+
+      int8_t interruptPin() const { return m_intPin; }
+
       TouchPoint read(void) {
   
-        TouchPoint retPoint = {0};
+        TouchPoint retPoint = {0, 0, 0};
       
         uint8_t i2cdat[16];
         Wire.beginTransmission(FT62XX_ADDR);
@@ -123,9 +141,9 @@
         uint16_t touchX = i2cdat[0x05] & 0x0F;
         touchX <<= 8;
         touchX |= i2cdat[0x06];
-        uint16_t touchID = i2cdat[0x05] >> 4;
       
         #ifdef TOUCHSCREEN_DEBUG
+          uint16_t touchID = i2cdat[0x05] >> 4;
           Serial.println();
           for (uint8_t i = 0; i < touches; i++) {
             Serial.print("ID #");
@@ -152,6 +170,7 @@
       uint16_t m_displayHeight;
       uint8_t m_sda;
       uint8_t m_scl;
+      int8_t  m_intPin = -1;
 
       uint8_t readByteFromTouch(uint8_t reg) {
         Wire.beginTransmission(FT62XX_ADDR);
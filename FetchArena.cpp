@@ -0,0 +1,80 @@
+#include "FetchArena.h"
+
+FetchArena fetchArena;
+
+FetchArena::OwnerStats* FetchArena::statsFor(const char* owner) {
+  for (int i = 0; i < FETCH_ARENA_OWNERS; i++) {
+    if (this->stats[i].owner == owner || !this->stats[i].owner) {
+      this->stats[i].owner = owner;
+      return &this->stats[i];
+    }
+  }
+  return NULL;
+}
+
+bool FetchArena::begin(const char* owner) {
+  if (this->owner) {
+    Serial.printf("FetchArena: %s is waiting on %s\n", owner, this->owner);
+    this->busy++;
+    return false;
+  }
+  this->owner = owner;
+  this->offset = 0;
+  this->dtorCount = 0;
+  OwnerStats* s = statsFor(owner);
+  if (s) s->sessions++;
+  return true;
+}
+
+void FetchArena::end() {
+  while (this->dtorCount) {
+    Destructor& d = this->dtors[--this->dtorCount];
+    d.destroy(d.object);
+  }
+  OwnerStats* s = statsFor(this->owner);
+  if (s && this->offset > s->highWater) {
+    s->highWater = this->offset;
+  }
+  this->offset = 0;
+  this->owner = NULL;
+}
+
+void* FetchArena::alloc(size_t size, size_t align) {
+  if (!this->owner) {
+    return NULL;
+  }
+  size_t start = (this->offset + align - 1) & ~(align - 1);
+  if (start + size > sizeof(this->buffer)) {
+    Serial.printf("FetchArena: %s needs %u more bytes, %u of %u used\n",
+                  this->owner, (unsigned)size, (unsigned)this->offset, (unsigned)sizeof(this->buffer));
+    OwnerStats* s = statsFor(this->owner);
+    if (s) {
+      s->overflows++;
+      // Remember what would have been needed, not what fitted
+      if (start + size > s->highWater) s->highWater = start + size;
+    }
+    return NULL;
+  }
+  this->offset = start + size;
+  return this->buffer + start;
+}
+
+bool FetchArena::addDestructor(void* object, void (*destroy)(void*)) {
+  if (this->dtorCount == FETCH_ARENA_DTORS) {
+    Serial.println("FetchArena: too many objects with destructors");
+    return false;
+  }
+  this->dtors[this->dtorCount].object = object;
+  this->dtors[this->dtorCount].destroy = destroy;
+  this->dtorCount++;
+  return true;
+}
+
+void FetchArena::report(Print& out) {
+  out.printf("Fetch arena %u bytes, %u sessions refused\n", (unsigned)sizeof(this->buffer), this->busy);
+  out.println("owner        sessions  high water  overflows");
+  for (int i = 0; i < FETCH_ARENA_OWNERS && this->stats[i].owner; i++) {
+    OwnerStats* s = &this->stats[i];
+    out.printf("%-12s %8u  %10u  %9u\n", s->owner, s->sessions, s->highWater, s->overflows);
+  }
+}
@@ -0,0 +1,91 @@
+#ifndef _RIVER_WEATHER_FETCH_ARENA_H_FILE
+#define _RIVER_WEATHER_FETCH_ARENA_H_FILE
+
+#include <Arduino.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+ * Scratch memory shared by the fetches. Only one fetch runs at a time, so
+ * the URL, line and XML buffers and the HTTPClient of every source come out
+ * of one bump-pointer arena instead of each object reserving its own.
+ *
+ * A fetch opens a FetchSession, allocates from it and everything is released
+ * together when the session goes out of scope. Objects with a destructor are
+ * destroyed in reverse order at that point. Running out of space returns NULL
+ * and is counted; 'a' on the serial monitor prints the high-water mark per
+ * owner so FETCH_ARENA_SIZE can be trimmed to what is really used.
+ */
+
+#define FETCH_ARENA_SIZE      3072
+#define FETCH_ARENA_DTORS        8
+#define FETCH_ARENA_OWNERS       6
+#define FETCH_URL_MAX          256
+
+class FetchArena {
+  public:
+    // Check the arena out, false if another session holds it
+    bool begin(const char* owner);
+    void end();
+
+    void* alloc(size_t size, size_t align);
+    bool addDestructor(void* object, void (*destroy)(void*));
+
+    size_t used() const { return this->offset; }
+    void report(Print& out);
+
+  private:
+    typedef struct Destructor {
+      void* object;
+      void (*destroy)(void*);
+    } Destructor;
+
+    typedef struct OwnerStats {
+      const char* owner;
+      uint32_t    sessions;
+      uint32_t    highWater;
+      uint32_t    overflows;
+    } OwnerStats;
+
+    OwnerStats* statsFor(const char* owner);
+
+    alignas(8) uint8_t buffer[FETCH_ARENA_SIZE];
+    size_t      offset = 0;
+    const char* owner = NULL;
+    Destructor  dtors[FETCH_ARENA_DTORS];
+    uint8_t     dtorCount = 0;
+    OwnerStats  stats[FETCH_ARENA_OWNERS] = {};
+    uint32_t    busy = 0;     // sessions refused because the arena was checked out
+};
+
+extern FetchArena fetchArena;
+
+class FetchSession {
+  public:
+    FetchSession(const char* owner) : open(fetchArena.begin(owner)) {}
+    ~FetchSession() { if (this->open) fetchArena.end(); }
+
+    bool ok() const { return this->open; }
+
+    char* chars(size_t len) { return this->open ? (char*)fetchArena.alloc(len, 1) : NULL; }
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+      if (!this->open) return NULL;
+      void* p = fetchArena.alloc(sizeof(T), alignof(T));
+      if (!p) return NULL;
+      T* object = new (p) T(std::forward<Args>(args)...);
+      if (!std::is_trivially_destructible<T>::value &&
+          !fetchArena.addDestructor(object, [](void* o) { static_cast<T*>(o)->~T(); })) {
+        object->~T();
+        return NULL;
+      }
+      return object;
+    }
+
+  private:
+    bool open;
+};
+
+#endif
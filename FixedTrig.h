@@ -0,0 +1,75 @@
+#ifndef _RIVER_WEATHER_FIXED_TRIG_H_FILE
+#define _RIVER_WEATHER_FIXED_TRIG_H_FILE
+
+#include <stdint.h>
+
+/*
+ * Whole-degree sine and cosine in Q14 (16384 == 1.0) for the gauges. The
+ * quarter-wave table is computed by the compiler from a Taylor series and
+ * ends up in flash, so drawing never touches floating point. Angles run
+ * clockwise from 12 o'clock like a compass, so a point at radius r and angle a
+ * is (x + r * sin(a), y - r * cos(a)).
+ */
+
+#define FIXED_TRIG_ONE   16384
+#define FIXED_TRIG_SHIFT 14
+
+namespace fixed_trig {
+
+constexpr double PI_D = 3.14159265358979323846;
+
+// sin(x) for |x| <= pi/2, to well beyond Q14 precision after 12 terms
+constexpr double taylorSin(double x, double term, double sum, int n) {
+  return n > 25 ? sum : taylorSin(x, -term * x * x / ((n + 1) * (n + 2)), sum + term, n + 2);
+}
+
+constexpr int16_t sinQ14(int degrees) {
+  return (int16_t)(taylorSin(degrees * PI_D / 180.0, degrees * PI_D / 180.0, 0.0, 1) * FIXED_TRIG_ONE + 0.5);
+}
+
+typedef struct QuarterWave {
+  int16_t value[91];
+} QuarterWave;
+
+// Index list 0..N-1 for building the table with a pack expansion
+template <int... I> struct Indices {};
+template <int N, int... I> struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+template <int... I> struct MakeIndices<0, I...> { typedef Indices<I...> type; };
+
+template <int... I>
+constexpr QuarterWave makeQuarterWave(Indices<I...>) {
+  return QuarterWave{{ sinQ14(I)... }};
+}
+
+constexpr QuarterWave QUARTER_WAVE = makeQuarterWave(MakeIndices<91>::type());
+
+static_assert(QUARTER_WAVE.value[0] == 0, "sin 0");
+static_assert(QUARTER_WAVE.value[30] == FIXED_TRIG_ONE / 2, "sin 30");
+static_assert(QUARTER_WAVE.value[90] == FIXED_TRIG_ONE, "sin 90");
+
+}
+
+// Any whole number of degrees, negative included
+inline int16_t isin(int degrees) {
+  degrees %= 360;
+  if (degrees < 0) degrees += 360;
+  if (degrees <= 90)  return fixed_trig::QUARTER_WAVE.value[degrees];
+  if (degrees <= 180) return fixed_trig::QUARTER_WAVE.value[180 - degrees];
+  if (degrees <= 270) return -fixed_trig::QUARTER_WAVE.value[degrees - 180];
+  return -fixed_trig::QUARTER_WAVE.value[360 - degrees];
+}
+
+inline int16_t icos(int degrees) {
+  return isin(degrees + 90);
+}
+
+// Offset of a point r pixels out at a compass angle, rounded to the nearest pixel
+inline int32_t polarX(int32_t r, int degrees) {
+  return (r * isin(degrees) + (FIXED_TRIG_ONE >> 1)) >> FIXED_TRIG_SHIFT;
+}
+
+inline int32_t polarY(int32_t r, int degrees) {
+  return -((r * icos(degrees) + (FIXED_TRIG_ONE >> 1)) >> FIXED_TRIG_SHIFT);
+}
+
+#endif
@@ -0,0 +1,153 @@
+#include "Gauges.h"
+#include "FixedTrig.h"
+#include "RenderTrace.h"
+#include "TextFormat.h"
+
+#define GAUGE_TRACK_COLOUR 0x4228   // same grey as the separators
+
+Gauges::Gauges(TracedTFT* tft) {
+  this->tft = tft;
+}
+
+void Gauges::fillSegment(int x, int y, int startAngle, int subAngle, int r, uint32_t colour) {
+  TRACE_SCOPE("fillSegment");
+  int endAngle = startAngle + subAngle;
+  int32_t x1 = x + polarX(r, startAngle);
+  int32_t y1 = y + polarY(r, startAngle);
+  for (int a = startAngle; a < endAngle; ) {
+    a += GAUGE_ARC_STEP;
+    if (a > endAngle) a = endAngle;
+    int32_t x2 = x + polarX(r, a);
+    int32_t y2 = y + polarY(r, a);
+    this->tft->fillTriangle(x1, y1, x2, y2, x, y, colour);
+    x1 = x2;
+    y1 = y2;
+  }
+}
+
+void Gauges::fillArc(int x, int y, int startAngle, int subAngle, int inner, int outer, uint32_t colour) {
+  TRACE_SCOPE("fillArc");
+  int endAngle = startAngle + subAngle;
+  int32_t ox1 = x + polarX(outer, startAngle);
+  int32_t oy1 = y + polarY(outer, startAngle);
+  int32_t ix1 = x + polarX(inner, startAngle);
+  int32_t iy1 = y + polarY(inner, startAngle);
+  for (int a = startAngle; a < endAngle; ) {
+    a += GAUGE_ARC_STEP;
+    if (a > endAngle) a = endAngle;
+    int32_t ox2 = x + polarX(outer, a);
+    int32_t oy2 = y + polarY(outer, a);
+    int32_t ix2 = x + polarX(inner, a);
+    int32_t iy2 = y + polarY(inner, a);
+    this->tft->fillTriangle(ox1, oy1, ox2, oy2, ix1, iy1, colour);
+    this->tft->fillTriangle(ix1, iy1, ox2, oy2, ix2, iy2, colour);
+    ox1 = ox2;
+    oy1 = oy2;
+    ix1 = ix2;
+    iy1 = iy2;
+  }
+}
+
+void Gauges::drawWindRose(int x, int y, int r, uint16_t bearing, uint16_t speed, uint32_t colour) {
+  TRACE_SCOPE("drawWindRose");
+  this->tft->fillCircle(x, y, r, TFT_BLACK);
+  this->tft->drawCircle(x, y, r, GAUGE_TRACK_COLOUR);
+
+  // Ticks on the eight compass points, north longer
+  for (int a = 0; a < 360; a += 45) {
+    int len = a ? r / 5 : r / 3;
+    this->tft->drawLine(x + polarX(r - len, a), y + polarY(r - len, a),
+                        x + polarX(r, a), y + polarY(r, a), a ? GAUGE_TRACK_COLOUR : TFT_ORANGE);
+  }
+
+  // Arrowhead on the rim where the wind comes from, pointing in
+  int tip = r / 2;
+  int base = r - 2;
+  this->tft->fillTriangle(x + polarX(tip, bearing), y + polarY(tip, bearing),
+                          x + polarX(base, bearing - 14), y + polarY(base, bearing - 14),
+                          x + polarX(base, bearing + 14), y + polarY(base, bearing + 14), colour);
+
+  this->tft->setTextDatum(MC_DATUM);
+  this->tft->setTextPadding(0);
+  this->tft->setTextColor(TFT_WHITE, TFT_BLACK);
+  this->tft->drawNumber(speed, x, y, 2);
+  this->tft->setTextDatum(TL_DATUM);
+}
+
+void Gauges::drawStageGauge(int x, int y, int r, int32_t stageHundredths, int32_t fullScaleHundredths, uint32_t colour) {
+  TRACE_SCOPE("drawStageGauge");
+  int thickness = r / 4;
+  int32_t clamped = stageHundredths < 0 ? 0 : stageHundredths;
+  if (clamped > fullScaleHundredths) clamped = fullScaleHundredths;
+  int filled = fullScaleHundredths > 0 ? clamped * STAGE_GAUGE_SWEEP / fullScaleHundredths : 0;
+
+  // Both parts are drawn every time so an old reading never shows through
+  fillArc(x, y, STAGE_GAUGE_START, filled, r - thickness, r, colour);
+  fillArc(x, y, STAGE_GAUGE_START + filled, STAGE_GAUGE_SWEEP - filled, r - thickness, r, GAUGE_TRACK_COLOUR);
+
+  TextStack<12> text;
+  if (stageHundredths < 0) {
+    text.add('-');
+    stageHundredths = -stageHundredths;
+  }
+  text.unum(stageHundredths / 100).add('.').unum(stageHundredths % 100, 2, '0');
+  this->tft->setTextDatum(MC_DATUM);
+  this->tft->setTextPadding(2 * (r - thickness) - 4);
+  this->tft->setTextColor(TFT_WHITE, TFT_BLACK);
+  this->tft->drawString(text.c_str(), x, y, 2);
+  this->tft->setTextPadding(0);
+  this->tft->setTextDatum(TL_DATUM);
+}
+
+
+/***************************************************************************************
+**                          Benchmark
+***************************************************************************************/
+// The segment fillSegment drew before the tables, kept only to compare against
+#define DEG2RAD 0.0174532925
+#define INC 2
+static void fillSegmentDouble(TracedTFT* tft, int x, int y, int start_angle, int sub_angle, int r, unsigned int colour)
+{
+  float sx = cos((start_angle - 90) * DEG2RAD);
+  float sy = sin((start_angle - 90) * DEG2RAD);
+  uint16_t x1 = sx * r + x;
+  uint16_t y1 = sy * r + y;
+  for (int i = start_angle; i < start_angle + sub_angle; i += INC) {
+    int x2 = cos((i + 1 - 90) * DEG2RAD) * r + x;
+    int y2 = sin((i + 1 - 90) * DEG2RAD) * r + y;
+    tft->fillTriangle(x1, y1, x2, y2, x, y, colour);
+    x1 = x2;
+    y1 = y2;
+  }
+}
+
+// Draws over whatever is at x, y, redraw the page afterwards
+void Gauges::benchmark(Print& out, int x, int y, int r) {
+  const int rounds = 10;
+  uint32_t start = micros();
+  for (int i = 0; i < rounds; i++) {
+    fillSegmentDouble(this->tft, x, y, 0, 360, r, i & 1 ? TFT_BLUE : TFT_BLACK);
+  }
+  uint32_t doubleUs = (micros() - start) / rounds;
+
+  start = micros();
+  for (int i = 0; i < rounds; i++) {
+    fillSegment(x, y, 0, 360, r, i & 1 ? TFT_BLUE : TFT_BLACK);
+  }
+  uint32_t fixedUs = (micros() - start) / rounds;
+
+  start = micros();
+  for (int i = 0; i < rounds; i++) {
+    drawStageGauge(x, y, r, i * 80, 800, TFT_GREEN);
+  }
+  uint32_t stageUs = (micros() - start) / rounds;
+
+  start = micros();
+  for (int i = 0; i < rounds; i++) {
+    drawWindRose(x, y, r, i * 36, i, TFT_ORANGE);
+  }
+  uint32_t roseUs = (micros() - start) / rounds;
+
+  out.printf("Full circle r=%d in %d degree steps: double %u us, fixed %u us\n", r, INC, doubleUs, fixedUs);
+  out.printf("Stage gauge %u us, wind rose %u us\n", stageUs, roseUs);
+}
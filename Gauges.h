@@ -0,0 +1,39 @@
+#ifndef _RIVER_WEATHER_GAUGES_H_FILE
+#define _RIVER_WEATHER_GAUGES_H_FILE
+
+#include "TracedTFT.h"
+
+/*
+ * Round gauges drawn from the FixedTrig tables with integer arithmetic only.
+ * Angles are whole degrees, clockwise from 12 o'clock. Arcs are built as
+ * triangle fans with a vertex every GAUGE_ARC_STEP degrees.
+ */
+
+#define GAUGE_ARC_STEP 2
+
+#define STAGE_GAUGE_SWEEP  270   // degrees of dial, gap at the bottom
+#define STAGE_GAUGE_START  225   // where zero sits (7:30)
+
+class Gauges {
+  public:
+    Gauges(TracedTFT* tft);
+
+    // Pie slice from startAngle spanning subAngle degrees
+    void fillSegment(int x, int y, int startAngle, int subAngle, int r, uint32_t colour);
+    // Ring slice between radii inner and outer
+    void fillArc(int x, int y, int startAngle, int subAngle, int inner, int outer, uint32_t colour);
+
+    // Compass ring with an arrow pointing where the wind blows from and the speed in the middle
+    void drawWindRose(int x, int y, int r, uint16_t bearing, uint16_t speed, uint32_t colour);
+
+    // Dial filled from 0 to stage out of fullScale, both in hundredths of a foot
+    void drawStageGauge(int x, int y, int r, int32_t stageHundredths, int32_t fullScaleHundredths, uint32_t colour);
+
+    // Times the integer segment against the double precision one it replaced
+    void benchmark(Print& out, int x, int y, int r);
+
+  private:
+    TracedTFT* tft;
+};
+
+#endif
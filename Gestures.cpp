@@ -0,0 +1,66 @@
+#include "Gestures.h"
+#include <stdlib.h>
+
+void GestureRecognizer::update(bool touched, uint16_t x, uint16_t y, uint32_t nowMs) {
+  if (touched) {
+    if (!this->inContact) {
+      this->inContact = true;
+      this->longPressSent = false;
+      this->startX = x;
+      this->startY = y;
+      this->downMs = nowMs;
+    }
+    this->lastX = x;
+    this->lastY = y;
+    this->lastTouchMs = nowMs;
+
+    // A long press fires while the finger is still down, as long as it has not wandered off into a swipe
+    if (!this->longPressSent && (nowMs - this->downMs) >= GESTURE_LONG_PRESS_MS) {
+      int dx = (int)this->lastX - (int)this->startX;
+      int dy = (int)this->lastY - (int)this->startY;
+      if (abs(dx) < GESTURE_SWIPE_MIN_PX && abs(dy) < GESTURE_SWIPE_MIN_PX) {
+        emit(GESTURE_LONG_PRESS, nowMs);
+        this->longPressSent = true;
+      }
+    }
+    return;
+  }
+
+  // Ignore short lifts so a flaky contact does not end the gesture early
+  if (this->inContact && (nowMs - this->lastTouchMs) >= GESTURE_RELEASE_MS) {
+    finishContact();
+  }
+}
+
+void GestureRecognizer::finishContact() {
+  this->inContact = false;
+  if (this->longPressSent) {
+    return;
+  }
+  if ((this->lastTouchMs - this->downMs) < GESTURE_DEBOUNCE_MS) {
+    return;
+  }
+
+  int dx = (int)this->lastX - (int)this->startX;
+  int dy = (int)this->lastY - (int)this->startY;
+  if (abs(dx) >= GESTURE_SWIPE_MIN_PX || abs(dy) >= GESTURE_SWIPE_MIN_PX) {
+    if (abs(dx) >= abs(dy)) {
+      emit(dx < 0 ? GESTURE_SWIPE_LEFT : GESTURE_SWIPE_RIGHT, this->lastTouchMs);
+    } else {
+      emit(dy < 0 ? GESTURE_SWIPE_UP : GESTURE_SWIPE_DOWN, this->lastTouchMs);
+    }
+  } else {
+    emit(GESTURE_TAP, this->lastTouchMs);
+  }
+}
+
+void GestureRecognizer::emit(uint8_t type, uint32_t endMs) {
+  GestureEvent ev;
+  ev.type = type;
+  ev.xPos = this->startX;
+  ev.yPos = this->startY;
+  ev.dx = (int16_t)((int)this->lastX - (int)this->startX);
+  ev.dy = (int16_t)((int)this->lastY - (int)this->startY);
+  ev.durationMs = (uint16_t)(endMs - this->downMs);
+  this->queue->push(ev);
+}
@@ -0,0 +1,64 @@
+#ifndef _RIVER_WEATHER_GESTURES_H_FILE
+#define _RIVER_WEATHER_GESTURES_H_FILE
+
+#include <stdint.h>
+#include "SpscQueue.h"
+
+#define GESTURE_DEBOUNCE_MS     30  // contacts shorter than this are treated as noise
+#define GESTURE_RELEASE_MS      40  // the finger must be up this long before a contact ends
+#define GESTURE_LONG_PRESS_MS  700
+#define GESTURE_SWIPE_MIN_PX    40
+#define GESTURE_QUEUE_SIZE       8
+
+typedef enum {
+  GESTURE_NONE = 0,
+  GESTURE_TAP,
+  GESTURE_LONG_PRESS,
+  GESTURE_SWIPE_LEFT,
+  GESTURE_SWIPE_RIGHT,
+  GESTURE_SWIPE_UP,
+  GESTURE_SWIPE_DOWN
+} GestureType;
+
+typedef struct GestureEvent {
+  uint8_t  type;
+  uint16_t xPos;        // where the contact started
+  uint16_t yPos;
+  int16_t  dx;          // total travel over the contact
+  int16_t  dy;
+  uint16_t durationMs;
+} GestureEvent;
+
+typedef SpscQueue<GestureEvent, GESTURE_QUEUE_SIZE> GestureQueue;
+
+/*
+ * Turns a stream of raw touch samples into discrete gestures.
+ * Feed it every sample read from the panel (touched or not) with a millisecond
+ * timestamp; each completed contact produces at most one event on the queue.
+ * It has no hardware dependencies so it can be driven from recorded traces.
+ */
+class GestureRecognizer {
+  public:
+    GestureRecognizer(GestureQueue* queue) : queue(queue) {}
+
+    void update(bool touched, uint16_t x, uint16_t y, uint32_t nowMs);
+
+    // True while a contact is in progress (including the release debounce)
+    bool active() const { return this->inContact; }
+
+  private:
+    void finishContact();
+    void emit(uint8_t type, uint32_t endMs);
+
+    GestureQueue* queue;
+    bool     inContact = false;
+    bool     longPressSent = false;
+    uint16_t startX = 0;
+    uint16_t startY = 0;
+    uint16_t lastX = 0;
+    uint16_t lastY = 0;
+    uint32_t downMs = 0;
+    uint32_t lastTouchMs = 0;
+};
+
+#endif
@@ -23,12 +23,14 @@ See more at http://blog.squix.ch
 // drawBMP() updated to buffer input and output pixels and avoid slow seeks
 
 #include "GfxUi.h"
+#include "RenderTrace.h"
 
 GfxUi::GfxUi(TFT_eSPI *tft) {
   _tft = tft;
 }
 
 void GfxUi::drawProgressBar(uint16_t x0, uint16_t y0, uint16_t w, uint16_t h, uint8_t percentage, uint16_t frameColor, uint16_t barColor) {
+  TRACE_SCOPE("drawProgressBar");
   if (percentage == 0) {
     _tft->fillRoundRect(x0, y0, w, h, 3, TFT_BLACK);
   }
@@ -40,11 +42,12 @@ void GfxUi::drawProgressBar(uint16_t x0, uint16_t y0, uint16_t w, uint16_t h, ui
 }
 
 // Bodmer's streamlined x2 faster "no seek" version
-void GfxUi::drawBmp(String filename, uint16_t x, uint16_t y)
+void GfxUi::drawBmp(const char* filename, uint16_t x, uint16_t y)
 {
 
   if ((x >= _tft->width()) || (y >= _tft->height())) return;
 
+  TRACE_SPAN(span, "drawBmp");
   fs::File bmpFS;
 
   // Check file exists and open it
@@ -76,6 +79,7 @@ void GfxUi::drawBmp(String filename, uint16_t x, uint16_t y)
     if ((read16(bmpFS) == 1) && (read16(bmpFS) == 24) && (read32(bmpFS) == 0))
     {
       y += h - 1;
+      TRACE_ADD_PIXELS(span, (uint32_t)w * h);
 
       _tft->setSwapBytes(true);
       bmpFS.seek(seekOffset);
@@ -142,7 +146,8 @@ uint32_t GfxUi::read32(fs::File &f) {
 //====================================================================================
 //   Opens the image file and prime the Jpeg decoder
 //====================================================================================
-void GfxUi::drawJpeg(String filename, int xpos, int ypos) {
+void GfxUi::drawJpeg(const char* filename, int xpos, int ypos) {
+  TRACE_SCOPE("drawJpeg");
 
   Serial.println("===========================");
   Serial.print("Drawing file: "); Serial.println(filename);
@@ -160,7 +165,11 @@ void GfxUi::drawJpeg(String filename, int xpos, int ypos) {
   // Use one of the three following methods to initialise the decoder:
   //boolean decoded = JpegDec.decodeFsFile(jpegFile); // Pass a SPIFFS file handle to the decoder,
   //boolean decoded = JpegDec.decodeSdFile(jpegFile); // or pass the SD file handle to the decoder,
-  boolean decoded = JpegDec.decodeFsFile(filename);  // or pass the filename (leading / distinguishes SPIFFS files)
+  boolean decoded;
+  {
+    TRACE_SCOPE("jpegDecodeOpen");
+    decoded = JpegDec.decodeFsFile(filename);  // or pass the filename (leading / distinguishes SPIFFS files)
+  }
                                    // Note: the filename can be a String or character array type
   if (decoded) {
     // print information about the image to the serial port
@@ -198,6 +207,7 @@ void GfxUi::jpegRender(int xpos, int ypos) {
 
   // record the current time so we can measure how long it takes to draw an image
   uint32_t drawTime = millis();
+  TRACE_SPAN(span, "jpegRender");
 
   // save the coordinate of the right and bottom edges to assist image cropping
   // to the screen size
@@ -246,6 +256,7 @@ void GfxUi::jpegRender(int xpos, int ypos) {
     if ( ( mcu_x + win_w) <= _tft->width() && ( mcu_y + win_h) <= _tft->height())
     {
       _tft->pushImage(mcu_x, mcu_y, win_w, win_h, pImg);
+      TRACE_ADD_PIXELS(span, win_w * win_h);
     }
 
     else if ( ( mcu_y + win_h) >= _tft->height()) JpegDec.abort();
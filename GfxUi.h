@@ -42,10 +42,10 @@ See more at http://blog.squix.ch
 class GfxUi {
   public:
     GfxUi(TFT_eSPI * tft);
-    void drawBmp(String filename, uint16_t x, uint16_t y);
+    void drawBmp(const char* filename, uint16_t x, uint16_t y);
     void drawProgressBar(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t percentage, uint16_t frameColor, uint16_t barColor);
     void jpegInfo();
-    void drawJpeg(String filename, int xpos, int ypos);
+    void drawJpeg(const char* filename, int xpos, int ypos);
     void jpegRender(int xpos, int ypos);
     
   private:
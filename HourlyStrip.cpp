@@ -0,0 +1,124 @@
+#include "HourlyStrip.h"
+#include "FixedTrig.h"
+#include "RenderTrace.h"
+#include "TextFormat.h"
+
+static_assert(HOURLY_STRIP_LABEL_W + WEATHER_HOURS * HOURLY_STRIP_HOUR_W <= HOURLY_STRIP_WIDTH, "48 hours must fit the strip");
+
+#define HOURLY_STRIP_RULE_COLOUR 0x4228   // same grey as the separators
+#define HOURLY_STRIP_RAIN_COLOUR 0x2A7F
+#define HOURLY_STRIP_ARROW_R        4
+
+HourlyStrip::HourlyStrip(TracedTFT* tft) : sprite(tft) {
+  this->tft = tft;
+}
+
+void HourlyStrip::draw(const WeatherModel* weather, uint32_t generation, int32_t x, int32_t y) {
+  TRACE_SCOPE("hourlyStrip");
+  if (!this->spriteTried) {
+    // Created once and kept, a strip that comes and goes would fragment the heap
+    this->spriteTried = true;
+    this->sprite.setColorDepth(8);
+    if (!this->sprite.createSprite(HOURLY_STRIP_WIDTH, HOURLY_STRIP_HEIGHT)) {
+      Serial.println("HourlyStrip: no room for the sprite, drawing direct");
+    }
+  }
+  if (!this->sprite.created()) {
+    render(this->tft, weather, x, y);
+    return;
+  }
+  if (!this->rendered || generation != this->generation) {
+    render(&this->sprite, weather, 0, 0);
+    this->generation = generation;
+    this->rendered = true;
+  }
+  this->sprite.pushSprite(x, y);
+}
+
+uint32_t HourlyStrip::conditionColour(uint8_t code) {
+  uint16_t id = weatherConditionId(code);
+  switch (id / 100) {
+    case 2: return TFT_MAGENTA;
+    case 3: return 0x5D9F;            // drizzle, light blue
+    case 5: return TFT_BLUE;
+    case 6: return TFT_WHITE;
+    case 7: return TFT_DARKGREY;      // mist, haze, dust
+    case 8:
+      if (id == 800) return TFT_YELLOW;
+      if (id <= 802) return 0xC618;   // few or scattered clouds
+      return TFT_LIGHTGREY;
+  }
+  return TFT_BLACK;
+}
+
+template <typename Surface>
+void HourlyStrip::render(Surface* g, const WeatherModel* weather, int32_t x, int32_t y) {
+  const WeatherHours* h = &weather->hours;
+  g->fillRect(x, y, HOURLY_STRIP_WIDTH, HOURLY_STRIP_HEIGHT, TFT_BLACK);
+  if (!weather->valid || !h->count) {
+    return;
+  }
+
+  int8_t low = h->temperature[0];
+  int8_t high = h->temperature[0];
+  uint8_t windScale = HOURLY_STRIP_WIND_MIN;
+  for (int i = 0; i < h->count; i++) {
+    low = min(low, h->temperature[i]);
+    high = max(high, h->temperature[i]);
+    windScale = max(windScale, h->windSpeed[i]);
+  }
+  int32_t span = high > low ? high - low : 1;
+
+  int32_t left = x + HOURLY_STRIP_LABEL_W;
+  int32_t top = y + HOURLY_STRIP_BAND_H + 2;
+  int32_t bottom = y + HOURLY_STRIP_HEIGHT - 1;
+  int32_t plot = bottom - top;
+
+  g->setTextDatum(TL_DATUM);
+  g->setTextPadding(0);
+  g->setTextColor(TFT_WHITE, TFT_BLACK);
+  TextStack<8> label;
+  g->drawString(label.num(high).c_str(), x + 2, top, 1);
+  g->drawString(label.clear().num(low).c_str(), x + 2, bottom - 7, 1);
+
+  // Bands, bars and midnights first so the lines go over them
+  for (int i = 0; i < h->count; i++) {
+    int32_t cx = left + i * HOURLY_STRIP_HOUR_W;
+    g->fillRect(cx, y, HOURLY_STRIP_HOUR_W, HOURLY_STRIP_BAND_H, conditionColour(h->condition[i]));
+    int32_t rain = h->pop[i] * plot / 100;
+    if (rain) {
+      g->fillRect(cx + 1, bottom - rain + 1, HOURLY_STRIP_HOUR_W - 2, rain, HOURLY_STRIP_RAIN_COLOUR);
+    }
+    int32_t local = (int32_t)(h->start + i * 3600UL) + weather->timezoneOffset;
+    if (i && local % 86400 == 0) {
+      g->drawFastVLine(cx, top, plot + 1, HOURLY_STRIP_RULE_COLOUR);
+    }
+  }
+
+  int32_t mid = left + HOURLY_STRIP_HOUR_W / 2;
+  int32_t lastTemp = 0;
+  int32_t lastWind = 0;
+  for (int i = 0; i < h->count; i++) {
+    int32_t cx = mid + i * HOURLY_STRIP_HOUR_W;
+    int32_t temp = bottom - (h->temperature[i] - low) * plot / span;
+    int32_t wind = bottom - h->windSpeed[i] * plot / windScale;
+    if (i) {
+      g->drawLine(cx - HOURLY_STRIP_HOUR_W, lastWind, cx, wind, TFT_ORANGE);
+      g->drawLine(cx - HOURLY_STRIP_HOUR_W, lastTemp, cx, temp, TFT_WHITE);
+    }
+    lastTemp = temp;
+    lastWind = wind;
+  }
+
+  // Arrows point where the wind is going, on the wind line
+  for (int i = HOURLY_STRIP_ARROW_HOURS / 2; i < h->count; i += HOURLY_STRIP_ARROW_HOURS) {
+    int32_t cx = mid + i * HOURLY_STRIP_HOUR_W;
+    int32_t cy = bottom - h->windSpeed[i] * plot / windScale;
+    int heading = h->windSector[i] * 45 / 2 + 180;
+    int32_t tipX = cx + polarX(HOURLY_STRIP_ARROW_R, heading);
+    int32_t tipY = cy + polarY(HOURLY_STRIP_ARROW_R, heading);
+    g->drawLine(cx - polarX(HOURLY_STRIP_ARROW_R, heading), cy - polarY(HOURLY_STRIP_ARROW_R, heading), tipX, tipY, TFT_ORANGE);
+    g->drawLine(tipX, tipY, tipX - polarX(3, heading - 35), tipY - polarY(3, heading - 35), TFT_ORANGE);
+    g->drawLine(tipX, tipY, tipX - polarX(3, heading + 35), tipY - polarY(3, heading + 35), TFT_ORANGE);
+  }
+}
@@ -0,0 +1,50 @@
+#ifndef _RIVER_WEATHER_HOURLY_STRIP_H_FILE
+#define _RIVER_WEATHER_HOURLY_STRIP_H_FILE
+
+#include "TracedTFT.h"
+#include "OneCall.h"
+
+/*
+ * The next 48 hours under the daily forecast, one column per hour:
+ *
+ *   condition  a band of colour along the top, yellow for clear through grey
+ *              cloud to blue rain, white snow and magenta thunder
+ *   rain       blue bars up from the bottom, the chance of precipitation
+ *   wind       orange line with an arrow every HOURLY_STRIP_ARROW_HOURS
+ *   temperature white line, scaled between the coldest and warmest hour
+ *
+ * Midnights are marked by a grey rule. The strip is rendered into an 8 bit
+ * sprite only when the weather generation changes, every other draw is a
+ * single push. Without the RAM for the sprite it is drawn straight to the
+ * panel instead.
+ */
+
+#define HOURLY_STRIP_WIDTH   320
+#define HOURLY_STRIP_HEIGHT   36
+#define HOURLY_STRIP_LABEL_W  32   // column on the left for the temperature range
+#define HOURLY_STRIP_HOUR_W    6   // 48 hours in 288 pixels
+#define HOURLY_STRIP_BAND_H    4
+#define HOURLY_STRIP_ARROW_HOURS 6
+#define HOURLY_STRIP_WIND_MIN 20   // full scale of the wind line, in half units, before stronger wind widens it
+
+class HourlyStrip {
+  public:
+    HourlyStrip(TracedTFT* tft);
+
+    // generation is the weather's publish count, the sprite is re-rendered when it moves
+    void draw(const WeatherModel* weather, uint32_t generation, int32_t x, int32_t y);
+
+  private:
+    // Onto the sprite, or straight to the panel through the traced primitives
+    template <typename Surface>
+    void render(Surface* g, const WeatherModel* weather, int32_t x, int32_t y);
+    static uint32_t conditionColour(uint8_t code);
+
+    TracedTFT*  tft;
+    TFT_eSprite sprite;
+    bool        spriteTried = false;
+    bool        rendered = false;
+    uint32_t    generation = 0;
+};
+
+#endif
@@ -0,0 +1,163 @@
+#include "HydrographView.h"
+#include "RenderTrace.h"
+#include "TextFormat.h"
+#include "utils.h"
+
+// Rows must tile the region exactly so a row never wraps around the ring
+static_assert(HYDROGRAPH_VIEW_HEIGHT % HYDROGRAPH_ROW_HEIGHT == 0, "scroll region must hold whole rows");
+
+HydrographView::HydrographView(TracedTFT* tft, Hydrograph* source, SmoothFont* font) {
+  this->tft = tft;
+  this->source = source;
+  this->font = font;
+}
+
+int32_t HydrographView::maxOffset() const {
+  int32_t height = this->rowCount * HYDROGRAPH_ROW_HEIGHT - HYDROGRAPH_VIEW_HEIGHT;
+  return height > 0 ? height : 0;
+}
+
+void HydrographView::draw() {
+  TRACE_SCOPE("hydrographView");
+  const HydrographModel* model = this->source->model();
+  if (this->source->generation() != this->generation) {
+    this->generation = this->source->generation();
+    memset(this->formatted, 0, sizeof(this->formatted));
+  }
+  this->rowCount = max(model->last_observed, model->last_forecast);
+
+  // A new model keeps the scroll position if it still has that many rows
+  this->target = constrain(this->target, 0, maxOffset());
+  this->offset = this->target;
+  defineScrollArea();
+  drawLines(this->offset, this->offset + HYDROGRAPH_VIEW_HEIGHT);
+  setScrollStart();
+}
+
+bool HydrographView::scrollBy(int16_t px) {
+  // Settle on a row boundary so the rows line up with the header
+  int32_t target = this->target + px;
+  target = (target + HYDROGRAPH_ROW_HEIGHT / 2) / HYDROGRAPH_ROW_HEIGHT * HYDROGRAPH_ROW_HEIGHT;
+  this->target = constrain(target, 0, maxOffset());
+  return this->target != this->offset;
+}
+
+bool HydrographView::step() {
+  if (this->offset == this->target) {
+    return false;
+  }
+  TRACE_SCOPE("hydrographScroll");
+  if (!this->font->inUse()) {
+    this->font->use();
+    this->fontHeld = true;
+  }
+
+  int32_t move = (this->target - this->offset) / HYDROGRAPH_VIEW_EASE;
+  if (!move) {
+    move = this->target > this->offset ? 1 : -1;
+  }
+  int32_t next = this->offset + move;
+
+  // Draw only the lines that scroll in, then move the start line over them
+  if (move > 0) {
+    drawLines(max(this->offset + HYDROGRAPH_VIEW_HEIGHT, next), next + HYDROGRAPH_VIEW_HEIGHT);
+  } else {
+    drawLines(next, min(this->offset, next + HYDROGRAPH_VIEW_HEIGHT));
+  }
+  this->offset = next;
+  setScrollStart();
+
+  if (this->offset != this->target) {
+    return true;
+  }
+  if (this->fontHeld) {
+    this->font->release();
+    this->fontHeld = false;
+  }
+  return false;
+}
+
+void HydrographView::reset() {
+  this->offset = 0;
+  this->target = 0;
+  setScrollStart();
+  if (this->fontHeld) {
+    this->font->release();
+    this->fontHeld = false;
+  }
+}
+
+void HydrographView::formatRow(int row) {
+  const HydrographModel* model = this->source->model();
+  RowText* text = &this->rows[row];
+  memset(text, 0, sizeof(RowText));
+  if (row < model->last_observed) {
+    const RiverStatus* rs = &model->observed_array[row];
+    TextBuf time(text->observedTime, sizeof(text->observedTime));
+    strLocalDateTime(rs->time, time);
+    TextBuf(text->observedStage, sizeof(text->observedStage)).fixed(rs->stage, 2);
+  }
+  if (row < model->last_forecast) {
+    const RiverStatus* rs = &model->forecast_array[row];
+    TextBuf time(text->forecastTime, sizeof(text->forecastTime));
+    strLocalDateTime(rs->time, time);
+    TextBuf(text->forecastStage, sizeof(text->forecastStage)).fixed(rs->stage, 2);
+  }
+  this->formatted[row] = true;
+}
+
+// Content lines [from, to), content line 0 being the top of the first row
+void HydrographView::drawLines(int32_t from, int32_t to) {
+  int32_t y = from;
+  while (y < to) {
+    int row = y / HYDROGRAPH_ROW_HEIGHT;
+    int32_t rowEnd = (row + 1) * HYDROGRAPH_ROW_HEIGHT;
+    int32_t end = min(to, rowEnd);
+    drawRowPart(row, y - row * HYDROGRAPH_ROW_HEIGHT, end - y);
+    y = end;
+  }
+}
+
+// Draws lines [top, top + lines) of a row into its slot of the ring, clipped
+// so the rest of the slot (still on screen) is left alone
+void HydrographView::drawRowPart(int row, int32_t top, int32_t lines) {
+  int32_t rowY = HYDROGRAPH_VIEW_TOP + (row * HYDROGRAPH_ROW_HEIGHT) % HYDROGRAPH_VIEW_HEIGHT;
+  int32_t width = this->tft->width();
+  this->tft->setViewport(0, rowY + top, width, lines, false);
+  this->tft->fillRect(0, rowY + top, width, lines, TFT_BLACK);
+
+  if (row < this->rowCount) {
+    if (!this->formatted[row]) {
+      formatRow(row);
+    }
+    const RowText* text = &this->rows[row];
+    this->tft->setTextDatum(TR_DATUM);
+    this->tft->setTextPadding(0);
+    this->tft->setTextColor(TFT_YELLOW, TFT_BLACK);
+    this->tft->drawString(text->observedTime, 100, rowY);
+    this->tft->drawString(text->forecastTime, 270, rowY);
+    this->tft->setTextColor(TFT_WHITE, TFT_BLACK);
+    this->tft->drawString(text->observedStage, 150, rowY);
+    this->tft->drawString(text->forecastStage, 305, rowY);
+  }
+  this->tft->resetViewport();
+}
+
+// Fixed area above, the table, fixed area below (rows in panel memory order)
+void HydrographView::defineScrollArea() {
+  uint16_t bottom = this->tft->height() - HYDROGRAPH_VIEW_TOP - HYDROGRAPH_VIEW_HEIGHT;
+  this->tft->writecommand(ST7796_VSCRDEF);
+  this->tft->writedata(HYDROGRAPH_VIEW_TOP >> 8);
+  this->tft->writedata(HYDROGRAPH_VIEW_TOP & 0xFF);
+  this->tft->writedata(HYDROGRAPH_VIEW_HEIGHT >> 8);
+  this->tft->writedata(HYDROGRAPH_VIEW_HEIGHT & 0xFF);
+  this->tft->writedata(bottom >> 8);
+  this->tft->writedata(bottom & 0xFF);
+}
+
+void HydrographView::setScrollStart() {
+  uint16_t line = scrollStart();
+  this->tft->writecommand(ST7796_VSCSAD);
+  this->tft->writedata(line >> 8);
+  this->tft->writedata(line & 0xFF);
+}
@@ -0,0 +1,77 @@
+#ifndef _RIVER_WEATHER_HYDROGRAPH_VIEW_H_FILE
+#define _RIVER_WEATHER_HYDROGRAPH_VIEW_H_FILE
+
+#include "TracedTFT.h"
+#include "hydrograph.h"
+#include "SmoothFont.h"
+
+/*
+ * Scrolling table of the observed and forecast stages, one row per index
+ * with the observation on the left and the forecast on the right.
+ *
+ * The table area is the ST7796's vertical scroll region. Panel memory for the
+ * region works as a ring of rows: scrolling moves the start line and only the
+ * lines that come into view are drawn, the rest of the table is already on
+ * the panel. Row text is formatted the first time a row is drawn and kept
+ * until the hydrograph publishes a new model.
+ */
+
+#define HYDROGRAPH_VIEW_TOP       300   // first screen line of the scroll region
+#define HYDROGRAPH_VIEW_HEIGHT    160   // 8 rows
+#define HYDROGRAPH_ROW_HEIGHT      20
+#define HYDROGRAPH_VIEW_FRAME_MS   33   // animation frame interval while scrolling
+#define HYDROGRAPH_VIEW_EASE        3   // each frame moves 1/EASE of the remaining distance
+
+// ST7796 vertical scrolling commands
+#define ST7796_VSCRDEF 0x33
+#define ST7796_VSCSAD  0x37
+
+class HydrographView {
+  public:
+    HydrographView(TracedTFT* tft, Hydrograph* source, SmoothFont* font);
+
+    // Redraws every visible row, call with the smooth font in use
+    void draw();
+
+    // Starts a scroll by px (positive shows later rows), false if there is nowhere to go
+    bool scrollBy(int16_t px);
+
+    // One animation frame, false once the table has stopped
+    bool step();
+
+    // Back to the first row with the panel unscrolled, before another page draws here
+    void reset();
+
+    // The panel memory line shown at the top of the region (HYDROGRAPH_VIEW_TOP when unscrolled)
+    uint16_t scrollStart() const { return HYDROGRAPH_VIEW_TOP + this->offset % HYDROGRAPH_VIEW_HEIGHT; }
+
+  private:
+    typedef struct RowText {
+      char observedTime[12];
+      char observedStage[8];
+      char forecastTime[12];
+      char forecastStage[8];
+    } RowText;
+
+    void formatRow(int row);
+    void drawLines(int32_t from, int32_t to);
+    void drawRowPart(int row, int32_t top, int32_t lines);
+    void defineScrollArea();
+    void setScrollStart();
+    int32_t maxOffset() const;
+
+    TracedTFT*  tft;
+    Hydrograph* source;
+    SmoothFont* font;
+
+    RowText  rows[HYDROGRAPH_COUNT_MAX];
+    bool     formatted[HYDROGRAPH_COUNT_MAX] = {};
+    uint32_t generation = 0;
+    int      rowCount = 0;
+
+    int32_t  offset = 0;       // content line shown at the top of the region
+    int32_t  target = 0;
+    bool     fontHeld = false; // the animation switched to the smooth font and has to switch back
+};
+
+#endif
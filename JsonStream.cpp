@@ -0,0 +1,251 @@
+#include "JsonStream.h"
+#include <string.h>
+
+JsonStream::JsonStream(const JsonPathField* fields, uint8_t fieldCount, JsonValueCallback callback, void* ctx) {
+  this->fields = fields;
+  this->fieldCount = fieldCount;
+  this->callback = callback;
+  this->ctx = ctx;
+  reset();
+}
+
+void JsonStream::reset() {
+  this->depth = 0;
+  this->path[0] = '\0';
+  this->pathLen = 0;
+  this->pathValid = true;
+  this->skipNest = 0;
+  this->inString = false;
+  this->stringIsKey = false;
+  this->escape = false;
+  this->hexSkip = 0;
+  this->inLiteral = false;
+  this->expectKey = false;
+  this->valueField = -1;
+  this->textLen = 0;
+  this->textOverflow = false;
+  this->finished = false;
+  this->error = false;
+}
+
+void JsonStream::feed(const char* data, size_t len) {
+  for (size_t i = 0; i < len && !this->finished && !this->error; i++) {
+    processChar(data[i]);
+  }
+}
+
+uint16_t JsonStream::arrayIndex(uint8_t n) const {
+  for (uint8_t i = 0; i < this->depth; i++) {
+    if (this->stack[i].isArray) {
+      if (!n) return this->stack[i].index;
+      n--;
+    }
+  }
+  return 0;
+}
+
+/***************************************************************************************
+**                          Path whitelist
+***************************************************************************************/
+bool JsonStream::appendPath(const char* s) {
+  size_t n = strlen(s);
+  if (this->pathLen + n >= sizeof(this->path)) {
+    return false;
+  }
+  memcpy(this->path + this->pathLen, s, n + 1);
+  this->pathLen += n;
+  return true;
+}
+
+// Could a whitelisted value live somewhere below the current path?
+bool JsonStream::isPrefixOfField() const {
+  if (!this->pathValid) return false;
+  if (!this->pathLen) return true;
+  for (uint8_t i = 0; i < this->fieldCount; i++) {
+    const char* p = this->fields[i].path;
+    if (!strncmp(p, this->path, this->pathLen) && (p[this->pathLen] == '.' || p[this->pathLen] == '[')) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int JsonStream::matchField() const {
+  if (!this->pathValid) return -1;
+  for (uint8_t i = 0; i < this->fieldCount; i++) {
+    if (!strcmp(this->fields[i].path, this->path)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/***************************************************************************************
+**                          Tokenizer
+***************************************************************************************/
+void JsonStream::processChar(char c) {
+  if (this->inString) {
+    if (this->hexSkip) {
+      this->hexSkip--;
+      return;
+    }
+    if (this->escape) {
+      this->escape = false;
+      switch (c) {
+        case 'n': c = '\n'; break;
+        case 't': c = '\t'; break;
+        case 'r': c = '\r'; break;
+        case 'b': c = '\b'; break;
+        case 'f': c = '\f'; break;
+        case 'u': c = '?'; this->hexSkip = 4; break;  // non-ASCII is not needed for any field we keep
+        default: break;                               // \" \\ \/
+      }
+      capture(c);
+      return;
+    }
+    if (c == '\\') {
+      this->escape = true;
+    } else if (c == '"') {
+      this->inString = false;
+      if (this->stringIsKey) {
+        setKey();
+      } else {
+        endScalar(true);
+      }
+    } else {
+      capture(c);
+    }
+    return;
+  }
+
+  if (this->inLiteral) {
+    if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '-' || c == '+' || c == '.') {
+      capture(c);
+      return;
+    }
+    this->inLiteral = false;
+    endScalar(false);
+    if (this->finished) return;
+  }
+
+  switch (c) {
+    case ' ':
+    case '\t':
+    case '\r':
+    case '\n':
+    case ':':
+      return;
+    case '{':
+      openContainer(false);
+      this->expectKey = true;
+      return;
+    case '[':
+      openContainer(true);
+      return;
+    case '}':
+    case ']':
+      closeContainer();
+      return;
+    case ',':
+      if (!this->skipNest && this->depth) {
+        if (this->stack[this->depth - 1].isArray) {
+          this->stack[this->depth - 1].index++;
+        } else {
+          this->expectKey = true;
+        }
+      }
+      return;
+    case '"':
+      this->inString = true;
+      this->escape = false;
+      this->textLen = 0;
+      this->textOverflow = false;
+      this->stringIsKey = !this->skipNest && this->depth && !this->stack[this->depth - 1].isArray && this->expectKey;
+      this->expectKey = false;
+      if (!this->stringIsKey) {
+        beginValue();
+      }
+      return;
+    default:
+      this->inLiteral = true;
+      this->textLen = 0;
+      this->textOverflow = false;
+      beginValue();
+      capture(c);
+      return;
+  }
+}
+
+void JsonStream::capture(char c) {
+  bool wanted = (this->inString && this->stringIsKey) || this->valueField >= 0;
+  if (!wanted) return;
+  if (this->textLen < JSON_STREAM_VALUE_MAX) {
+    this->text[this->textLen++] = c;
+  } else {
+    this->textOverflow = true;
+  }
+}
+
+void JsonStream::beginValue() {
+  this->valueField = this->skipNest ? -1 : matchField();
+}
+
+void JsonStream::setKey() {
+  Level& top = this->stack[this->depth - 1];
+  this->text[this->textLen] = '\0';
+  this->pathLen = top.baseLen;
+  this->path[this->pathLen] = '\0';
+  // A truncated key can not be trusted to match anything
+  this->pathValid = !this->textOverflow && (!this->pathLen || appendPath(".")) && appendPath(this->text);
+}
+
+void JsonStream::endScalar(bool isString) {
+  this->text[this->textLen] = '\0';
+  if (this->valueField >= 0 && this->callback) {
+    this->callback(this->ctx, this->fields[this->valueField].id, *this, this->text, isString);
+  }
+  this->valueField = -1;
+  if (!this->depth && !this->skipNest) {
+    this->finished = true;
+  }
+}
+
+void JsonStream::openContainer(bool isArray) {
+  this->valueField = -1;
+  if (this->skipNest) {
+    this->skipNest++;
+    return;
+  }
+  if (this->depth >= JSON_STREAM_DEPTH_MAX || !isPrefixOfField()) {
+    this->skipNest = 1;
+    return;
+  }
+  Level& level = this->stack[this->depth++];
+  level.isArray = isArray;
+  level.baseLen = this->pathLen;
+  level.index = 0;
+  if (isArray && !appendPath("[]")) {
+    this->pathValid = false;
+  }
+}
+
+void JsonStream::closeContainer() {
+  if (this->skipNest) {
+    this->skipNest--;
+    if (!this->skipNest && !this->depth) {
+      this->finished = true;
+    }
+    return;
+  }
+  if (!this->depth) {
+    this->error = true;
+    return;
+  }
+  this->depth--;
+  this->pathLen = this->stack[this->depth].baseLen;
+  this->path[this->pathLen] = '\0';
+  this->pathValid = true;
+  if (!this->depth) {
+    this->finished = true;
+  }
+}
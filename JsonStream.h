@@ -0,0 +1,92 @@
+#ifndef _RIVER_WEATHER_JSON_STREAM_H_FILE
+#define _RIVER_WEATHER_JSON_STREAM_H_FILE
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Streaming JSON extractor with a path whitelist.
+ *
+ * Paths are dotted keys with [] for array elements, e.g. "daily[].temp.max".
+ * Bytes can be fed in any size of chunk. Only scalar values whose path is in
+ * the whitelist are collected (up to JSON_STREAM_VALUE_MAX characters) and
+ * handed to the callback; any container whose path is not a prefix of a
+ * whitelisted path is skipped by counting brackets, without tracking keys or
+ * values. No heap is used, all state is in the object.
+ */
+
+#define JSON_STREAM_PATH_MAX   48
+#define JSON_STREAM_KEY_MAX    24
+#define JSON_STREAM_VALUE_MAX  32
+#define JSON_STREAM_DEPTH_MAX   8
+
+typedef struct JsonPathField {
+  uint8_t     id;
+  const char* path;
+} JsonPathField;
+
+class JsonStream;
+
+// text is NUL terminated; isString tells "123" from 123
+typedef void (*JsonValueCallback)(void* ctx, uint8_t fieldId, const JsonStream& json, const char* text, bool isString);
+
+class JsonStream {
+  public:
+    JsonStream(const JsonPathField* fields, uint8_t fieldCount, JsonValueCallback callback, void* ctx);
+
+    void reset();
+    void feed(const char* data, size_t len);
+    // True once the top level value is complete
+    bool done() const { return this->finished; }
+    bool failed() const { return this->error; }
+
+    // Element index of the n-th array (outermost first) on the current path
+    uint16_t arrayIndex(uint8_t n) const;
+
+  private:
+    typedef struct Level {
+      uint8_t  isArray;
+      uint8_t  baseLen;   // path length of the container itself
+      uint16_t index;     // element index for arrays
+    } Level;
+
+    void processChar(char c);
+    void openContainer(bool isArray);
+    void closeContainer();
+    void beginValue();
+    void endScalar(bool isString);
+    void setKey();
+    void capture(char c);
+    bool appendPath(const char* s);
+    bool isPrefixOfField() const;
+    int  matchField() const;
+
+    const JsonPathField* fields;
+    uint8_t              fieldCount;
+    JsonValueCallback    callback;
+    void*                ctx;
+
+    Level    stack[JSON_STREAM_DEPTH_MAX];
+    uint8_t  depth;
+    char     path[JSON_STREAM_PATH_MAX];
+    uint8_t  pathLen;
+    bool     pathValid;      // false when a key or the path was too long to track
+
+    uint16_t skipNest;       // open containers inside a skipped subtree
+    bool     inString;
+    bool     stringIsKey;
+    bool     escape;
+    uint8_t  hexSkip;        // remaining digits of a \uXXXX escape
+    bool     inLiteral;
+    bool     expectKey;
+    int16_t  valueField;     // whitelist entry of the value being read, -1 when not captured
+
+    char     text[JSON_STREAM_VALUE_MAX + 1];
+    uint8_t  textLen;
+    bool     textOverflow;
+
+    bool     finished;
+    bool     error;
+};
+
+#endif
@@ -0,0 +1,277 @@
+#include "Metrics.h"
+
+Metrics metrics;
+
+static const char* taskNames[METRIC_TASK_COUNT] = {
+  "fetchUSGS", "fetchHydrograph", "fetchWeather", "updateTime", "displayTime", "gestures", "serial", "scroll",
+  "sampleMetrics", "pollSntp", "modelCache", "peerPush", "screenServer"
+};
+
+static const char* sourceNames[METRIC_SOURCE_COUNT] = {
+  "USGS", "NWS", "OpenWeather", "NTP", "Peer"
+};
+
+static inline void counterMax(Counter& c, uint32_t value) {
+  uint32_t cur = c.load(std::memory_order_relaxed);
+  while (value > cur && !c.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {
+  }
+}
+
+static inline void counterMin(Counter& c, uint32_t value) {
+  uint32_t cur = c.load(std::memory_order_relaxed);
+  while (value < cur && !c.compare_exchange_weak(cur, value, std::memory_order_relaxed)) {
+  }
+}
+
+static inline void counterAdd(Counter& c, uint32_t value) {
+  c.fetch_add(value, std::memory_order_relaxed);
+}
+
+static inline uint32_t counterGet(const Counter& c) {
+  return c.load(std::memory_order_relaxed);
+}
+
+/***************************************************************************************
+**                          Histogram
+***************************************************************************************/
+void Histogram::add(uint32_t value) {
+  uint8_t bucket = 31 - __builtin_clz(value | 1);
+  if (bucket >= METRIC_HIST_BUCKETS) bucket = METRIC_HIST_BUCKETS - 1;
+  counterAdd(buckets[bucket], 1);
+}
+
+uint32_t Histogram::count() const {
+  uint32_t total = 0;
+  for (int i = 0; i < METRIC_HIST_BUCKETS; i++) {
+    total += counterGet(buckets[i]);
+  }
+  return total;
+}
+
+uint32_t Histogram::percentile(uint8_t pct) const {
+  uint32_t total = count();
+  if (!total) return 0;
+  uint32_t target = (total * pct + 99) / 100;
+  uint32_t seen = 0;
+  for (int i = 0; i < METRIC_HIST_BUCKETS; i++) {
+    seen += counterGet(buckets[i]);
+    if (seen >= target) {
+      return (2UL << i) - 1;
+    }
+  }
+  return UINT32_MAX;
+}
+
+void Histogram::reset() {
+  for (int i = 0; i < METRIC_HIST_BUCKETS; i++) {
+    buckets[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+/***************************************************************************************
+**                          Metrics
+***************************************************************************************/
+Metrics::Metrics() {
+  reset();
+}
+
+void Metrics::reset() {
+  for (int i = 0; i < METRIC_TASK_COUNT; i++) {
+    TaskStats& t = tasks[i];
+    t.runs = 0; t.totalUs = 0; t.maxUs = 0;
+    t.lateRuns = 0; t.totalLateMs = 0; t.maxLateMs = 0;
+    t.runUs.reset();
+    t.heapHeldRuns = 0; t.heapHeldBytes = 0; t.maxHeapHeld = 0;
+  }
+  for (int i = 0; i < METRIC_SOURCE_COUNT; i++) {
+    FetchStats& f = fetches[i];
+    f.fetches = 0; f.failures = 0; f.parseErrors = 0;
+    f.bytes = 0; f.totalMs = 0; f.maxMs = 0;
+    f.durationMs.reset();
+    f.maxRefreshMs = 0;
+    f.refreshMs.reset();
+  }
+  radio.windows = 0; radio.onMs = 0; radio.maxWindowMs = 0;
+  heap.freeBytes = 0;
+  heap.minFreeBytes = UINT32_MAX;
+  heap.largestBlock = 0;
+  heap.minLargestBlock = UINT32_MAX;
+  heap.samples = 0;
+  startMs = millis();
+}
+
+void Metrics::recordTaskRun(uint8_t task, uint32_t runUs) {
+  if (task >= METRIC_TASK_COUNT) return;
+  TaskStats& t = tasks[task];
+  counterAdd(t.runs, 1);
+  counterAdd(t.totalUs, runUs);
+  counterMax(t.maxUs, runUs);
+  t.runUs.add(runUs);
+}
+
+void Metrics::recordLateness(uint8_t task, uint32_t lateMs) {
+  if (task >= METRIC_TASK_COUNT || !lateMs) return;
+  TaskStats& t = tasks[task];
+  counterAdd(t.lateRuns, 1);
+  counterAdd(t.totalLateMs, lateMs);
+  counterMax(t.maxLateMs, lateMs);
+}
+
+void Metrics::recordTaskHeap(uint8_t task, uint32_t freeBefore, uint32_t freeAfter) {
+  if (task >= METRIC_TASK_COUNT || freeAfter >= freeBefore) return;
+  TaskStats& t = tasks[task];
+  uint32_t held = freeBefore - freeAfter;
+  counterAdd(t.heapHeldRuns, 1);
+  counterAdd(t.heapHeldBytes, held);
+  counterMax(t.maxHeapHeld, held);
+}
+
+void Metrics::recordFetch(uint8_t source, uint32_t bytes, uint32_t durationMs, bool ok) {
+  if (source >= METRIC_SOURCE_COUNT) return;
+  FetchStats& f = fetches[source];
+  counterAdd(f.fetches, 1);
+  if (!ok) counterAdd(f.failures, 1);
+  counterAdd(f.bytes, bytes);
+  counterAdd(f.totalMs, durationMs);
+  counterMax(f.maxMs, durationMs);
+  f.durationMs.add(durationMs);
+}
+
+void Metrics::recordParseError(uint8_t source) {
+  if (source >= METRIC_SOURCE_COUNT) return;
+  counterAdd(fetches[source].parseErrors, 1);
+}
+
+void Metrics::recordRefresh(uint8_t source, uint32_t msSinceFetch) {
+  if (source >= METRIC_SOURCE_COUNT) return;
+  FetchStats& f = fetches[source];
+  counterMax(f.maxRefreshMs, msSinceFetch);
+  f.refreshMs.add(msSinceFetch);
+}
+
+void Metrics::recordRadioWindow(uint32_t onMs) {
+  counterAdd(radio.windows, 1);
+  counterAdd(radio.onMs, onMs);
+  counterMax(radio.maxWindowMs, onMs);
+}
+
+void Metrics::sampleHeap() {
+  uint32_t freeBytes = ESP.getFreeHeap();
+  uint32_t largest   = ESP.getMaxAllocHeap();
+  heap.freeBytes.store(freeBytes, std::memory_order_relaxed);
+  heap.largestBlock.store(largest, std::memory_order_relaxed);
+  heap.minFreeBytes.store(ESP.getMinFreeHeap(), std::memory_order_relaxed);
+  counterMin(heap.minLargestBlock, largest);
+  counterAdd(heap.samples, 1);
+}
+
+void Metrics::dump(Print& out) {
+  sampleHeap();
+  uint32_t uptimeMs = millis() - startMs;
+  out.printf("=== Metrics, uptime %lus ===\n", (unsigned long)(uptimeMs / 1000));
+  uint32_t freeBytes = counterGet(heap.freeBytes);
+  // How much of the free heap is unusable for one allocation
+  uint32_t fragmentation = freeBytes ? 100 - (uint32_t)((uint64_t)counterGet(heap.largestBlock) * 100 / freeBytes) : 0;
+  out.printf("Heap free %u min %u largest %u min-largest %u fragmented %u%%\n",
+             freeBytes, counterGet(heap.minFreeBytes),
+             counterGet(heap.largestBlock), counterGet(heap.minLargestBlock), fragmentation);
+  uint32_t windows = counterGet(radio.windows);
+  out.printf("Radio on %u s/h in %u windows, avg %u ms max %u ms\n",
+             (uint32_t)((uint64_t)counterGet(radio.onMs) * 3600 / (uptimeMs ? uptimeMs : 1)),
+             windows, windows ? counterGet(radio.onMs) / windows : 0, counterGet(radio.maxWindowMs));
+
+  out.println("Task             runs    avg us    max us   p50 us   p99 us  late  avg late  max late");
+  for (int i = 0; i < METRIC_TASK_COUNT; i++) {
+    TaskStats& t = tasks[i];
+    uint32_t runs = counterGet(t.runs);
+    uint32_t late = counterGet(t.lateRuns);
+    out.printf("%-15s %6u %9u %9u %8u %8u %5u %9u %9u\n", taskNames[i], runs,
+               runs ? counterGet(t.totalUs) / runs : 0, counterGet(t.maxUs),
+               t.runUs.percentile(50), t.runUs.percentile(99),
+               late, late ? counterGet(t.totalLateMs) / late : 0, counterGet(t.maxLateMs));
+  }
+
+  out.println("Task heap        held runs  held bytes  max held");
+  for (int i = 0; i < METRIC_TASK_COUNT; i++) {
+    TaskStats& t = tasks[i];
+    if (!counterGet(t.heapHeldRuns)) continue;
+    out.printf("%-15s %10u %11u %9u\n", taskNames[i], counterGet(t.heapHeldRuns),
+               counterGet(t.heapHeldBytes), counterGet(t.maxHeapHeld));
+  }
+
+  out.println("Source       fetches  fail  parse err     bytes   avg ms   max ms   p90 ms");
+  for (int i = 0; i < METRIC_SOURCE_COUNT; i++) {
+    FetchStats& f = fetches[i];
+    uint32_t n = counterGet(f.fetches);
+    out.printf("%-12s %7u %5u %10u %9u %8u %8u %8u\n", sourceNames[i], n,
+               counterGet(f.failures), counterGet(f.parseErrors), counterGet(f.bytes),
+               n ? counterGet(f.totalMs) / n : 0, counterGet(f.maxMs), f.durationMs.percentile(90));
+  }
+
+  out.println("Refresh        draws   p50 ms   p90 ms   p99 ms   max ms");
+  for (int i = 0; i < METRIC_SOURCE_COUNT; i++) {
+    FetchStats& f = fetches[i];
+    out.printf("%-12s %7u %8u %8u %8u %8u\n", sourceNames[i], f.refreshMs.count(),
+               f.refreshMs.percentile(50), f.refreshMs.percentile(90), f.refreshMs.percentile(99),
+               counterGet(f.maxRefreshMs));
+  }
+}
+
+static void writeU32(Print& out, uint32_t v) {
+  uint8_t b[4] = { (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24) };
+  out.write(b, sizeof(b));
+}
+
+static void writeHistogram(Print& out, const Histogram& h) {
+  for (int i = 0; i < METRIC_HIST_BUCKETS; i++) {
+    writeU32(out, counterGet(h.buckets[i]));
+  }
+}
+
+// Little endian u32 stream: magic "RWM4", uptime ms, task/source/bucket counts,
+// heap (5), radio (3), then per task 6 counters + histogram + 3 heap held
+// counters, per source 6 counters + histogram and the refresh max + histogram
+void Metrics::dumpBinary(Print& out) {
+  sampleHeap();
+  out.write((const uint8_t*)"RWM4", 4);
+  writeU32(out, millis() - startMs);
+  writeU32(out, METRIC_TASK_COUNT);
+  writeU32(out, METRIC_SOURCE_COUNT);
+  writeU32(out, METRIC_HIST_BUCKETS);
+
+  writeU32(out, counterGet(heap.freeBytes));
+  writeU32(out, counterGet(heap.minFreeBytes));
+  writeU32(out, counterGet(heap.largestBlock));
+  writeU32(out, counterGet(heap.minLargestBlock));
+  writeU32(out, counterGet(heap.samples));
+
+  writeU32(out, counterGet(radio.windows));
+  writeU32(out, counterGet(radio.onMs));
+  writeU32(out, counterGet(radio.maxWindowMs));
+
+  for (int i = 0; i < METRIC_TASK_COUNT; i++) {
+    TaskStats& t = tasks[i];
+    writeU32(out, counterGet(t.runs));
+    writeU32(out, counterGet(t.totalUs));
+    writeU32(out, counterGet(t.maxUs));
+    writeU32(out, counterGet(t.lateRuns));
+    writeU32(out, counterGet(t.totalLateMs));
+    writeU32(out, counterGet(t.maxLateMs));
+    writeHistogram(out, t.runUs);
+    writeU32(out, counterGet(t.heapHeldRuns));
+    writeU32(out, counterGet(t.heapHeldBytes));
+    writeU32(out, counterGet(t.maxHeapHeld));
+  }
+  for (int i = 0; i < METRIC_SOURCE_COUNT; i++) {
+    FetchStats& f = fetches[i];
+    writeU32(out, counterGet(f.fetches));
+    writeU32(out, counterGet(f.failures));
+    writeU32(out, counterGet(f.parseErrors));
+    writeU32(out, counterGet(f.bytes));
+    writeU32(out, counterGet(f.totalMs));
+    writeU32(out, counterGet(f.maxMs));
+    writeHistogram(out, f.durationMs);
+    writeU32(out, counterGet(f.maxRefreshMs));
+    writeHistogram(out, f.refreshMs);
+  }
+}
@@ -0,0 +1,142 @@
+#ifndef _RIVER_WEATHER_METRICS_H_FILE
+#define _RIVER_WEATHER_METRICS_H_FILE
+
+#include <Arduino.h>
+#include <atomic>
+
+/*
+ * Fixed size run-time counters for the tasks, fetches and heap.
+ * Everything is a relaxed atomic so the counters can be bumped from any task
+ * without locks, and nothing here allocates. Dump on demand with 'm' (text)
+ * or 'b' (binary) on the serial monitor.
+ */
+
+#define METRIC_HIST_BUCKETS 24   // log2 buckets, bucket i holds values in [2^i, 2^(i+1))
+
+typedef enum {
+  METRIC_TASK_FETCH_USGS = 0,
+  METRIC_TASK_FETCH_HYDROGRAPH,
+  METRIC_TASK_FETCH_WEATHER,
+  METRIC_TASK_UPDATE_TIME,
+  METRIC_TASK_DISPLAY_TIME,
+  METRIC_TASK_GESTURES,
+  METRIC_TASK_SERIAL,
+  METRIC_TASK_SCROLL,
+  METRIC_TASK_SAMPLE_METRICS,
+  METRIC_TASK_POLL_SNTP,
+  METRIC_TASK_MODEL_CACHE,
+  METRIC_TASK_PEER_PUSH,
+  METRIC_TASK_SCREEN_SERVER,
+  METRIC_TASK_COUNT
+} MetricTask;
+
+typedef enum {
+  METRIC_SOURCE_USGS = 0,
+  METRIC_SOURCE_NWS,
+  METRIC_SOURCE_OPENWEATHER,
+  METRIC_SOURCE_NTP,
+  METRIC_SOURCE_PEER,
+  METRIC_SOURCE_COUNT
+} MetricSource;
+
+typedef std::atomic<uint32_t> Counter;
+
+class Histogram {
+  public:
+    void add(uint32_t value);
+    uint32_t count() const;
+    // Upper bound of the bucket holding the given percentile
+    uint32_t percentile(uint8_t pct) const;
+    void reset();
+
+    Counter buckets[METRIC_HIST_BUCKETS];
+};
+
+typedef struct TaskStats {
+  Counter   runs;
+  Counter   totalUs;
+  Counter   maxUs;
+  Counter   lateRuns;     // runs that started after their scheduled time
+  Counter   totalLateMs;
+  Counter   maxLateMs;
+  Histogram runUs;
+  // Runs that ended with less free heap than they started with. Other tasks
+  // (WiFi, touch) allocate too, so one such run means little, a total that
+  // keeps climbing is a leak in the task.
+  Counter   heapHeldRuns;
+  Counter   heapHeldBytes;
+  Counter   maxHeapHeld;
+} TaskStats;
+
+typedef struct FetchStats {
+  Counter   fetches;
+  Counter   failures;
+  Counter   parseErrors;
+  Counter   bytes;
+  Counter   totalMs;
+  Counter   maxMs;
+  Histogram durationMs;
+  Counter   maxRefreshMs;
+  Histogram refreshMs;    // fetch start to the new data on screen
+} FetchStats;
+
+// Time the radio spends at full power in the network wake windows
+typedef struct RadioStats {
+  Counter   windows;
+  Counter   onMs;
+  Counter   maxWindowMs;
+} RadioStats;
+
+typedef struct HeapStats {
+  Counter   freeBytes;
+  Counter   minFreeBytes;      // low water mark reported by the allocator
+  Counter   largestBlock;
+  Counter   minLargestBlock;   // smallest largest-free-block ever seen
+  Counter   samples;
+} HeapStats;
+
+class Metrics {
+  public:
+    Metrics();
+
+    void recordTaskRun(uint8_t task, uint32_t runUs);
+    void recordLateness(uint8_t task, uint32_t lateMs);
+    void recordTaskHeap(uint8_t task, uint32_t freeBefore, uint32_t freeAfter);
+    void recordFetch(uint8_t source, uint32_t bytes, uint32_t durationMs, bool ok);
+    void recordParseError(uint8_t source);
+    // New data from the source reached the screen, msSinceFetch after its fetch started
+    void recordRefresh(uint8_t source, uint32_t msSinceFetch);
+    void recordRadioWindow(uint32_t onMs);
+    void sampleHeap();
+    void reset();
+
+    void dump(Print& out);
+    void dumpBinary(Print& out);
+
+    TaskStats  tasks[METRIC_TASK_COUNT];
+    FetchStats fetches[METRIC_SOURCE_COUNT];
+    RadioStats radio;
+    HeapStats  heap;
+    uint32_t   startMs;
+};
+
+extern Metrics metrics;
+
+// Times one run of a scheduler task, construct it first thing in the callback
+class TaskTimer {
+  public:
+    TaskTimer(uint8_t task, uint32_t startDelayMs) : task(task), startUs(micros()), startFree(ESP.getFreeHeap()) {
+      metrics.recordLateness(task, startDelayMs);
+    }
+    ~TaskTimer() {
+      metrics.recordTaskRun(task, micros() - startUs);
+      metrics.recordTaskHeap(task, startFree, ESP.getFreeHeap());
+    }
+
+  private:
+    uint8_t  task;
+    uint32_t startUs;
+    uint32_t startFree;
+};
+
+#endif
@@ -0,0 +1,547 @@
+#include "ModelCache.h"
+#include "Metrics.h"
+#include "FetchArena.h"
+#include "utils.h"
+#include <HTTPClient.h>
+#include <stdarg.h>
+
+static const uint8_t MODEL_MAGIC[4] = { 'R', 'W', 'M', 'C' };
+
+ModelCache::ModelCache(USGSStation* usgs, Hydrograph* hydrograph, OneCallWeather* weather, Astronomy* astronomy) {
+  this->usgs = usgs;
+  this->hydrograph = hydrograph;
+  this->weather = weather;
+  this->astronomy = astronomy;
+}
+
+void ModelCache::update() {
+  // Until a source has published the models are empty, and a peer would take
+  // them for data. The server answers 503 meanwhile.
+  if (!this->usgs->generation() && !this->hydrograph->generation() && !this->weather->generation()) {
+    this->binLen = 0;
+    this->binHash = 0;
+    return;
+  }
+  encodeBinary();
+}
+
+/***************************************************************************************
+**                          Binary encoding
+***************************************************************************************/
+// "RWMC" version
+// reading:    time u32, temp f32, flow u32, stage f32
+// hydrograph: site str, generated str, issued str, observed u8, forecast u8,
+//             then per row time u32, stage f32, flow f32
+// weather:    valid u8, timezone offset u32, dt u32, sunrise u32, sunset u32,
+//             temp f32, wind speed f32, pressure f32, wind bearing u16, id u16,
+//             humidity u8, clouds u8, main str, days u8,
+//             then per day dt u32, sunrise u32, sunset u32, high f32, low f32, id u16,
+//             hours start u32, hours u8, then one run of a byte per hour for each of
+//             temperature, wind speed, wind sector, pop and condition
+// astronomy:  valid u8, day u32, civil dawn u32, sunrise u32, sunset u32, civil dusk u32,
+//             moon icon u8, moon phase u8, illumination u8
+static void putRiverStatus(ByteWriter& w, const RiverStatus* rs) {
+  w.put32(rs->time);
+  w.putFloat(rs->stage);
+  w.putFloat(rs->flow);
+}
+
+void ModelCache::encodeReading(ByteWriter& w) {
+  const StationReading* sr = this->usgs->getLastReading();
+  w.put32(sr->time);
+  w.putFloat(sr->temp);
+  w.put32((uint32_t)sr->flow);
+  w.putFloat(sr->stage);
+}
+
+void ModelCache::encodeHydrograph(ByteWriter& w) {
+  const HydrographModel* h = this->hydrograph->model();
+  w.putStr(h->siteName);
+  w.putStr(h->generationTime);
+  w.putStr(h->forecastIssued);
+  w.put8((uint8_t)h->last_observed);
+  w.put8((uint8_t)h->last_forecast);
+  for (int i = 0; i < h->last_observed; i++) {
+    putRiverStatus(w, &h->observed_array[i]);
+  }
+  for (int i = 0; i < h->last_forecast; i++) {
+    putRiverStatus(w, &h->forecast_array[i]);
+  }
+}
+
+void ModelCache::encodeWeather(ByteWriter& w) {
+  const WeatherModel* m = this->weather->getWeather();
+  const WeatherNow* now = &m->current;
+  w.put8(m->valid);
+  w.put32((uint32_t)m->timezoneOffset);
+  w.put32(now->dayTime);
+  w.put32(now->sunriseTime);
+  w.put32(now->sunsetTime);
+  w.putFloat(now->temperature);
+  w.putFloat(now->windSpeed);
+  w.putFloat(now->pressure);
+  w.put16(now->windBearing);
+  w.put16(now->id);
+  w.put8(now->humidity);
+  w.put8(now->cloudCover);
+  w.putStr(now->main);
+  w.put8(m->days);
+  for (int i = 0; i < m->days; i++) {
+    const WeatherDay* d = &m->daily[i];
+    w.put32(d->dayTime);
+    w.put32(d->sunriseTime);
+    w.put32(d->sunsetTime);
+    w.putFloat(d->temperatureHigh);
+    w.putFloat(d->temperatureLow);
+    w.put16(d->id);
+  }
+  const WeatherHours* h = &m->hours;
+  w.put32(h->start);
+  w.put8(h->count);
+  w.putBytes(h->temperature, h->count);
+  w.putBytes(h->windSpeed, h->count);
+  w.putBytes(h->windSector, h->count);
+  w.putBytes(h->pop, h->count);
+  w.putBytes(h->condition, h->count);
+}
+
+void ModelCache::encodeAstronomy(ByteWriter& w) {
+  const Ephemeris* e = this->astronomy->current();
+  w.put8(e->valid);
+  w.put32((uint32_t)e->day);
+  w.put32(e->civilDawn);
+  w.put32(e->sunrise);
+  w.put32(e->sunset);
+  w.put32(e->civilDusk);
+  w.put8(e->moonIcon);
+  w.put8(e->moonPhase);
+  w.put8(e->illumination);
+}
+
+void ModelCache::encodeBinary() {
+  ByteWriter w(this->binBuf, sizeof(this->binBuf));
+  w.putBytes(MODEL_MAGIC, sizeof(MODEL_MAGIC));
+  w.put8(MODEL_CACHE_VERSION);
+  encodeReading(w);
+  encodeHydrograph(w);
+  encodeWeather(w);
+  encodeAstronomy(w);
+
+  if (!w.ok()) {
+    Serial.printf("ModelCache binary encoding overflowed %u bytes\n", (unsigned)sizeof(this->binBuf));
+    this->binLen = 0;
+    this->binHash = 0;
+    return;
+  }
+  this->binLen = w.length();
+  this->binHash = fnv1a32(this->binBuf, this->binLen);
+}
+
+static void getRiverStatus(ByteReader& r, RiverStatus* rs) {
+  rs->time = r.get32();
+  rs->stage = r.getFloat();
+  rs->flow = r.getFloat();
+}
+
+ModelSectionStatus ModelCache::decodeReading(ByteReader& r) {
+  StationReading* sr = this->usgs->back();
+  sr->time = r.get32();
+  sr->temp = r.getFloat();
+  sr->flow = (int)r.get32();
+  sr->stage = r.getFloat();
+  if (!r.ok()) {
+    Serial.println("ModelCache: truncated reading");
+    return MODEL_SECTION_BAD;
+  }
+  // A sender that has not fetched a reading yet must not wipe ours, and one
+  // no newer than ours is a repeat, or a replayed packet rolling us back
+  if (!sr->time || sr->time <= this->usgs->getLastReading()->time) {
+    return MODEL_SECTION_KEPT;
+  }
+  return this->usgs->publish() ? MODEL_SECTION_APPLIED : MODEL_SECTION_BAD;
+}
+
+ModelSectionStatus ModelCache::decodeHydrograph(ByteReader& r) {
+  HydrographModel* h = this->hydrograph->back();
+  memset(h, 0, sizeof(HydrographModel));
+  r.getStr(h->siteName, sizeof(h->siteName));
+  r.getStr(h->generationTime, sizeof(h->generationTime));
+  r.getStr(h->forecastIssued, sizeof(h->forecastIssued));
+  int observed = r.get8();
+  int forecast = r.get8();
+  if (observed > HYDROGRAPH_COUNT_MAX || forecast > HYDROGRAPH_COUNT_MAX) {
+    Serial.printf("ModelCache: %d/%d rows will not fit\n", observed, forecast);
+    r.fail();
+    return MODEL_SECTION_BAD;
+  }
+  for (int i = 0; i < observed; i++) {
+    getRiverStatus(r, &h->observed_array[i]);
+  }
+  for (int i = 0; i < forecast; i++) {
+    getRiverStatus(r, &h->forecast_array[i]);
+  }
+  if (!r.ok()) {
+    Serial.println("ModelCache: truncated hydrograph");
+    return MODEL_SECTION_BAD;
+  }
+  uint32_t mine = parseIsoTime(this->hydrograph->model()->generationTime);
+  if (!forecast || (mine && parseIsoTime(h->generationTime) <= mine)) {
+    return MODEL_SECTION_KEPT;
+  }
+  h->last_observed = observed;
+  h->last_forecast = forecast;
+  return this->hydrograph->publish() ? MODEL_SECTION_APPLIED : MODEL_SECTION_BAD;
+}
+
+ModelSectionStatus ModelCache::decodeWeather(ByteReader& r) {
+  WeatherModel* m = this->weather->back();
+  WeatherNow* now = &m->current;
+  memset(m, 0, sizeof(WeatherModel));
+  m->valid = r.get8();
+  m->timezoneOffset = (int32_t)r.get32();
+  now->dayTime = r.get32();
+  now->sunriseTime = r.get32();
+  now->sunsetTime = r.get32();
+  now->temperature = r.getFloat();
+  now->windSpeed = r.getFloat();
+  now->pressure = r.getFloat();
+  now->windBearing = r.get16();
+  now->id = r.get16();
+  now->humidity = r.get8();
+  now->cloudCover = r.get8();
+  r.getStr(now->main, sizeof(now->main));
+  m->days = r.get8();
+  if (m->days > WEATHER_DAYS) {
+    Serial.printf("ModelCache: %d weather days will not fit\n", m->days);
+    r.fail();
+    return MODEL_SECTION_BAD;
+  }
+  for (int i = 0; i < m->days; i++) {
+    WeatherDay* d = &m->daily[i];
+    d->dayTime = r.get32();
+    d->sunriseTime = r.get32();
+    d->sunsetTime = r.get32();
+    d->temperatureHigh = r.getFloat();
+    d->temperatureLow = r.getFloat();
+    d->id = r.get16();
+  }
+  WeatherHours* h = &m->hours;
+  h->start = r.get32();
+  h->count = r.get8();
+  if (h->count > WEATHER_HOURS) {
+    Serial.printf("ModelCache: %d weather hours will not fit\n", h->count);
+    r.fail();
+    return MODEL_SECTION_BAD;
+  }
+  r.getBytes(h->temperature, h->count);
+  r.getBytes(h->windSpeed, h->count);
+  r.getBytes(h->windSector, h->count);
+  r.getBytes(h->pop, h->count);
+  r.getBytes(h->condition, h->count);
+  if (!r.ok()) {
+    Serial.println("ModelCache: truncated weather");
+    return MODEL_SECTION_BAD;
+  }
+  const WeatherModel* mine = this->weather->getWeather();
+  if (!m->valid || (mine->valid && now->dayTime <= mine->current.dayTime)) {
+    return MODEL_SECTION_KEPT;
+  }
+  return this->weather->publish() ? MODEL_SECTION_APPLIED : MODEL_SECTION_BAD;
+}
+
+ModelSectionStatus ModelCache::decodeAstronomy(ByteReader& r) {
+  Ephemeris e = {};
+  e.valid = r.get8();
+  e.day = (int32_t)r.get32();
+  e.civilDawn = r.get32();
+  e.sunrise = r.get32();
+  e.sunset = r.get32();
+  e.civilDusk = r.get32();
+  e.moonIcon = r.get8();
+  e.moonPhase = r.get8();
+  e.illumination = r.get8();
+  if (!r.ok() || e.moonIcon > 23 || e.moonPhase > 7 || e.illumination > 100) {
+    Serial.println("ModelCache: bad astronomy");
+    return MODEL_SECTION_BAD;
+  }
+  // Saves working it out here; a day we have already computed is kept
+  const Ephemeris* mine = this->astronomy->current();
+  if (!e.valid || (mine->valid && mine->day >= e.day)) {
+    return MODEL_SECTION_KEPT;
+  }
+  this->astronomy->restore(&e);
+  return MODEL_SECTION_APPLIED;
+}
+
+uint8_t ModelCache::decode(const uint8_t* data, size_t len, uint8_t* applied) {
+  ByteReader r(data, len);
+  uint8_t magic[4];
+  r.getBytes(magic, sizeof(magic));
+  if (!r.ok() || memcmp(magic, MODEL_MAGIC, sizeof(magic)) || r.get8() != MODEL_CACHE_VERSION) {
+    Serial.println("ModelCache: not a model or wrong version");
+    return 0;
+  }
+  // Every section is published or dropped on its own. Once the reader has
+  // lost its place the sections after it cannot be found and count as bad.
+  uint8_t current = 0;
+  for (uint8_t section = MODEL_SECTION_READING; section <= MODEL_SECTION_ASTRONOMY && r.ok(); section <<= 1) {
+    ModelSectionStatus status;
+    if (section == MODEL_SECTION_READING) {
+      status = decodeReading(r);
+    } else if (section == MODEL_SECTION_HYDROGRAPH) {
+      status = decodeHydrograph(r);
+    } else if (section == MODEL_SECTION_WEATHER) {
+      status = decodeWeather(r);
+    } else {
+      status = decodeAstronomy(r);
+    }
+    if (status != MODEL_SECTION_BAD) {
+      current |= section;
+    }
+    if (status == MODEL_SECTION_APPLIED && applied) {
+      *applied |= section;
+    }
+  }
+  if (current != MODEL_SECTION_ALL) {
+    Serial.printf("ModelCache: sections %02x of %02x are current\n", current, MODEL_SECTION_ALL);
+  }
+  return current;
+}
+
+/***************************************************************************************
+**                          JSON encoding
+***************************************************************************************/
+// Formats into a small buffer and hands it to out a buffer at a time, so the
+// document is never held whole. Without out it only counts, for the
+// Content-Length ahead of the body; both passes read the same models, so the
+// counts agree.
+class JsonOut {
+  public:
+    JsonOut(Print* out) : out(out) {}
+    ~JsonOut() { flush(); }
+
+    void printf(const char* fmt, ...) {
+      va_list args, again;
+      va_start(args, fmt);
+      va_copy(again, args);
+      int n = vsnprintf(buf + used, sizeof(buf) - used, fmt, args);
+      if (n >= 0 && (size_t)n >= sizeof(buf) - used) {
+        flush();
+        n = vsnprintf(buf, sizeof(buf), fmt, again);
+        if ((size_t)n >= sizeof(buf)) n = sizeof(buf) - 1;  // no field comes near
+      }
+      va_end(again);
+      va_end(args);
+      if (n < 0) return;
+      used += n;
+      len += n;
+    }
+    // The values are dates, numbers and site names, only quotes and backslashes need escaping
+    void string(const char* s) {
+      printf("\"");
+      for (; *s; s++) {
+        if (*s == '"' || *s == '\\') printf("\\%c", *s);
+        else if ((uint8_t)*s >= 0x20) printf("%c", *s);
+      }
+      printf("\"");
+    }
+    // Missing gauge values are NAN, which JSON has no literal for
+    void number(float v, int decimals) {
+      if (isnan(v)) printf("null");
+      else printf("%.*f", decimals, v);
+    }
+    void flush() {
+      if (this->out && this->used) this->out->write((const uint8_t*)this->buf, this->used);
+      this->used = 0;
+    }
+
+    size_t len = 0;
+
+  private:
+    Print* out;
+    char   buf[256];
+    size_t used = 0;
+};
+
+static void jsonRiverStatus(JsonOut& j, const RiverStatus* rs, bool last) {
+  j.printf("{\"time\":%u,\"stage\":", rs->time);
+  j.number(rs->stage, 2);
+  j.printf(",\"flow\":");
+  j.number(rs->flow, 2);
+  j.printf("}%s", last ? "" : ",");
+}
+
+void ModelCache::encodeJson(JsonOut& j) {
+  const StationReading* sr = this->usgs->getLastReading();
+  j.printf("{\"version\":%d,\"etag\":\"%08x\",\"reading\":{\"time\":%u,\"temp_c\":", MODEL_CACHE_VERSION, this->binHash, sr->time);
+  j.number(sr->temp, 1);
+  j.printf(",\"flow_cfs\":%d,\"stage_ft\":", sr->flow);
+  j.number(sr->stage, 2);
+  j.printf("},");
+
+  const HydrographModel* h = this->hydrograph->model();
+  j.printf("\"hydrograph\":{\"site\":");
+  j.string(h->siteName);
+  j.printf(",\"generated\":");
+  j.string(h->generationTime);
+  j.printf(",\"issued\":");
+  j.string(h->forecastIssued);
+  j.printf(",\"observed\":[");
+  for (int i = 0; i < h->last_observed; i++) {
+    jsonRiverStatus(j, &h->observed_array[i], i == h->last_observed - 1);
+  }
+  j.printf("],\"forecast\":[");
+  for (int i = 0; i < h->last_forecast; i++) {
+    jsonRiverStatus(j, &h->forecast_array[i], i == h->last_forecast - 1);
+  }
+  j.printf("]},");
+
+  const WeatherModel* m = this->weather->getWeather();
+  const WeatherNow* now = &m->current;
+  j.printf("\"weather\":{\"valid\":%s,\"timezone_offset\":%d,\"current\":{\"dt\":%u,\"sunrise\":%u,\"sunset\":%u,",
+           m->valid ? "true" : "false", m->timezoneOffset, now->dayTime, now->sunriseTime, now->sunsetTime);
+  j.printf("\"temp\":%.1f,\"wind_speed\":%.1f,\"wind_deg\":%d,\"pressure\":%.0f,\"humidity\":%d,\"clouds\":%d,\"id\":%d,\"main\":",
+           now->temperature, now->windSpeed, now->windBearing, now->pressure, now->humidity, now->cloudCover, now->id);
+  j.string(now->main);
+  j.printf("},\"daily\":[");
+  for (int i = 0; i < m->days; i++) {
+    const WeatherDay* d = &m->daily[i];
+    j.printf("{\"dt\":%u,\"sunrise\":%u,\"sunset\":%u,\"high\":%.0f,\"low\":%.0f,\"id\":%d}%s",
+             d->dayTime, d->sunriseTime, d->sunsetTime, d->temperatureHigh, d->temperatureLow, d->id,
+             i == m->days - 1 ? "" : ",");
+  }
+  // Hourly values as parallel arrays from start, an hour apart
+  const WeatherHours* hours = &m->hours;
+  j.printf("],\"hourly\":{\"start\":%u,\"temp\":[", hours->start);
+  for (int i = 0; i < hours->count; i++) {
+    j.printf("%d%s", hours->temperature[i], i == hours->count - 1 ? "" : ",");
+  }
+  j.printf("],\"wind_speed\":[");
+  for (int i = 0; i < hours->count; i++) {
+    j.printf("%d.%d%s", hours->windSpeed[i] / 2, hours->windSpeed[i] % 2 * 5, i == hours->count - 1 ? "" : ",");
+  }
+  j.printf("],\"wind_deg\":[");
+  for (int i = 0; i < hours->count; i++) {
+    j.printf("%d%s", hours->windSector[i] * 45 / 2, i == hours->count - 1 ? "" : ",");
+  }
+  j.printf("],\"pop\":[");
+  for (int i = 0; i < hours->count; i++) {
+    j.printf("%d%s", hours->pop[i], i == hours->count - 1 ? "" : ",");
+  }
+  j.printf("],\"id\":[");
+  for (int i = 0; i < hours->count; i++) {
+    j.printf("%d%s", weatherConditionId(hours->condition[i]), i == hours->count - 1 ? "" : ",");
+  }
+  j.printf("]}},");
+
+  const Ephemeris* e = this->astronomy->current();
+  j.printf("\"astronomy\":{\"valid\":%s,\"day\":%d,\"civil_dawn\":%u,\"sunrise\":%u,\"sunset\":%u,\"civil_dusk\":%u,",
+           e->valid ? "true" : "false", (int)e->day, e->civilDawn, e->sunrise, e->sunset, e->civilDusk);
+  j.printf("\"moon_icon\":%d,\"moon_phase\":%d,\"illumination\":%d}}", e->moonIcon, e->moonPhase, e->illumination);
+}
+
+/***************************************************************************************
+**                          Server
+***************************************************************************************/
+void ModelCache::beginServer(uint16_t port) {
+  if (this->server) return;
+  this->server = new WebServer(port);
+  static const char* headerKeys[] = { "If-None-Match" };
+  this->server->collectHeaders(headerKeys, 1);
+  this->server->on("/model.bin", HTTP_GET, [this]() {
+    if (!sendHeaders('b')) return;
+    this->server->setContentLength(this->binLen);
+    this->server->send(200, "application/octet-stream", "");
+    this->server->client().write(this->binBuf, this->binLen);
+  });
+  // The JSON is built as it is sent, once to measure it and once to the client
+  this->server->on("/model.json", HTTP_GET, [this]() {
+    if (!sendHeaders('j')) return;
+    JsonOut count(NULL);
+    encodeJson(count);
+    this->server->setContentLength(count.len);
+    this->server->send(200, "application/json", "");
+    auto client = this->server->client();
+    JsonOut out(&client);
+    encodeJson(out);
+  });
+  this->server->begin();
+  Serial.printf("ModelCache serving on port %d\n", port);
+}
+
+void ModelCache::handleClient() {
+  if (this->server) {
+    this->server->handleClient();
+  }
+}
+
+// The 503 before a source has published, the ETag and the 304 for a peer that
+// is current. False when that answered the request.
+bool ModelCache::sendHeaders(char suffix) {
+  if (!this->binLen) {
+    this->server->send(503, "text/plain", "No data yet");
+    return false;
+  }
+  char etag[16];
+  snprintf(etag, sizeof(etag), "\"%08x%c\"", this->binHash, suffix);
+  this->server->sendHeader("ETag", etag);
+  this->server->sendHeader("Cache-Control", "no-cache");
+  if (this->server->header("If-None-Match") == etag) {
+    this->server->send(304);
+    return false;
+  }
+  return true;
+}
+
+/***************************************************************************************
+**                          Peer client
+***************************************************************************************/
+uint8_t ModelCache::fetchFromPeer(const char* host, uint8_t* applied) {
+  uint32_t startMs = millis();
+  FetchSession session("Peer");
+  char* url = session.chars(FETCH_URL_MAX);
+  HTTPClient* http = session.make<HTTPClient>();
+  if (!url || !http) {
+    metrics.recordFetch(METRIC_SOURCE_PEER, 0, millis() - startMs, false);
+    return 0;
+  }
+  snprintf(url, FETCH_URL_MAX, "http://%s/model.bin", host);
+
+  static const char* headerKeys[] = { "ETag" };
+  http->begin(url);
+  http->collectHeaders(headerKeys, 1);
+  if (this->peerHash) {
+    char etag[16];
+    snprintf(etag, sizeof(etag), "\"%08xb\"", this->peerHash);
+    http->addHeader("If-None-Match", etag);
+  }
+
+  uint8_t current = 0;
+  size_t bytes = 0;
+  int httpCode = http->GET();
+  Serial.printf("[HTTP] GET %s... code: %d\n", url, httpCode);
+  if (httpCode == HTTP_CODE_NOT_MODIFIED) {
+    current = this->peerSections;
+  } else if (httpCode == HTTP_CODE_OK) {
+    int len = http->getSize();
+    if (len > 0 && len <= (int)sizeof(this->binBuf)) {
+      WiFiClient* stream = http->getStreamPtr();
+      bytes = stream->readBytes(this->binBuf, len);
+      if (bytes == (size_t)len) {
+        current = decode(this->binBuf, bytes, applied);
+      }
+      // Only a model that decoded completely is worth a 304 next time. The
+      // 'b' suffix is a hex digit too, so only the first eight are the hash.
+      unsigned hash = 0;
+      this->peerSections = current;
+      this->peerHash = current == MODEL_SECTION_ALL && sscanf(http->header("ETag").c_str(), "\"%8x", &hash) == 1 ? hash : 0;
+    } else {
+      Serial.printf("ModelCache: peer sent %d bytes\n", len);
+    }
+    // binBuf was used as the receive buffer, rebuild it from the models
+    update();
+  }
+  http->end();
+  metrics.recordFetch(METRIC_SOURCE_PEER, bytes, millis() - startMs, current != 0);
+  return current;
+}
@@ -0,0 +1,98 @@
+#ifndef _RIVER_WEATHER_MODEL_CACHE_H_FILE
+#define _RIVER_WEATHER_MODEL_CACHE_H_FILE
+
+#include <Arduino.h>
+#include <WebServer.h>
+#include "hydrograph.h"
+#include "USGSRDB.h"
+#include "OneCall.h"
+#include "Astronomy.h"
+#include "ByteCodec.h"
+
+/*
+ * Read-through cache of the parsed models for other displays on the LAN.
+ *   GET /model.bin   compact little endian encoding (see encodeBinary)
+ *   GET /model.json  the same data as JSON, built as it is sent
+ * Both honour If-None-Match, so a peer that is already current gets a 304,
+ * and answer 503 until one of the sources has published.
+ * A display built with MODEL_CACHE_PEER fetches /model.bin from that peer
+ * instead of going upstream. tools/cache_test.cpp runs both ends on loopback.
+ */
+
+#define MODEL_CACHE_PORT       80
+#define MODEL_CACHE_VERSION     5
+#define MODEL_CACHE_BIN_MAX  1536
+
+// The sections of a model, as bits of a decode() result
+#define MODEL_SECTION_READING    0x01
+#define MODEL_SECTION_HYDROGRAPH 0x02
+#define MODEL_SECTION_WEATHER    0x04
+#define MODEL_SECTION_ASTRONOMY  0x08
+#define MODEL_SECTION_ALL        0x0F
+
+// What became of one decoded section
+typedef enum {
+  MODEL_SECTION_BAD,      // truncated or failed validation, dropped
+  MODEL_SECTION_KEPT,     // the sender has nothing newer than ours
+  MODEL_SECTION_APPLIED   // validated and published
+} ModelSectionStatus;
+
+class JsonOut;
+
+class ModelCache {
+  public:
+    ModelCache(USGSStation* usgs, Hydrograph* hydrograph, OneCallWeather* weather, Astronomy* astronomy);
+
+    // Re-encode the binary model, call after any of them changed. Empty until
+    // one of the sources has published.
+    void update();
+
+    void beginServer(uint16_t port = MODEL_CACHE_PORT);
+    void handleClient();
+
+    // Pull a peer's /model.bin into the local models. Returns the sections that
+    // hold the peer's current data, either freshly decoded or unchanged since
+    // last time; the ones published now are added to applied.
+    uint8_t fetchFromPeer(const char* host, uint8_t* applied = NULL);
+
+    // Apply an encoded model to the local models section by section, a bad
+    // section does not stop the others. Returns the sections that are current
+    // (applied or kept) and adds the published ones to applied.
+    uint8_t decode(const uint8_t* data, size_t len, uint8_t* applied = NULL);
+
+    // The individual sections, also used for the peer push packets. A decoded
+    // section is validated and published by its source, or dropped. One that
+    // is no newer than what is published (by the reading's time, the forecast's
+    // generation time or the weather's current time) is kept out as well.
+    void encodeReading(ByteWriter& w);
+    ModelSectionStatus decodeReading(ByteReader& r);
+    void encodeHydrograph(ByteWriter& w);
+    ModelSectionStatus decodeHydrograph(ByteReader& r);
+    void encodeWeather(ByteWriter& w);
+    ModelSectionStatus decodeWeather(ByteReader& r);
+    void encodeAstronomy(ByteWriter& w);
+    ModelSectionStatus decodeAstronomy(ByteReader& r);
+
+    const uint8_t* binary() const { return this->binBuf; }
+    size_t binaryLength() const { return this->binLen; }
+    uint32_t hash() const { return this->binHash; }
+
+  private:
+    void encodeBinary();
+    void encodeJson(JsonOut& j);
+    bool sendHeaders(char suffix);
+
+    USGSStation*    usgs;
+    Hydrograph*     hydrograph;
+    OneCallWeather* weather;
+    Astronomy*      astronomy;
+    WebServer*      server = NULL;
+
+    uint8_t  binBuf[MODEL_CACHE_BIN_MAX];
+    size_t   binLen = 0;
+    uint32_t binHash = 0;
+    uint32_t peerHash = 0;
+    uint8_t  peerSections = 0;  // current after the last full fetch, for a 304
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include "NetScheduler.h"
+#include <Print.h>
+
+// a is before b, across millis() wrapping
+static inline bool before(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) < 0;
+}
+
+void NetScheduler::configure(uint8_t id, const char* name, uint32_t intervalMs, uint32_t earlyMs, uint32_t lateMs, uint32_t nowMs) {
+  if (id >= NET_SOURCES_MAX) {
+    return;
+  }
+  Source* s = &this->sources[id];
+  s->name = name;
+  s->intervalMs = intervalMs;
+  s->earlyMs = earlyMs;
+  s->lateMs = lateMs;
+  s->dueMs = nowMs;
+  s->urgent = false;
+  if (id >= this->count) {
+    this->count = id + 1;
+  }
+}
+
+void NetScheduler::completed(uint8_t id, uint32_t nowMs) {
+  Source* s = &this->sources[id];
+  // From the due time, unless a whole interval has gone by since
+  uint32_t from = s->urgent || before(s->dueMs + s->intervalMs, nowMs) ? nowMs : s->dueMs;
+  schedule(id, from, s->intervalMs);
+}
+
+void NetScheduler::schedule(uint8_t id, uint32_t nowMs, uint32_t delayMs) {
+  this->sources[id].dueMs = nowMs + delayMs;
+  this->sources[id].urgent = false;
+}
+
+void NetScheduler::requestNow(uint8_t id, uint32_t nowMs) {
+  this->sources[id].dueMs = nowMs;
+  this->sources[id].urgent = true;
+}
+
+uint32_t NetScheduler::msUntilWindow(uint32_t nowMs) const {
+  bool any = false;
+  uint32_t first = 0;
+  for (int i = 0; i < this->count; i++) {
+    const Source& s = this->sources[i];
+    if (!s.name) {
+      continue;
+    }
+    uint32_t d = deadline(s);
+    if (!any || before(d, first)) {
+      first = d;
+      any = true;
+    }
+  }
+  if (!any || !before(nowMs, first)) {
+    return 0;
+  }
+  return first - nowMs;
+}
+
+uint8_t NetScheduler::beginWindow(uint32_t nowMs) {
+  this->windowCount = 0;
+  this->windowNext = 0;
+  for (int i = 0; i < this->count; i++) {
+    const Source& s = this->sources[i];
+    if (s.name && !before(nowMs + s.earlyMs, s.dueMs)) {
+      // Insertion sort by due time, there are only a handful
+      int j = this->windowCount++;
+      while (j > 0 && before(s.dueMs, this->sources[this->window[j - 1]].dueMs)) {
+        this->window[j] = this->window[j - 1];
+        j--;
+      }
+      this->window[j] = i;
+    }
+  }
+  return this->windowCount;
+}
+
+uint8_t NetScheduler::nextInWindow() {
+  if (this->windowNext >= this->windowCount) {
+    return NET_SOURCE_NONE;
+  }
+  return this->window[this->windowNext++];
+}
+
+uint32_t NetScheduler::lateMs(uint8_t id, uint32_t nowMs) const {
+  uint32_t due = this->sources[id].dueMs;
+  return before(due, nowMs) ? nowMs - due : 0;
+}
+
+void NetScheduler::report(Print& out, uint32_t nowMs) const {
+  out.printf("Next wake window in %u s\n", msUntilWindow(nowMs) / 1000);
+  for (int i = 0; i < this->count; i++) {
+    const Source& s = this->sources[i];
+    if (!s.name) {
+      continue;
+    }
+    int32_t dueIn = (int32_t)(s.dueMs - nowMs);
+    out.printf("  %-12s due in %6d s  every %5u s  early %4u s  late %4u s%s\n", s.name, dueIn / 1000,
+               s.intervalMs / 1000, s.earlyMs / 1000, s.lateMs / 1000, s.urgent ? "  requested" : "");
+  }
+}
@@ -0,0 +1,76 @@
+#ifndef _RIVER_WEATHER_NET_SCHEDULER_H_FILE
+#define _RIVER_WEATHER_NET_SCHEDULER_H_FILE
+
+#include <stdint.h>
+
+/*
+ * Groups the network fetches into shared wake windows so the radio can sit in
+ * modem sleep in between.
+ *
+ * Every source has a due time and two tolerances: how long it may run late
+ * (waiting for other sources to come due) and how early it may run (riding
+ * along with a window another source opened). A window opens when the first
+ * source runs out of lateness and takes every source due within its early
+ * tolerance. The sources of a window are handed out one at a time, earliest
+ * due first, and run back to back.
+ *
+ * Times are millis() values passed in by the caller, so the policy runs the
+ * same against a simulated clock. Comparisons are wrap safe.
+ */
+
+#define NET_SOURCES_MAX 6
+#define NET_SOURCE_NONE 0xFF
+
+class Print;
+
+class NetScheduler {
+  public:
+    // A source id is an index below NET_SOURCES_MAX. It is first due at nowMs.
+    void configure(uint8_t id, const char* name, uint32_t intervalMs, uint32_t earlyMs, uint32_t lateMs, uint32_t nowMs);
+
+    // Next run a normal interval on. A source keeps its cadence from the time it
+    // was due, so riding along early does not make it poll faster and waiting
+    // for a window does not make it poll slower.
+    void completed(uint8_t id, uint32_t nowMs);
+    // Next run after a given wait, for retries and open circuits
+    void schedule(uint8_t id, uint32_t nowMs, uint32_t delayMs);
+    // Due now with no lateness allowed, for a refresh the user asked for
+    void requestNow(uint8_t id, uint32_t nowMs);
+
+    // How long until the next window should open, 0 if it is already late
+    uint32_t msUntilWindow(uint32_t nowMs) const;
+
+    // Collect the sources for a window opening now, returns how many
+    uint8_t beginWindow(uint32_t nowMs);
+    // The next source to run in the open window, NET_SOURCE_NONE once all have run
+    uint8_t nextInWindow();
+    bool windowOpen() const { return this->windowNext < this->windowCount; }
+
+    // How far past its due time a source is, for the task lateness metrics
+    uint32_t lateMs(uint8_t id, uint32_t nowMs) const;
+    uint32_t dueMs(uint8_t id) const { return this->sources[id].dueMs; }
+    const char* name(uint8_t id) const { return this->sources[id].name; }
+
+    void report(Print& out, uint32_t nowMs) const;
+
+  private:
+    typedef struct Source {
+      const char* name;
+      uint32_t    intervalMs;
+      uint32_t    earlyMs;
+      uint32_t    lateMs;
+      uint32_t    dueMs;
+      bool        urgent;     // requested now, lateness does not apply
+    } Source;
+
+    // Latest time the source may start
+    uint32_t deadline(const Source& s) const { return s.dueMs + (s.urgent ? 0 : s.lateMs); }
+
+    Source  sources[NET_SOURCES_MAX] = {};
+    uint8_t count = 0;
+    uint8_t window[NET_SOURCES_MAX];
+    uint8_t windowCount = 0;
+    uint8_t windowNext = 0;
+};
+
+#endif
@@ -0,0 +1,293 @@
+#include "OneCall.h"
+#include "Metrics.h"
+#include "FetchArena.h"
+#include "StreamIngest.h"
+#include <HTTPClient.h>
+
+typedef enum {
+  WF_TIMEZONE_OFFSET,
+  WF_CURRENT_DT,
+  WF_CURRENT_SUNRISE,
+  WF_CURRENT_SUNSET,
+  WF_CURRENT_TEMP,
+  WF_CURRENT_PRESSURE,
+  WF_CURRENT_HUMIDITY,
+  WF_CURRENT_CLOUDS,
+  WF_CURRENT_WIND_SPEED,
+  WF_CURRENT_WIND_DEG,
+  WF_CURRENT_WEATHER_ID,
+  WF_CURRENT_WEATHER_MAIN,
+  WF_DAILY_DT,
+  WF_DAILY_SUNRISE,
+  WF_DAILY_SUNSET,
+  WF_DAILY_TEMP_MIN,
+  WF_DAILY_TEMP_MAX,
+  WF_DAILY_WEATHER_ID,
+  WF_HOURLY_DT,
+  WF_HOURLY_TEMP,
+  WF_HOURLY_WIND_SPEED,
+  WF_HOURLY_WIND_DEG,
+  WF_HOURLY_POP,
+  WF_HOURLY_WEATHER_ID
+} WeatherField;
+
+// Everything else in the response, including minutely if the exclude
+// parameter is ignored, is skipped
+static const JsonPathField WEATHER_FIELDS[] = {
+  { WF_TIMEZONE_OFFSET,      "timezone_offset" },
+  { WF_CURRENT_DT,           "current.dt" },
+  { WF_CURRENT_SUNRISE,      "current.sunrise" },
+  { WF_CURRENT_SUNSET,       "current.sunset" },
+  { WF_CURRENT_TEMP,         "current.temp" },
+  { WF_CURRENT_PRESSURE,     "current.pressure" },
+  { WF_CURRENT_HUMIDITY,     "current.humidity" },
+  { WF_CURRENT_CLOUDS,       "current.clouds" },
+  { WF_CURRENT_WIND_SPEED,   "current.wind_speed" },
+  { WF_CURRENT_WIND_DEG,     "current.wind_deg" },
+  { WF_CURRENT_WEATHER_ID,   "current.weather[].id" },
+  { WF_CURRENT_WEATHER_MAIN, "current.weather[].main" },
+  { WF_DAILY_DT,             "daily[].dt" },
+  { WF_DAILY_SUNRISE,        "daily[].sunrise" },
+  { WF_DAILY_SUNSET,         "daily[].sunset" },
+  { WF_DAILY_TEMP_MIN,       "daily[].temp.min" },
+  { WF_DAILY_TEMP_MAX,       "daily[].temp.max" },
+  { WF_DAILY_WEATHER_ID,     "daily[].weather[].id" },
+  { WF_HOURLY_DT,            "hourly[].dt" },
+  { WF_HOURLY_TEMP,          "hourly[].temp" },
+  { WF_HOURLY_WIND_SPEED,    "hourly[].wind_speed" },
+  { WF_HOURLY_WIND_DEG,      "hourly[].wind_deg" },
+  { WF_HOURLY_POP,           "hourly[].pop" },
+  { WF_HOURLY_WEATHER_ID,    "hourly[].weather[].id" }
+};
+
+#define WEATHER_FIELD_COUNT (sizeof(WEATHER_FIELDS) / sizeof(WEATHER_FIELDS[0]))
+
+/***************************************************************************************
+**                          Condition codes
+***************************************************************************************/
+// Each group of ids is packed after the one before, 197 codes in all
+typedef struct ConditionGroup {
+  uint16_t first;
+  uint16_t last;
+  uint8_t  code;
+} ConditionGroup;
+
+static const ConditionGroup CONDITION_GROUPS[] = {
+  { 200, 232,   1 },   // thunderstorm
+  { 300, 321,  34 },   // drizzle
+  { 500, 531,  56 },   // rain
+  { 600, 622,  88 },   // snow
+  { 701, 781, 111 },   // mist, smoke, haze ... tornado
+  { 800, 804, 192 }    // clear and clouds
+};
+
+uint8_t weatherConditionCode(uint16_t id) {
+  for (const ConditionGroup& g : CONDITION_GROUPS) {
+    if (id >= g.first && id <= g.last) {
+      return g.code + (id - g.first);
+    }
+  }
+  return 0;
+}
+
+uint16_t weatherConditionId(uint8_t code) {
+  for (const ConditionGroup& g : CONDITION_GROUPS) {
+    if (code >= g.code && code <= g.code + (g.last - g.first)) {
+      return g.first + (code - g.code);
+    }
+  }
+  return 0;
+}
+
+/***************************************************************************************
+**                          Extractor
+***************************************************************************************/
+OneCallExtractor::OneCallExtractor(WeatherModel* out)
+  : out(out), json(WEATHER_FIELDS, WEATHER_FIELD_COUNT, onValue, this) {
+  memset(out, 0, sizeof(WeatherModel));
+}
+
+bool OneCallExtractor::complete() {
+  if (this->out->hours.count > this->hourLimit) {
+    this->out->hours.count = this->hourLimit;
+  }
+  this->out->valid = this->json.done() && !this->json.failed() && this->out->current.dayTime && this->out->days;
+  return this->out->valid;
+}
+
+void OneCallExtractor::onValue(void* ctx, uint8_t fieldId, const JsonStream& json, const char* text, bool isString) {
+  WeatherModel* m = ((OneCallExtractor*)ctx)->out;
+  WeatherNow* now = &m->current;
+
+  if (fieldId >= WF_HOURLY_DT) {
+    ((OneCallExtractor*)ctx)->onHour(fieldId, json, text);
+    return;
+  }
+
+  if (fieldId >= WF_DAILY_DT) {
+    uint16_t day = json.arrayIndex(0);
+    if (day >= WEATHER_DAYS) return;
+    if (day >= m->days) m->days = day + 1;
+    WeatherDay* d = &m->daily[day];
+    switch (fieldId) {
+      case WF_DAILY_DT:         d->dayTime = strtoul(text, NULL, 10); break;
+      case WF_DAILY_SUNRISE:    d->sunriseTime = strtoul(text, NULL, 10); break;
+      case WF_DAILY_SUNSET:     d->sunsetTime = strtoul(text, NULL, 10); break;
+      case WF_DAILY_TEMP_MIN:   d->temperatureLow = atof(text); break;
+      case WF_DAILY_TEMP_MAX:   d->temperatureHigh = atof(text); break;
+      case WF_DAILY_WEATHER_ID: if (!json.arrayIndex(1)) d->id = atoi(text); break;
+    }
+    return;
+  }
+
+  switch (fieldId) {
+    case WF_TIMEZONE_OFFSET:    m->timezoneOffset = atol(text); break;
+    case WF_CURRENT_DT:         now->dayTime = strtoul(text, NULL, 10); break;
+    case WF_CURRENT_SUNRISE:    now->sunriseTime = strtoul(text, NULL, 10); break;
+    case WF_CURRENT_SUNSET:     now->sunsetTime = strtoul(text, NULL, 10); break;
+    case WF_CURRENT_TEMP:       now->temperature = atof(text); break;
+    case WF_CURRENT_PRESSURE:   now->pressure = atof(text); break;
+    case WF_CURRENT_HUMIDITY:   now->humidity = atoi(text); break;
+    case WF_CURRENT_CLOUDS:     now->cloudCover = atoi(text); break;
+    case WF_CURRENT_WIND_SPEED: now->windSpeed = atof(text); break;
+    case WF_CURRENT_WIND_DEG:   now->windBearing = atoi(text); break;
+    // Only the primary condition is shown
+    case WF_CURRENT_WEATHER_ID:
+      if (!json.arrayIndex(0)) now->id = atoi(text);
+      break;
+    case WF_CURRENT_WEATHER_MAIN:
+      if (!json.arrayIndex(0) && isString) strlcpy(now->main, text, sizeof(now->main));
+      break;
+  }
+}
+
+static uint8_t clampByte(long v) {
+  return v < 0 ? 0 : v > 255 ? 255 : (uint8_t)v;
+}
+
+// Hours past WEATHER_HOURS are dropped as they stream by
+void OneCallExtractor::onHour(uint8_t fieldId, const JsonStream& json, const char* text) {
+  WeatherHours* h = &this->out->hours;
+  uint16_t hour = json.arrayIndex(0);
+  if (hour >= WEATHER_HOURS) return;
+  if (hour >= h->count) h->count = hour + 1;
+
+  switch (fieldId) {
+    case WF_HOURLY_DT: {
+      uint32_t t = strtoul(text, NULL, 10);
+      if (!hour) {
+        h->start = t;
+      } else if (t != h->start + hour * 3600UL) {
+        // The layout has no room for a gap, so a strip that skips an hour is cut there
+        this->hourLimit = min(this->hourLimit, (uint8_t)hour);
+      }
+      break;
+    }
+    case WF_HOURLY_TEMP: {
+      long t = lroundf(atof(text));
+      h->temperature[hour] = t < -128 ? -128 : t > 127 ? 127 : (int8_t)t;
+      break;
+    }
+    case WF_HOURLY_WIND_SPEED: h->windSpeed[hour] = clampByte(lroundf(atof(text) * 2)); break;
+    case WF_HOURLY_WIND_DEG:   h->windSector[hour] = ((atoi(text) % 360 + 360) % 360 * 16 + 180) / 360 % 16; break;
+    case WF_HOURLY_POP:        h->pop[hour] = min(clampByte(lroundf(atof(text) * 100)), (uint8_t)100); break;
+    case WF_HOURLY_WEATHER_ID: if (!json.arrayIndex(1)) h->condition[hour] = weatherConditionCode(atoi(text)); break;
+  }
+}
+
+/***************************************************************************************
+**                          Fetch
+***************************************************************************************/
+OneCallWeather::OneCallWeather(const char* baseUrl, const char* apiKey, const char* latitude, const char* longitude, const char* units) {
+  this->baseUrl = baseUrl;
+  this->apiKey = apiKey;
+  this->latitude = latitude;
+  this->longitude = longitude;
+  this->units = units;
+}
+
+#define ONECALL_CHUNK 512
+
+bool OneCallWeather::fetch() {
+  uint32_t startMs = millis();
+  uint32_t bytes = 0;
+  bool success = false;
+
+  FetchSession session("OpenWeather");
+  char* url = session.chars(FETCH_URL_MAX);
+  char* chunk = session.chars(ONECALL_CHUNK);
+  StreamIngest* body = session.make<StreamIngest>(chunk, ONECALL_CHUNK);
+  OneCallExtractor* extractor = session.make<OneCallExtractor>(this->back());
+  HTTPClient* http = session.make<HTTPClient>();
+  if (!url || !chunk || !body || !extractor || !http) {
+    metrics.recordFetch(METRIC_SOURCE_OPENWEATHER, 0, millis() - startMs, false);
+    return false;
+  }
+  snprintf(url, FETCH_URL_MAX,
+           "%s/data/2.5/onecall?lat=%s&lon=%s&exclude=minutely,alerts&units=%s&appid=%s",
+           this->baseUrl, this->latitude, this->longitude, this->units, this->apiKey);
+
+  http->begin(url);
+  StreamIngest::collectHeaders(http);
+  int httpCode = http->GET();
+  Serial.printf("[HTTP] GET onecall... code: %d\n", httpCode);
+  if (httpCode == HTTP_CODE_OK) {
+    body->begin(http);
+    const char* data;
+    size_t n;
+    while ((n = body->read(&data))) {
+      extractor->feed(data, n);
+    }
+    bytes = body->bytes();
+    if (extractor->complete()) {
+      success = publish();
+    } else {
+      Serial.println("OneCall: incomplete or malformed response");
+      metrics.recordParseError(METRIC_SOURCE_OPENWEATHER);
+    }
+  }
+  http->end();
+  metrics.recordFetch(METRIC_SOURCE_OPENWEATHER, bytes, millis() - startMs, success);
+  return success;
+}
+
+/***************************************************************************************
+**                          Validate and publish
+***************************************************************************************/
+static bool validTemperature(float t) {
+  return t >= WEATHER_TEMP_MIN && t <= WEATHER_TEMP_MAX;
+}
+
+bool OneCallWeather::validate(const WeatherModel* m) {
+  if (!m->valid || !m->current.dayTime || !m->days || m->days > WEATHER_DAYS ||
+      !validTemperature(m->current.temperature) || m->current.humidity > 100 || m->current.cloudCover > 100) {
+    return false;
+  }
+  for (int i = 0; i < m->days; i++) {
+    const WeatherDay* d = &m->daily[i];
+    if (!validTemperature(d->temperatureHigh) || !validTemperature(d->temperatureLow) ||
+        (i && d->dayTime <= m->daily[i - 1].dayTime)) {
+      return false;
+    }
+  }
+  const WeatherHours* h = &m->hours;
+  if (h->count > WEATHER_HOURS || (h->count && !h->start)) {
+    return false;
+  }
+  for (int i = 0; i < h->count; i++) {
+    if (h->pop[i] > 100 || h->windSector[i] > 15) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool OneCallWeather::publish() {
+  if (!validate(this->back())) {
+    Serial.println("OneCall: weather out of order or out of range");
+    metrics.recordParseError(METRIC_SOURCE_OPENWEATHER);
+    return false;
+  }
+  this->models.publish();
+  return true;
+}
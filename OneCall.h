@@ -0,0 +1,115 @@
+#ifndef _RIVER_WEATHER_ONE_CALL_H_FILE
+#define _RIVER_WEATHER_ONE_CALL_H_FILE
+
+#include <Arduino.h>
+#include "JsonStream.h"
+#include "DoubleBuffer.h"
+
+#define WEATHER_DAYS      5
+#define WEATHER_HOURS    48
+#define WEATHER_MAIN_MAX 16
+
+// Plausible limits for a published model, anything outside is a bad parse
+#define WEATHER_TEMP_MIN -80.0f
+#define WEATHER_TEMP_MAX 140.0f
+
+// Only the OpenWeather OneCall fields the display uses
+typedef struct WeatherNow {
+  uint32_t dayTime;
+  uint32_t sunriseTime;
+  uint32_t sunsetTime;
+  float    temperature;
+  float    windSpeed;
+  float    pressure;
+  uint16_t windBearing;
+  uint16_t id;
+  uint8_t  humidity;
+  uint8_t  cloudCover;
+  char     main[WEATHER_MAIN_MAX];
+} WeatherNow;
+
+typedef struct WeatherDay {
+  uint32_t dayTime;
+  uint32_t sunriseTime;
+  uint32_t sunsetTime;
+  float    temperatureHigh;
+  float    temperatureLow;
+  uint16_t id;
+} WeatherDay;
+
+/*
+ * The next 48 hours, quantized to a byte per value and kept as one array per
+ * field, 5 bytes an hour. Hour i starts at start + i * 3600.
+ */
+typedef struct WeatherHours {
+  uint32_t start;
+  uint8_t  count;
+  int8_t   temperature[WEATHER_HOURS];  // whole degrees in the request units
+  uint8_t  windSpeed[WEATHER_HOURS];    // half units, 0.5 mph or m/s steps
+  uint8_t  windSector[WEATHER_HOURS];   // 16 points of the compass, 0 is north, where it blows from
+  uint8_t  pop[WEATHER_HOURS];          // chance of precipitation in percent
+  uint8_t  condition[WEATHER_HOURS];    // weatherConditionCode() of the primary condition
+} WeatherHours;
+
+// OpenWeather condition ids (200 to 804) packed into a byte, 0 for unknown
+uint8_t  weatherConditionCode(uint16_t id);
+uint16_t weatherConditionId(uint8_t code);
+
+typedef struct WeatherModel {
+  WeatherNow   current;
+  WeatherDay   daily[WEATHER_DAYS];
+  WeatherHours hours;
+  uint8_t      days;
+  int32_t      timezoneOffset;
+  bool         valid;
+} WeatherModel;
+
+/*
+ * Streams a OneCall response straight into a WeatherModel. Values outside the
+ * whitelist in OneCall.cpp are skipped by JsonStream without being stored, and
+ * hourly values are quantized as they arrive, so neither the document nor the
+ * hourly array is ever held.
+ */
+class OneCallExtractor {
+  public:
+    OneCallExtractor(WeatherModel* out);
+
+    void feed(const char* data, size_t len) { this->json.feed(data, len); }
+    // True when the document was complete and held the current conditions and at least one day
+    bool complete();
+
+  private:
+    static void onValue(void* ctx, uint8_t fieldId, const JsonStream& json, const char* text, bool isString);
+    void onHour(uint8_t fieldId, const JsonStream& json, const char* text);
+
+    WeatherModel* out;
+    JsonStream    json;
+    uint8_t       hourLimit = WEATHER_HOURS;   // first hour after a gap in the timestamps
+};
+
+class OneCallWeather {
+  public:
+    // baseUrl is where the API lives, e.g. "https://api.openweathermap.org"
+    OneCallWeather(const char* baseUrl, const char* apiKey, const char* latitude, const char* longitude, const char* units);
+
+    // Parses into the back buffer, the published model only changes on success
+    bool fetch();
+    const WeatherModel* getWeather() const { return this->models.front(); }
+    // Changes every time a model is published
+    uint32_t generation() const { return this->models.published(); }
+
+    // For other writers (peer updates): fill back() completely, then publish()
+    WeatherModel* back() { return this->models.back(); }
+    bool publish();
+    static bool validate(const WeatherModel* m);
+
+  private:
+    const char*  baseUrl;
+    const char*  apiKey;
+    const char*  latitude;
+    const char*  longitude;
+    const char*  units;
+    DoubleBuffer<WeatherModel> models;
+};
+
+#endif
@@ -0,0 +1,205 @@
+#include "PeerPush.h"
+#include "ByteCodec.h"
+#include <WiFi.h>
+#include <Preferences.h>
+#include <mbedtls/md.h>
+
+#define PEER_PUSH_HEADER_LEN 23
+
+bool PeerPush::begin(IPAddress group, uint16_t port, PeerPushCallback onApplied) {
+  if (!this->key || strlen(this->key) < PEER_PUSH_KEY_MIN || !strcmp(this->key, PEER_PUSH_PLACEHOLDER_KEY)) {
+    Serial.println("PeerPush: PEER_PUSH_KEY is the placeholder or too short, not starting");
+    return false;
+  }
+  this->group = group;
+  this->port = port;
+  this->onApplied = onApplied;
+
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  this->senderId = ((uint32_t)mac[2] << 24) | ((uint32_t)mac[3] << 16) | ((uint32_t)mac[4] << 8) | mac[5];
+  // A new boot id lets peers accept our sequence numbers starting over. It
+  // counts up in NVS, so a peer can tell it from one played back from before.
+  Preferences prefs;
+  prefs.begin("peerpush", false);
+  this->bootId = prefs.getUInt("boot", 0) + 1;
+  prefs.putUInt("boot", this->bootId);
+  prefs.end();
+
+  if (!this->udp.beginMulticast(group, port)) {
+    Serial.println("PeerPush: could not join the multicast group");
+    return false;
+  }
+  Serial.printf("PeerPush: sender %08x boot %u listening on %s:%d\n", this->senderId, this->bootId, group.toString().c_str(), port);
+  return true;
+}
+
+void PeerPush::sign(const uint8_t* data, size_t len, uint8_t* mac) {
+  uint8_t full[32];
+  mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+                  (const uint8_t*)this->key, strlen(this->key), data, len, full);
+  memcpy(mac, full, PEER_PUSH_MAC_LEN);
+}
+
+bool PeerPush::broadcast(uint8_t kind, uint32_t nowS) {
+  if (!this->port || !nowS) return false;
+
+  ByteWriter w(this->packet, sizeof(this->packet) - PEER_PUSH_MAC_LEN);
+  w.putBytes("RWP", 3);
+  w.put8(PEER_PUSH_VERSION);
+  w.put8(kind);
+  w.put32(this->senderId);
+  w.put32(this->bootId);
+  w.put32(this->seq + 1);
+  w.put32(nowS);
+  w.put16(0);  // payload length, patched below
+
+  if (kind == PEER_PUSH_READING) {
+    this->cache->encodeReading(w);
+  } else if (kind == PEER_PUSH_HYDROGRAPH) {
+    this->cache->encodeHydrograph(w);
+  } else if (kind == PEER_PUSH_WEATHER) {
+    this->cache->encodeWeather(w);
+  } else {
+    return false;
+  }
+  if (!w.ok()) {
+    Serial.printf("PeerPush: kind %d does not fit in a packet\n", kind);
+    return false;
+  }
+
+  size_t len = w.length();
+  uint16_t payloadLen = len - PEER_PUSH_HEADER_LEN;
+  this->packet[PEER_PUSH_HEADER_LEN - 2] = (uint8_t)payloadLen;
+  this->packet[PEER_PUSH_HEADER_LEN - 1] = (uint8_t)(payloadLen >> 8);
+  sign(this->packet, len, this->packet + len);
+  len += PEER_PUSH_MAC_LEN;
+
+  this->udp.beginMulticastPacket();
+  this->udp.write(this->packet, len);
+  if (!this->udp.endPacket()) {
+    Serial.println("PeerPush: send failed");
+    return false;
+  }
+  this->seq++;
+  return true;
+}
+
+void PeerPush::poll(uint32_t nowS) {
+  if (!this->port) return;
+
+  int size;
+  while ((size = this->udp.parsePacket()) > 0) {
+    if (size > (int)sizeof(this->packet)) {
+      this->udp.flush();
+      continue;
+    }
+    int len = this->udp.read(this->packet, sizeof(this->packet));
+    if (len > 0) {
+      handlePacket(this->packet, len, this->udp.remoteIP(), nowS);
+    }
+  }
+}
+
+PeerPush::PeerState* PeerPush::peerFor(uint32_t senderId) {
+  for (int i = 0; i < this->peerCount; i++) {
+    if (this->peers[i].senderId == senderId) {
+      return &this->peers[i];
+    }
+  }
+  if (this->peerCount == PEER_PUSH_MAX_PEERS) {
+    return NULL;
+  }
+  PeerState* p = &this->peers[this->peerCount++];
+  p->senderId = senderId;
+  p->bootId = 0;
+  p->lastSeq = 0;
+  return p;
+}
+
+void PeerPush::handlePacket(const uint8_t* data, size_t len, IPAddress from, uint32_t nowS) {
+  if (len < PEER_PUSH_HEADER_LEN + PEER_PUSH_MAC_LEN || memcmp(data, "RWP", 3)) {
+    return;
+  }
+  uint8_t mac[PEER_PUSH_MAC_LEN];
+  sign(data, len - PEER_PUSH_MAC_LEN, mac);
+  if (memcmp(mac, data + len - PEER_PUSH_MAC_LEN, PEER_PUSH_MAC_LEN)) {
+    Serial.printf("PeerPush: bad signature from %s\n", from.toString().c_str());
+    this->counts.badMac++;
+    return;
+  }
+
+  ByteReader r(data + 3, len - 3 - PEER_PUSH_MAC_LEN);
+  uint8_t  version  = r.get8();
+  uint8_t  kind     = r.get8();
+  uint32_t senderId = r.get32();
+  uint32_t bootId   = r.get32();
+  uint32_t seq      = r.get32();
+  uint32_t sent     = r.get32();
+  uint16_t payload  = r.get16();
+  if (version != PEER_PUSH_VERSION || payload != r.remaining() || senderId == this->senderId || !bootId) {
+    return;
+  }
+  if (!nowS || (sent > nowS ? sent - nowS : nowS - sent) > PEER_PUSH_MAX_AGE_S) {
+    this->counts.stale++;
+    return;
+  }
+
+  PeerState* peer = peerFor(senderId);
+  if (!peer) {
+    return;  // no room to track it
+  }
+  if (bootId < peer->bootId || (bootId == peer->bootId && seq <= peer->lastSeq)) {
+    Serial.printf("PeerPush: replay of %08x boot %u packet %u\n", senderId, bootId, seq);
+    this->counts.replayed++;
+    return;
+  }
+  if (bootId != peer->bootId) {
+    // A sender rebooted, its sequence starts over. One we had not heard from
+    // before is taken from wherever it has got to.
+    peer->lastSeq = peer->bootId ? 0 : seq - 1;
+    peer->bootId = bootId;
+  }
+  bool lost = seq != peer->lastSeq + 1;
+  peer->lastSeq = seq;
+
+  if (lost) {
+    // Missed at least one push. This one is still good, the rest comes from
+    // the sender's cache once the sketch gets round to it.
+    Serial.printf("PeerPush: lost packets from %08x\n", senderId);
+    this->counts.lost++;
+    this->lostFrom = from;
+    this->lostPending = true;
+  }
+
+  ModelSectionStatus status = MODEL_SECTION_BAD;
+  if (kind == PEER_PUSH_READING) {
+    status = this->cache->decodeReading(r);
+  } else if (kind == PEER_PUSH_HYDROGRAPH) {
+    status = this->cache->decodeHydrograph(r);
+  } else if (kind == PEER_PUSH_WEATHER) {
+    status = this->cache->decodeWeather(r);
+  }
+  if (status == MODEL_SECTION_APPLIED) {
+    this->counts.applied++;
+    this->cache->update();
+    if (this->onApplied) {
+      this->onApplied(kind);
+    }
+  }
+}
+
+bool PeerPush::takeLost(IPAddress* from) {
+  if (!this->lostPending) {
+    return false;
+  }
+  *from = this->lostFrom;
+  this->lostPending = false;
+  return true;
+}
+
+void PeerPush::report(Print& out) const {
+  const PeerPushStats& c = this->counts;
+  out.printf("PeerPush: boot %u, sent %u, applied %u, lost %u, bad MAC %u, stale %u, replayed %u\n",
+             this->bootId, this->seq, c.applied, c.lost, c.badMac, c.stale, c.replayed);
+}
@@ -0,0 +1,105 @@
+#ifndef _RIVER_WEATHER_PEER_PUSH_H_FILE
+#define _RIVER_WEATHER_PEER_PUSH_H_FILE
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include "ModelCache.h"
+
+/*
+ * Pushes fresh readings to the other displays on a LAN multicast group.
+ *
+ * Packet, little endian:
+ *   "RWP" version u8, kind u8, sender id u32, boot id u32, sequence u32,
+ *   sent u32 (the sender's Unix seconds), payload length u16, payload (a
+ *   ModelCache section), HMAC-SHA256 truncated to PEER_PUSH_MAC_LEN bytes over
+ *   everything before it.
+ *
+ * Receivers drop packets with a bad MAC or an unknown version. A packet sent
+ * more than PEER_PUSH_MAX_AGE_S away from the receiver's clock is dropped too,
+ * so a recording cannot be played back later, and until the clock is set
+ * nothing is taken. The boot id is a counter kept in NVS, so a sender's boots
+ * only count up: a packet from an older boot than the last one seen, or with a
+ * sequence number already seen, is a replay. The model cache on top of that
+ * keeps any section that is no newer than its own.
+ *
+ * A gap in a sender's sequence means a packet was lost. The packet that shows
+ * the gap is still applied, and takeLost() hands the sender to the sketch,
+ * which pulls its full /model.bin over HTTP from a wake window rather than
+ * holding up the poll. tools/peer_test.cpp runs a fleet as processes on one host.
+ */
+
+#define PEER_PUSH_VERSION     2
+#define PEER_PUSH_MAX_AGE_S 120
+#define PEER_PUSH_MAC_LEN    16
+#define PEER_PUSH_MAX_PACKET 1400
+#define PEER_PUSH_MAX_PEERS     8
+#define PEER_PUSH_KEY_MIN      16
+#define PEER_PUSH_PLACEHOLDER_KEY "change-this-fleet-key"
+
+typedef enum {
+  PEER_PUSH_READING = 1,
+  PEER_PUSH_HYDROGRAPH,
+  PEER_PUSH_WEATHER
+} PeerPushKind;
+
+typedef void (*PeerPushCallback)(uint8_t kind);
+
+typedef struct PeerPushStats {
+  uint32_t applied;
+  uint32_t badMac;
+  uint32_t stale;     // sent too long ago, or our clock is not set
+  uint32_t replayed;  // from an older boot or a sequence number already seen
+  uint32_t lost;      // gaps in a sender's sequence
+} PeerPushStats;
+
+class PeerPush {
+  public:
+    PeerPush(ModelCache* cache, const char* key) : cache(cache), key(key) {}
+
+    // Refuses to start with a short key or the placeholder from All_Settings.h,
+    // anyone who has read the sketch could sign pushes with it
+    bool begin(IPAddress group, uint16_t port, PeerPushCallback onApplied);
+
+    // Send the current model section to the group. nowS is the clock's Unix
+    // time, nothing is sent before it is set as the receivers could not check it.
+    bool broadcast(uint8_t kind, uint32_t nowS);
+
+    // Drain received packets, call often
+    void poll(uint32_t nowS);
+
+    // True once for each gap found, with the sender whose model should be pulled
+    bool takeLost(IPAddress* from);
+
+    const PeerPushStats& stats() const { return this->counts; }
+    void report(Print& out) const;
+
+  private:
+    typedef struct PeerState {
+      uint32_t senderId;
+      uint32_t bootId;
+      uint32_t lastSeq;
+    } PeerState;
+
+    void sign(const uint8_t* data, size_t len, uint8_t* mac);
+    void handlePacket(const uint8_t* data, size_t len, IPAddress from, uint32_t nowS);
+    PeerState* peerFor(uint32_t senderId);
+
+    ModelCache*      cache;
+    const char*      key;
+    WiFiUDP          udp;
+    IPAddress        group;
+    uint16_t         port = 0;
+    PeerPushCallback onApplied = NULL;
+
+    uint32_t  senderId = 0;
+    uint32_t  bootId = 0;       // from 1, 0 is a peer we have not heard from
+    uint32_t  seq = 0;
+    PeerState peers[PEER_PUSH_MAX_PEERS];
+    uint8_t   peerCount = 0;
+    IPAddress lostFrom;
+    bool      lostPending = false;
+    uint8_t   packet[PEER_PUSH_MAX_PACKET];
+    PeerPushStats counts = {};
+};
+
+#endif
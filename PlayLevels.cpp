@@ -0,0 +1,93 @@
+#include "PlayLevels.h"
+#include "ByteCodec.h"
+#include <FS.h>
+#include <SPIFFS.h>
+
+// RGB565 of TFT_LIGHTGREY, the stage colour of a gauge without levels
+#define LEVEL_NONE 0xD69A
+
+// One unnamed band and no boundaries until a table is loaded. Another river's
+// names would be wrong for this gauge, so there is no built in table.
+PlayLevels::PlayLevels() {
+  this->bands = 1;
+  for (int i = 0; i < PLAY_LEVELS_MAX; i++) {
+    this->bounds[i] = INFINITY;
+    this->colors[i] = LEVEL_NONE;
+    this->names[i][0] = '\0';
+  }
+}
+
+bool PlayLevels::load(const char* path) {
+  if (!SPIFFS.exists(path)) {
+    Serial.printf("PlayLevels: no %s, no play levels for this gauge\n", path);
+    return false;
+  }
+  fs::File f = SPIFFS.open(path, "r");
+  uint8_t buf[PLAY_LEVELS_FILE_MAX];
+  size_t len = f.read(buf, sizeof(buf));
+  bool whole = !f.available();
+  f.close();
+  if (!whole || !decode(buf, len)) {
+    Serial.printf("PlayLevels: %s is not a valid level table\n", path);
+    return false;
+  }
+  Serial.printf("PlayLevels: %d bands from %s\n", this->bands, path);
+  return true;
+}
+
+bool PlayLevels::decode(const uint8_t* data, size_t len) {
+  if (len < 4 + 4 || fnv1a32(data, len - 4) != ByteReader(data + len - 4, 4).get32()) {
+    return false;
+  }
+  ByteReader r(data, len - 4);
+  char magic[3];
+  r.getBytes(magic, sizeof(magic));
+  uint8_t version = r.get8();
+  uint8_t count = r.get8();
+  if (!r.ok() || memcmp(magic, "PLV", 3) != 0 || version != PLAY_LEVELS_VERSION
+      || count < 1 || count > PLAY_LEVELS_MAX) {
+    return false;
+  }
+
+  // Decode into locals so a bad file leaves the current table alone
+  float bounds[PLAY_LEVELS_MAX];
+  uint16_t colors[PLAY_LEVELS_MAX];
+  char names[PLAY_LEVELS_MAX][PLAY_LEVELS_NAME_MAX];
+  for (int i = 0; i < PLAY_LEVELS_MAX; i++) {
+    bounds[i] = i < count - 1 ? r.getFloat() : INFINITY;
+    if (i < count - 1 && (!isfinite(bounds[i]) || (i > 0 && !(bounds[i] > bounds[i - 1])))) {
+      return false;
+    }
+  }
+  for (int i = 0; i < count; i++) {
+    colors[i] = r.get16();
+    r.getStr(names[i], PLAY_LEVELS_NAME_MAX);
+  }
+  if (!r.ok() || r.remaining()) {
+    return false;
+  }
+  // Unused bands repeat the last one, so a lookup never needs a clamp
+  for (int i = count; i < PLAY_LEVELS_MAX; i++) {
+    colors[i] = colors[count - 1];
+    memcpy(names[i], names[count - 1], PLAY_LEVELS_NAME_MAX);
+  }
+
+  memcpy(this->bounds, bounds, sizeof(bounds));
+  memcpy(this->colors, colors, sizeof(colors));
+  memcpy(this->names, names, sizeof(names));
+  this->bands = count;
+  return true;
+}
+
+// Number of boundaries at or below the stage. The table is always
+// PLAY_LEVELS_MAX long, so this is the same four compare-and-selects for any
+// river, with no branch on the data.
+uint8_t PlayLevels::classify(float stage) const {
+  const float* base = this->bounds;
+  for (int n = PLAY_LEVELS_MAX; n > 1; n -= n / 2) {
+    base = base[n / 2] <= stage ? base + n / 2 : base;
+  }
+  int band = (base - this->bounds) + (*base <= stage);
+  // Only an infinite stage gets past the padding
+  return band < PLAY_LEVELS_MAX ? band : PLAY_LEVELS_MAX - 1;
+}
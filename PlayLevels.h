@@ -0,0 +1,56 @@
+#ifndef _RIVER_WEATHER_PLAY_LEVELS_H_FILE
+#define _RIVER_WEATHER_PLAY_LEVELS_H_FILE
+
+#include <Arduino.h>
+
+/*
+ * The named play levels of a gauge, read from /levels/<USGS station>.bin so a
+ * different river is a different data file, not a different build. Bands are
+ * split by ascending stage boundaries; band i covers boundary[i-1] <= stage <
+ * boundary[i], the first and last bands are open ended.
+ *
+ * File layout, little endian, made by tools/make_levels.py:
+ *   "PLV" version(1)  bandCount(1)
+ *   boundary float x (bandCount - 1)
+ *   per band: colour565(2) name(length prefixed)
+ *   fnv1a32 of everything before it(4)
+ *
+ * Without a file the gauge has no play levels: one unnamed grey band and no
+ * boundaries, so nothing is named and no crossing is forecast.
+ */
+
+#define PLAY_LEVELS_VERSION    1
+#define PLAY_LEVELS_MAX       16   // bands, a power of two so every lookup takes the same steps
+#define PLAY_LEVELS_NAME_MAX  16
+#define PLAY_LEVELS_FILE_MAX 512
+
+class PlayLevels {
+  public:
+    PlayLevels();
+
+    // Replace the table with a file's, the current one is kept on any error
+    bool load(const char* path);
+    bool decode(const uint8_t* data, size_t len);
+
+    // Band of a stage, a NAN stage is in band 0
+    uint8_t classify(float stage) const;
+
+    const char* name(float stage) const { return this->names[classify(stage)]; }
+    uint16_t color(float stage) const { return this->colors[classify(stage)]; }
+    const char* bandName(uint8_t band) const { return this->names[band < this->bands ? band : this->bands - 1]; }
+    uint16_t bandColor(uint8_t band) const { return this->colors[band < this->bands ? band : this->bands - 1]; }
+
+    // The boundaries between bands, ascending, for the crossing forecasts
+    const float* boundaries() const { return this->bounds; }
+    uint8_t boundaryCount() const { return this->bands - 1; }
+    uint8_t bandCount() const { return this->bands; }
+
+  private:
+    // Unused tail entries are +infinity so the search never stops early
+    float    bounds[PLAY_LEVELS_MAX];
+    uint16_t colors[PLAY_LEVELS_MAX];
+    char     names[PLAY_LEVELS_MAX][PLAY_LEVELS_NAME_MAX];
+    uint8_t  bands = 0;
+};
+
+#endif
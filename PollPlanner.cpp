@@ -0,0 +1,139 @@
+#include "PollPlanner.h"
+#include <Print.h>
+
+void PollPlanner::configure(uint8_t id, const char* name, uint32_t defaultS, uint32_t minProbeS, uint32_t maxProbeS, uint32_t maxWaitS) {
+  if (id >= POLL_SOURCES_MAX) {
+    return;
+  }
+  Source& s = this->sources[id];
+  s = Source();
+  s.name = name;
+  s.defaultS = defaultS;
+  s.minProbeS = minProbeS;
+  s.maxProbeS = maxProbeS;
+  s.maxWaitS = maxWaitS;
+}
+
+static uint32_t median(const uint32_t* values, uint8_t count) {
+  uint32_t sorted[POLL_GAPS];
+  for (int i = 0; i < count; i++) {
+    uint32_t v = values[i];
+    int j = i;
+    while (j > 0 && sorted[j - 1] > v) {
+      sorted[j] = sorted[j - 1];
+      j--;
+    }
+    sorted[j] = v;
+  }
+  return sorted[count / 2];
+}
+
+void PollPlanner::learn(Source& s, uint32_t nowS, uint32_t dataS) {
+  if (s.lastDataS) {
+    s.gaps[s.gapNext] = dataS - s.lastDataS;
+    s.gapNext = (s.gapNext + 1) % POLL_GAPS;
+    if (s.gapCount < POLL_GAPS) s.gapCount++;
+    s.cadenceS = median(s.gaps, s.gapCount);
+    s.shortestS = s.gaps[0];
+    for (int i = 1; i < s.gapCount; i++) {
+      if (s.gaps[i] < s.shortestS) s.shortestS = s.gaps[i];
+    }
+  }
+
+  // The lag is only pinned down when the last poll came after the timestamp
+  // and missed the data, then it appeared in between. Otherwise this poll only
+  // shows it is no longer than the data's age now.
+  int32_t latest = (int32_t)(nowS - dataS);
+  bool bracketed = s.lastFetchS > dataS;
+  int32_t lag = bracketed ? ((int32_t)(s.lastFetchS - dataS) + latest) / 2 : latest;
+  if (!s.lagKnown) {
+    // The first poll may come long after the data, that says little about
+    // the lag. Keep to defaultS until a poll brackets it.
+    if (bracketed) {
+      s.lagS = lag;
+      s.lagDevS = lag / 2;
+      s.lagKnown = true;
+    }
+  } else if (bracketed || lag < s.lagS) {
+    int32_t err = lag - s.lagS;
+    s.lagS += err / 4;
+    s.lagDevS += ((err < 0 ? -err : err) - s.lagDevS) / 4;
+  } else {
+    // Polling late only ever confirms the estimate, so creep earlier until a
+    // poll lands before the data again and brackets it
+    s.lagS -= s.lagDevS / 4 + 1;
+    s.lagDevS -= s.lagDevS / 8;
+  }
+  if (s.lagS < 0) {
+    s.lagS = 0;
+  }
+  s.totalAgeS += latest;
+  s.fresh++;
+  s.lastDataS = dataS;
+}
+
+uint32_t PollPlanner::expected(const Source& s) {
+  if (s.gapCount < POLL_GAPS_MIN || !s.lagKnown) {
+    return 0;
+  }
+  return s.lastDataS + s.cadenceS + (s.lagS > 0 ? s.lagS : 0);
+}
+
+uint32_t PollPlanner::expectedS(uint8_t id) const {
+  return id < POLL_SOURCES_MAX ? expected(this->sources[id]) : 0;
+}
+
+uint32_t PollPlanner::nextWait(Source& s, uint32_t nowS) {
+  uint32_t due = expected(s);
+  uint32_t wait;
+  // Start as early as the shortest recent gap says it can come, less a deviation
+  int32_t early = (int32_t)(s.cadenceS - s.shortestS) + s.lagDevS;
+  if (!due || s.shortestS <= s.defaultS) {
+    // Publishes at least as often as the fixed interval polls, timing the
+    // polls cannot beat it
+    wait = s.defaultS;
+  } else if ((int32_t)(due - early - nowS) > 0) {
+    wait = due - early - nowS;
+  } else {
+    // Late, probe and back off while it stays late
+    wait = s.misses < 16 ? s.minProbeS << s.misses : s.maxProbeS;
+    if (wait > s.maxProbeS) wait = s.maxProbeS;
+    // Never further apart than the fixed interval while the data is due
+    if (wait > s.defaultS) wait = s.defaultS;
+    if (s.misses < 16) s.misses++;
+  }
+  if (wait < POLL_MIN_WAIT_S) wait = POLL_MIN_WAIT_S;
+  if (wait > s.maxWaitS) wait = s.maxWaitS;
+  return wait;
+}
+
+uint32_t PollPlanner::fetched(uint8_t id, uint32_t nowS, uint32_t dataS) {
+  if (id >= POLL_SOURCES_MAX || !this->sources[id].name) {
+    return 0;
+  }
+  Source& s = this->sources[id];
+  s.fetches++;
+  bool fresh = dataS && (int32_t)(dataS - s.lastDataS) > 0;
+  if (fresh) {
+    learn(s, nowS, dataS);
+    s.misses = 0;
+  } else {
+    s.unchanged++;
+  }
+  s.lastFetchS = nowS;
+  return nextWait(s, nowS);
+}
+
+void PollPlanner::report(Print& out, uint32_t nowS) const {
+  for (int i = 0; i < POLL_SOURCES_MAX; i++) {
+    const Source& s = this->sources[i];
+    if (!s.name) {
+      continue;
+    }
+    uint32_t due = expected(s);
+    out.printf("  %-12s every %4u min  lag %3d+-%-3d min  expected in %5d min  %u fetches, %u unchanged, avg age %u min\n",
+               s.name, s.cadenceS / 60, s.lagS / 60, s.lagDevS / 60,
+               due ? (int32_t)(due - nowS) / 60 : 0, s.fetches, s.unchanged,
+               s.fresh ? s.totalAgeS / s.fresh / 60 : 0);
+  }
+}
@@ -0,0 +1,82 @@
+#ifndef _RIVER_WEATHER_POLL_PLANNER_H_FILE
+#define _RIVER_WEATHER_POLL_PLANNER_H_FILE
+
+#include <stdint.h>
+
+/*
+ * Picks when to poll a source from when it publishes, learnt from the data
+ * timestamps the fetches return (the newest USGS row, the NWS issue time).
+ *
+ *   cadence  median gap between successive new timestamps
+ *   lag      how long after its timestamp the data shows up, smoothed along
+ *            with its deviation the way TCP smooths round trip times
+ *
+ * The next poll is as early before the expected publication as the shortest
+ * recent gap fell short of the cadence, and one lag deviation earlier still.
+ * If it has nothing new the source is probed again after minProbeS, doubling
+ * on every miss up to maxProbeS but never past defaultS, so a late source is
+ * never polled less often than the fixed interval would. A source that has
+ * shown a gap no longer than defaultS is polled every defaultS, as is one
+ * with fewer than POLL_GAPS_MIN gaps or whose lag no poll has bracketed yet.
+ * No wait is ever longer than maxWaitS.
+ *
+ * Times are Unix seconds passed in by the caller, so the policy runs the same
+ * in a host simulation (tools/poll_sim.cpp). Ids match the NetScheduler ids.
+ */
+
+#define POLL_SOURCES_MAX 6
+#define POLL_GAPS          8     // gaps kept for the cadence median
+#define POLL_GAPS_MIN      4     // gaps seen before the cadence is trusted
+#define POLL_MIN_WAIT_S   30
+
+class Print;
+
+class PollPlanner {
+  public:
+    void configure(uint8_t id, const char* name, uint32_t defaultS, uint32_t minProbeS, uint32_t maxProbeS, uint32_t maxWaitS);
+
+    // A fetch at nowS returned data stamped dataS. Returns the seconds until the next poll.
+    uint32_t fetched(uint8_t id, uint32_t nowS, uint32_t dataS);
+
+    // When the next new data should appear, 0 until the cadence and lag are known
+    uint32_t expectedS(uint8_t id) const;
+
+    uint32_t fetches(uint8_t id) const { return this->sources[id].fetches; }
+    uint32_t unchanged(uint8_t id) const { return this->sources[id].unchanged; }
+
+    void report(Print& out, uint32_t nowS) const;
+
+  private:
+    typedef struct Source {
+      const char* name;
+      uint32_t    defaultS;
+      uint32_t    minProbeS;
+      uint32_t    maxProbeS;
+      uint32_t    maxWaitS;
+
+      uint32_t    lastDataS;      // newest timestamp seen
+      uint32_t    lastFetchS;
+      uint32_t    gaps[POLL_GAPS];
+      uint8_t     gapCount;
+      uint8_t     gapNext;
+      uint32_t    cadenceS;
+      uint32_t    shortestS;      // shortest gap kept
+      int32_t     lagS;
+      int32_t     lagDevS;
+      bool        lagKnown;
+      uint8_t     misses;         // polls with nothing new since the data was expected
+
+      uint32_t    fetches;
+      uint32_t    unchanged;
+      uint32_t    fresh;
+      uint32_t    totalAgeS;      // age of new data when it was fetched, summed
+    } Source;
+
+    void learn(Source& s, uint32_t nowS, uint32_t dataS);
+    uint32_t nextWait(Source& s, uint32_t nowS);
+    static uint32_t expected(const Source& s);
+
+    Source sources[POLL_SOURCES_MAX] = {};
+};
+
+#endif
@@ -0,0 +1,36 @@
+#include "RenderTrace.h"
+
+#ifdef RENDER_TRACE
+
+RenderTrace renderTrace;
+
+void RenderTrace::record(const char* name, uint32_t startUs, uint32_t durUs, uint32_t pixels, uint32_t spiBytes) {
+  TraceEvent& ev = events[next];
+  ev.name     = name;
+  ev.startUs  = startUs;
+  ev.durUs    = durUs;
+  ev.pixels   = pixels;
+  ev.spiBytes = spiBytes;
+  next = (next + 1) % RENDER_TRACE_EVENTS;
+  if (count < RENDER_TRACE_EVENTS) count++;
+}
+
+void RenderTrace::clear() {
+  next = 0;
+  count = 0;
+}
+
+// Complete ("X") events, oldest first. Chrome nests spans on the same thread by time.
+void RenderTrace::exportChromeJson(Print& out) {
+  uint16_t first = (next + RENDER_TRACE_EVENTS - count) % RENDER_TRACE_EVENTS;
+  out.print("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  for (uint16_t i = 0; i < count; i++) {
+    const TraceEvent& ev = events[(first + i) % RENDER_TRACE_EVENTS];
+    out.printf("{\"name\":\"%s\",\"cat\":\"render\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%u,\"dur\":%u,"
+               "\"args\":{\"pixels\":%u,\"spi_bytes\":%u}}%s\n",
+               ev.name, ev.startUs, ev.durUs, ev.pixels, ev.spiBytes, (i + 1 < count) ? "," : "");
+  }
+  out.print("]}\n");
+}
+
+#endif
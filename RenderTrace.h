@@ -0,0 +1,93 @@
+#ifndef _RIVER_WEATHER_RENDER_TRACE_H_FILE
+#define _RIVER_WEATHER_RENDER_TRACE_H_FILE
+
+/*
+ * Scoped spans around draw primitives and asset loads, kept in a ring buffer
+ * and exported as Chrome trace_event JSON ('t' on the serial monitor). Save the
+ * output to a .json file and open it in chrome://tracing or ui.perfetto.dev.
+ *
+ * Leave RENDER_TRACE undefined and every macro below compiles to nothing.
+ */
+//#define RENDER_TRACE
+
+#include <Arduino.h>
+
+#ifdef RENDER_TRACE
+
+#define RENDER_TRACE_EVENTS 256
+
+// Bytes clocked out per setWindow() (CASET + RASET + RAMWR with their arguments)
+#define TRACE_WINDOW_SPI_BYTES 11
+
+class TraceSpan;
+
+typedef struct TraceEvent {
+  const char* name;     // must be a string literal, only the pointer is kept
+  uint32_t    startUs;
+  uint32_t    durUs;
+  uint32_t    pixels;
+  uint32_t    spiBytes;
+} TraceEvent;
+
+class RenderTrace {
+  public:
+    void record(const char* name, uint32_t startUs, uint32_t durUs, uint32_t pixels, uint32_t spiBytes);
+    void exportChromeJson(Print& out);
+    void clear();
+    uint16_t recorded() const { return count; }
+
+    TraceSpan* open = NULL;   // innermost open span
+
+  private:
+    TraceEvent events[RENDER_TRACE_EVENTS];
+    uint16_t   next = 0;
+    uint16_t   count = 0;
+};
+
+extern RenderTrace renderTrace;
+
+// A primitive span is one TracedTFT draw call; the primitives TFT_eSPI calls
+// from inside it add their pixels to it rather than getting spans of their own.
+class TraceSpan {
+  public:
+    TraceSpan(const char* name, uint32_t pixels = 0, bool primitive = false)
+      : name(name), startUs(micros()), pixels(pixels), primitive(primitive), parent(renderTrace.open) {
+      renderTrace.open = this;
+    }
+    ~TraceSpan() {
+      renderTrace.open = parent;
+      // 16 bit colour, two bytes per pixel plus the address window
+      uint32_t spiBytes = pixels ? pixels * 2 + TRACE_WINDOW_SPI_BYTES : 0;
+      renderTrace.record(name, startUs, micros() - startUs, pixels, spiBytes);
+    }
+    void addPixels(uint32_t n) { pixels += n; }
+    uint32_t counted() const { return pixels; }
+    bool isPrimitive() const { return primitive; }
+
+  private:
+    const char* name;
+    uint32_t    startUs;
+    uint32_t    pixels;
+    bool        primitive;
+    TraceSpan*  parent;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name)              TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name)
+#define TRACE_SPAN(var, name)          TraceSpan var(name)
+#define TRACE_ADD_PIXELS(var, n)       (var).addPixels(n)
+#define TRACE_EXPORT(out)              renderTrace.exportChromeJson(out)
+#define TRACE_CLEAR()                  renderTrace.clear()
+
+#else
+
+#define TRACE_SCOPE(name)
+#define TRACE_SPAN(var, name)
+#define TRACE_ADD_PIXELS(var, n)
+#define TRACE_EXPORT(out)
+#define TRACE_CLEAR()
+
+#endif
+
+#endif
@@ -0,0 +1,82 @@
+#include "RetryPolicy.h"
+
+RetryPolicy::RetryPolicy(const char* name, uint32_t baseMs, uint32_t maxBackoffMs, uint32_t openMs, uint32_t maxOpenMs) {
+  this->name = name;
+  this->baseMs = baseMs;
+  this->maxBackoffMs = maxBackoffMs;
+  this->openMs = openMs;
+  this->maxOpenMs = maxOpenMs;
+  this->currentOpenMs = openMs;
+}
+
+const char* RetryPolicy::stateName() const {
+  switch (this->circuit) {
+    case CIRCUIT_OPEN:      return "open";
+    case CIRCUIT_HALF_OPEN: return "half-open";
+    default:                return "closed";
+  }
+}
+
+void RetryPolicy::setState(CircuitState state) {
+  if (state != this->circuit) {
+    this->circuit = state;
+    Serial.printf("%s circuit %s after %d failures\n", this->name, stateName(), this->consecutiveFailures);
+  }
+}
+
+bool RetryPolicy::allow(uint32_t nowMs) {
+  if (this->circuit == CIRCUIT_CLOSED) {
+    return true;
+  }
+  // Open, or half-open with the probe still out
+  if (nowMs - this->openedAtMs < this->currentOpenMs) {
+    return false;
+  }
+  // The probe's period starts now, so a probe whose result never comes is
+  // followed by another one open period later rather than a stream of them
+  setState(CIRCUIT_HALF_OPEN);
+  this->openedAtMs = nowMs;
+  return true;
+}
+
+uint32_t RetryPolicy::waitMs(uint32_t nowMs) const {
+  if (this->circuit == CIRCUIT_CLOSED) {
+    return 0;
+  }
+  uint32_t elapsed = nowMs - this->openedAtMs;
+  return elapsed < this->currentOpenMs ? this->currentOpenMs - elapsed : 0;
+}
+
+void RetryPolicy::recordSuccess() {
+  setState(CIRCUIT_CLOSED);
+  this->consecutiveFailures = 0;
+  this->currentOpenMs = this->openMs;
+}
+
+// Exponential with "equal jitter": half the step is fixed, half is random, so
+// displays that failed together do not retry together
+uint32_t RetryPolicy::backoffMs() {
+  uint8_t shift = this->consecutiveFailures - 1;
+  if (shift > 16) shift = 16;
+  uint32_t step = this->baseMs << shift;
+  if (step > this->maxBackoffMs || step < this->baseMs) {
+    step = this->maxBackoffMs;
+  }
+  return step / 2 + random(step / 2 + 1);
+}
+
+uint32_t RetryPolicy::recordFailure(uint32_t nowMs) {
+  if (this->consecutiveFailures < 255) {
+    this->consecutiveFailures++;
+  }
+
+  if (this->circuit == CIRCUIT_HALF_OPEN) {
+    // The probe failed, stay away twice as long
+    this->currentOpenMs = this->currentOpenMs > this->maxOpenMs / 2 ? this->maxOpenMs : this->currentOpenMs * 2;
+  } else if (this->consecutiveFailures < RETRY_OPEN_AFTER) {
+    return backoffMs();
+  }
+  this->openedAtMs = nowMs;
+  setState(CIRCUIT_OPEN);
+  return this->currentOpenMs;
+}
@@ -0,0 +1,62 @@
+#ifndef _RIVER_WEATHER_RETRY_POLICY_H_FILE
+#define _RIVER_WEATHER_RETRY_POLICY_H_FILE
+
+#include <Arduino.h>
+
+/*
+ * Retry schedule and circuit breaker for one upstream endpoint.
+ *
+ * A failed fetch is retried after a jittered exponential backoff instead of
+ * blocking. After RETRY_OPEN_AFTER consecutive failures the circuit opens and
+ * the endpoint is left alone for an open period, which doubles on every failed
+ * probe. When the open period is over one half-open probe is let through and
+ * nothing else until its result is recorded, or another open period has gone
+ * by without one. The probe closes the circuit if it succeeds.
+ *
+ * The policy never sleeps, it only returns how long the caller should wait,
+ * normally handed to Task::delay().
+ */
+
+#define RETRY_OPEN_AFTER 4
+
+typedef enum {
+  CIRCUIT_CLOSED,
+  CIRCUIT_OPEN,
+  CIRCUIT_HALF_OPEN
+} CircuitState;
+
+class RetryPolicy {
+  public:
+    RetryPolicy(const char* name, uint32_t baseMs, uint32_t maxBackoffMs, uint32_t openMs, uint32_t maxOpenMs);
+
+    // May a request go out now? Moves an expired open circuit to half-open
+    // and lets its probe through.
+    bool allow(uint32_t nowMs);
+    // How long until allow() will say yes
+    uint32_t waitMs(uint32_t nowMs) const;
+
+    void recordSuccess();
+    // Returns the delay before the next attempt
+    uint32_t recordFailure(uint32_t nowMs);
+
+    CircuitState state() const { return this->circuit; }
+    uint8_t failures() const { return this->consecutiveFailures; }
+    const char* stateName() const;
+
+  private:
+    uint32_t backoffMs();
+    void setState(CircuitState state);
+
+    const char*  name;
+    uint32_t     baseMs;
+    uint32_t     maxBackoffMs;
+    uint32_t     openMs;
+    uint32_t     maxOpenMs;
+
+    CircuitState circuit = CIRCUIT_CLOSED;
+    uint8_t      consecutiveFailures = 0;
+    uint32_t     currentOpenMs = 0;
+    uint32_t     openedAtMs = 0;
+};
+
+#endif
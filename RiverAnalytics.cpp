@@ -0,0 +1,136 @@
+#include "RiverAnalytics.h"
+
+void StageRate::add(uint32_t time, float stage) {
+  if (this->samples && time <= this->time) {
+    return;
+  }
+  if (this->samples) {
+    float hours = (time - this->time) / 3600.0f;
+    float instant = (stage - this->stage) / hours;
+    if (this->samples == 1) {
+      this->rate = instant;
+    } else {
+      // dt / (tau + dt) approximates 1 - exp(-dt / tau) and keeps gaps from being over-weighted
+      float alpha = (float)(time - this->time) / (RIVER_RATE_TAU_S + (time - this->time));
+      this->rate += alpha * (instant - this->rate);
+    }
+  }
+  this->time = time;
+  this->stage = stage;
+  this->samples++;
+}
+
+
+RiverAnalytics::RiverAnalytics(const float* levels, uint8_t count) {
+  setLevels(levels, count);
+}
+
+void RiverAnalytics::setLevels(const float* levels, uint8_t count) {
+  this->levelCount = count < RIVER_LEVELS_MAX ? count : RIVER_LEVELS_MAX;
+  memcpy(this->levels, levels, this->levelCount * sizeof(float));
+}
+
+// Rows come newest first from NWS, either order is accepted
+static void feedRows(StageRate& trend, const RiverStatus* rows, int count) {
+  bool descending = count > 1 && rows[1].time < rows[0].time;
+  for (int i = 0; i < count; i++) {
+    const RiverStatus* rs = &rows[descending ? count - 1 - i : i];
+    trend.add(rs->time, rs->stage);
+  }
+}
+
+void RiverAnalytics::update(const HydrographModel* model, const StationReading* reading) {
+  // Observations: the hydrograph's, then the live gauge reading if it is newer
+  feedRows(this->trend, model->observed_array, model->last_observed);
+  if (reading && reading->time) {
+    this->trend.add(reading->time, reading->stage);
+  }
+
+  this->forecastCount = 0;
+  bool descending = model->last_forecast > 1 && model->forecast_array[1].time < model->forecast_array[0].time;
+  for (int i = 0; i < model->last_forecast; i++) {
+    const RiverStatus* rs = &model->forecast_array[descending ? model->last_forecast - 1 - i : i];
+    this->forecastTime[this->forecastCount] = rs->time;
+    this->forecastStage[this->forecastCount] = rs->stage;
+    this->forecastCount++;
+  }
+
+  // Walk from the latest observation through the rest of the forecast
+  this->crossings = 0;
+  uint32_t t0 = this->trend.lastTime();
+  float s0 = this->trend.lastStage();
+  if (!t0) {
+    return;
+  }
+  for (int i = 0; i < this->forecastCount; i++) {
+    if (this->forecastTime[i] <= t0) {
+      continue;
+    }
+    addCrossings(t0, s0, this->forecastTime[i], this->forecastStage[i]);
+    t0 = this->forecastTime[i];
+    s0 = this->forecastStage[i];
+  }
+}
+
+// First level above stage
+static int upperBound(const float* levels, int count, float stage) {
+  int lo = 0;
+  int hi = count;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (levels[mid] <= stage) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+// A level counts as crossed when the stage goes from below it to at or above
+// it, or back, matching the "stage < level" test getPlayString uses
+void RiverAnalytics::addCrossings(uint32_t t0, float s0, uint32_t t1, float s1) {
+  if (s0 == s1) {
+    return;
+  }
+  int from = upperBound(this->levels, this->levelCount, s0);
+  int to = upperBound(this->levels, this->levelCount, s1);
+  bool rising = s1 > s0;
+  int step = rising ? 1 : -1;
+  for (int k = rising ? from : from - 1; rising ? k < to : k >= to; k += step) {
+    if (this->crossings == RIVER_CROSSINGS_MAX) {
+      return;
+    }
+    float level = this->levels[k];
+    LevelCrossing* c = &this->crossingList[this->crossings++];
+    c->time = t0 + (uint32_t)((level - s0) / (s1 - s0) * (t1 - t0) + 0.5f);
+    c->stage = level;
+    c->rising = rising;
+  }
+}
+
+float RiverAnalytics::stageAt(uint32_t time) const {
+  int n = this->forecastCount;
+  if (!n || time < this->forecastTime[0] || time > this->forecastTime[n - 1]) {
+    return NAN;
+  }
+  // Last point at or before time
+  int lo = 0;
+  int hi = n - 1;
+  while (lo < hi) {
+    int mid = (lo + hi + 1) / 2;
+    if (this->forecastTime[mid] <= time) lo = mid;
+    else hi = mid - 1;
+  }
+  if (lo == n - 1) {
+    return this->forecastStage[lo];
+  }
+  float f = (float)(time - this->forecastTime[lo]) / (this->forecastTime[lo + 1] - this->forecastTime[lo]);
+  return this->forecastStage[lo] + f * (this->forecastStage[lo + 1] - this->forecastStage[lo]);
+}
+
+const LevelCrossing* RiverAnalytics::nextCrossing(uint32_t after) const {
+  for (int i = 0; i < this->crossings; i++) {
+    if (this->crossingList[i].time >= after) {
+      return &this->crossingList[i];
+    }
+  }
+  return NULL;
+}
@@ -0,0 +1,80 @@
+#ifndef _RIVER_WEATHER_RIVER_ANALYTICS_H_FILE
+#define _RIVER_WEATHER_RIVER_ANALYTICS_H_FILE
+
+#include <Arduino.h>
+#include "hydrograph.h"
+#include "USGSRDB.h"
+
+/*
+ * Where the river is heading, worked out once per data update so the draw
+ * functions only read results:
+ *   - a smoothed rate of change, updated in O(1) per new observation
+ *   - the forecast stage at any time, by binary search over the segments
+ *   - when the observed-then-forecast curve next crosses each play level
+ */
+
+#define RIVER_RATE_TAU_S     (2 * 60 * 60)   // smoothing time constant of the rate
+#define RIVER_LEVELS_MAX     16
+#define RIVER_CROSSINGS_MAX   8
+
+// Exponentially weighted rate of change for unevenly spaced samples
+class StageRate {
+  public:
+    // Samples at or before the last one are ignored, so a series can be fed again
+    void add(uint32_t time, float stage);
+
+    bool ready() const { return this->samples >= 2; }
+    float feetPerHour() const { return this->rate; }
+    uint32_t lastTime() const { return this->time; }
+    float lastStage() const { return this->stage; }
+
+  private:
+    uint32_t samples = 0;
+    uint32_t time = 0;
+    float    stage = 0.0f;
+    float    rate = 0.0f;
+};
+
+typedef struct LevelCrossing {
+  uint32_t time;     // Unix seconds
+  float    stage;    // the level crossed
+  bool     rising;
+} LevelCrossing;
+
+class RiverAnalytics {
+  public:
+    // Levels are stage boundaries in feet, ascending
+    RiverAnalytics(const float* levels, uint8_t count);
+    // Takes effect at the next update()
+    void setLevels(const float* levels, uint8_t count);
+
+    // Take in new observations and redo the forecast and crossings
+    void update(const HydrographModel* model, const StationReading* reading);
+
+    float rate() const { return this->trend.ready() ? this->trend.feetPerHour() : NAN; }
+    uint32_t lastObserved() const { return this->trend.lastTime(); }
+
+    // Linear between forecast points, NAN outside the forecast
+    float stageAt(uint32_t time) const;
+
+    // The first crossing at or after a time, NULL when none is forecast
+    const LevelCrossing* nextCrossing(uint32_t after) const;
+    uint8_t crossingCount() const { return this->crossings; }
+    const LevelCrossing* crossing(uint8_t i) const { return &this->crossingList[i]; }
+
+  private:
+    void addCrossings(uint32_t t0, float s0, uint32_t t1, float s1);
+
+    float     levels[RIVER_LEVELS_MAX];
+    uint8_t   levelCount;
+    StageRate trend;
+
+    uint32_t  forecastTime[HYDROGRAPH_COUNT_MAX];   // ascending
+    float     forecastStage[HYDROGRAPH_COUNT_MAX];
+    uint8_t   forecastCount = 0;
+
+    LevelCrossing crossingList[RIVER_CROSSINGS_MAX];
+    uint8_t       crossings = 0;
+};
+
+#endif
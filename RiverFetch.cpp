@@ -0,0 +1,212 @@
+#include "RiverFetch.h"
+#include "Metrics.h"
+#include "utils.h"
+#include "All_Settings.h"
+#if defined(MODEL_CACHE_SERVER) || defined(MODEL_CACHE_PEER) || defined(PEER_PUSH)
+#include "ModelCache.h"
+#endif
+#ifdef PEER_PUSH
+#include "PeerPush.h"
+#endif
+
+// Time a fetch run from a wake window, lateness is against the source's due time
+#define METRICS_FETCH(id, source) TaskTimer taskTimer(id, this->scheduler->lateMs(source, millis()))
+
+// name, first backoff, longest backoff, first open period, longest open period
+RiverFetch::RiverFetch(USGSStation* usgs, Hydrograph* hydrograph, OneCallWeather* oneCall, RiverAnalytics* analytics,
+                       RiverPages* pages, SntpClock* clock, NetScheduler* scheduler, PollPlanner* planner)
+    : usgsRetry("USGS", 15 * 1000, 5 * 60 * 1000, 10 * 60 * 1000, 60 * 60 * 1000),
+      nwsRetry("NWS", 30 * 1000, 5 * 60 * 1000, 15 * 60 * 1000, 2 * 60 * 60 * 1000),
+      weatherRetry("OpenWeather", 30 * 1000, 10 * 60 * 1000, 30 * 60 * 1000, 2 * 60 * 60 * 1000),
+      ntpRetry("NTP", 5 * 1000, 5 * 60 * 1000, 10 * 60 * 1000, 60 * 60 * 1000) {
+  this->usgs = usgs;
+  this->hydrograph = hydrograph;
+  this->oneCall = oneCall;
+  this->analytics = analytics;
+  this->pages = pages;
+  this->clock = clock;
+  this->scheduler = scheduler;
+  this->planner = planner;
+}
+
+void RiverFetch::begin(uint32_t nowMs, FetchRedraw redraw) {
+  this->redraw = redraw;
+  // name, interval, how early it may join a window, how late it may wait for one
+  this->scheduler->configure(NET_USGS,    "USGS",        20 * 60 * 1000,      1 * 60 * 1000,  2 * 60 * 1000, nowMs);
+  this->scheduler->configure(NET_NWS,     "NWS",         15 * 60 * 1000,      5 * 60 * 1000,  2 * 60 * 1000, nowMs);
+  this->scheduler->configure(NET_WEATHER, "OpenWeather", 30 * 60 * 1000,     10 * 60 * 1000,  5 * 60 * 1000, nowMs);
+  this->scheduler->configure(NET_TIME,    "NTP",         SNTP_POLL_MIN_MS,    10 * 60 * 1000, 10 * 60 * 1000, nowMs);
+  // Only does anything after a lost push, which brings it forward
+  this->scheduler->configure(NET_PEER,    "Peer",        24 * 60 * 60 * 1000,  0,              5 * 60 * 1000,  nowMs);
+  // name, interval until learnt, first probe, longest probe, longest wait (seconds).
+  // tools/poll_sim.cpp runs these against simulated publishing. USGS may only join a
+  // window a minute early, earlier than that it would mostly find nothing new.
+  this->planner->configure(NET_USGS, "USGS", 20 * 60, 3 * 60, 15 * 60, 60 * 60);
+  this->planner->configure(NET_NWS,  "NWS",  15 * 60, 5 * 60, 60 * 60, 3 * 60 * 60);
+}
+
+void RiverFetch::share(ModelCache* cache, PeerPush* push) {
+  this->cache = cache;
+  this->push = push;
+}
+
+RetryPolicy* RiverFetch::retry(uint8_t source) {
+  switch (source) {
+    case NET_USGS:    return &this->usgsRetry;
+    case NET_NWS:     return &this->nwsRetry;
+    case NET_WEATHER: return &this->weatherRetry;
+    case NET_TIME:    return &this->ntpRetry;
+    default:          return NULL;
+  }
+}
+
+bool RiverFetch::retryAllows(uint8_t source) {
+  RetryPolicy* policy = this->retry(source);
+  if (!policy || policy->allow(millis())) {
+    return true;
+  }
+  this->scheduler->schedule(source, millis(), policy->waitMs(millis()));
+  return false;
+}
+
+void RiverFetch::retrySchedule(uint8_t source, bool success) {
+  RetryPolicy* policy = this->retry(source);
+  if (!policy) {
+    this->scheduler->completed(source, millis());
+    return;
+  }
+  if (success) {
+    policy->recordSuccess();
+    this->scheduler->completed(source, millis());
+    return;
+  }
+  uint32_t waitMs = policy->recordFailure(millis());
+  Serial.printf("Next attempt in %u s\n", waitMs / 1000);
+  this->scheduler->schedule(source, millis(), waitMs);
+}
+
+void RiverFetch::planNext(uint8_t source) {
+  uint32_t now = this->clock->unixSeconds();
+  if (!now) {
+    return;
+  }
+  uint32_t dataTime;
+  if (source == NET_USGS) {
+    dataTime = this->usgs->getLastReading()->time;
+  } else if (source == NET_NWS) {
+    dataTime = parseIsoTime(this->hydrograph->model()->forecastIssued);
+  } else {
+    return;
+  }
+  this->scheduler->schedule(source, millis(), this->planner->fetched(source, now, dataTime) * 1000);
+}
+
+bool RiverFetch::refresh(uint8_t source) {
+  switch (source) {
+    case NET_USGS:    return this->pages->refreshReading();
+    case NET_NWS:     return this->pages->refreshForecast();
+    case NET_WEATHER: return this->pages->refreshWeather();
+    default:          return false;
+  }
+}
+
+// An upstream fetch goes into the model cache for the other displays
+void RiverFetch::shareFetched(uint8_t source) {
+#if defined(MODEL_CACHE_SERVER) || defined(PEER_PUSH)
+  if (this->cache) {
+    this->cache->update();
+  }
+#endif
+#ifdef PEER_PUSH
+  if (this->push) {
+    uint8_t kind = source == NET_USGS ? PEER_PUSH_READING : source == NET_NWS ? PEER_PUSH_HYDROGRAPH : PEER_PUSH_WEATHER;
+    this->push->broadcast(kind, this->clock->unixSeconds());
+  }
+#else
+  (void)source;
+#endif
+}
+
+void RiverFetch::fetchUSGSStation() {
+  METRICS_FETCH(METRIC_TASK_FETCH_USGS, NET_USGS);
+  if (!this->retryAllows(NET_USGS)) {
+    return;
+  }
+  uint32_t startMs = millis();
+#ifdef MODEL_CACHE_PEER
+  bool success = this->cache->fetchFromPeer(MODEL_CACHE_PEER) & MODEL_SECTION_READING;
+#else
+  bool success = this->usgs->fetch();
+  if (success) {
+    this->shareFetched(NET_USGS);
+  }
+#endif
+  this->retrySchedule(NET_USGS, success);
+  if (success) {
+    this->planNext(NET_USGS);
+    this->analytics->update(this->hydrograph->model(), this->usgs->getLastReading());
+    if (this->redraw ? this->redraw(NET_USGS) : this->refresh(NET_USGS)) {
+      metrics.recordRefresh(METRIC_SOURCE_USGS, millis() - startMs);
+      this->usgs->serialPrint();
+    }
+  }
+  metrics.sampleHeap();
+}
+
+void RiverFetch::fetchHydrograph() {
+  METRICS_FETCH(METRIC_TASK_FETCH_HYDROGRAPH, NET_NWS);
+  if (!this->retryAllows(NET_NWS)) {
+    return;
+  }
+  uint32_t startMs = millis();
+
+#ifdef MODEL_CACHE_PEER
+  bool parsed = (this->cache->fetchFromPeer(MODEL_CACHE_PEER) & MODEL_SECTION_HYDROGRAPH) &&
+                this->hydrograph->model()->last_forecast > 0;
+#else
+  bool parsed = this->hydrograph->fetch();
+  if (parsed) {
+    this->shareFetched(NET_NWS);
+  }
+#endif
+  this->retrySchedule(NET_NWS, parsed);
+  if (parsed) {
+    this->planNext(NET_NWS);
+    this->analytics->update(this->hydrograph->model(), this->usgs->getLastReading());
+  }
+  if (!parsed) {
+    Serial.println("hydrograph fetch failed. forecast is empty");
+  } else if (this->redraw ? this->redraw(NET_NWS) : this->refresh(NET_NWS)) {
+    metrics.recordRefresh(METRIC_SOURCE_NWS, millis() - startMs);
+    Serial.println("Displayed forecast");
+    this->hydrograph->printForecast();
+  }
+
+  metrics.sampleHeap();
+}
+
+void RiverFetch::fetchWeather() {
+  METRICS_FETCH(METRIC_TASK_FETCH_WEATHER, NET_WEATHER);
+  if (!this->retryAllows(NET_WEATHER)) {
+    return;
+  }
+  uint32_t startMs = millis();
+#ifdef MODEL_CACHE_PEER
+  bool success = (this->cache->fetchFromPeer(MODEL_CACHE_PEER) & MODEL_SECTION_WEATHER) &&
+                 this->oneCall->getWeather()->valid;
+#else
+  bool success = this->oneCall->fetch();
+  if (success) {
+    this->shareFetched(NET_WEATHER);
+  }
+#endif
+  Serial.printf("Fetching weather %s\n", success ? "succeeded" : "failed");
+  this->retrySchedule(NET_WEATHER, success);
+  if (!success) {
+    return;
+  }
+  if (this->redraw ? this->redraw(NET_WEATHER) : this->refresh(NET_WEATHER)) {
+    metrics.recordRefresh(METRIC_SOURCE_OPENWEATHER, millis() - startMs);
+  }
+  metrics.sampleHeap();
+}
@@ -0,0 +1,93 @@
+#ifndef _RIVER_WEATHER_RIVER_FETCH_H_FILE
+#define _RIVER_WEATHER_RIVER_FETCH_H_FILE
+
+#include "USGSRDB.h"
+#include "hydrograph.h"
+#include "OneCall.h"
+#include "RiverAnalytics.h"
+#include "RiverPages.h"
+#include "SntpClock.h"
+#include "NetScheduler.h"
+#include "PollPlanner.h"
+#include "RetryPolicy.h"
+
+/*
+ * The fetches the wake windows run, and what follows each one:
+ *
+ *   retries   each endpoint has a RetryPolicy, a failure backs off or opens
+ *             its circuit and the scheduler holds the source back for it
+ *   planning  a parsed reading or forecast puts the next poll just after the
+ *             source should publish again, once the clock is set
+ *   redraw    new data goes to the analytics and the page showing it
+ *
+ * The intervals, windows, retry and planning settings are all here, begin()
+ * applies them. The sketch runs the windows, the radio and the clock's syncs
+ * around this, tools/soak.cpp runs the same fetches for weeks of simulated
+ * uptime.
+ */
+
+// The fetches share wake windows, the radio sleeps in between
+typedef enum {
+  NET_USGS = 0,
+  NET_NWS,
+  NET_WEATHER,
+  NET_TIME,
+  NET_PEER          // pulls a peer's model after a lost push
+} NetSource;
+
+// Draws a source's new data, true if the page showing has it
+typedef bool (*FetchRedraw)(uint8_t source);
+
+class ModelCache;
+class PeerPush;
+
+class RiverFetch {
+  public:
+    RiverFetch(USGSStation* usgs, Hydrograph* hydrograph, OneCallWeather* oneCall, RiverAnalytics* analytics,
+               RiverPages* pages, SntpClock* clock, NetScheduler* scheduler, PollPlanner* planner);
+
+    // Every source is first due at nowMs. redraw stands in for refresh() after
+    // a fetch, NULL to use it.
+    void begin(uint32_t nowMs, FetchRedraw redraw = NULL);
+    // With MODEL_CACHE_PEER the fetches ask cache's peer instead of upstream.
+    // With MODEL_CACHE_SERVER or PEER_PUSH a fetch updates cache, and with
+    // PEER_PUSH push broadcasts it.
+    void share(ModelCache* cache, PeerPush* push);
+
+    void fetchUSGSStation();
+    void fetchHydrograph();
+    void fetchWeather();
+
+    // Holds the source back while the endpoint's circuit is open
+    bool retryAllows(uint8_t source);
+    // A failure brings the next attempt forward (backoff) or pushes it out
+    // (open circuit), a success puts the source back on its normal interval
+    void retrySchedule(uint8_t source, bool success);
+    // Next poll just after USGS or NWS should have published again. Until the
+    // clock is set the source keeps its fixed interval.
+    void planNext(uint8_t source);
+    // Redraws the part of the page that shows source, true if it is showing
+    bool refresh(uint8_t source);
+
+  private:
+    RetryPolicy* retry(uint8_t source);
+    void shareFetched(uint8_t source);
+
+    USGSStation*    usgs;
+    Hydrograph*     hydrograph;
+    OneCallWeather* oneCall;
+    RiverAnalytics* analytics;
+    RiverPages*     pages;
+    SntpClock*      clock;
+    NetScheduler*   scheduler;
+    PollPlanner*    planner;
+    ModelCache*     cache = NULL;
+    PeerPush*       push = NULL;
+    FetchRedraw     redraw = NULL;
+    RetryPolicy     usgsRetry;
+    RetryPolicy     nwsRetry;
+    RetryPolicy     weatherRetry;
+    RetryPolicy     ntpRetry;
+};
+
+#endif
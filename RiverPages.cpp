@@ -0,0 +1,420 @@
+#include "RiverPages.h"
+#include "RenderTrace.h"
+#include "TextFormat.h"
+#include "utils.h"
+#include "All_Settings.h"
+
+// As AceTime's DateStrings spells them, index 0 is unused
+static const char* const dayNames[8] = { "", "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+static const char* const monthNames[13] = { "", "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                            "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+RiverPages::RiverPages(TracedTFT* tft, SmoothFont* smallFont, GfxUi* ui, OneCallWeather* oneCall, USGSStation* usgs,
+                       HydrographView* hydrographView, Astronomy* astronomy, RiverAnalytics* analytics,
+                       PlayLevels* levels, SntpClock* clock)
+    : dials(tft), hourlyStrip(tft) {
+  this->tft = tft;
+  this->smallFont = smallFont;
+  this->ui = ui;
+  this->oneCall = oneCall;
+  this->usgs = usgs;
+  this->hydrographView = hydrographView;
+  this->astronomy = astronomy;
+  this->analytics = analytics;
+  this->levels = levels;
+  this->clock = clock;
+}
+
+void RiverPages::show(uint8_t page) {
+  TRACE_SCOPE("showPage");
+  this->hydrographView->reset();
+  this->tft->fillScreen(TFT_BLACK);
+  this->current = page;
+  if (page == SHOW_CURRENT) {
+    displayWeatherCurrent();
+    drawUSGSStationReading(this->usgs->getLastReading());
+  } else {
+    displayWeatherForecast();
+    drawHydrograph();
+  }
+  displayTime();
+}
+
+bool RiverPages::refreshReading() {
+  if (this->current != SHOW_CURRENT) {
+    return false;
+  }
+  drawUSGSStationReading(this->usgs->getLastReading());
+  return true;
+}
+
+bool RiverPages::refreshForecast() {
+  if (this->current != SHOW_FORECAST) {
+    return false;
+  }
+  drawHydrograph();
+  return true;
+}
+
+bool RiverPages::refreshWeather() {
+  if (this->current == SHOW_CURRENT) {
+    displayWeatherCurrent();
+  } else {
+    displayWeatherForecast();
+  }
+  return true;
+}
+
+/***************************************************************************************
+**                          Draw the current weather
+***************************************************************************************/
+void RiverPages::drawCurrentWeather() {
+  TRACE_SCOPE("drawCurrentWeather");
+  const WeatherModel* weather = this->oneCall->getWeather();
+  if (!weather->valid) {
+    Serial.println("Weather returned no current data");
+    return;
+  }
+  static const char* const wind[] = {"N", "NE", "E", "SE", "S", "SW", "W", "NW" };
+  drawSeparator(100);
+  this->tft->setTextPadding(0);
+  this->tft->setCursor(LABEL_X, WEATHER_START_Y, 2);
+  const WeatherNow* current = &weather->current;
+
+  TextStack<24> weatherText;
+
+  this->tft->setTextDatum(TL_DATUM);
+  this->tft->setTextColor(TFT_ORANGE, TFT_BLACK);
+  this->tft->drawString("Currently:", LABEL_X, WEATHER_START_Y + 0);
+
+  this->tft->setTextColor(TFT_WHITE, TFT_BLACK);
+  this->tft->drawString(current->main, 100, WEATHER_START_Y + 0);
+  this->tft->setTextColor(TFT_ORANGE, TFT_BLACK);
+  this->tft->drawString("Temperature:", LABEL_X, WEATHER_START_Y + 20);
+  this->tft->setTextColor(TFT_WHITE, TFT_BLACK);
+  weatherText.clear().fixed(current->temperature, 2).add(" F");
+  this->tft->drawString(weatherText.c_str(), 100, WEATHER_START_Y + 20);
+
+  this->tft->setTextColor(TFT_ORANGE, TFT_BLACK);
+  this->tft->drawString("Wind:", LABEL_X, WEATHER_START_Y + 40);
+  this->tft->setTextColor(TFT_WHITE, TFT_BLACK);
+  int windAngle = (current->windBearing + 22.5) / 45;
+  if (windAngle > 7) windAngle = 0;
+  weatherText.clear().add(wind[windAngle]).add(' ').unum((uint16_t)current->windSpeed).add(" mph");
+  this->tft->drawString(weatherText.c_str(), 100, WEATHER_START_Y + 40);
+
+  this->tft->setTextColor(TFT_ORANGE, TFT_BLACK);
+  this->tft->drawString("Barometer:", LABEL_X, WEATHER_START_Y + 60);
+  this->tft->setTextColor(TFT_WHITE, TFT_BLACK);
+  weatherText.clear().fixed(current->pressure, 2);
+  this->tft->drawString(weatherText.c_str(), 100, WEATHER_START_Y + 60);
+
+  this->tft->setTextColor(TFT_ORANGE, TFT_BLACK);
+  this->tft->drawString("Humidity:", LABEL_X, WEATHER_START_Y + 80);
+  this->tft->setTextColor(TFT_WHITE, TFT_BLACK);
+  weatherText.clear().unum(current->humidity).add('%');
+  this->tft->drawString(weatherText.c_str(), 100, WEATHER_START_Y + 80);
+
+  this->tft->setTextColor(TFT_ORANGE, TFT_BLACK);
+  this->tft->drawString("Clouds:", LABEL_X, WEATHER_START_Y + 100);
+  this->tft->setTextColor(TFT_WHITE, TFT_BLACK);
+  weatherText.clear().unum(current->cloudCover).add('%');
+  this->tft->drawString(weatherText.c_str(), 100, WEATHER_START_Y + 100);
+
+  this->dials.drawWindRose(WIND_ROSE_X, WIND_ROSE_Y, WIND_ROSE_R, current->windBearing % 360,
+                           (uint16_t)current->windSpeed, TFT_ORANGE);
+
+  this->tft->setTextDatum(TL_DATUM); // Reset datum to normal
+  this->tft->setTextPadding(0);      // Reset padding width to none
+}
+
+void RiverPages::displayWeatherCurrent() {
+  drawCurrentWeather();
+  drawAstronomy();
+}
+
+/***************************************************************************************
+**                          Draw the 5 forecast columns
+***************************************************************************************/
+void RiverPages::displayWeatherForecast() {
+  TRACE_SCOPE("displayWeatherForecast");
+  int8_t dayIndex = 0;
+  drawSeparator(100);
+  this->smallFont->release();
+  this->tft->setCursor(8, WEATHER_START_Y, 2);
+  drawForecastDetail(  8, WEATHER_START_Y, dayIndex++);
+  drawForecastDetail( 68, WEATHER_START_Y, dayIndex++);
+  drawForecastDetail(128, WEATHER_START_Y, dayIndex++);
+  drawForecastDetail(188, WEATHER_START_Y, dayIndex++);
+  drawForecastDetail(248, WEATHER_START_Y, dayIndex  );
+  drawSeparator(WEATHER_START_Y + 110);
+  this->hourlyStrip.draw(this->oneCall->getWeather(), this->oneCall->generation(), 0, WEATHER_START_Y + 113);
+}
+
+/***************************************************************************************
+**                          Draw 1 forecast column at x, y
+***************************************************************************************/
+void RiverPages::drawForecastDetail(uint16_t x, uint16_t y, uint8_t dayIndex) {
+  TRACE_SCOPE("drawForecastDetail");
+
+  const WeatherModel* weather = this->oneCall->getWeather();
+  if (dayIndex >= MAX_DAYS || dayIndex >= weather->days) return;
+  const WeatherDay* daily = weather->daily;
+
+  CalendarTime date;
+  localCalendar(daily[dayIndex].dayTime, date);
+  const char* day = shortDOW[date.dayOfWeek];
+
+  this->tft->setTextDatum(BC_DATUM);
+
+  this->tft->setTextColor(TFT_ORANGE, TFT_BLACK);
+  this->tft->setTextPadding(this->tft->textWidth("WWW"));
+  this->tft->drawString(day, x + 25, y);
+
+  this->tft->setTextColor(TFT_WHITE, TFT_BLACK);
+  this->tft->setTextPadding(this->tft->textWidth("-88   -88"));
+  TextStack<24> text;
+  text.fixed(daily[dayIndex].temperatureLow, 0).add(" - ").fixed(daily[dayIndex].temperatureHigh, 0);
+  this->tft->drawString(text.c_str(), x + 25, y + 27);
+
+  text.clear().add("/icon50/").add(getMeteoconIcon(daily[dayIndex].id, false)).add(".bmp");
+  this->ui->drawBmp(text.c_str(), x, y + 28);
+
+  this->tft->setTextPadding(0); // Reset padding width to none
+}
+
+/***************************************************************************************
+**                          Draw Sun rise/set, Moon, cloud cover and humidity
+***************************************************************************************/
+void RiverPages::drawAstronomy() {
+  TRACE_SCOPE("drawAstronomy");
+  uint32_t now = this->clock->unixSeconds();
+  if (!now) {
+    Serial.println("No time yet for the sun and moon");
+    return;
+  }
+  CalendarTime date;
+  localCalendar(now, date);
+  const Ephemeris* sky = this->astronomy->forDate(date.year, date.month, date.day, date.offsetMinutes);
+
+  this->tft->setTextDatum(BC_DATUM);
+  this->tft->setTextColor(TFT_WHITE, TFT_BLACK);
+  this->tft->setTextPadding(this->tft->textWidth(" Last qtr 100% "));
+
+  TextStack<32> text;
+  text.add(moonPhase[sky->moonPhase]).add(' ').unum(sky->illumination).add('%');
+  this->tft->drawString(text.c_str(), 230, 260);
+  text.clear().add("/moon/moonphase_L").unum(sky->moonIcon).add(".bmp");
+  this->ui->drawBmp(text.c_str(), 210, 180);
+
+  this->tft->setTextDatum(BC_DATUM);
+  this->tft->setTextColor(TFT_ORANGE, TFT_BLACK);
+  this->tft->setTextPadding(0); // Reset padding width to none
+  this->tft->drawString("Sunrise:", 200, WEATHER_START_Y + 15);
+  this->tft->drawString("Sunset :", 200, WEATHER_START_Y + 30);
+
+  this->tft->setTextDatum(BR_DATUM);
+  this->tft->setTextColor(TFT_WHITE, TFT_BLACK);
+  this->tft->setTextPadding(this->tft->textWidth(" 88:88 "));
+
+  // No crossing (never happens this far south) leaves the time blank
+  TextStack<8> hhmm;
+  if (sky->sunrise) strLocalTime(sky->sunrise, hhmm);
+  int dt = rightOffset(hhmm.c_str(), ":"); // Draw relative to colon to them aligned
+  this->tft->drawString(hhmm.c_str(), 260 + dt, WEATHER_START_Y + 15);
+
+  hhmm.clear();
+  if (sky->sunset) strLocalTime(sky->sunset, hhmm);
+  dt = rightOffset(hhmm.c_str(), ":");
+  this->tft->drawString(hhmm.c_str(), 260 + dt, WEATHER_START_Y + 30);
+
+  this->tft->setTextPadding(0); // Reset padding width to none
+}
+
+/***************************************************************************************
+**                          Get the icon file name from the index number
+***************************************************************************************/
+const char* RiverPages::getMeteoconIcon(uint16_t id, bool today)
+{
+  (void)today;
+  // if ( today && id/100 == 8 && (now->dayTime < now->sunriseTime || now->dayTime > now->sunsetTime)) id += 1000;
+
+  if (id/100 == 2) return "thunderstorm";
+  if (id/100 == 3) return "drizzle";
+  if (id/100 == 4) return "unknown";
+  if (id == 500) return "lightRain";
+  else if (id == 511) return "sleet";
+  else if (id/100 == 5) return "rain";
+  if (id >= 611 && id <= 616) return "sleet";
+  else if (id/100 == 6) return "snow";
+  if (id/100 == 7) return "fog";
+  if (id == 800) return "clear-day";
+  if (id == 801) return "partly-cloudy-day";
+  if (id == 802) return "cloudy";
+  if (id == 803) return "cloudy";
+  if (id == 804) return "cloudy";
+  if (id == 1800) return "clear-night";
+  if (id == 1801) return "partly-cloudy-night";
+  if (id == 1802) return "cloudy";
+  if (id == 1803) return "cloudy";
+  if (id == 1804) return "cloudy";
+
+  return "unknown";
+}
+
+/***************************************************************************************
+**                          Draw screen section separator line
+***************************************************************************************/
+// if you don't want separators, comment out the tft-line
+void RiverPages::drawSeparator(uint16_t y) {
+  this->tft->drawFastHLine(10, y, 320 - 2 * 10, 0x4228);
+}
+
+/***************************************************************************************
+**                          Right side offset to a character
+***************************************************************************************/
+// Calculate coord delta from end of text String to start of sub String contained within that text
+// Can be used to vertically right align text so for example a colon ":" in the time value is always
+// plotted at same point on the screen irrespective of different proportional character widths,
+// could also be used to align decimal points for neat formatting
+int RiverPages::rightOffset(const char* text, const char* sub)
+{
+  int index = StrView(text).indexOf(sub);
+  if (index < 0) return 0;
+  return this->tft->textWidth(text + index);
+}
+
+/***************************************************************************************
+**                          Draw the forecast table
+***************************************************************************************/
+void RiverPages::drawHydrograph() {
+  TRACE_SCOPE("drawHydrograph");
+  this->tft->fillRect(0, 280, 320, 480, TFT_BLACK);
+  this->smallFont->use();
+  this->tft->setTextColor(TFT_ORANGE, TFT_BLACK);
+  this->tft->setTextDatum(TR_DATUM);
+  this->tft->setTextPadding(0);
+  this->tft->drawString(FORECAST_LABEL, 220, 280);
+  this->hydrographView->draw();
+  this->smallFont->release();
+}
+
+/***************************************************************************************
+**                          Draw the current stream status
+***************************************************************************************/
+static unsigned int getTempColor(float tempC) {
+  if (tempC < 10.0f) return TFT_BLUE;
+  if (tempC < 15.0f) return TFT_GREEN;
+  if (tempC < 20.0f) return TFT_YELLOW;
+  if (tempC < 25.0f) return TFT_ORANGE;
+  return TFT_RED;
+}
+
+void RiverPages::drawUSGSStationReading(const StationReading* sr) {
+  TRACE_SCOPE("drawUSGSStationReading");
+  this->tft->fillRect(0, 270, 320, 480, TFT_BLACK);
+  this->tft->setTextDatum(TL_DATUM);
+  drawSeparator(270);
+  int valueOffset = 120;
+  TextStack<40> scratch;
+
+  this->smallFont->use();
+  this->tft->setTextColor(TFT_ORANGE, TFT_BLACK);
+  this->tft->setTextPadding(0);
+  this->tft->setTextDatum(TR_DATUM);
+  this->tft->drawString(CURRENT_LABEL, 220, 280);
+  if (sr && sr->time) {
+    this->tft->setTextDatum(TL_DATUM);
+    this->tft->setTextPadding(0);
+    this->tft->drawString("Updated at:", LABEL_X, 295);
+    this->tft->setTextColor(TFT_LIGHTGREY, TFT_BLACK);
+    strLocalDateTime(sr->time, scratch);
+    this->tft->drawString(scratch.c_str(), valueOffset, 295);
+
+    this->tft->setTextColor(TFT_ORANGE, TFT_BLACK);
+    this->tft->drawString("Flow:", LABEL_X, 325);
+    this->tft->setTextColor(TFT_LIGHTGREY, TFT_BLACK);
+    scratch.clear().num(sr->flow);
+    this->tft->drawString(scratch.c_str(), valueOffset, 325);
+
+    this->tft->setTextColor(TFT_ORANGE, TFT_BLACK);
+    this->tft->drawString("Height:", LABEL_X, 340);
+    this->tft->setTextColor(this->levels->color(sr->stage), TFT_BLACK);
+    scratch.clear().fixed(sr->stage, 2).add("  ").add(this->levels->name(sr->stage));
+    this->tft->drawString(scratch.c_str(), valueOffset, 340);
+
+    this->dials.drawStageGauge(STAGE_GAUGE_X, STAGE_GAUGE_Y, STAGE_GAUGE_R, (int32_t)lroundf(sr->stage * 100),
+                               STAGE_GAUGE_FEET * 100, this->levels->color(sr->stage));
+
+    drawRiverTrend();
+
+    if (isnan(sr->temp)) {
+      this->smallFont->release();
+      return;
+    }
+    this->tft->setTextColor(TFT_ORANGE, TFT_BLACK);
+    this->tft->drawString("Temp:", LABEL_X, 365);
+    this->tft->setTextColor(TFT_LIGHTGREY, TFT_BLACK);
+    float fahrenheit = (sr->temp * 9.0) / 5.0 + 32;
+    scratch.clear().fixed(sr->temp, 1).add("C / ").fixed(fahrenheit, 1).add('F');
+    this->tft->drawString(scratch.c_str(), valueOffset, 365);
+
+    // Capped so the bar stops short of the stage dial
+    int temp_width = constrain((int) roundf(sr->temp * 5), 0, 110);
+    this->tft->fillRoundRect(valueOffset, 385, temp_width, 20, 5, getTempColor(sr->temp));
+  }
+  this->smallFont->release();
+}
+
+// Rate of change and the next play level the forecast reaches, below the temperature
+void RiverPages::drawRiverTrend() {
+  TextStack<40> text;
+  float rate = this->analytics->rate();
+  if (!isnan(rate)) {
+    this->tft->setTextColor(TFT_ORANGE, TFT_BLACK);
+    this->tft->drawString("Trend:", LABEL_X, 440);
+    this->tft->setTextColor(TFT_LIGHTGREY, TFT_BLACK);
+    if (rate > 0) text.add('+');
+    text.fixed(rate, 2).add(" ft/h");
+    this->tft->drawString(text.c_str(), 120, 440);
+  }
+
+  const LevelCrossing* next = this->analytics->nextCrossing(this->clock->unixSeconds());
+  if (!next) {
+    return;
+  }
+  // Rising into the band that starts at the level, or falling into the one below it
+  uint8_t band = this->levels->classify(next->stage) - (next->rising ? 0 : 1);
+  this->tft->setTextColor(TFT_ORANGE, TFT_BLACK);
+  this->tft->drawString("Next:", LABEL_X, 460);
+  this->tft->setTextColor(this->levels->bandColor(band), TFT_BLACK);
+  text.clear().add(this->levels->bandName(band)).add(' ');
+  strLocalDateTime(next->time, text);
+  this->tft->drawString(text.c_str(), 120, 460);
+}
+
+/***************************************************************************************
+**                          Draw the clock
+***************************************************************************************/
+void RiverPages::displayTime() {
+  TRACE_SCOPE("displayTime");
+  uint32_t now = this->clock->unixSeconds();
+  if (!now) {
+    return;
+  }
+  CalendarTime date;
+  localCalendar(now, date);
+
+  this->smallFont->release();
+  this->tft->setTextDatum(TL_DATUM);
+  this->tft->setTextPadding(0);
+  this->tft->setTextColor(TFT_GREEN, TFT_BLACK);
+  TextStack<8> text;
+  text.unum(date.hour, 2, '0').add(':').unum(date.minute, 2, '0');
+  this->tft->drawString(text.c_str(), 5, 5, 8);
+  this->tft->drawString(dayNames[date.dayOfWeek], 260, 5, 4);
+  this->tft->drawString(monthNames[date.month], 260, 31, 4);
+  text.clear().unum(date.day);
+  this->tft->drawString(text.c_str(), 260, 56, 4);
+  this->smallFont->release();
+}
@@ -0,0 +1,102 @@
+#ifndef _RIVER_WEATHER_RIVER_PAGES_H_FILE
+#define _RIVER_WEATHER_RIVER_PAGES_H_FILE
+
+#include "TracedTFT.h"
+#include "SmoothFont.h"
+#include "GfxUi.h"
+#include "Gauges.h"
+#include "HourlyStrip.h"
+#include "HydrographView.h"
+#include "OneCall.h"
+#include "USGSRDB.h"
+#include "Astronomy.h"
+#include "RiverAnalytics.h"
+#include "PlayLevels.h"
+#include "SntpClock.h"
+
+/*
+ * The display's two pages, drawn from the models the fetches keep:
+ *
+ *   forecast  five daily columns, the hourly strip and the forecast table
+ *   current   the weather now with its wind rose, the sun and moon, and the
+ *             latest reading with its stage dial, trend and next play level
+ *
+ * with the clock across the top of both. show() clears the screen and draws
+ * a whole page, the refresh functions redraw the part of the page that shows
+ * a source after it has new data, and do nothing when the other page is up.
+ *
+ * Labels are formatted into TextStack buffers and the smooth font is switched
+ * with SmoothFont, so a draw makes no heap allocation of its own. The icons
+ * come from SPIFFS, the file system allocates while one is open. This is
+ * built by the sketch and by tools/soak.cpp, which counts the allocations
+ * around these functions.
+ */
+
+#define SHOW_FORECAST 0
+#define SHOW_CURRENT  1
+
+#define WEATHER_START_Y 130
+#define LABEL_X 8
+#define MAX_DAYS 5
+
+// Right of the sunrise times on the current page
+#define WIND_ROSE_X 292
+#define WIND_ROSE_Y 180
+#define WIND_ROSE_R 24
+
+// Beside the temperature, where the stage bar used to be
+#define STAGE_GAUGE_X 275
+#define STAGE_GAUGE_Y 400
+#define STAGE_GAUGE_R 36
+
+class RiverPages {
+  public:
+    RiverPages(TracedTFT* tft, SmoothFont* smallFont, GfxUi* ui, OneCallWeather* oneCall, USGSStation* usgs,
+               HydrographView* hydrographView, Astronomy* astronomy, RiverAnalytics* analytics,
+               PlayLevels* levels, SntpClock* clock);
+
+    // Clears the screen and draws all of page, SHOW_FORECAST or SHOW_CURRENT
+    void show(uint8_t page);
+    uint8_t page() const { return this->current; }
+
+    // After a fetch, true if the page showing has the source and was redrawn
+    bool refreshReading();
+    bool refreshForecast();
+    bool refreshWeather();
+
+    // Sun rise and set and the moon, nothing until the clock is set
+    void drawAstronomy();
+    // The time and date at the top, once a second
+    void displayTime();
+
+    // The dials, for the serial monitor's benchmark
+    Gauges* gauges() { return &this->dials; }
+
+  private:
+    void drawCurrentWeather();
+    void displayWeatherCurrent();
+    void displayWeatherForecast();
+    void drawForecastDetail(uint16_t x, uint16_t y, uint8_t dayIndex);
+    void drawHydrograph();
+    void drawUSGSStationReading(const StationReading* sr);
+    void drawRiverTrend();
+    void drawSeparator(uint16_t y);
+    int rightOffset(const char* text, const char* sub);
+    static const char* getMeteoconIcon(uint16_t id, bool today);
+
+    TracedTFT*      tft;
+    SmoothFont*     smallFont;
+    GfxUi*          ui;
+    OneCallWeather* oneCall;
+    USGSStation*    usgs;
+    HydrographView* hydrographView;
+    Astronomy*      astronomy;
+    RiverAnalytics* analytics;
+    PlayLevels*     levels;
+    SntpClock*      clock;
+    Gauges          dials;
+    HourlyStrip     hourlyStrip;
+    uint8_t         current = SHOW_FORECAST;
+};
+
+#endif
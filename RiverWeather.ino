@@ -15,7 +15,7 @@
 //  Original by Daniel Eichhorn, see license at end of file.
 
 //#define SERIAL_MESSAGES // For serial output weather reports
-//#define SCREEN_SERVER   // For dumping screen shots from TFT
+//#define SCREEN_SERVER   // Screen captures for tools/screen_receiver.py, over serial or TCP
 //#define RANDOM_LOCATION // Test only, selects random weather location every refresh
 //#define FORMAT_SPIFFS   // Wipe SPIFFS and all files!
 
@@ -39,6 +39,7 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include "FT62XXTouchScreen.h"
+#include "Gestures.h"
 #include <SPI.h>
 
 //
@@ -64,9 +65,12 @@
 
 //#define TOUCH_CS PIN_D2     // Chip select pin (T_CS) of touch screen
 #include <TFT_eSPI.h> // https://github.com/Bodmer/TFT_eSPI
+#include "TracedTFT.h"  // TFT_eSPI with render tracing when RENDER_TRACE is defined
 
 // Additional functions
 #include "GfxUi.h"          // Attached to this sketch
+#include "RiverPages.h"     // The forecast and current pages, shared with tools/soak.cpp
+#include "RiverFetch.h"     // The fetches, their retries and poll planning, shared with tools/soak.cpp
 #include "SPIFFS_Support.h" // Attached to this sketch
 #include <WiFiManager.h> // https://github.com/tzapu/WiFiManager
 
@@ -74,16 +78,32 @@
 // check All_Settings.h for adapting to your needs
 //#define FREDERICKSBURG
 #include "All_Settings.h"
-#include <OpenWeatherOneCall.h>
 
 #include <AceTime.h>
 #include <AceTimeClock.h>
 #define _TASK_SLEEP_ON_IDLE_RUN
+#define _TASK_TIMECRITICAL      // Task::getStartDelay() feeds the lateness metrics
 #include <TaskScheduler.h>
 
 #include "hydrograph.h"
 #include "USGSRDB.h"
+#include "OneCall.h"
 #include "utils.h"
+#include "Metrics.h"
+#include "RetryPolicy.h"
+#include "FetchArena.h"
+#include "ModelCache.h"
+#include "PeerPush.h"
+#include "HydrographView.h"
+#include "Astronomy.h"
+#include "RiverAnalytics.h"
+#include "PlayLevels.h"
+#include "ScreenServer.h"
+#include "NetScheduler.h"
+#include "PollPlanner.h"
+#include "SntpClock.h"
+#include "SmoothFont.h"
+#include <esp_wifi.h>
 
 // #define FORMAT_SPIFFS 1
 
@@ -92,15 +112,7 @@
 
 #define TFT_GREY 0x5AEB
 
-#define SHOW_FORECAST 0
-#define SHOW_CURRENT  1
-#define SHOW_GRAPH    2
-
 #define SERIAL_MESSAGES 1
-#define MAX_DAYS 5
-
-#define WEATHER_START_Y 130
-#define LABEL_X 8
 /***************************************************************************************
 **                          Define the globals and class instances
 ***************************************************************************************/
@@ -109,72 +121,108 @@ using namespace ace_time;
 using namespace ace_time::clock;
 
 
-#define GAUGE_TEXT_START 150
-#define METRIC_WEATHER 0
+#define TOUCH_INT_PIN   39  // FT62XX INT line on the WT32-SC01
+#define TOUCH_SAMPLE_MS 15  // I2C read rate while a finger is down
 
-TFT_eSPI tft = TFT_eSPI();             // Invoke custom library
+TracedTFT tft = TracedTFT();           // Invoke custom library
+static SmoothFont smallFont(&tft, AA_FONT_SMALL);   // loaded in setup and kept
 FT62XXTouchScreen touchScreen = FT62XXTouchScreen(DISPLAY_HEIGHT, PIN_SDA, PIN_SCL);
+static GestureQueue gestureQueue;
+static GestureRecognizer gestureRecognizer(&gestureQueue);
+static TaskHandle_t touchReaderHandle = NULL;
 
 boolean booted = true;
 
 GfxUi ui = GfxUi(&tft); // Jpeg and bmpDraw functions TODO: pull outside of a class
 
-OpenWeatherOneCall OWOC;    // Invoke Weather Library
+static OneCallWeather oneCall(OPENWEATHER_BASE_URL, ONECALLKEY, WEATHER_LAT, WEATHER_LON, units.c_str());
 
 long lastDownloadUpdate = millis();
 
 void XML_callback(uint8_t statusflags, char* tagName, uint16_t tagNameLen, char* data, uint16_t dataLen);
-static Hydrograph hydrograph(NWIS_STATION, &XML_callback);
+static Hydrograph hydrograph(NWIS_STATION, NWS_BASE_URL, &XML_callback);
+static HydrographView hydrographView(&tft, &hydrograph, &smallFont);
+#ifdef SCREEN_SERVER
+static ScreenServer screenServer(&tft, &hydrographView);
+#endif
 
 void XML_callback(uint8_t statusflags, char* tagName, uint16_t tagNameLen, char* data, uint16_t dataLen) {
   hydrograph.processXML(statusflags, tagName, tagNameLen, data, dataLen);
 }
-static BasicZoneProcessor timeZoneProcessor;
-static NtpClock ntpClock;
-static SystemClockLoop systemClock(nullptr /*reference*/, nullptr /*backup*/);
-static USGSStation* usgs = new USGSStation(USGS_STATION);
+static SntpClock systemClock(SNTP_SERVER);
+static USGSStation usgs(USGS_STATION, USGS_BASE_URL);
+static Astronomy astronomy(atof(WEATHER_LAT), atof(WEATHER_LON));
+// 1.5 KB of encoded model, only built in when something serves or reads it
+#if defined(MODEL_CACHE_SERVER) || defined(MODEL_CACHE_PEER) || defined(PEER_PUSH)
+static ModelCache modelCache(&usgs, &hydrograph, &oneCall, &astronomy);
+#endif
+#ifdef PEER_PUSH
+static PeerPush peerPush(&modelCache, PEER_PUSH_KEY);
+#endif
+
+// Loaded from PLAY_LEVELS_FILE in setup, the crossing forecasts use the same boundaries
+static PlayLevels playLevels;
+static RiverAnalytics riverAnalytics(playLevels.boundaries(), playLevels.boundaryCount());
+static RiverPages pages(&tft, &smallFont, &ui, &oneCall, &usgs, &hydrographView, &astronomy, &riverAnalytics,
+                        &playLevels, &systemClock);
 
-int currentRiverDisplay = SHOW_FORECAST;
 Scheduler runner;
 
+// The fetches share wake windows, the radio sleeps in between
+static NetScheduler netScheduler;
+// When USGS and NWS publish, so their polls land just after new data
+static PollPlanner pollPlanner;
+// Settings for both are in RiverFetch.cpp, applied in setup
+static RiverFetch riverFetch(&usgs, &hydrograph, &oneCall, &riverAnalytics, &pages, &systemClock, &netScheduler,
+                             &pollPlanner);
 
-void fetchUSGSStation();
-void fetchHydrograph();
-void fetchWeather();
+
+void runNetWindow();
 void updateSystemTime();
+void pollSntp();
 void displayTime();
-void checkTouch();
+void handleGestures();
+void scrollHydrograph();
+void startScroll();
+void checkSerial();
+void sampleMetrics();
+void serveModelCache();
+void pollPeerPush();
+void resyncFromPeer();
+void serveScreen();
+
+// Time the running task and record how late it started. Lateness only counts when the
+// scheduler invoked the task, not when it is called directly from setup() or another task.
+#define METRICS_TASK(id, task) TaskTimer taskTimer(id, runner.currentTaskPointer() == &(task) ? (task).getStartDelay() : 0)
+// The same for a fetch run from a wake window, lateness is against the source's due time
+#define METRICS_FETCH(id, source) TaskTimer taskTimer(id, netScheduler.lateMs(source, millis()))
 
 // Tasks
-Task fetchUSGSStationTask(20 * 60 * 1000, TASK_FOREVER, &fetchUSGSStation, &runner, true);
-Task fetchHydrographTask(15 * 60 * 1000, TASK_FOREVER, &fetchHydrograph, &runner, true);
-Task fetchWeatherTask(30 * 60 * 1000, TASK_FOREVER, &fetchWeather, &runner, true);
-Task updateSystemTimeTask(24 * 60 * 60 * 1000, TASK_FOREVER, &updateSystemTime, &runner, true);
+Task netWindowTask(TASK_IMMEDIATE, TASK_FOREVER, &runNetWindow, &runner, true);
+Task pollSntpTask(10, TASK_FOREVER, &pollSntp, &runner, false);
 Task displayTimeTask(1000, TASK_FOREVER, &displayTime,  &runner, true);
-Task checkTouchTask(100, TASK_FOREVER, &checkTouch, &runner, true);
+Task handleGesturesTask(50, TASK_FOREVER, &handleGestures, &runner, true);
+Task scrollHydrographTask(HYDROGRAPH_VIEW_FRAME_MS, TASK_FOREVER, &scrollHydrograph, &runner, false);
+Task checkSerialTask(250, TASK_FOREVER, &checkSerial, &runner, true);
+Task sampleMetricsTask(60 * 1000, TASK_FOREVER, &sampleMetrics, &runner, true);
+#ifdef MODEL_CACHE_SERVER
+Task serveModelCacheTask(20, TASK_FOREVER, &serveModelCache, &runner, true);
+#endif
+#ifdef PEER_PUSH
+Task pollPeerPushTask(100, TASK_FOREVER, &pollPeerPush, &runner, true);
+#endif
+#ifdef SCREEN_SERVER
+Task serveScreenTask(100, TASK_FOREVER, &serveScreen, &runner, true);
+#endif
 
 /***************************************************************************************
 **                          Declare prototypes
 ***************************************************************************************/
 void updateData();
-void drawProgress(uint8_t percentage, String text);
-void drawTime();
-void drawCurrentWeather();
-void drawForecast();
-void drawForecastDetail(uint16_t x, uint16_t y, uint8_t dayIndex);
-const char* getMeteoconIcon(uint16_t id, bool today);
-void drawAstronomy();
-void drawSeparator(uint16_t y);
-void fillSegment(int x, int y, int start_angle, int sub_angle, int r, unsigned int colour);
+void drawProgress(uint8_t percentage, const char* text);
 String strDate(time_t unixTime);
 String strTime(time_t unixTime);
 void printWeather(void);
-int leftOffset(String text, String sub);
-int rightOffset(String text, String sub);
-int splitIndex(String text);
-
-void drawHydrograph();
-void drawUSGSStationReading(StationReading* sr);
 
 
 void WIFISetUp(void)
@@ -216,286 +264,6 @@ void WIFISetUp(void)
 }
 
 
-/***************************************************************************************
-**                          Draw the current weather
-***************************************************************************************/
-void drawCurrentWeather() {
-  if (!OWOC.current) {
-    Serial.println("Weather returned no current data");
-    return;
-  }
-  String wind[] = {"N", "NE", "E", "SE", "S", "SW", "W", "NW" };
-  drawSeparator(100);
-  tft.setTextPadding(0); 
-  tft.setCursor(LABEL_X,WEATHER_START_Y,2);
-  String weatherIcon = "";
-  OpenWeatherOneCall::nowData* current = OWOC.current;
-  String currentSummary = current->main;
-  currentSummary.toLowerCase();
-
-  String weatherText = "None";
-  //weatherIcon = getMeteoconIcon(current->id, true);
-  //ui.drawBmp("/icon50/" + weatherIcon + ".bmp", 8, WEATHER_START_Y);
-  
-  
-
-  tft.setTextDatum(TL_DATUM);
-  tft.setTextColor(TFT_ORANGE, TFT_BLACK);
-  tft.drawString("Currently:" ,LABEL_X , WEATHER_START_Y + 0);
-  
-  tft.setTextColor(TFT_WHITE, TFT_BLACK);
-  tft.drawString(current->main,100 , WEATHER_START_Y + 0);
-  tft.setTextColor(TFT_ORANGE, TFT_BLACK);
-  tft.drawString("Temperature:" ,LABEL_X , WEATHER_START_Y + 20);
-  tft.setTextColor(TFT_WHITE, TFT_BLACK);
-  weatherText = String(current->temperature) + " F";
-  tft.drawString(weatherText, 100, WEATHER_START_Y + 20);
-
-  tft.setTextColor(TFT_ORANGE, TFT_BLACK);
-  tft.drawString("Wind:" ,LABEL_X , WEATHER_START_Y + 40);
-  tft.setTextColor(TFT_WHITE, TFT_BLACK);
-  int windAngle = (current->windBearing + 22.5) / 45;
-  if (windAngle > 7) windAngle = 0;
-  weatherText = wind[windAngle] + " " + (uint16_t)current->windSpeed + " mph";
-  tft.drawString(weatherText ,100 , WEATHER_START_Y + 40);
-
-  tft.setTextColor(TFT_ORANGE, TFT_BLACK);
-  tft.drawString("Barometer:" ,LABEL_X , WEATHER_START_Y + 60);
-  tft.setTextColor(TFT_WHITE, TFT_BLACK);
-  tft.drawString(String(current->pressure) ,100 , WEATHER_START_Y + 60);
-
-  tft.setTextColor(TFT_ORANGE, TFT_BLACK);
-  tft.drawString("Humidity:" ,LABEL_X , WEATHER_START_Y + 80);
-  tft.setTextColor(TFT_WHITE, TFT_BLACK);
-  tft.drawString(String(current->humidity) + "%" ,100 , WEATHER_START_Y + 80);
-
-  tft.setTextColor(TFT_ORANGE, TFT_BLACK);
-  tft.drawString("Clouds:" ,LABEL_X , WEATHER_START_Y + 100);
-  tft.setTextColor(TFT_WHITE, TFT_BLACK);
-  tft.drawString(String(current->cloudCover) + "%",100 , WEATHER_START_Y + 100);
-    
-
-  //ui.drawBmp("/wind/" + wind[windAngle] + ".bmp", 101, WEATHER_START_Y);
-
- 
-  tft.setTextDatum(TL_DATUM); // Reset datum to normal
-  tft.setTextPadding(0);      // Reset padding width to none
-  
-}
-
-/***************************************************************************************
-**                          Draw the 5 forecast columns
-***************************************************************************************/
-// draws the three forecast columns
-void displayWeatherForecast() {
-  if (currentRiverDisplay == SHOW_FORECAST) {
-    int8_t dayIndex = 0;
-    drawSeparator(100);
-    tft.unloadFont();
-    tft.setCursor(8,WEATHER_START_Y,2);
-    drawForecastDetail(  8, WEATHER_START_Y, dayIndex++);
-    drawForecastDetail( 68, WEATHER_START_Y, dayIndex++); 
-    drawForecastDetail(128, WEATHER_START_Y, dayIndex++); 
-    drawForecastDetail(188, WEATHER_START_Y, dayIndex++); 
-    drawForecastDetail(248, WEATHER_START_Y, dayIndex  ); 
-    drawSeparator(WEATHER_START_Y + 110);
-  }
-}
-
-
-
-/***************************************************************************************
-**                          Draw 1 forecast column at x, y
-***************************************************************************************/
-// helper for the forecast columns
-void drawForecastDetail(uint16_t x, uint16_t y, uint8_t dayIndex) {
-
-  if (dayIndex >= MAX_DAYS) return;
-  OpenWeatherOneCall::futureData *daily = OWOC.forecast;
-  String day  = daily[dayIndex].weekDayName;
-  day.toUpperCase();
-
-  tft.setTextDatum(BC_DATUM);
-
-  tft.setTextColor(TFT_ORANGE, TFT_BLACK);
-  tft.setTextPadding(tft.textWidth("WWW"));
-  tft.drawString(day, x + 25, y);
-
-  tft.setTextColor(TFT_WHITE, TFT_BLACK);
-  tft.setTextPadding(tft.textWidth("-88   -88"));
-  String highTemp = String(daily[dayIndex].temperatureHigh, 0);
-  String lowTemp  = String(daily[dayIndex].temperatureLow, 0);
-  tft.drawString(lowTemp + " - " + highTemp, x + 25, y + 27);
-
-  String weatherIcon = getMeteoconIcon(daily[dayIndex].id, false);
-
-  ui.drawBmp("/icon50/" + weatherIcon + ".bmp", x, y + 28);
-
-  tft.setTextPadding(0); // Reset padding width to none
-}
-
-/***************************************************************************************
-**                          Draw Sun rise/set, Moon, cloud cover and humidity
-***************************************************************************************/
-void drawAstronomy() {
-  if (!OWOC.forecast) {
-    Serial.println("No weather forecast!");
-    return;
-  }
-  tft.setTextDatum(BC_DATUM);
-  tft.setTextColor(TFT_WHITE, TFT_BLACK);
-  tft.setTextPadding(tft.textWidth(" Last qtr "));
-
-  auto localTz = TimeZone::forZoneInfo(&zonedb::kZoneAmerica_New_York, &timeZoneProcessor);
-  acetime_t nowSeconds = systemClock.getNow();
-  ZonedDateTime dateTime = ZonedDateTime::forEpochSeconds(nowSeconds, localTz);
-
-  uint16_t y = dateTime.year();
-  uint8_t  m = dateTime.month();
-  uint8_t  d = dateTime.day();
-  uint8_t  h = dateTime.hour();
-  int      ip;
-  uint8_t icon = moon_phase(y, m, d, h, &ip);
-
-  tft.drawString(moonPhase[ip], 230, 260);
-  ui.drawBmp("/moon/moonphase_L" + String(icon) + ".bmp", 210, 180);
-
-  tft.setTextDatum(BC_DATUM);
-  tft.setTextColor(TFT_ORANGE, TFT_BLACK);
-  tft.setTextPadding(0); // Reset padding width to none
-  tft.drawString("Sunrise:", 200, WEATHER_START_Y + 15);
-  tft.drawString("Sunset :", 200, WEATHER_START_Y + 30);
-
-  tft.setTextDatum(BR_DATUM);
-  tft.setTextColor(TFT_WHITE, TFT_BLACK);
-  tft.setTextPadding(tft.textWidth(" 88:88 "));
-
-  String rising = OWOC.forecast[0].readableSunrise;
-  int dt = rightOffset(rising, ":"); // Draw relative to colon to them aligned
-  tft.drawString(rising, 260 + dt, WEATHER_START_Y + 15);
-
-  String setting = OWOC.forecast[0].readableSunset;
-  dt = rightOffset(setting, ":");
-  tft.drawString(setting, 260 + dt, WEATHER_START_Y + 30);
-
-  tft.setTextPadding(0); // Reset padding width to none
-}
-
-/***************************************************************************************
-**                          Get the icon file name from the index number
-***************************************************************************************/
-const char* getMeteoconIcon(uint16_t id, bool today)
-{
-  // if ( today && id/100 == 8 && (OWOC.current->dt < OWOC.current->sunrise || OWOC.current->dt > OWOC.current->sunset)) id += 1000; 
-
-  if (id/100 == 2) return "thunderstorm";
-  if (id/100 == 3) return "drizzle";
-  if (id/100 == 4) return "unknown";
-  if (id == 500) return "lightRain";
-  else if (id == 511) return "sleet";
-  else if (id/100 == 5) return "rain";
-  if (id >= 611 && id <= 616) return "sleet";
-  else if (id/100 == 6) return "snow";
-  if (id/100 == 7) return "fog";
-  if (id == 800) return "clear-day";
-  if (id == 801) return "partly-cloudy-day";
-  if (id == 802) return "cloudy";
-  if (id == 803) return "cloudy";
-  if (id == 804) return "cloudy";
-  if (id == 1800) return "clear-night";
-  if (id == 1801) return "partly-cloudy-night";
-  if (id == 1802) return "cloudy";
-  if (id == 1803) return "cloudy";
-  if (id == 1804) return "cloudy";
-
-  return "unknown";
-}
-
-void displayWeatherCurrent() {
-      drawCurrentWeather();
-      drawAstronomy();
-}
-
-
-/***************************************************************************************
-**                          Draw screen section separator line
-***************************************************************************************/
-// if you don't want separators, comment out the tft-line
-void drawSeparator(uint16_t y) {
-  tft.drawFastHLine(10, y, 320 - 2 * 10, 0x4228);
-}
-
-/***************************************************************************************
-**                          Determine place to split a line line
-***************************************************************************************/
-// determine the "space" split point in a long string
-int splitIndex(String text)
-{
-  int index = 0;
-  while ( (text.indexOf(' ', index) >= 0) && ( index <= text.length() / 2 ) ) {
-    index = text.indexOf(' ', index) + 1;
-  }
-  if (index) index--;
-  return index;
-}
-
-/***************************************************************************************
-**                          Right side offset to a character
-***************************************************************************************/
-// Calculate coord delta from end of text String to start of sub String contained within that text
-// Can be used to vertically right align text so for example a colon ":" in the time value is always
-// plotted at same point on the screen irrespective of different proportional character widths,
-// could also be used to align decimal points for neat formatting
-int rightOffset(String text, String sub)
-{
-  int index = text.indexOf(sub);
-  return tft.textWidth(text.substring(index));
-}
-
-/***************************************************************************************
-**                          Left side offset to a character
-***************************************************************************************/
-// Calculate coord delta from start of text String to start of sub String contained within that text
-// Can be used to vertically left align text so for example a colon ":" in the time value is always
-// plotted at same point on the screen irrespective of different proportional character widths,
-// could also be used to align decimal points for neat formatting
-int leftOffset(String text, String sub)
-{
-  int index = text.indexOf(sub);
-  return tft.textWidth(text.substring(0, index));
-}
-
-/***************************************************************************************
-**                          Draw circle segment
-***************************************************************************************/
-// Draw a segment of a circle, centred on x,y with defined start_angle and subtended sub_angle
-// Angles are defined in a clockwise direction with 0 at top
-// Segment has radius r and it is plotted in defined colour
-// Can be used for pie charts etc, in this sketch it is used for wind direction
-#define DEG2RAD 0.0174532925 // Degrees to Radians conversion factor
-#define INC 2 // Minimum segment subtended angle and plotting angle increment (in degrees)
-void fillSegment(int x, int y, int start_angle, int sub_angle, int r, unsigned int colour)
-{
-  // Calculate first pair of coordinates for segment start
-  float sx = cos((start_angle - 90) * DEG2RAD);
-  float sy = sin((start_angle - 90) * DEG2RAD);
-  uint16_t x1 = sx * r + x;
-  uint16_t y1 = sy * r + y;
-
-  // Draw colour blocks every INC degrees
-  for (int i = start_angle; i < start_angle + sub_angle; i += INC) {
-
-    // Calculate pair of coordinates for segment end
-    int x2 = cos((i + 1 - 90) * DEG2RAD) * r + x;
-    int y2 = sin((i + 1 - 90) * DEG2RAD) * r + y;
-
-    tft.fillTriangle(x1, y1, x2, y2, x, y, colour);
-
-    // Copy segment end to segment start for next segment
-    x1 = x2;
-    y1 = y2;
-  }
-}
 #if 0
 /***************************************************************************************
 **                          Print the weather info to the Serial Monitor
@@ -535,255 +303,357 @@ void printWeather(void)
 }
 #endif
 
+/***************************************************************************************
+**                          Tasks
+***************************************************************************************/
+// Full power while a window runs, modem sleep between windows
+void radioWake() {
+  esp_wifi_set_ps(WIFI_PS_NONE);
+}
 
-void drawHydrograph() { 
-  tft.fillRect(0, 280, 320, 480, TFT_BLACK);
-  tft.loadFont(AA_FONT_SMALL);
-  tft.setTextColor(TFT_ORANGE, TFT_BLACK);
-  tft.setTextDatum(TR_DATUM);
-  tft.setTextPadding(0);
-  tft.drawString(FORECAST_LABEL, 220, 280);
-  char dateString[20] = {};
-  int startY = 300;
-  for (int i = 0; i < hydrograph.last_observed; i++) {
-    RiverStatus* rs =  &hydrograph.observed_array[i]; 
-    utcDateStringToLocalString(rs->dateTime, dateString, sizeof(dateString));
-    tft.setTextColor(TFT_YELLOW, TFT_BLACK);
-    tft.setTextPadding(0);
-    tft.drawString(dateString, 100, startY);
-    tft.setTextColor(TFT_WHITE, TFT_BLACK);
-    tft.drawString(rs->stage.c_str(), 150, startY);
-    startY += 20;
-    if (startY > 460) {
-      break;
-    }
+void radioSleep() {
+#ifdef SCREEN_SERVER
+  // A screen viewer holds the radio awake, in modem sleep a frame takes seconds
+  if (screenServer.connected()) {
+    return;
   }
-  startY = 300;
-  for (int i = 0; i < hydrograph.last_forecast; i++) {
-    RiverStatus* rs =  &hydrograph.forecast_array[i]; 
-    utcDateStringToLocalString(rs->dateTime, dateString, sizeof(dateString));
-    tft.setTextColor(TFT_YELLOW, TFT_BLACK);
-    tft.setTextPadding(0);
-    tft.drawString(dateString, 270, startY);
-    tft.setTextColor(TFT_WHITE, TFT_BLACK);
-    tft.drawString(rs->stage.c_str(), 305, startY);
-    startY += 20;
-    if (startY > 460) {
-      break;
-    }
-  } 
-  tft.unloadFont();
+#endif
+  esp_wifi_set_ps(NET_IDLE_POWER_SAVE);
 }
 
+// Runs the sources of a wake window one per pass, so the display and touch
+// tasks still get their turns between fetches
+void runNetWindow() {
+  static uint32_t windowStartMs = 0;
+  if (!netScheduler.windowOpen() && !systemClock.busy()) {
+    if (!netScheduler.beginWindow(millis())) {
+      netWindowTask.delay(netScheduler.msUntilWindow(millis()));
+      return;
+    }
+    windowStartMs = millis();
+    radioWake();
+  }
 
-/***************************************************************************************
-**                          Draw the current stream status
-***************************************************************************************/
+  switch (netScheduler.nextInWindow()) {
+    case NET_USGS:    riverFetch.fetchUSGSStation(); break;
+    case NET_NWS:     riverFetch.fetchHydrograph(); break;
+    case NET_WEATHER: riverFetch.fetchWeather(); break;
+    case NET_TIME:    updateSystemTime(); break;
+    case NET_PEER:    resyncFromPeer(); break;
+    default: break;
+  }
 
-const char* getPlayString(float level) {
-  if (level < 3.5f) return "Attainment";
-  if (level < 3.65f) return "Low O-Deck!";
-  if (level < 3.8f) return "O-Deck!";
-  if (level < 4.03f) return "Tweener";
-  if (level < 4.25f) return "Low Rocky";
-  if (level < 4.5f) return "Rocky";
-  if (level < 4.7f) return "High Rocky";
-  if (level < 5.0f) return "Oufut";
-  if (level < 5.5f) return "Low Center";
-  if (level < 6.5f) return "Center";
-  if (level < 7.0f) return "High Center";
-  if (level < 7.5f) return "Skull";
+  if (netScheduler.windowOpen()) {
+    netWindowTask.forceNextIteration();
+    return;
+  }
+  // Stay awake until the clock's request burst has had its replies
+  if (systemClock.busy()) {
+    netWindowTask.delay(SNTP_SAMPLE_GAP_MS);
+    return;
+  }
+  radioSleep();
+  metrics.recordRadioWindow(millis() - windowStartMs);
+  netWindowTask.delay(netScheduler.msUntilWindow(millis()));
 }
 
+// Starts a sync, pollSntp() carries it through while the other tasks run
+void updateSystemTime(){
+  METRICS_FETCH(METRIC_TASK_UPDATE_TIME, NET_TIME);
+  if (!riverFetch.retryAllows(NET_TIME)) {
+    return;
+  }
+  if (systemClock.startSync()) {
+    pollSntpTask.enableIfNot();
+  } else if (!systemClock.busy()) {
+    metrics.recordFetch(METRIC_SOURCE_NTP, 0, systemClock.lastSyncMs(), false);
+    riverFetch.retrySchedule(NET_TIME, false);
+  }
+}
 
-const unsigned int getPlayColor(float level) {
-  if (level < 3.5f) return TFT_YELLOW;
-  if (level < 3.65f) return TFT_GREEN;
-  if (level < 3.8f) return TFT_GREEN;
-  if (level < 4.03f) return TFT_YELLOW;
-  if (level < 4.25f) return TFT_GREEN;
-  if (level < 4.5f) return TFT_GREEN;
-  if (level < 4.7f) return TFT_GREEN;
-  if (level < 5.0f) return TFT_YELLOW;
-  if (level < 5.5f) return TFT_GREEN;
-  if (level < 6.5f) return TFT_GREEN;
-  if (level < 7.0f) return TFT_GREEN;
-  if (level < 7.5f) return TFT_GREEN;
-  return TFT_RED;
+void pollSntp() {
+  METRICS_TASK(METRIC_TASK_POLL_SNTP, pollSntpTask);
+  if (systemClock.poll()) {
+    return;
+  }
+  pollSntpTask.disable();
+  bool success = systemClock.lastSyncOk();
+  metrics.recordFetch(METRIC_SOURCE_NTP, SNTP_BURST * SNTP_PACKET_LEN, systemClock.lastSyncMs(), success);
+  if (success) {
+    // The clock picks its own interval from how well it is holding time
+    riverFetch.retrySchedule(NET_TIME, true);
+    netScheduler.schedule(NET_TIME, millis(), systemClock.pollIntervalMs());
+    // The clock runs last in the boot window, after the weather page was drawn without it
+    static bool firstSync = true;
+    if (firstSync && pages.page() == SHOW_CURRENT) {
+      pages.drawAstronomy();
+    }
+    firstSync = false;
+  } else {
+    riverFetch.retrySchedule(NET_TIME, false);
+  }
 }
 
-const unsigned int getTempColor(float tempC) {
-  if (tempC < 10.0f) return TFT_BLUE;
-  if (tempC < 15.0f) return TFT_GREEN;
-  if (tempC < 20.0f) return TFT_YELLOW;
-  if (tempC < 25.0f) return TFT_ORANGE;
-  return TFT_RED;
+
+void displayTime(){
+  METRICS_TASK(METRIC_TASK_DISPLAY_TIME, displayTimeTask);
+  pages.displayTime();
 }
 
-// draws the current USGS stream data
-void drawUSGSStationReading(StationReading* sr) {
-  tft.fillRect(0, 270, 320, 480, TFT_BLACK);
-  tft.setTextDatum(TL_DATUM);
-  drawSeparator(270);
-  int valueOffset = 120;
-  char scratch[255] = {};
-  
-  tft.loadFont(AA_FONT_SMALL);
-  tft.setTextColor(TFT_ORANGE, TFT_BLACK);
-  tft.setTextPadding(0);
-  tft.setTextDatum(TR_DATUM);
-  tft.drawString(CURRENT_LABEL, 220, 280);
-  if (sr) {
-    tft.setTextDatum(TL_DATUM);
-    tft.setTextPadding(0);
-    tft.drawString("Updated at:", LABEL_X, 295);
-    tft.setTextColor(TFT_LIGHTGREY, TFT_BLACK);
-    tft.drawString(sr->timeStr.c_str(), valueOffset, 295);
-
-    tft.setTextColor(TFT_ORANGE, TFT_BLACK);
-    tft.drawString("Flow:", LABEL_X, 325);
-    tft.setTextColor(TFT_LIGHTGREY, TFT_BLACK);
-    sprintf(scratch, "%d", sr->flow);
-    tft.drawString(scratch, valueOffset, 325);
+/***************************************************************************************
+**                          Touch input
+***************************************************************************************/
+// The FT62XX pulls INT low when a finger lands. The ISR only wakes the reader task,
+// which samples the panel over I2C until the contact ends and feeds the recognizer.
+// Nothing touches I2C while the screen is idle.
+void IRAM_ATTR touchISR() {
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(touchReaderHandle, &woken);
+  if (woken) {
+    portYIELD_FROM_ISR();
+  }
+}
 
-    
-    tft.setTextColor(TFT_ORANGE, TFT_BLACK);
-    tft.drawString("Height:", LABEL_X, 340);
-    int level_width = (int)roundf(sr->stage * (float)30);
-    tft.setTextColor(getPlayColor(sr->stage), TFT_BLACK);
-    sprintf(scratch,"%2.2f  %s", sr->stage, getPlayString(sr->stage));
-    tft.drawString(scratch, valueOffset, 340);
-
-    tft.fillRoundRect(valueOffset,360,level_width,20,5,getPlayColor(sr->stage));
-
-    tft.setTextColor(TFT_ORANGE, TFT_BLACK);
-    tft.drawString("Temp:", LABEL_X, 390);
-    tft.setTextColor(TFT_LIGHTGREY, TFT_BLACK);
-    float fahrenheit = (sr->temp * 9.0) / 5.0 + 32;
-    sprintf(scratch, "%2.1fC / %2.1fF", sr->temp, fahrenheit);
-    tft.drawString(scratch, valueOffset, 390);
-
-    int temp_width = (int) roundf(sr->temp * 5);
-    tft.fillRoundRect(valueOffset,410,temp_width,20,5,getTempColor(sr->temp));
+void touchReader(void* arg) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    do {
+      TouchPoint p = touchScreen.read();
+      gestureRecognizer.update(p.touched != 0, p.xPos, p.yPos, millis());
+      vTaskDelay(pdMS_TO_TICKS(TOUCH_SAMPLE_MS));
+    } while (touchScreen.touching() || gestureRecognizer.active());
   }
-  tft.unloadFont();
 }
 
-void utcDateStringToLocalString(String dateTime, char* outString, size_t outStringLen) {
-  static auto localTz = ace_time::TimeZone::forZoneInfo(&ace_time::zonedb::kZoneAmerica_New_York, &timeZoneProcessor);
-  ace_time::ZonedDateTime zdt = ace_time::ZonedDateTime::forDateString(dateTime.c_str()).convertToTimeZone(localTz);
-  snprintf(outString, outStringLen,"%02d/%02d %02d:%02d\n", zdt.month(), zdt.day(), zdt.hour(), zdt.minute());
+void startTouchReader() {
+  touchScreen.begin(TOUCH_INT_PIN);
+  xTaskCreatePinnedToCore(touchReader, "touch", 3072, NULL, 1, &touchReaderHandle, 0);
+  attachInterrupt(digitalPinToInterrupt(TOUCH_INT_PIN), touchISR, FALLING);
 }
 
-/***************************************************************************************
-**                          Tasks
-***************************************************************************************/
-void fetchUSGSStation() {
-  Serial.println(ESP.getFreeHeap());
-  bool success = usgs->fetch();
-  if (success) {
-    // usgs->serialPrint();
-    Serial.println("Getting the last entry");
-    StationReading* sr = usgs->getLastReading();
-    if (sr && currentRiverDisplay == SHOW_CURRENT) {
-      sr->serialPrint();
-      drawUSGSStationReading(sr);
+void showPage(int page) {
+  scrollHydrographTask.disable();
+  pages.show(page);
+}
+
+// Each gesture produces at most one page change or table scroll
+void handleGestures() {
+  METRICS_TASK(METRIC_TASK_GESTURES, handleGesturesTask);
+  GestureEvent ev;
+  while (gestureQueue.pop(ev)) {
+    Serial.printf("Gesture %d at %d x %d (%d, %d) %dms\n", ev.type, ev.xPos, ev.yPos, ev.dx, ev.dy, ev.durationMs);
+    switch (ev.type) {
+      case GESTURE_TAP:
+      case GESTURE_SWIPE_LEFT:
+      case GESTURE_SWIPE_RIGHT:
+        showPage(pages.page() == SHOW_FORECAST ? SHOW_CURRENT : SHOW_FORECAST);
+        break;
+      case GESTURE_SWIPE_UP:
+      case GESTURE_SWIPE_DOWN:
+        // Drag the forecast table, swiping up shows later rows
+        if (pages.page() == SHOW_FORECAST && hydrographView.scrollBy(-ev.dy)) {
+          startScroll();
+        }
+        break;
+      case GESTURE_LONG_PRESS:
+        // Refresh whatever the current page is showing
+        netScheduler.requestNow(NET_WEATHER, millis());
+        netScheduler.requestNow(pages.page() == SHOW_CURRENT ? NET_USGS : NET_NWS, millis());
+        netWindowTask.forceNextIteration();
+        break;
+      default:
+        break;
     }
   }
-  Serial.println(ESP.getFreeHeap());
 }
 
 
-void fetchHydrograph() {
-  Serial.println(ESP.getFreeHeap());
-  bool parsed = false;
-
-  for(int i=0; i <5; i++) {
-    parsed = hydrograph.fetch();
-    if (!parsed) {
-      Serial.println("hydrograph fetch failed. forecast is empty Will try again");
-      delay(2000);
-    } else  if (currentRiverDisplay == SHOW_FORECAST) {
-      Serial.println("Displaying forecast");
-      hydrograph.printForecast();
-      drawHydrograph();
-      break;
+// The scroll metric when the running animation started, for its frame time
+static uint32_t scrollStartRuns = 0;
+static uint32_t scrollStartUs = 0;
+
+void startScroll() {
+  if (!scrollHydrographTask.isEnabled()) {
+    scrollStartRuns = metrics.tasks[METRIC_TASK_SCROLL].runs;
+    scrollStartUs = metrics.tasks[METRIC_TASK_SCROLL].totalUs;
+    scrollHydrographTask.enable();
+  }
+}
+
+// One frame of the table scroll animation, the task runs only while the table moves
+void scrollHydrograph() {
+  METRICS_TASK(METRIC_TASK_SCROLL, scrollHydrographTask);
+  if (!hydrographView.step()) {
+    scrollHydrographTask.disable();
+    // This frame is still being timed, the average is over the ones before it.
+    // An 'r' during the scroll restarted the counters, nothing to report.
+    const TaskStats& t = metrics.tasks[METRIC_TASK_SCROLL];
+    uint32_t frames = t.runs >= scrollStartRuns ? t.runs - scrollStartRuns : 0;
+    if (frames) {
+      uint32_t us = (t.totalUs - scrollStartUs) / frames;
+      Serial.printf("Scroll: %u frames, %u.%02u ms a frame, slowest frame so far %u ms\n", frames,
+                    us / 1000, us % 1000 / 10, t.maxUs / 1000);
     }
   }
+}
+
 
-  Serial.println(ESP.getFreeHeap());
+/***************************************************************************************
+**                          Diagnostics
+***************************************************************************************/
+void sampleMetrics() {
+  METRICS_TASK(METRIC_TASK_SAMPLE_METRICS, sampleMetricsTask);
+  metrics.sampleHeap();
 }
 
-void fetchWeather() {
-  Serial.println(ESP.getFreeHeap());
-  int res = OWOC.parseWeather(ONECALLKEY, NULL, NULL, NULL, METRIC_WEATHER, WEATHER_CITY, EXCL_H + EXCL_M + EXCL_A, 0); //<---------excludes hourly, minutely, historical data 1 day
-  Serial.printf("Parsing openweather returned %d\n", res);
-  if (0 > res) {
-    return;
-  }
-  switch(currentRiverDisplay) {
-    case SHOW_FORECAST:
-      displayWeatherForecast();
-      break;
-    case SHOW_CURRENT:
-      displayWeatherCurrent();
-      break;
+#ifdef MODEL_CACHE_SERVER
+void serveModelCache() {
+  METRICS_TASK(METRIC_TASK_MODEL_CACHE, serveModelCacheTask);
+  modelCache.handleClient();
+}
+#endif
+
+#ifdef SCREEN_SERVER
+void serveScreen() {
+  METRICS_TASK(METRIC_TASK_SCREEN_SERVER, serveScreenTask);
+  bool viewing = screenServer.connected();
+  screenServer.poll();
+  if (screenServer.connected() != viewing) {
+    if (viewing && !netScheduler.windowOpen() && !systemClock.busy()) {
+      radioSleep();
+    } else if (!viewing) {
+      radioWake();
+    }
   }
-  Serial.println(ESP.getFreeHeap());
 }
+#endif
 
+// When the push being applied was picked up, for the refresh latency
+static uint32_t peerPushStartMs = 0;
 
+#ifdef PEER_PUSH
+// The peer whose model to pull after a lost push
+static IPAddress resyncPeer;
+static bool resyncPending = false;
+#endif
 
-void updateSystemTime(){
-  if (!ntpClock.isSetup()) {
-    Serial.println(F("NTPClock setup failed... tring again."));
-    ntpClock.setup();
+void pollPeerPush() {
+#ifdef PEER_PUSH
+  METRICS_TASK(METRIC_TASK_PEER_PUSH, pollPeerPushTask);
+  peerPushStartMs = millis();
+  peerPush.poll(systemClock.unixSeconds());
+  // The push that showed the gap is already applied, the pull can wait for a
+  // window, up to the source's lateness
+  if (peerPush.takeLost(&resyncPeer)) {
+    resyncPending = true;
+    netScheduler.schedule(NET_PEER, millis(), 0);
+    netWindowTask.forceNextIteration();
   }
-  auto localTz = TimeZone::forZoneInfo(&zonedb::kZoneAmerica_New_York, &timeZoneProcessor);
-  acetime_t nowSeconds = ntpClock.getNow();
-  Serial.printf("ntpClock returned %ul\n", nowSeconds);
-  ZonedDateTime dateTime = ZonedDateTime::forEpochSeconds(nowSeconds, localTz);
-  Serial.printf("Unix time is %d %02d:%02d\n", dateTime.toEpochSeconds(), dateTime.hour(), dateTime.minute());
-  systemClock.setNow(dateTime.toEpochSeconds());
+#endif
 }
 
-
-void displayTime(){
-  int xpos = 0;
-  int ypos = 0; 
-  
-  auto localTz = TimeZone::forZoneInfo(&zonedb::kZoneAmerica_New_York, &timeZoneProcessor);
-  acetime_t nowSeconds = systemClock.getNow();
-  ZonedDateTime dateTime = ZonedDateTime::forEpochSeconds(nowSeconds, localTz);
-
-  tft.unloadFont();
-  tft.setCursor(5,5,8);
-  tft.setTextColor(TFT_GREEN, TFT_BLACK);
-  tft.printf("%02d:%02d", dateTime.hour(), dateTime.minute());
-  tft.setCursor(260,5,4);
-  tft.printf("%s", DateStrings().dayOfWeekShortString(dateTime.dayOfWeek()));
-  tft.setCursor(260,31,4);
-  tft.printf("%s", DateStrings().monthShortString(dateTime.month()));
-  tft.setCursor(260,56,4);
-  tft.printf("%d",dateTime.day());
-  tft.unloadFont();
+// A peer fetched something newer. Show it and push our own poll of that source back a full interval.
+void onPeerPushApplied(uint8_t kind) {
+  Serial.printf("Applied peer push kind %d\n", kind);
+  if (kind != PEER_PUSH_WEATHER) {
+    riverAnalytics.update(hydrograph.model(), usgs.getLastReading());
+  }
+  if (kind == PEER_PUSH_READING) {
+    netScheduler.completed(NET_USGS, millis());
+    riverFetch.planNext(NET_USGS);
+    if (pages.refreshReading()) {
+      metrics.recordRefresh(METRIC_SOURCE_PEER, millis() - peerPushStartMs);
+    }
+  } else if (kind == PEER_PUSH_HYDROGRAPH) {
+    netScheduler.completed(NET_NWS, millis());
+    riverFetch.planNext(NET_NWS);
+    if (pages.refreshForecast()) {
+      metrics.recordRefresh(METRIC_SOURCE_PEER, millis() - peerPushStartMs);
+    }
+  } else if (kind == PEER_PUSH_WEATHER) {
+    netScheduler.completed(NET_WEATHER, millis());
+    if (pages.refreshWeather()) {
+      metrics.recordRefresh(METRIC_SOURCE_PEER, millis() - peerPushStartMs);
+    }
+  }
 }
 
+// Pulls the whole model from a peer we lost a push from. One that does not
+// answer is left, its next push or our own polls catch up.
+void resyncFromPeer() {
+#ifdef PEER_PUSH
+  netScheduler.completed(NET_PEER, millis());
+  if (!resyncPending) {
+    return;
+  }
+  resyncPending = false;
+  peerPushStartMs = millis();
+  uint8_t applied = 0;
+  modelCache.fetchFromPeer(resyncPeer.toString().c_str(), &applied);
+  if (applied & MODEL_SECTION_READING) onPeerPushApplied(PEER_PUSH_READING);
+  if (applied & MODEL_SECTION_HYDROGRAPH) onPeerPushApplied(PEER_PUSH_HYDROGRAPH);
+  if (applied & MODEL_SECTION_WEATHER) onPeerPushApplied(PEER_PUSH_WEATHER);
+#endif
+}
 
-void checkTouch(){
-  // This will report a LOT of events when touched
-  TouchPoint p = touchScreen.read();
-  if (p.touched) {
-    Serial.printf("You touched me at %d x %d\n", p.xPos, p.yPos);
-    tft.fillScreen(TFT_BLACK);
-    if (currentRiverDisplay == SHOW_FORECAST) {
-      currentRiverDisplay = SHOW_CURRENT;
-      displayWeatherCurrent();
-      drawUSGSStationReading(usgs->getLastReading());
-    } else {
-      currentRiverDisplay = SHOW_FORECAST;
-      displayWeatherForecast();
-      drawHydrograph();
+// Single character commands on the serial monitor
+//   m  metrics as text
+//   b  metrics as a binary blob
+//   r  reset the metrics
+//   t  render trace as Chrome trace_event JSON (RENDER_TRACE builds)
+//   c  clear the render trace
+//   a  fetch arena usage
+//   g  time the gauge drawing (draws over the page, then redraws it)
+//   w  network wake window schedule, the learnt USGS and NWS publication times and the peer push counts
+//   n  clock sync state: offset, round trip, frequency correction
+//   s  screen capture of the tiles changed since the last one on serial (SCREEN_SERVER builds)
+//   S  screen capture of every tile
+void checkSerial() {
+  METRICS_TASK(METRIC_TASK_SERIAL, checkSerialTask);
+  while (Serial.available()) {
+    int c = Serial.read();
+    switch (c) {
+      case 'm':
+        metrics.dump(Serial);
+        break;
+      case 'b':
+        metrics.dumpBinary(Serial);
+        break;
+      case 'r':
+        metrics.reset();
+        break;
+      case 't':
+        TRACE_EXPORT(Serial);
+        break;
+      case 'c':
+        TRACE_CLEAR();
+        break;
+      case 'a':
+        fetchArena.report(Serial);
+        break;
+      case 'g':
+        pages.gauges()->benchmark(Serial, STAGE_GAUGE_X, STAGE_GAUGE_Y, STAGE_GAUGE_R);
+        showPage(pages.page());
+        break;
+      case 'w':
+        netScheduler.report(Serial, millis());
+        pollPlanner.report(Serial, systemClock.unixSeconds());
+#ifdef PEER_PUSH
+        peerPush.report(Serial);
+#endif
+        break;
+      case 'n':
+        systemClock.report(Serial);
+        break;
+#ifdef SCREEN_SERVER
+      case 's':
+      case 'S':
+        screenServer.capture(Serial, SCREEN_SINK_SERIAL, c == 'S');
+        screenServer.report(Serial);
+        break;
+#endif
+      default:
+        break;
     }
   }
 }
@@ -800,7 +670,7 @@ void setup() {
   pinMode(TFT_BL, OUTPUT);
   digitalWrite(TFT_BL, 128);
 
-  touchScreen.begin();
+  startTouchReader();
   tft.fillScreen(TFT_BLACK);
 
   SPIFFS.begin();
@@ -813,6 +683,10 @@ void setup() {
     tft.drawString("Formatting SPIFFS, so wait!", 120, 195); SPIFFS.format();
   #endif
 
+  if (playLevels.load(PLAY_LEVELS_FILE)) {
+    riverAnalytics.setLevels(playLevels.boundaries(), playLevels.boundaryCount());
+  }
+
   // Draw splash screen
   if (SPIFFS.exists("/splash/OpenWeather.jpg")   == true) ui.drawJpeg("/splash/OpenWeather.jpg",   0, 40);
 
@@ -821,7 +695,9 @@ void setup() {
   // Clear bottom section of screen
   tft.fillRect(0, 206, 240, 320 - 206, TFT_BLACK);
 
-  tft.loadFont(AA_FONT_SMALL);
+  // The only loadFont(), the draw functions switch the font on and off from here
+  smallFont.begin();
+  smallFont.use();
   tft.setTextDatum(BC_DATUM); // Bottom Centre datum
   tft.setTextColor(TFT_LIGHTGREY, TFT_BLACK);
 
@@ -840,20 +716,37 @@ void setup() {
   WIFISetUp();
   tft.fillRect(0, 206, 240, 320 - 206, TFT_BLACK);
 
-  // Setup the NTP Clock
-  ntpClock.setup();
-  if (!ntpClock.isSetup()) {
-    SERIAL_PORT_MONITOR.println(F("NTPClock setup failed... try again."));
-  }
+#ifdef MODEL_CACHE_SERVER
+  modelCache.update();
+  modelCache.beginServer();
+  Serial.printf("Model cache at http://%s/model.json\n", WiFi.localIP().toString().c_str());
+#endif
+#ifdef PEER_PUSH
+  peerPush.begin(PEER_PUSH_GROUP, PEER_PUSH_PORT, &onPeerPushApplied);
+#endif
+#ifdef SCREEN_SERVER
+  screenServer.begin();
+  Serial.printf("Screen captures on %s port %d\n", WiFi.localIP().toString().c_str(), SCREEN_SERVER_PORT);
+#endif
+
+  // The clock syncs in the first wake window, without holding up the display
+  systemClock.begin();
 
   tft.setTextDatum(BC_DATUM);
   tft.setTextPadding(240); // Pad next drawString() text to full width to over-write old text
   tft.drawString(" ", 120, 220);  // Clear line above using set padding width
   tft.drawString("Fetching weather data...", 120, 240);
 
-  tft.unloadFont();
+  smallFont.release();
   tft.fillScreen(TFT_BLACK);
-  updateSystemTime();
+
+  riverFetch.begin(millis());
+#if defined(MODEL_CACHE_SERVER) || defined(MODEL_CACHE_PEER)
+  riverFetch.share(&modelCache, NULL);
+#endif
+#ifdef PEER_PUSH
+  riverFetch.share(&modelCache, &peerPush);
+#endif
   //fetchWeather();
   //fetchUSGSStation();
   //fetchHydrograph();
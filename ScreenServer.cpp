@@ -0,0 +1,185 @@
+#include "ScreenServer.h"
+#include "ByteCodec.h"
+
+static const uint8_t SCREEN_MAGIC[4] = { 'R', 'W', 'S', 'C' };
+
+ScreenServer::ScreenServer(TFT_eSPI* tft, const HydrographView* scroller) {
+  this->tft = tft;
+  this->scroller = scroller;
+}
+
+void ScreenServer::begin(uint16_t port) {
+  this->server = new WiFiServer(port);
+  this->server->begin();
+  this->server->setNoDelay(true);
+}
+
+/***************************************************************************************
+**                          Tile codec
+***************************************************************************************/
+size_t ScreenServer::encodeTile(const uint16_t* pixels, int w, int h, uint8_t* out) {
+  int n = w * h;
+  int i = 0;
+  size_t len = 0;
+  uint16_t prev = 0;
+
+  while (i < n) {
+    int limit = min(n - i, SCREEN_OP_MAX);
+    int run = 0;
+    while (run < limit && pixels[i + run] == prev) run++;
+    int up = 0;
+    if (i >= w) {
+      while (up < limit && pixels[i + up] == pixels[i + up - w]) up++;
+    }
+    if (run || up) {
+      int count = run >= up ? run : up;
+      out[len++] = (run >= up ? SCREEN_OP_RUN : SCREEN_OP_UP) | (count - 1);
+      i += count;
+      prev = pixels[i - 1];
+      continue;
+    }
+
+    int same = 1;
+    while (same < limit && pixels[i + same] == pixels[i]) same++;
+    if (same >= 2) {
+      out[len++] = SCREEN_OP_COLOUR | (same - 1);
+      out[len++] = pixels[i] & 0xFF;
+      out[len++] = pixels[i] >> 8;
+      i += same;
+      prev = pixels[i - 1];
+      continue;
+    }
+
+    // Literal until the next pixel would compress
+    int start = i;
+    do {
+      i++;
+    } while (i < n && i - start < limit &&
+             pixels[i] != pixels[i - 1] &&
+             (i < w || pixels[i] != pixels[i - w]) &&
+             (i + 1 >= n || pixels[i + 1] != pixels[i]));
+    out[len++] = SCREEN_OP_LIT | (i - start - 1);
+    for (int k = start; k < i; k++) {
+      out[len++] = pixels[k] & 0xFF;
+      out[len++] = pixels[k] >> 8;
+    }
+    prev = pixels[i - 1];
+  }
+  return len;
+}
+
+/***************************************************************************************
+**                          Capture
+***************************************************************************************/
+// readRectRGB gives three bytes a pixel whatever the panel's byte order, packed back to RGB565
+void ScreenServer::readTile(int32_t x, int32_t y, int w, int h) {
+  this->tft->readRectRGB(x, y, w, h, this->rgb);
+  const uint8_t* p = this->rgb;
+  for (int i = 0; i < w * h; i++, p += 3) {
+    this->pixels[i] = ((p[0] & 0xF8) << 8) | ((p[1] & 0xFC) << 3) | (p[2] >> 3);
+  }
+}
+
+void ScreenServer::capture(Print& out, ScreenSink sink, bool full) {
+  uint32_t startMs = millis();
+  int width = this->tft->width();
+  int height = this->tft->height();
+  int cols = (width + SCREEN_TILE - 1) / SCREEN_TILE;
+  int rows = (height + SCREEN_TILE - 1) / SCREEN_TILE;
+  if (cols * rows > SCREEN_TILES_MAX) {
+    Serial.printf("ScreenServer: %dx%d is too many tiles\n", cols, rows);
+    return;
+  }
+  full = full || !this->hashesValid[sink];
+
+  uint8_t header[32];
+  ByteWriter w(header, sizeof(header));
+  w.putBytes(SCREEN_MAGIC, sizeof(SCREEN_MAGIC));
+  w.put8(SCREEN_SERVER_VERSION);
+  w.put16(width);
+  w.put16(height);
+  w.put8(SCREEN_TILE);
+  w.put16(HYDROGRAPH_VIEW_TOP);
+  w.put16(HYDROGRAPH_VIEW_HEIGHT);
+  w.put16(this->scroller ? this->scroller->scrollStart() : HYDROGRAPH_VIEW_TOP);
+  w.put32(++this->frame);
+  w.put8(full ? SCREEN_FLAG_FULL : 0);
+  out.write(header, w.length());
+
+  uint32_t bytes = w.length();
+  uint32_t check = fnv1a32(NULL, 0);   // the offset basis
+  uint16_t sent = 0;
+  for (int index = 0; index < cols * rows; index++) {
+    int32_t x = (index % cols) * SCREEN_TILE;
+    int32_t y = (index / cols) * SCREEN_TILE;
+    int tw = min(SCREEN_TILE, width - (int)x);
+    int th = min(SCREEN_TILE, height - (int)y);
+    readTile(x, y, tw, th);
+    uint32_t hash = fnv1a32((const uint8_t*)this->pixels, tw * th * sizeof(uint16_t));
+    if (!full && hash == this->tileHash[sink][index]) {
+      continue;
+    }
+    this->tileHash[sink][index] = hash;
+
+    size_t len = encodeTile(this->pixels, tw, th, this->code);
+    uint8_t record[4];
+    ByteWriter r(record, sizeof(record));
+    r.put16(index);
+    r.put16(len);
+    check = fnv1a32(record, sizeof(record), check);
+    check = fnv1a32(this->code, len, check);
+    out.write(record, sizeof(record));
+    out.write(this->code, len);
+    bytes += sizeof(record) + len;
+    sent++;
+  }
+  this->hashesValid[sink] = true;
+
+  uint8_t trailer[8];
+  ByteWriter t(trailer, sizeof(trailer));
+  t.put16(0xFFFF);
+  t.put16(sent);
+  t.put32(check);
+  out.write(trailer, t.length());
+  out.flush();
+
+  this->lastTiles = sent;
+  this->lastBytes = bytes + t.length();
+  this->lastMs = millis() - startMs;
+}
+
+/***************************************************************************************
+**                          TCP viewer
+***************************************************************************************/
+void ScreenServer::poll() {
+  if (!this->server) {
+    return;
+  }
+  if (!this->client.connected()) {
+    WiFiClient next = this->server->available();
+    if (!next) {
+      return;
+    }
+    this->client = next;
+    this->client.setNoDelay(true);
+    this->clientNeedsFull = true;
+    this->lastFrameMs = millis() - SCREEN_SERVER_FRAME_MS;
+    Serial.printf("ScreenServer: viewer %s connected\n", this->client.remoteIP().toString().c_str());
+  }
+  while (this->client.available()) {
+    if (this->client.read() == 'S') {
+      this->clientNeedsFull = true;
+    }
+  }
+  if (millis() - this->lastFrameMs < SCREEN_SERVER_FRAME_MS && !this->clientNeedsFull) {
+    return;
+  }
+  this->lastFrameMs = millis();
+  capture(this->client, SCREEN_SINK_VIEWER, this->clientNeedsFull);
+  this->clientNeedsFull = false;
+}
+
+void ScreenServer::report(Print& out) const {
+  out.printf("ScreenServer: frame %u, %u tiles, %u bytes in %u ms%s\n", this->frame, this->lastTiles,
+             this->lastBytes, this->lastMs, this->server ? "" : ", no TCP listener");
+}
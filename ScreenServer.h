@@ -0,0 +1,104 @@
+#ifndef _RIVER_WEATHER_SCREEN_SERVER_H_FILE
+#define _RIVER_WEATHER_SCREEN_SERVER_H_FILE
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <TFT_eSPI.h>
+#include "HydrographView.h"
+
+/*
+ * Screen capture for SCREEN_SERVER builds. The panel memory is read back in
+ * SCREEN_TILE x SCREEN_TILE tiles and a tile is only sent when its hash
+ * differs from the last capture sent to the same sink, so a viewer that has
+ * the previous picture gets just what changed. The serial port and the TCP
+ * viewer keep separate hashes, as each has only seen its own frames.
+ * tools/screen_receiver.py rebuilds PNGs from the stream, over the serial port
+ * ('s' and 'S') or a TCP connection to SCREEN_SERVER_PORT, and
+ * tools/screen_test.cpp checks the codec against it.
+ *
+ * Frame, little endian:
+ *   "RWSC" version u8, width u16, height u16, tile size u8,
+ *   scroll top u16, scroll height u16, scroll start u16, frame u32, flags u8,
+ *   then per changed tile index u16, length u16, encoded pixels,
+ *   then 0xFFFF, tile count u16, fnv1a32 u32 over the tile records.
+ *
+ * The capture is of panel memory, so inside the hydrograph's scroll region
+ * the receiver rotates the lines by scroll start to get what is on the glass.
+ *
+ * Tile pixels are RGB565 in rows. Each op byte holds the op in its top two
+ * bits and a count of 1 to 64 pixels, less one, in the rest:
+ *   RUN     repeat the previous pixel (black at the start of a tile)
+ *   UP      copy the pixels one row up
+ *   LIT     count pixels follow, u16 each
+ *   COLOUR  one u16 follows, repeated count times
+ * The mostly black pages come out at a few percent of their raw 300 KB.
+ */
+
+#define SCREEN_SERVER_VERSION  1
+#define SCREEN_SERVER_PORT     5950
+#define SCREEN_SERVER_FRAME_MS 1000   // how often a connected viewer is sent the changes
+#define SCREEN_TILE            32
+#define SCREEN_TILES_MAX       ((480 / SCREEN_TILE) * (480 / SCREEN_TILE))
+#define SCREEN_OP_MAX          64
+// Literals cost a byte per SCREEN_OP_MAX pixels on top of the pixels themselves
+#define SCREEN_TILE_CODE_MAX   (SCREEN_TILE * SCREEN_TILE * 2 + SCREEN_TILE * SCREEN_TILE / SCREEN_OP_MAX)
+
+#define SCREEN_FLAG_FULL 0x01   // every tile is in the frame
+
+typedef enum {
+  SCREEN_SINK_SERIAL = 0,
+  SCREEN_SINK_VIEWER,
+  SCREEN_SINKS
+} ScreenSink;
+
+typedef enum {
+  SCREEN_OP_RUN    = 0x00,
+  SCREEN_OP_UP     = 0x40,
+  SCREEN_OP_LIT    = 0x80,
+  SCREEN_OP_COLOUR = 0xC0
+} ScreenOp;
+
+class ScreenServer {
+  public:
+    ScreenServer(TFT_eSPI* tft, const HydrographView* scroller);
+
+    void begin(uint16_t port = SCREEN_SERVER_PORT);
+
+    // Sends the tiles that changed since the sink's last capture, or all of them
+    void capture(Print& out, ScreenSink sink, bool full);
+
+    // Accepts a viewer and sends it the changes every SCREEN_SERVER_FRAME_MS.
+    // The viewer asks for a full frame by sending 'S'.
+    void poll();
+    bool connected() { return this->client.connected(); }
+
+    void report(Print& out) const;
+
+    // Encodes w x h pixels, returns the length written to out
+    static size_t encodeTile(const uint16_t* pixels, int w, int h, uint8_t* out);
+
+  private:
+    void readTile(int32_t x, int32_t y, int w, int h);
+
+    TFT_eSPI*             tft;
+    const HydrographView* scroller;
+    WiFiServer*           server = NULL;
+    WiFiClient            client;
+    uint32_t              lastFrameMs = 0;
+    bool                  clientNeedsFull = false;
+
+    uint32_t tileHash[SCREEN_SINKS][SCREEN_TILES_MAX];
+    bool     hashesValid[SCREEN_SINKS] = {};
+    uint32_t frame = 0;
+
+    // Last capture, for the report
+    uint16_t lastTiles = 0;
+    uint32_t lastBytes = 0;
+    uint32_t lastMs = 0;
+
+    uint8_t  rgb[SCREEN_TILE * SCREEN_TILE * 3];
+    uint16_t pixels[SCREEN_TILE * SCREEN_TILE];
+    uint8_t  code[SCREEN_TILE_CODE_MAX];
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef _RIVER_WEATHER_SMOOTH_FONT_H_FILE
+#define _RIVER_WEATHER_SMOOTH_FONT_H_FILE
+
+#include "TracedTFT.h"
+
+/*
+ * The anti-aliased font, loaded once and kept. TFT_eSPI allocates the glyph
+ * tables in loadFont() and frees them in unloadFont(), so loading it for each
+ * draw put seven allocations into every render. Instead the draw code turns
+ * it on and off with the library's fontLoaded flag: while it is off
+ * drawString() and print() use the built in fonts and the tables stay where
+ * they are. Nothing may call loadFont() or unloadFont() behind its back.
+ */
+class SmoothFont {
+  public:
+    SmoothFont(TracedTFT* tft, const char* name) : tft(tft), name(name) {}
+
+    // Once, with SPIFFS mounted. Without the font file everything draws in
+    // the built in fonts.
+    bool begin() {
+      if (!this->loaded) {
+        this->tft->loadFont(this->name);
+        this->loaded = this->tft->fontLoaded;
+      }
+      return this->loaded;
+    }
+
+    // drawString() uses the smooth font
+    void use() { this->tft->fontLoaded = this->loaded; }
+
+    // drawString() uses the built in fonts
+    void release() { this->tft->fontLoaded = false; }
+
+    bool inUse() const { return this->tft->fontLoaded; }
+
+  private:
+    TracedTFT*  tft;
+    const char* name;
+    bool        loaded = false;
+};
+
+#endif
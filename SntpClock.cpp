@@ -0,0 +1,245 @@
+#include "SntpClock.h"
+#include <WiFi.h>
+#include <esp_timer.h>
+
+using namespace ace_time;
+
+// Seconds from 1900, the NTP era, to 1970
+#define NTP_UNIX_OFFSET 2208988800ULL
+
+static inline int64_t localMicros() {
+  return esp_timer_get_time();
+}
+
+static int64_t readTimestampUs(const uint8_t* p) {
+  uint32_t seconds = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+  uint32_t fraction = ((uint32_t)p[4] << 24) | ((uint32_t)p[5] << 16) | ((uint32_t)p[6] << 8) | p[7];
+  return ((int64_t)seconds - (int64_t)NTP_UNIX_OFFSET) * 1000000 + (((uint64_t)fraction * 1000000) >> 32);
+}
+
+void SntpClock::begin() {
+  this->udp.begin(SNTP_LOCAL_PORT);
+}
+
+/***************************************************************************************
+**                          Request burst
+***************************************************************************************/
+bool SntpClock::startSync() {
+  if (busy()) {
+    return false;
+  }
+  this->syncStartMs = millis();
+  this->sample = 0;
+  this->bestDelayUs = -1;
+  // Look the server up again after a failed sync, it may have moved
+  if (!this->resolved || !this->lastOk) {
+    this->resolved = WiFi.hostByName(this->server, this->serverIp) == 1;
+  }
+  if (!this->resolved) {
+    Serial.printf("SntpClock: cannot resolve %s\n", this->server);
+    finishSync();
+    return false;
+  }
+  if (!sendRequest()) {
+    finishSync();
+    return false;
+  }
+  this->state = SYNC_WAITING;
+  return true;
+}
+
+bool SntpClock::sendRequest() {
+  // Drop late replies to earlier requests
+  this->udp.flush();
+  while (this->udp.parsePacket() > 0) {
+    this->udp.flush();
+  }
+
+  uint8_t packet[SNTP_PACKET_LEN] = {};
+  packet[0] = 0x23;  // no leap warning, version 4, client
+  // Any unique value does as the transmit timestamp, the server only echoes it
+  this->nonce = ((uint64_t)esp_random() << 32) | esp_random();
+  for (int i = 0; i < 8; i++) {
+    packet[40 + i] = (uint8_t)(this->nonce >> (56 - 8 * i));
+  }
+  this->stateMs = millis();
+  this->sentUs = localMicros();
+  if (!this->udp.beginPacket(this->serverIp, SNTP_PORT)) {
+    return false;
+  }
+  this->udp.write(packet, sizeof(packet));
+  return this->udp.endPacket();
+}
+
+bool SntpClock::readReply(int64_t arrivedUs) {
+  uint8_t packet[SNTP_PACKET_LEN];
+  if (this->udp.read(packet, sizeof(packet)) != SNTP_PACKET_LEN) {
+    return false;
+  }
+  uint64_t origin = 0;
+  for (int i = 0; i < 8; i++) {
+    origin = (origin << 8) | packet[24 + i];
+  }
+  uint8_t leap = packet[0] >> 6;
+  uint8_t mode = packet[0] & 0x07;
+  uint8_t stratum = packet[1];
+  // Not ours, not a server, unsynchronised, or a kiss-of-death
+  if (origin != this->nonce || mode != 4 || leap == 3 || stratum == 0 || stratum > 15) {
+    return false;
+  }
+
+  int64_t received = readTimestampUs(packet + 32);
+  int64_t transmitted = readTimestampUs(packet + 40);
+  int64_t delay = (arrivedUs - this->sentUs) - (transmitted - received);
+  if (delay < 0) {
+    delay = 0;
+  }
+  if (this->bestDelayUs < 0 || delay < this->bestDelayUs) {
+    this->bestDelayUs = delay;
+    // The server's time at the middle of its turnaround matches the middle of ours
+    this->bestLocalUs = this->sentUs + (arrivedUs - this->sentUs) / 2;
+    this->bestServerUs = received + (transmitted - received) / 2;
+  }
+  return true;
+}
+
+bool SntpClock::poll() {
+  uint32_t now = millis();
+  if (this->state == SYNC_WAITING) {
+    int size = this->udp.parsePacket();
+    if (size > 0 && size < SNTP_PACKET_LEN) {
+      // A runt is held until flushed, and parsePacket() sees nothing behind it
+      this->udp.flush();
+      size = 0;
+    }
+    if (size > 0) {
+      int64_t arrivedUs = localMicros();
+      bool ours = readReply(arrivedUs);
+      this->udp.flush();  // anything past the 48 bytes read
+      if (!ours) {
+        // Stray packet, keep waiting for ours
+        return true;
+      }
+    } else if (now - this->stateMs < SNTP_TIMEOUT_MS) {
+      return true;
+    }
+    if (++this->sample >= SNTP_BURST) {
+      finishSync();
+      return false;
+    }
+    this->state = SYNC_GAP;
+    this->stateMs = now;
+  } else if (this->state == SYNC_GAP) {
+    if (now - this->stateMs >= SNTP_SAMPLE_GAP_MS) {
+      this->state = sendRequest() ? SYNC_WAITING : SYNC_GAP;
+      this->stateMs = millis();
+      if (this->state == SYNC_GAP && ++this->sample >= SNTP_BURST) {
+        finishSync();
+        return false;
+      }
+    }
+  }
+  return busy();
+}
+
+void SntpClock::finishSync() {
+  this->state = SYNC_IDLE;
+  this->syncMs = millis() - this->syncStartMs;
+  this->lastOk = this->bestDelayUs >= 0;
+  if (!this->lastOk) {
+    this->failures++;
+    Serial.printf("SntpClock: no reply from %s\n", this->server);
+    return;
+  }
+  this->lastDelayUs = this->bestDelayUs;
+  apply(this->bestLocalUs, this->bestServerUs);
+}
+
+/***************************************************************************************
+**                          Discipline
+***************************************************************************************/
+int64_t SntpClock::clockAt(int64_t localUs) const {
+  int64_t elapsed = localUs - this->baseLocalUs;
+  int64_t t = this->baseUnixUs + elapsed + elapsed * this->freqPpb / 1000000000LL;
+  int64_t slewable = elapsed * SNTP_SLEW_PPM / 1000000;
+  if (this->slewUs > 0) {
+    t += this->slewUs < slewable ? this->slewUs : slewable;
+  } else {
+    t += -this->slewUs < slewable ? this->slewUs : -slewable;
+  }
+  return t;
+}
+
+void SntpClock::apply(int64_t localUs, int64_t serverUs) {
+  this->syncs++;
+  if (!this->set) {
+    this->set = true;
+    this->baseLocalUs = localUs;
+    this->baseUnixUs = serverUs;
+    this->slewUs = 0;
+    this->anchorLocalUs = localUs;
+    this->anchorServerUs = serverUs;
+    this->lastOffsetUs = 0;
+    Serial.printf("SntpClock: set from %s, round trip %d ms\n", this->server, (int)(this->lastDelayUs / 1000));
+    return;
+  }
+
+  int64_t ours = clockAt(localUs);
+  int64_t offset = serverUs - ours;
+
+  // The timer's rate against the server, from raw samples far enough apart
+  int64_t span = localUs - this->anchorLocalUs;
+  if (span >= (int64_t)SNTP_FREQ_MIN_SPAN_S * 1000000) {
+    int64_t measured = ((serverUs - this->anchorServerUs) - span) * 1000000000LL / span;
+    int64_t freq = this->freqEstimates ? this->freqPpb + (measured - this->freqPpb) / 2 : measured;
+    if (freq > SNTP_FREQ_MAX_PPB) freq = SNTP_FREQ_MAX_PPB;
+    if (freq < -SNTP_FREQ_MAX_PPB) freq = -SNTP_FREQ_MAX_PPB;
+    this->freqPpb = (int32_t)freq;
+    this->freqEstimates++;
+    this->anchorLocalUs = localUs;
+    this->anchorServerUs = serverUs;
+  }
+
+  // Carry on from where the clock is now, then correct the offset
+  this->baseLocalUs = localUs;
+  this->baseUnixUs = ours;
+  if (offset > SNTP_STEP_US || offset < -SNTP_STEP_US) {
+    this->baseUnixUs = serverUs;
+    this->slewUs = 0;
+    this->steps++;
+  } else {
+    // Replaces whatever was still to be slewed, the offset already includes it
+    this->slewUs = offset;
+  }
+  this->lastOffsetUs = offset;
+
+  int64_t magnitude = offset < 0 ? -offset : offset;
+  if (magnitude < SNTP_STEADY_US) {
+    this->intervalMs = this->intervalMs < SNTP_POLL_MAX_MS / 2 ? this->intervalMs * 2 : SNTP_POLL_MAX_MS;
+  } else {
+    this->intervalMs = this->intervalMs > SNTP_POLL_MIN_MS * 2 ? this->intervalMs / 2 : SNTP_POLL_MIN_MS;
+  }
+}
+
+int64_t SntpClock::unixMicros() const {
+  return this->set ? clockAt(localMicros()) : 0;
+}
+
+uint32_t SntpClock::unixSeconds() const {
+  return this->set ? (uint32_t)(clockAt(localMicros()) / 1000000) : 0;
+}
+
+acetime_t SntpClock::getNow() const {
+  if (!this->set) {
+    return LocalDate::kInvalidEpochSeconds;
+  }
+  return LocalDateTime::forUnixSeconds64(unixSeconds()).toEpochSeconds();
+}
+
+void SntpClock::report(Print& out) const {
+  out.printf("SntpClock %s: %s, %u syncs, %u steps, %u failed\n", this->server,
+             this->set ? "set" : "not set", this->syncs, this->steps, this->failures);
+  out.printf("  last offset %d ms, round trip %d ms, frequency %d ppb, next sync in %u min\n",
+             (int)(this->lastOffsetUs / 1000), (int)(this->lastDelayUs / 1000), this->freqPpb,
+             this->intervalMs / 60000);
+}
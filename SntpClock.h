@@ -0,0 +1,117 @@
+#ifndef _RIVER_WEATHER_SNTP_CLOCK_H_FILE
+#define _RIVER_WEATHER_SNTP_CLOCK_H_FILE
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include <AceTimeClock.h>
+
+/*
+ * The display's clock, disciplined by SNTP without ever blocking.
+ *
+ * A sync is a burst of SNTP_BURST requests driven by poll(); the reply with
+ * the shortest round trip is the one used, as it has the least room for
+ * asymmetric delay. Time is the free running microsecond timer scaled by a
+ * frequency correction, so the clock keeps good time between syncs:
+ *   - the correction comes from comparing how far the timer and the server
+ *     moved between syncs, smoothed over successive syncs
+ *   - a small offset is slewed out at SNTP_SLEW_PPM, so the time never jumps
+ *     and never runs backwards; only a large one is stepped
+ *   - the poll interval doubles while the offsets stay small, up to
+ *     SNTP_POLL_MAX_MS, and halves when they do not
+ *
+ * Point SNTP_SERVER at tools/ntp_standin.py to try it against a server with a
+ * known offset, drift, delay and loss; tools/sntp_test.cpp runs the same server
+ * in process on a simulated timer.
+ */
+
+#define SNTP_PORT                123
+#define SNTP_LOCAL_PORT         4123
+#define SNTP_PACKET_LEN           48
+#define SNTP_BURST                 4      // requests per sync
+#define SNTP_SAMPLE_GAP_MS       250      // between the requests of a burst
+#define SNTP_TIMEOUT_MS         1000      // wait for one reply
+#define SNTP_STEP_US          128000L     // offsets above this are stepped, below it slewed
+#define SNTP_SLEW_PPM            500
+#define SNTP_FREQ_MAX_PPB     500000L
+#define SNTP_FREQ_MIN_SPAN_S     900      // shortest baseline for a frequency estimate
+#define SNTP_STEADY_US         20000L     // offsets under this lengthen the poll interval
+#define SNTP_POLL_MIN_MS  (30UL * 60 * 1000)
+#define SNTP_POLL_MAX_MS  (48UL * 60 * 60 * 1000)
+
+class SntpClock : public ace_time::clock::Clock {
+  public:
+    SntpClock(const char* server) : server(server) {}
+
+    void begin();
+
+    // Send the first request of a sync, false if a sync is already running
+    bool startSync();
+    // Drive a running sync, call every few ms; false once it has finished
+    bool poll();
+    bool busy() const { return this->state != SYNC_IDLE; }
+    bool lastSyncOk() const { return this->lastOk; }
+    uint32_t lastSyncMs() const { return this->syncMs; }
+    // When the next sync is due
+    uint32_t pollIntervalMs() const { return this->intervalMs; }
+    // The timer's rate against the server, the correction applied to it
+    int32_t frequencyPpb() const { return this->freqPpb; }
+
+    bool isSet() const { return this->set; }
+    int64_t unixMicros() const;
+    // 0 until the first sync
+    uint32_t unixSeconds() const;
+    // AceTime epoch seconds, kInvalidEpochSeconds until the first sync
+    acetime_t getNow() const override;
+
+    void report(Print& out) const;
+
+  private:
+    typedef enum {
+      SYNC_IDLE,
+      SYNC_WAITING,   // for the reply to the last request
+      SYNC_GAP        // before the next request
+    } SyncState;
+
+    bool sendRequest();
+    bool readReply(int64_t arrivedUs);
+    void finishSync();
+    void apply(int64_t localUs, int64_t serverUs);
+    int64_t clockAt(int64_t localUs) const;
+
+    const char* server;
+    WiFiUDP     udp;
+    IPAddress   serverIp;
+    bool        resolved = false;
+
+    // Burst in progress
+    SyncState state = SYNC_IDLE;
+    uint8_t   sample = 0;
+    uint32_t  stateMs = 0;
+    uint32_t  syncStartMs = 0;
+    uint64_t  nonce = 0;        // our transmit timestamp, echoed back as the origin
+    int64_t   sentUs = 0;
+    int64_t   bestDelayUs = -1;
+    int64_t   bestLocalUs = 0;  // timer at the middle of the best round trip
+    int64_t   bestServerUs = 0; // server time there
+
+    // Discipline: time = baseUnix + elapsed scaled by freqPpb, plus the slewed part of slewUs
+    bool      set = false;
+    int64_t   baseLocalUs = 0;
+    int64_t   baseUnixUs = 0;
+    int32_t   freqPpb = 0;
+    int64_t   slewUs = 0;
+    int64_t   anchorLocalUs = 0;  // the raw sample the next frequency estimate is taken against
+    int64_t   anchorServerUs = 0;
+    uint8_t   freqEstimates = 0;
+
+    bool      lastOk = false;
+    uint32_t  syncMs = 0;
+    uint32_t  intervalMs = SNTP_POLL_MIN_MS;
+    int64_t   lastOffsetUs = 0;
+    int64_t   lastDelayUs = 0;
+    uint32_t  syncs = 0;
+    uint32_t  steps = 0;
+    uint32_t  failures = 0;
+};
+
+#endif
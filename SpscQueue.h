@@ -0,0 +1,57 @@
+#ifndef _RIVER_WEATHER_SPSC_QUEUE_H_FILE
+#define _RIVER_WEATHER_SPSC_QUEUE_H_FILE
+
+#include <stdint.h>
+#include <atomic>
+
+/*
+ * Single producer / single consumer ring buffer.
+ * One context (an ISR or a FreeRTOS task) may push while another (the
+ * scheduler loop) pops, without locks. N must be a power of two no larger
+ * than 128 so the free-running 8 bit indices wrap cleanly.
+ */
+template <typename T, uint8_t N>
+class SpscQueue {
+  static_assert(N > 0 && N <= 128 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two <= 128");
+
+  public:
+    SpscQueue() : head(0), tail(0) {}
+
+    // Returns false (and drops the item) when the queue is full
+    bool push(const T& item) {
+      uint8_t h = head.load(std::memory_order_relaxed);
+      uint8_t t = tail.load(std::memory_order_acquire);
+      if ((uint8_t)(h - t) == N) {
+        dropped++;
+        return false;
+      }
+      items[h & (N - 1)] = item;
+      head.store((uint8_t)(h + 1), std::memory_order_release);
+      return true;
+    }
+
+    bool pop(T& item) {
+      uint8_t t = tail.load(std::memory_order_relaxed);
+      uint8_t h = head.load(std::memory_order_acquire);
+      if (h == t) {
+        return false;
+      }
+      item = items[t & (N - 1)];
+      tail.store((uint8_t)(t + 1), std::memory_order_release);
+      return true;
+    }
+
+    bool empty() const {
+      return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    uint32_t droppedCount() const { return dropped; }
+
+  private:
+    T items[N];
+    std::atomic<uint8_t> head;
+    std::atomic<uint8_t> tail;
+    uint32_t dropped = 0;   // only touched by the producer
+};
+
+#endif
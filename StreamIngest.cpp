@@ -0,0 +1,236 @@
+#include "StreamIngest.h"
+
+StreamIngest::StreamIngest(char* buffer, size_t size) {
+  this->buffer = buffer;
+  this->size = size;
+}
+
+void StreamIngest::collectHeaders(HTTPClient* http) {
+  static const char* headerKeys[] = { "Transfer-Encoding" };
+  http->collectHeaders(headerKeys, 1);
+}
+
+void StreamIngest::begin(HTTPClient* http) {
+  this->stream = http->getStreamPtr();
+  this->head = 0;
+  this->tail = 0;
+  this->payload = 0;
+  this->skippedLines = 0;
+  this->skipping = false;
+  this->chunkLeft = 0;
+  this->sizeDigits = false;
+  this->sizeDone = false;
+  if (http->header("Transfer-Encoding").equalsIgnoreCase("chunked")) {
+    this->state = STATE_CHUNK_SIZE;
+    this->remaining = -1;
+  } else {
+    this->state = STATE_IDENTITY;
+    this->remaining = http->getSize();
+    if (this->remaining == 0) {
+      this->state = STATE_DONE;
+    }
+  }
+}
+
+// Strip the chunk framing from newly read bytes, moving the data down over it.
+// Returns how many data bytes are left at the start of data.
+size_t StreamIngest::dechunk(char* data, size_t len) {
+  char* out = data;
+  const char* p = data;
+  const char* end = data + len;
+  while (p < end) {
+    switch (this->state) {
+      case STATE_CHUNK_DATA: {
+        size_t n = (size_t)(end - p) < this->chunkLeft ? (size_t)(end - p) : this->chunkLeft;
+        memmove(out, p, n);
+        out += n;
+        p += n;
+        this->chunkLeft -= n;
+        if (!this->chunkLeft) {
+          this->state = STATE_CHUNK_END;
+        }
+        break;
+      }
+      case STATE_CHUNK_SIZE: {
+        char c = *p++;
+        if (c == '\n') {
+          if (!this->sizeDigits) {
+            this->state = STATE_ERROR;
+          } else {
+            this->state = this->chunkLeft ? STATE_CHUNK_DATA : STATE_TRAILER;
+            this->lineEmpty = true;
+          }
+        } else if (this->sizeDone || c == '\r') {
+          // extension, ignored
+        } else if (isxdigit((unsigned char)c) && this->chunkLeft < 0x1000000) {
+          this->chunkLeft = (this->chunkLeft << 4) | (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+          this->sizeDigits = true;
+        } else if (c == ';' || c == ' ' || c == '\t') {
+          this->sizeDone = true;
+        } else {
+          this->state = STATE_ERROR;
+        }
+        break;
+      }
+      case STATE_CHUNK_END: {
+        char c = *p++;
+        if (c == '\n') {
+          this->state = STATE_CHUNK_SIZE;
+          this->chunkLeft = 0;
+          this->sizeDigits = false;
+          this->sizeDone = false;
+        } else if (c != '\r') {
+          this->state = STATE_ERROR;
+        }
+        break;
+      }
+      case STATE_TRAILER: {
+        // Trailer fields up to an empty line, none of them are used
+        char c = *p++;
+        if (c == '\n') {
+          if (this->lineEmpty) {
+            this->state = STATE_DONE;
+          }
+          this->lineEmpty = true;
+        } else if (c != '\r') {
+          this->lineEmpty = false;
+        }
+        break;
+      }
+      default:
+        // Anything after the end or a framing error is dropped
+        p = end;
+        break;
+    }
+  }
+  return out - data;
+}
+
+// Append at least one payload byte to the buffer, false at the end of the body
+bool StreamIngest::fill() {
+  if (this->head == this->tail) {
+    this->head = 0;
+    this->tail = 0;
+  } else if (this->head > 0) {
+    memmove(this->buffer, this->buffer + this->head, this->tail - this->head);
+    this->tail -= this->head;
+    this->head = 0;
+  }
+  // One byte is kept back for readLine's terminator
+  size_t room = this->size - 1 - this->tail;
+  if (!room || !this->stream) {
+    return false;
+  }
+
+  uint32_t waitStart = millis();
+  while (this->state != STATE_DONE && this->state != STATE_ERROR) {
+    size_t want = room;
+    if (this->state == STATE_IDENTITY && this->remaining >= 0 && (size_t)this->remaining < want) {
+      want = this->remaining;
+    }
+    int available = this->stream->available();
+    if (available <= 0) {
+      if (!this->stream->connected()) {
+        // Without a length the close is the end of the body, otherwise it is cut short
+        if (this->state == STATE_IDENTITY && this->remaining < 0) {
+          this->state = STATE_DONE;
+        }
+        return false;
+      }
+      if (millis() - waitStart > STREAM_INGEST_TIMEOUT_MS) {
+        // Give up on the body, a later call must not wait all over again
+        Serial.println("StreamIngest: timed out");
+        this->state = STATE_ERROR;
+        return false;
+      }
+      delay(1);
+      continue;
+    }
+
+    int n = this->stream->read((uint8_t*)this->buffer + this->tail, (size_t)available < want ? available : want);
+    if (n <= 0) {
+      continue;
+    }
+    waitStart = millis();
+    size_t kept = n;
+    if (this->state == STATE_IDENTITY) {
+      if (this->remaining > 0) {
+        this->remaining -= n;
+        if (!this->remaining) {
+          this->state = STATE_DONE;
+        }
+      }
+    } else {
+      kept = dechunk(this->buffer + this->tail, n);
+      if (this->state == STATE_ERROR) {
+        Serial.println("StreamIngest: bad chunk framing");
+      }
+    }
+    this->tail += kept;
+    this->payload += kept;
+    if (kept) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t StreamIngest::read(const char** data) {
+  if (this->head == this->tail && !fill()) {
+    return 0;
+  }
+  *data = this->buffer + this->head;
+  size_t n = this->tail - this->head;
+  this->head = this->tail;
+  return n;
+}
+
+char* StreamIngest::readLine(size_t* length) {
+  size_t scanned = this->head;
+  while (true) {
+    char* nl = (char*)memchr(this->buffer + scanned, '\n', this->tail - scanned);
+    if (nl) {
+      char* line = this->buffer + this->head;
+      this->head = nl + 1 - this->buffer;
+      if (this->skipping) {
+        this->skipping = false;
+        scanned = this->head;
+        continue;
+      }
+      size_t n = nl - line;
+      if (n && line[n - 1] == '\r') {
+        n--;
+      }
+      line[n] = '\0';
+      *length = n;
+      return line;
+    }
+
+    if (this->head == 0 && this->tail == this->size - 1) {
+      // No line ending anywhere in a full buffer
+      if (!this->skipping) {
+        this->skippedLines++;
+        this->skipping = true;
+        Serial.printf("StreamIngest: skipped a line longer than %d bytes\n", (int)this->size - 1);
+      }
+      this->tail = 0;
+    }
+    scanned = this->tail - this->head;
+    if (!fill()) {
+      break;
+    }
+  }
+
+  // The last line need not end in a newline, but a body that was cut short
+  // or timed out leaves a piece of a line, not a line
+  if (this->head == this->tail || this->skipping || this->state != STATE_DONE) {
+    this->head = this->tail;
+    return NULL;
+  }
+  char* line = this->buffer + this->head;
+  size_t n = this->tail - this->head;
+  this->head = this->tail;
+  line[n] = '\0';
+  *length = n;
+  return line;
+}
@@ -0,0 +1,75 @@
+#ifndef _RIVER_WEATHER_STREAM_INGEST_H_FILE
+#define _RIVER_WEATHER_STREAM_INGEST_H_FILE
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+
+/*
+ * Reads an HTTP response body in bulk for the streaming parsers.
+ *
+ * The socket is read straight into a caller supplied buffer as much at a time
+ * as it has, chunked transfer encoding is stripped in place, and the parsers
+ * get contiguous spans: read() for byte parsers, readLine() for line parsers.
+ * A line that runs across socket reads or chunk boundaries is moved to the
+ * front of the buffer and completed by the next read, so only a line longer
+ * than the whole buffer is lost, and that is counted, not cut short.
+ *
+ * The body ends at Content-Length, at the last chunk, or when the server
+ * closes a response that has neither. complete() says whether it got there.
+ * A body cut short, or with nothing for STREAM_INGEST_TIMEOUT_MS, ends where
+ * it stopped and readLine() drops the unfinished line it was in.
+ */
+
+#define STREAM_INGEST_TIMEOUT_MS 5000   // longest wait for the next bytes
+
+class StreamIngest {
+  public:
+    StreamIngest(char* buffer, size_t size);
+
+    // Call between http->begin() and GET() so the transfer encoding is kept
+    static void collectHeaders(HTTPClient* http);
+    // Start on a response whose headers have been read
+    void begin(HTTPClient* http);
+
+    // The next run of body bytes, 0 at the end of the body. The span is valid
+    // until the next call.
+    size_t read(const char** data);
+    // The next line without its line ending, NUL terminated in the buffer,
+    // NULL at the end of the body
+    char* readLine(size_t* length);
+
+    bool complete() const { return this->state == STATE_DONE; }
+    uint32_t bytes() const { return this->payload; }
+    uint16_t longLines() const { return this->skippedLines; }
+
+  private:
+    typedef enum {
+      STATE_IDENTITY,     // up to Content-Length, or the connection closing
+      STATE_CHUNK_SIZE,
+      STATE_CHUNK_DATA,
+      STATE_CHUNK_END,    // the CRLF after a chunk's data
+      STATE_TRAILER,
+      STATE_DONE,
+      STATE_ERROR
+    } State;
+
+    bool fill();
+    size_t dechunk(char* data, size_t len);
+
+    WiFiClient* stream = NULL;
+    char*    buffer;
+    size_t   size;
+    size_t   head = 0;         // first unconsumed payload byte
+    size_t   tail = 0;         // end of the payload in the buffer
+    State    state = STATE_DONE;
+    int32_t  remaining = -1;   // identity bytes left, -1 until the connection closes
+    uint32_t chunkLeft = 0;
+    bool     sizeDigits = false;
+    bool     sizeDone = false; // past the size, in a chunk extension
+    bool     lineEmpty = true;
+    bool     skipping = false;
+    uint32_t payload = 0;
+    uint16_t skippedLines = 0;
+};
+
+#endif
@@ -0,0 +1,115 @@
+#include "TextFormat.h"
+#include <math.h>
+
+int StrView::indexOf(char c) const {
+  for (size_t i = 0; i < this->len; i++) {
+    if (this->text[i] == c) return i;
+  }
+  return -1;
+}
+
+int StrView::indexOf(StrView sub) const {
+  if (sub.len == 0) return 0;
+  for (size_t i = 0; i + sub.len <= this->len; i++) {
+    if (this->text[i] == sub.text[0] && !memcmp(this->text + i, sub.text, sub.len)) return i;
+  }
+  return -1;
+}
+
+
+TextBuf::TextBuf(char* buffer, size_t size) : buffer(buffer), size(size), len(0), overflow(false) {
+  if (this->size) this->buffer[0] = '\0';
+}
+
+TextBuf& TextBuf::clear() {
+  this->len = 0;
+  this->overflow = false;
+  if (this->size) this->buffer[0] = '\0';
+  return *this;
+}
+
+TextBuf& TextBuf::add(char c) {
+  if (this->len + 1 < this->size) {
+    this->buffer[this->len++] = c;
+    this->buffer[this->len] = '\0';
+  } else {
+    this->overflow = true;
+  }
+  return *this;
+}
+
+TextBuf& TextBuf::add(const char* text) {
+  return this->add(StrView(text));
+}
+
+TextBuf& TextBuf::add(StrView text) {
+  if (!this->size) {
+    this->overflow = this->overflow || text.length();
+    return *this;
+  }
+  size_t room = this->size - 1 - this->len;
+  size_t n = text.length();
+  if (n > room) {
+    n = room;
+    this->overflow = true;
+  }
+  memcpy(this->buffer + this->len, text.data(), n);
+  this->len += n;
+  this->buffer[this->len] = '\0';
+  return *this;
+}
+
+TextBuf& TextBuf::unum(uint32_t value, uint8_t width, char pad) {
+  char digits[10];
+  uint8_t count = 0;
+  do {
+    digits[count++] = '0' + value % 10;
+    value /= 10;
+  } while (value);
+  while (width > count) {
+    this->add(pad);
+    width--;
+  }
+  while (count) {
+    this->add(digits[--count]);
+  }
+  return *this;
+}
+
+TextBuf& TextBuf::num(int32_t value, uint8_t width, char pad) {
+  if (value >= 0) {
+    return this->unum(value, width, pad);
+  }
+  // Zero padding goes between the sign and the digits, spaces before the sign
+  uint32_t magnitude = 0u - (uint32_t)value;
+  if (pad == '0') {
+    this->add('-');
+    return this->unum(magnitude, width ? width - 1 : 0, pad);
+  }
+  uint8_t count = 1;
+  for (uint32_t v = magnitude; v; v /= 10) count++;
+  while (width > count) {
+    this->add(pad);
+    width--;
+  }
+  this->add('-');
+  return this->unum(magnitude);
+}
+
+TextBuf& TextBuf::fixed(float value, uint8_t decimals) {
+  static const uint32_t scales[] = { 1, 10, 100, 1000, 10000 };
+  if (decimals > 4) decimals = 4;
+  float scaled = fabsf(value) * scales[decimals] + 0.5f;
+  if (isnan(value) || scaled >= 4294967040.0f) {
+    return this->add("--");
+  }
+  uint32_t units = (uint32_t)scaled;
+  // No "-0.00" for values that round to zero
+  if (value < 0 && units) this->add('-');
+  this->unum(units / scales[decimals]);
+  if (decimals) {
+    this->add('.');
+    this->unum(units % scales[decimals], decimals, '0');
+  }
+  return *this;
+}
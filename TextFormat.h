@@ -0,0 +1,76 @@
+#ifndef _RIVER_WEATHER_TEXT_FORMAT_H_FILE
+#define _RIVER_WEATHER_TEXT_FORMAT_H_FILE
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * Label formatting for the draw functions without String or printf. Text is
+ * built in a buffer the caller owns, usually a TextStack on the stack, and
+ * numbers are converted here rather than through newlib's float printf, which
+ * allocates the first time it runs. Appending past the end of the buffer
+ * truncates and sets overflowed(), the text stays terminated.
+ */
+
+// Read-only piece of a string, not necessarily terminated
+class StrView {
+  public:
+    StrView(const char* text) : text(text), len(text ? strlen(text) : 0) {}
+    StrView(const char* text, size_t len) : text(text), len(len) {}
+
+    const char* data() const { return this->text; }
+    size_t length() const { return this->len; }
+
+    // Offset of the first match, -1 when there is none
+    int indexOf(char c) const;
+    int indexOf(StrView sub) const;
+
+    StrView left(size_t n) const { return StrView(this->text, n < this->len ? n : this->len); }
+    StrView from(size_t start) const {
+      return start < this->len ? StrView(this->text + start, this->len - start) : StrView(this->text, 0);
+    }
+
+  private:
+    const char* text;
+    size_t      len;
+};
+
+class TextBuf {
+  public:
+    TextBuf(char* buffer, size_t size);
+
+    TextBuf& clear();
+    TextBuf& add(char c);
+    TextBuf& add(const char* text);
+    TextBuf& add(StrView text);
+
+    // Right aligned in width characters, padded with pad ('0' for "%02d")
+    TextBuf& num(int32_t value, uint8_t width = 0, char pad = ' ');
+    TextBuf& unum(uint32_t value, uint8_t width = 0, char pad = ' ');
+
+    // Rounded to decimals places (at most 4), "--" for NAN or out of range
+    TextBuf& fixed(float value, uint8_t decimals);
+
+    const char* c_str() const { return this->buffer; }
+    size_t length() const { return this->len; }
+    bool overflowed() const { return this->overflow; }
+
+  private:
+    char*  buffer;
+    size_t size;
+    size_t len;
+    bool   overflow;
+};
+
+// A TextBuf with its own storage
+template <size_t N>
+class TextStack : public TextBuf {
+  public:
+    TextStack() : TextBuf(this->storage, N) {}
+
+  private:
+    char storage[N];
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef _RIVER_WEATHER_TRACED_TFT_H_FILE
+#define _RIVER_WEATHER_TRACED_TFT_H_FILE
+
+#include <TFT_eSPI.h>
+#include "RenderTrace.h"
+
+#ifdef RENDER_TRACE
+
+/*
+ * TFT_eSPI with a trace span around the primitives the sketch calls directly.
+ * The fillRect and drawFastHLine calls TFT_eSPI makes from inside one of them
+ * (the rows of a fillTriangle, the padding inside a drawString) add their
+ * pixels to it instead of being recorded on their own, so fillScreen,
+ * fillRoundRect, fillTriangle and fillCircle count exactly what they drew.
+ * The wrappers other than fillRect and drawFastHLine are not virtual: a widget
+ * has to hold a TracedTFT*, or each row of a triangle is a span of its own.
+ */
+class TracedTFT : public TFT_eSPI {
+  public:
+    TracedTFT(int16_t w = TFT_WIDTH, int16_t h = TFT_HEIGHT) : TFT_eSPI(w, h) {}
+
+    // Glyphs are not drawn through the traced primitives, so a string counts its
+    // text box unless what it drew inside the span adds up to more
+    int16_t drawString(const char* string, int32_t x, int32_t y, uint8_t font) {
+      TraceSpan span("drawString", 0, true);
+      int16_t width = TFT_eSPI::drawString(string, x, y, font);
+      addText(span, width * fontHeight(font));
+      return width;
+    }
+    int16_t drawString(const char* string, int32_t x, int32_t y) {
+      TraceSpan span("drawString", 0, true);
+      int16_t width = TFT_eSPI::drawString(string, x, y);
+      addText(span, width * fontHeight());
+      return width;
+    }
+    int16_t drawString(const String& string, int32_t x, int32_t y, uint8_t font) {
+      return drawString(string.c_str(), x, y, font);
+    }
+    int16_t drawString(const String& string, int32_t x, int32_t y) {
+      return drawString(string.c_str(), x, y);
+    }
+
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) override {
+      if (foldInto((uint32_t)w * h)) {
+        TFT_eSPI::fillRect(x, y, w, h, color);
+        return;
+      }
+      TraceSpan span("fillRect", (uint32_t)w * h, true);
+      TFT_eSPI::fillRect(x, y, w, h, color);
+    }
+
+    void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) override {
+      if (foldInto(w)) {
+        TFT_eSPI::drawFastHLine(x, y, w, color);
+        return;
+      }
+      TraceSpan span("drawFastHLine", w, true);
+      TFT_eSPI::drawFastHLine(x, y, w, color);
+    }
+
+    void fillScreen(uint32_t color) {
+      TraceSpan span("fillScreen", 0, true);
+      TFT_eSPI::fillScreen(color);
+    }
+
+    void fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t radius, uint32_t color) {
+      TraceSpan span("fillRoundRect", 0, true);
+      TFT_eSPI::fillRoundRect(x, y, w, h, radius, color);
+    }
+
+    void fillTriangle(int32_t x1, int32_t y1, int32_t x2, int32_t y2, int32_t x3, int32_t y3, uint32_t color) {
+      TraceSpan span("fillTriangle", 0, true);
+      TFT_eSPI::fillTriangle(x1, y1, x2, y2, x3, y3, color);
+    }
+
+    void loadFont(String fontName, bool flash = true) {
+      TraceSpan span("loadFont");
+      TFT_eSPI::loadFont(fontName, flash);
+    }
+
+    void fillCircle(int32_t x, int32_t y, int32_t r, uint32_t color) {
+      TraceSpan span("fillCircle", 0, true);
+      TFT_eSPI::fillCircle(x, y, r, color);
+    }
+
+  private:
+    // Adds the pixels to the primitive this call was made from, false if there is none
+    static bool foldInto(uint32_t pixels) {
+      TraceSpan* open = renderTrace.open;
+      if (!open || !open->isPrimitive()) {
+        return false;
+      }
+      open->addPixels(pixels);
+      return true;
+    }
+
+    static void addText(TraceSpan& span, uint32_t box) {
+      if (box > span.counted()) {
+        span.addPixels(box - span.counted());
+      }
+    }
+};
+
+#else
+
+typedef TFT_eSPI TracedTFT;
+
+#endif
+
+#endif
@@ -1,113 +1,152 @@
 #include "USGSRDB.h"
+#include "Metrics.h"
+#include "utils.h"
+#include "FetchArena.h"
+#include "StreamIngest.h"
 #include <HTTPClient.h>
 
 const int TOKEN_COUNT_MAX = 15;
-typedef Vector<String> Tokens;
+typedef Vector<char*> Tokens;
 
-void StationReading::clear(){
-//  delete(this->line);
-//  delete(this->timeStr);
+USGSStation::USGSStation(const char* siteId, const char* baseUrl) {
+  this->siteId = siteId; 
+  this->baseUrl = baseUrl;
+  this->parsing = NULL;
 }
 
-
-void StationReading::serialPrint() {
-  Serial.printf("%s\t%2.1f\t%d\t%2.2f\n", this->timeStr.c_str(), this->temp, this->flow,  this->stage);
+// RDB times are local clock time, tz_cd says which offset applies
+static int zoneOffsetMinutes(const char* tz) {
+  static const struct { const char* code; int16_t minutes; } zones[] = {
+    { "EST", -300 }, { "EDT", -240 }, { "CST", -360 }, { "CDT", -300 },
+    { "MST", -420 }, { "MDT", -360 }, { "PST", -480 }, { "PDT", -420 },
+    { "UTC", 0 },    { "GMT", 0 }
+  };
+  for (size_t i = 0; i < sizeof(zones) / sizeof(zones[0]); i++) {
+    if (!strcmp(tz, zones[i].code)) return zones[i].minutes;
+  }
+  return -300;  // Eastern standard, both stations are in Virginia
 }
 
-
-StationReading* USGSStation::getLastReading(){
-  return &this->reading;
- }
-
-USGSStation::USGSStation(String siteId) { 
-  this->siteId = siteId; 
+// "2021-06-01 12:15" in the zone named by tz
+static uint32_t rowUnixTime(const char* dateTime, const char* tz) {
+  int year, month, day, hour, minute;
+  if (sscanf(dateTime, "%d-%d-%d %d:%d", &year, &month, &day, &hour, &minute) != 5) {
+    return 0;
+  }
+  return unixTimeForOffset(year, month, day, hour, minute, zoneOffsetMinutes(tz));
 }
 
   
 bool USGSStation::fetch() {
-   char host[255] = {};
-   snprintf(host, sizeof(host), "https://waterservices.usgs.gov/nwis/iv/?&parameterCd=00065,00060,00010&period=P1D&format=rdb&sites=%s", siteId.c_str());
-
-   bool success = false;
+   uint32_t startMs = millis();
+   FetchSession session("USGS");
+   char* host = session.chars(FETCH_URL_MAX);
+   char* buffer = session.chars(USGS_LINE_MAX);
+   StreamIngest* body = session.make<StreamIngest>(buffer, USGS_LINE_MAX);
+   HTTPClient* http = session.make<HTTPClient>();
+   if (!host || !buffer || !body || !http) {
+     metrics.recordFetch(METRIC_SOURCE_USGS, 0, millis() - startMs, false);
+     return false;
+   }
+   snprintf(host, FETCH_URL_MAX, "%s/nwis/iv/?&parameterCd=00065,00060,00010&period=P1D&format=rdb&sites=%s", this->baseUrl, this->siteId);
+
+   uint32_t bytes = 0;
+   // The heading row sets these again, a response without one has no usable data
+   this->timeColumn = 0;
+   this->tzColumn = 0;
+   this->tempColumn = 0;
+   this->stageColumn = 0;
+   this->flowColumn = 0;
+   this->rowCount = 0;
+   this->lastRowTime = 0;
+   this->rowsInOrder = true;
+   bool complete = false;
+
+   // Rows go to the back buffer, the screen keeps showing the published reading
+   this->parsing = this->back();
+   memset(this->parsing, 0, sizeof(StationReading));
+   this->parsing->temp = NAN;
+   this->parsing->stage = NAN;
 
-  HTTPClient http;
   Serial.printf("[HTTP] GET to %s\n", host);
-  http.begin(host); //HTTP
+  http->begin(host); //HTTP
+  StreamIngest::collectHeaders(http);
 
   Serial.print("[HTTP] GET...\n");
   // start connection and send HTTP header
-  int httpCode = http.GET();
+  int httpCode = http->GET();
   // httpCode will be negative on error
   Serial.printf("[HTTP] GET... code: %d\n", httpCode);
   if (httpCode > 0) {
     // HTTP header has been send and Server response header has been handled
     if (httpCode == HTTP_CODE_OK) {
-      // get lenght of document (is -1 when Server sends no Content-Length header)
-      delay(100);
-      int len = http.getSize();
-      this->reading.clear();
-      uint32_t t = 0;
-      byte     c;
-      WiFiClient* stream = http.getStreamPtr();
-      while(http.connected() && (len > 0 || len == -1)) {
-          // get available data size
-          size_t size = stream->available();
-          if(size) {
-              int c =  stream->readBytesUntil('\n', buffer, sizeof(buffer));
-              if(len > 0) {
-                  len -= c;
-              }
-              buffer[c] = 0x00;
-              tokenize(buffer, c);
-          }
-          delay(1);
+      body->begin(http);
+      size_t length;
+      char* line;
+      while ((line = body->readLine(&length))) {
+        tokenize(line, length);
       }
+      bytes = body->bytes();
+      // A row too long for the buffer is lost, so the reading may be stale
+      complete = body->complete() && !body->longLines();
     }
   } else {
-    Serial.print("What do I do when I get a negative response?");
+    Serial.printf("[HTTP] GET... failed, error: %s\n", http->errorToString(httpCode).c_str());
   }
-  http.end();
-  
+  http->end();
+  this->parsing = NULL;
+  if (!this->rowsInOrder) {
+    Serial.println("USGS rows are out of order");
+  }
+  bool success = complete && this->rowCount > 0 && this->rowsInOrder && publish();
+  metrics.recordFetch(METRIC_SOURCE_USGS, bytes, millis() - startMs, success);
+  return success;
 }
 
 void USGSStation::tokenize(char* line, int len) {
+    (void)len;
     //Serial.printf("RDB String %s\n", line);
-    // Vector of string to save tokens 
-    String token_array[TOKEN_COUNT_MAX];
+    // Tokens point into the line, nothing is copied
+    char* token_array[TOKEN_COUNT_MAX];
     Tokens tokens;
     tokens.setStorage(token_array);
     
-    char* pch = strtok(line,"\t");
-    while (pch != NULL)
+    // Split by hand, strtok would merge the empty fields of a missing value and shift the columns
+    char* pch = line;
+    while (pch != NULL && tokens.size() < TOKEN_COUNT_MAX)
     {
+      char* tab = strchr(pch, '\t');
+      if (tab) *tab++ = '\0';
       tokens.push_back(pch);
-      pch = strtok (NULL,"\t");
+      pch = tab;
     }
 
     if (tokens.size() > 0) {
-      if ( !tokens[0].compareTo("agency_cd") ) {
+      if (!strcmp(tokens[0], "agency_cd")) {
         processHeading(tokens);
-      } else if (!tokens[0].compareTo("USGS")) {
+      } else if (!strcmp(tokens[0], "USGS")) {
         processReading(tokens);
       } /* else {
-        Serial.printf("Unknown token %s\n",  tokens[0].c_str());
+        Serial.printf("Unknown token %s\n",  tokens[0]);
       } */
     } else {
       Serial.println("No tokens!");
     }
 }
 
-void USGSStation::processHeading(Vector <String> tokens) {
-  for(int i = 0; i < tokens.size(); i++) {
-    if (tokens[i].indexOf("_cd") == -1) {
-        Serial.printf("Token %d : %s\n", i, tokens[i].c_str());
-        if (tokens[i].indexOf("_00010") != -1) {
+void USGSStation::processHeading(Vector <char*>& tokens) {
+  for(int i = 0; i < (int)tokens.size(); i++) {
+    if (!strcmp(tokens[i], "tz_cd")) {
+      this->tzColumn = i;
+    } else if (!strstr(tokens[i], "_cd")) {
+        Serial.printf("Token %d : %s\n", i, tokens[i]);
+        if (strstr(tokens[i], "_00010")) {
           this->tempColumn = i;
-        } else if (tokens[i].indexOf("_00060") != -1) {
+        } else if (strstr(tokens[i], "_00060")) {
           this->flowColumn = i;
-        } else if (tokens[i].indexOf("_00065") != -1) {
+        } else if (strstr(tokens[i], "_00065")) {
           this->stageColumn = i;
-        } else if (tokens[i].indexOf("datetime") != -1) {
+        } else if (strstr(tokens[i], "datetime")) {
           this->timeColumn = i;
         }
       }
@@ -115,20 +154,57 @@ void USGSStation::processHeading(Vector <String> tokens) {
 }
 
 
-void USGSStation::processReading(Vector <String> tokens) {
+void USGSStation::processReading(Vector <char*>& tokens) {
   int ts = tokens.size();
-  if (this->timeColumn && ts >= this->timeColumn  ) this->reading.timeStr = tokens[this->timeColumn];
-  if (this->tempColumn && ts >= this->tempColumn  ) this->reading.temp = tokens[this->tempColumn].toFloat();
-  if (this->flowColumn && ts >= this->flowColumn  ) this->reading.flow = tokens[this->flowColumn].toFloat();
-  if (this->stageColumn && ts >= this->stageColumn) this->reading.stage = tokens[this->stageColumn].toFloat(); 
+  if (!this->timeColumn) {
+    // A data row before the heading row, the columns are unknown
+    metrics.recordParseError(METRIC_SOURCE_USGS);
+    return;
+  }
+  if (ts <= this->timeColumn) {
+    return;
+  }
+  uint32_t rowTime = rowUnixTime(tokens[this->timeColumn], this->tzColumn && ts > this->tzColumn ? tokens[this->tzColumn] : "");
+  if (!rowTime || rowTime <= this->lastRowTime) {
+    this->rowsInOrder = false;
+    return;
+  }
+  this->lastRowTime = rowTime;
+  this->rowCount++;
+
+  // Rows come oldest first. A blank field (no data, ice, equipment trouble)
+  // keeps the value from the row before.
+  StationReading* sr = this->parsing;
+  sr->time = rowTime;
+  if (this->tempColumn && ts > this->tempColumn && *tokens[this->tempColumn]) sr->temp = atof(tokens[this->tempColumn]);
+  if (this->flowColumn && ts > this->flowColumn && *tokens[this->flowColumn]) sr->flow = atoi(tokens[this->flowColumn]);
+  if (this->stageColumn && ts > this->stageColumn && *tokens[this->stageColumn]) sr->stage = atof(tokens[this->stageColumn]);
 }
 
 
-void USGSStation::clear() {
-  this->reading.clear();
+bool USGSStation::validate(const StationReading* sr) {
+  if (!sr->time || !(sr->stage >= USGS_STAGE_MIN && sr->stage <= USGS_STAGE_MAX) ||
+      sr->flow < 0 || sr->flow > USGS_FLOW_MAX ||
+      (!isnan(sr->temp) && (sr->temp < USGS_TEMP_MIN || sr->temp > USGS_TEMP_MAX))) {
+    Serial.printf("USGS reading out of range: stage %2.2f flow %d temp %2.1f\n", sr->stage, sr->flow, sr->temp);
+    return false;
+  }
+  return true;
+}
+
+bool USGSStation::publish() {
+  if (!validate(this->back())) {
+    metrics.recordParseError(METRIC_SOURCE_USGS);
+    return false;
+  }
+  this->readings.publish();
+  return true;
 }
 
 
 void USGSStation::serialPrint() {
-    this->reading.serialPrint();
+  const StationReading* sr = this->getLastReading();
+  TextStack<16> when;
+  strLocalDateTime(sr->time, when);
+  Serial.printf("%s\t%2.1f\t%d\t%2.2f\n", when.c_str(), sr->temp, sr->flow, sr->stage);
 }
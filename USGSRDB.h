@@ -1,52 +1,64 @@
+#ifndef _RIVER_WEATHER_USGSRDB_H_FILE
+#define _RIVER_WEATHER_USGSRDB_H_FILE
+
 #include <Vector.h>
+#include "DoubleBuffer.h"
 
 const int ELEMENT_COUNT_MAX = 75;
 
-class StationReading {
-  public:
-    StationReading(int timeColumn, int tempColumn, int stageColumn, int flowColumn) {
-      this->timeStr = timeColumn;
-      this->temp    = tempColumn;
-      this->stage   = stageColumn;
-      this->flow    = flowColumn;
-    };
-    StationReading() {};
-    virtual ~StationReading(){this->clear();}
-    void clear();
-    void serialPrint();
+#define USGS_LINE_MAX 1000   // read buffer, also the longest row that can be parsed
 
-    String  line;
-    String  timeStr;
-    float   temp;
-    int     flow;
-    float   stage;
+// Plausible limits for a published reading, anything outside is a bad parse
+#define USGS_STAGE_MIN  -10.0f
+#define USGS_STAGE_MAX  100.0f
+#define USGS_FLOW_MAX   2000000
+#define USGS_TEMP_MIN   -5.0f
+#define USGS_TEMP_MAX    45.0f
 
-  
-};
+typedef struct StationReading {
+  uint32_t time;    // Unix seconds
+  float    temp;    // Celsius, NAN when the gauge does not report it
+  int      flow;    // cfs
+  float    stage;   // feet
+} StationReading;
 
 class USGSStation {
   public:
-    USGSStation(String siteId);
-    ~USGSStation() {this->clear();};
+    // baseUrl is where the API lives, e.g. "https://waterservices.usgs.gov"
+    USGSStation(const char* siteId, const char* baseUrl);
 
+    // Parses into the back buffer, the published reading only changes on success
     bool fetch();
-   
-    void clear();
+
     void serialPrint();
-    StationReading* getLastReading();
- 
+    const StationReading* getLastReading() const { return this->readings.front(); }
+    // Changes every time a new reading is published
+    uint32_t generation() const { return this->readings.published(); }
+
+    // For other writers (peer updates): fill back() completely, then publish()
+    StationReading* back() { return this->readings.back(); }
+    bool publish();
+    static bool validate(const StationReading* sr);
+
   private:
     void tokenize(char* line, int length);
-    void processHeading(Vector <String> tokens);
-    void processReading(Vector <String> tokens);
+    void processHeading(Vector <char*>& tokens);
+    void processReading(Vector <char*>& tokens);
     
   private:
-    char buffer[1000];
-    String siteId;
+    const char* siteId;
+    const char* baseUrl;
 
-    StationReading reading;
+    DoubleBuffer<StationReading> readings;
+    StationReading* parsing;
+    uint32_t lastRowTime;
+    bool     rowsInOrder;
     int timeColumn;
+    int tzColumn;
     int tempColumn;
     int stageColumn;
     int flowColumn;
+    int rowCount;
 };
+
+#endif
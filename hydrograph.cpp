@@ -1,13 +1,16 @@
 #include "hydrograph.h"
+#include "Metrics.h"
+#include "utils.h"
+#include "FetchArena.h"
+#include "StreamIngest.h"
 #include <HTTPClient.h>
-#define READ_ATTEMPTS 5
 
 
-Hydrograph::Hydrograph(const String site, XMLcallback xml_callback) {
+Hydrograph::Hydrograph(const char* site, const char* baseUrl, XMLcallback xml_callback) {
 
   this->siteCode = site;
-  this->xml.init((uint8_t *)buffer, sizeof(buffer), xml_callback);
-  this->clear();
+  this->baseUrl = baseUrl;
+  this->xmlCallback = xml_callback;
 }
   //
   // Status flags
@@ -18,76 +21,119 @@ Hydrograph::Hydrograph(const String site, XMLcallback xml_callback) {
   #define STATUS_END_TAG   0x08
   #define STATUS_ERROR     0x10
 
+// NWS marks a missing secondary value with -999
+static float parseFlow(const char* text) {
+  float flow = atof(text);
+  return flow < 0.0f ? NAN : flow;
+}
+
 void Hydrograph::processXML(uint8_t statusflags, char* tagName, uint16_t tagNameLen, char* stuff, uint16_t dataLen) {
-  static RiverStatus* inForecast = NULL;
-  static RiverStatus* inObesrvered = NULL;
-  
+  (void)tagNameLen;
+  (void)dataLen;
+  if (!this->parsing || !this->currentTag) {
+    return;
+  }
+
   if (statusflags == STATUS_ERROR) {
     Serial.printf("XML_callback error statusflags 0x%2x tagName %s\n", statusflags, tagName);
+    metrics.recordParseError(METRIC_SOURCE_NWS);
     return;
   }
 
   if (statusflags == STATUS_START_TAG) {
-    strncpy(currentTag, tagName, sizeof(currentTag));
+    strlcpy(currentTag, tagName, HYDROGRAPH_TAG_MAX);
     //Serial.printf("New current tag is %s\n", tagName);
-  } 
+  }
+
 
- 
   if (!strcasecmp(currentTag,"/site")) {
     processSite(statusflags, tagName, stuff);
-  } 
+  }
+  // <forecast issued="..."> says when NWS put the forecast out
+  if (statusflags == STATUS_ATTR_TEXT && !strcasecmp(currentTag, "/site/forecast") && !strcasecmp(tagName, "issued")) {
+    strlcpy(this->parsing->forecastIssued, stuff, sizeof(this->parsing->forecastIssued));
+  }
   //Serial.printf("XML current tag is %s\n", tagName);
   if (!strcasecmp(tagName, "/site/observed/datum")) {
     if (statusflags == STATUS_START_TAG) {
-      inObesrvered = this->nextObserved();
-    } 
+      this->inObserved = this->nextObserved();
+      this->inForecast = NULL;
+    }
   } else if (!strcasecmp(tagName, "/site/forecast/datum")) {
     if (statusflags == STATUS_START_TAG) {
-      inForecast = this->nextForecast();
-    } 
-  } 
+      this->inForecast = this->nextForecast();
+      this->inObserved = NULL;
+    }
+  }
   if (statusflags == STATUS_TAG_TEXT) {
-    if (inObesrvered) {
+    if (this->inObserved) {
       if (!strcasecmp(tagName, "/site/observed/datum/primary"))   {
-        inObesrvered->stage = stuff;
+        this->inObserved->stage = atof(stuff);
       }
       else if (!strcasecmp(tagName, "/site/observed/datum/secondary")) {
-        inObesrvered->flow = stuff;
+        this->inObserved->flow = parseFlow(stuff);
       }
       else if (!strcasecmp(tagName, "/site/observed/datum/valid"))     {
-        inObesrvered->dateTime = stuff;
+        this->inObserved->time = parseIsoTime(stuff);
       }
     }
-    
-    else if (inForecast) {
+
+    else if (this->inForecast) {
       if (!strcasecmp(tagName, "/site/forecast/datum/primary"))   {
-        inForecast->stage = stuff;
+        this->inForecast->stage = atof(stuff);
       }
       else if (!strcasecmp(tagName, "/site/forecast/datum/secondary")) {
-        inForecast->flow = stuff;
+        this->inForecast->flow = parseFlow(stuff);
       }
       else if (!strcasecmp(tagName, "/site/forecast/datum/valid"))     {
-        inForecast->dateTime = stuff;
+        this->inForecast->time = parseIsoTime(stuff);
       }
     }
   }
   if (statusflags == STATUS_END_TAG) {
     currentTag[0] = '\0';
-  } 
+  }
 }
 
+
 bool Hydrograph::fetch() {
 
-  HTTPClient http;
-  char host[255] = {};
-  snprintf(host, sizeof(host), "https://water.weather.gov/ahps2/hydrograph_to_xml.php?gage=%s&output=xml", siteCode.c_str());
+  uint32_t startMs = millis();
+  uint32_t bytes = 0;
+  bool complete = false;
+
+  FetchSession session("NWS");
+  char* host = session.chars(FETCH_URL_MAX);
+  char* xmlBuffer = session.chars(HYDROGRAPH_XML_BUFFER);
+  this->currentTag = session.chars(HYDROGRAPH_TAG_MAX);
+  this->xml = session.make<TinyXML>();
+  char* readBuffer = session.chars(HYDROGRAPH_READ_MAX);
+  StreamIngest* body = session.make<StreamIngest>(readBuffer, HYDROGRAPH_READ_MAX);
+  HTTPClient* http = session.make<HTTPClient>();
+  if (!host || !xmlBuffer || !this->currentTag || !this->xml || !readBuffer || !body || !http) {
+    this->xml = NULL;
+    this->currentTag = NULL;
+    metrics.recordFetch(METRIC_SOURCE_NWS, 0, millis() - startMs, false);
+    return false;
+  }
+  snprintf(host, FETCH_URL_MAX, "%s/ahps2/hydrograph_to_xml.php?gage=%s&output=xml", this->baseUrl, this->siteCode);
+
+  // Parse into the back buffer, the screen keeps showing the published model
+  this->parsing = this->back();
+  memset(this->parsing, 0, sizeof(HydrographModel));
+  this->inObserved = NULL;
+  this->inForecast = NULL;
+  this->currentTag[0] = '\0';
+  memset(xmlBuffer, 0, HYDROGRAPH_XML_BUFFER);
+  this->xml->init((uint8_t *)xmlBuffer, HYDROGRAPH_XML_BUFFER, this->xmlCallback);
 
   Serial.printf("[HTTP] GET to %s\n", host);
-  http.begin(host); //HTTP
+  http->begin(host); //HTTP
+  StreamIngest::collectHeaders(http);
 
   Serial.print("[HTTP] GET...\n");
   // start connection and send HTTP header
-  int httpCode = http.GET();
+  int httpCode = http->GET();
 
   // httpCode will be negative on error
   if (httpCode > 0) {
@@ -96,110 +142,135 @@ bool Hydrograph::fetch() {
 
     // file found at server
     if (httpCode == HTTP_CODE_OK) {
-      // get lenght of document (is -1 when Server sends no Content-Length header)
-      delay(100);
-      int len = http.getSize();
-      Serial.printf("[HTTP] GET... length: %d\n", len);
-      if (len > 0) {
-        this->clear();
-      }
-      byte     c;
-      WiFiClient* stream = http.getStreamPtr();
-      while(http.connected() && (len > 0 || len == -1)) {
-          // get available data size
-          size_t size = stream->available();
-          if(size) {
-              c = stream->read();
-              if(c != -1 && c != '\0') {
-                  len--;
-                  xml.processChar(c);
-              } else {
-                Serial.printf("[HTTP] Error processing char %d\n",(int) c);
-                break;
-              }
-          } else {
-            delay(1);
-          }
+      Serial.printf("[HTTP] GET... length: %d\n", http->getSize());
+      body->begin(http);
+      bool clean = true;
+      const char* data;
+      size_t n;
+      while ((n = body->read(&data))) {
+        if (memchr(data, '\0', n)) {
+          Serial.println("[HTTP] NUL in the XML body");
+          clean = false;
+          break;
+        }
+        for (size_t i = 0; i < n; i++) {
+          this->xml->processChar(data[i]);
+        }
       }
+      bytes = body->bytes();
+      // A dropped connection leaves part of the body unread
+      complete = clean && body->complete();
     }
 
   } else {
-    Serial.printf("[HTTP] GET... failed, error: %s\n", http.errorToString(httpCode).c_str());
+    Serial.printf("[HTTP] GET... failed, error: %s\n", http->errorToString(httpCode).c_str());
   }
 
-  http.end();
-  return (this->last_forecast > 0);
+  http->end();
+  this->parsing = NULL;
+  this->xml = NULL;
+  this->currentTag = NULL;
+  bool parsed = complete && this->publish();
+  metrics.recordFetch(METRIC_SOURCE_NWS, bytes, millis() - startMs, parsed);
+  return parsed;
 
 }
 
 
-void Hydrograph::clear() {
-  memset(this->buffer, 0 , sizeof(this->buffer));
-  xml.reset();
-  this->siteName.clear();
-  this->generationTime.clear();
-  this->last_observed = 0;
-  this->last_forecast = 0;
-  for(int i = 0; i < HYDROGRAPH_COUNT_MAX; i++) {
-    clearRiverStatus(&this->observed_array[i]);
-    clearRiverStatus(&this->forecast_array[i]);
+/***************************************************************************************
+**                          Validate and publish
+***************************************************************************************/
+// Rows must have a time and a stage in range, and the times must run the same
+// way through the whole section (NWS lists observations newest first)
+static bool validRows(const RiverStatus* rows, int count) {
+  bool descending = count > 1 && rows[1].time < rows[0].time;
+  for (int i = 0; i < count; i++) {
+    if (!rows[i].time || !(rows[i].stage >= HYDROGRAPH_STAGE_MIN && rows[i].stage <= HYDROGRAPH_STAGE_MAX)) {
+      return false;
+    }
+    if (i && (descending ? rows[i].time >= rows[i - 1].time : rows[i].time <= rows[i - 1].time)) {
+      return false;
+    }
   }
+  return true;
 }
 
-void Hydrograph::clearRiverStatus(RiverStatus* rs) {
-  if (rs){
-    rs->dateTime.clear();
-    rs->stage.clear();
-    rs->flow.clear();
+bool Hydrograph::validate(const HydrographModel* m) {
+  if (m->last_forecast <= 0 || m->last_forecast > HYDROGRAPH_COUNT_MAX ||
+      m->last_observed < 0 || m->last_observed > HYDROGRAPH_COUNT_MAX) {
+    Serial.printf("Hydrograph has %d observed and %d forecast rows\n", m->last_observed, m->last_forecast);
+    return false;
   }
+  if (!validRows(m->observed_array, m->last_observed) || !validRows(m->forecast_array, m->last_forecast)) {
+    Serial.println("Hydrograph rows are out of order or out of range");
+    return false;
+  }
+  return true;
+}
+
+bool Hydrograph::publish() {
+  if (!validate(this->back())) {
+    metrics.recordParseError(METRIC_SOURCE_NWS);
+    return false;
+  }
+  this->models.publish();
+  return true;
 }
 
 RiverStatus* Hydrograph::nextObserved() {
-  if (this->last_observed < HYDROGRAPH_COUNT_MAX) {
-    return &this->observed_array[this->last_observed++];
-  } 
+  if (this->parsing->last_observed < HYDROGRAPH_COUNT_MAX) {
+    return &this->parsing->observed_array[this->parsing->last_observed++];
+  }
   return NULL;
 }
 
 RiverStatus* Hydrograph::nextForecast() {
-  if (this->last_forecast < HYDROGRAPH_COUNT_MAX) {
-    return &this->forecast_array[this->last_forecast++];
-  } 
+  if (this->parsing->last_forecast < HYDROGRAPH_COUNT_MAX) {
+    return &this->parsing->forecast_array[this->parsing->last_forecast++];
+  }
   return NULL;
 }
 
 
+void Hydrograph::printRiverStatus(const RiverStatus* rs) {
+  TextStack<16> when;
+  strLocalDateTime(rs->time, when);
+  Serial.printf("%s %2.2f %2.2f\n", when.c_str(), rs->stage, rs->flow);
+}
+
 void Hydrograph::print() {
-  
-  Serial.println(generationTime.c_str());
+  const HydrographModel* m = this->model();
+  Serial.println(m->generationTime);
 
   Serial.println("Observations");
-  for(int i = 0; i < HYDROGRAPH_COUNT_MAX; i++) {
-    this->observed_array[i].print();
+  for(int i = 0; i < m->last_observed; i++) {
+    printRiverStatus(&m->observed_array[i]);
   }
-  
+
   Serial.println("Forecast");
-  for(int i = 0; i < HYDROGRAPH_COUNT_MAX; i++) {
-    this->forecast_array[i].print();
+  for(int i = 0; i < m->last_forecast; i++) {
+    printRiverStatus(&m->forecast_array[i]);
   }
 
 }
 
 
 void Hydrograph::printForecast() {
-  Serial.println(generationTime.c_str());
+  const HydrographModel* m = this->model();
+  Serial.println(m->generationTime);
   Serial.println("Forecast");
-  for(int i = 0; i < HYDROGRAPH_COUNT_MAX; i++) {
-    this->forecast_array[i].print();
+  for(int i = 0; i < m->last_forecast; i++) {
+    printRiverStatus(&m->forecast_array[i]);
   }
 }
 
 void Hydrograph::processSite(uint8_t statusflags, char* tagName, char* stuff) {
+  (void)statusflags;
   if (!strcasecmp(tagName, "generationtime")) {
       Serial.printf("Generation Time = %s\n", stuff);
-      this->generationTime = stuff;
+      strlcpy(this->parsing->generationTime, stuff, sizeof(this->parsing->generationTime));
     } else if (!strcasecmp(tagName, "name")) {
       Serial.printf("Name = %s\n", stuff);
-      this->siteName = stuff;
+      strlcpy(this->parsing->siteName, stuff, sizeof(this->parsing->siteName));
     }
 }
@@ -1,66 +1,78 @@
+#ifndef _RIVER_WEATHER_HYDROGRAPH_H_FILE
+#define _RIVER_WEATHER_HYDROGRAPH_H_FILE
+
 #include <Arduino.h>
 #include <TinyXML.h>
+#include "DoubleBuffer.h"
 
 
 #define HYDROGRAPH_COUNT_MAX 15
+#define HYDROGRAPH_TEXT_MAX  40
+#define HYDROGRAPH_XML_BUFFER 1000
+#define HYDROGRAPH_READ_MAX   512   // socket reads, see StreamIngest
+#define HYDROGRAPH_TAG_MAX    255
 
+// Plausible limits for a published model, anything outside is a bad parse
+#define HYDROGRAPH_STAGE_MIN -10.0f
+#define HYDROGRAPH_STAGE_MAX 100.0f
 
-class RiverStatus {
-  public:
-    RiverStatus() {};
-
-    virtual~RiverStatus() {
-      clear();
-    } 
-    
-    void print(){
-      Serial.printf("%s %s %s\n", dateTime.c_str(), stage.c_str(), flow.c_str());
-    }
-    
-    void clear() {
-      dateTime.clear();
-      stage.clear();
-      flow.clear();
-    }
-
-    String dateTime;
-    String stage;
-    String flow;
-};
+
+typedef struct RiverStatus {
+  uint32_t time;    // Unix seconds
+  float    stage;   // feet
+  float    flow;    // kcfs, NAN when the gauge has no rating
+} RiverStatus;
+
+typedef struct HydrographModel {
+  char siteName[HYDROGRAPH_TEXT_MAX];
+  char generationTime[HYDROGRAPH_TEXT_MAX];
+  char forecastIssued[HYDROGRAPH_TEXT_MAX];
+
+  int last_observed;
+  int last_forecast;
+  RiverStatus observed_array[HYDROGRAPH_COUNT_MAX];   // in the order NWS lists them
+  RiverStatus forecast_array[HYDROGRAPH_COUNT_MAX];
+} HydrographModel;
 
 class Hydrograph {
   public:
-    Hydrograph(const String site, XMLcallback xml_callback);
-
-    virtual ~Hydrograph() {clear();}
+    // baseUrl is where the API lives, e.g. "https://water.weather.gov"
+    Hydrograph(const char* site, const char* baseUrl, XMLcallback xml_callback);
 
-  
+    // Parses into the back buffer, the published model only changes on success
     bool fetch();
-    void clear();
-    void clearRiverStatus(RiverStatus* rs);
+
+    const HydrographModel* model() const { return this->models.front(); }
+    // Changes every time a new model is published
+    uint32_t generation() const { return this->models.published(); }
+
+    // For other writers (peer updates): fill back() completely, then publish()
+    HydrographModel* back() { return this->models.back(); }
+    bool publish();
+    static bool validate(const HydrographModel* m);
+
     void print();
     void printForecast();
-    void printRiverStatus(RiverStatus* rs);
     void processXML(uint8_t statusflags, char* tagName, uint16_t tagNameLen, char* stuff, uint16_t dataLen);
 
-    String siteName;
-    String generationTime;
-    String forecastIssued;
-    
-    int last_observed;
-    int last_forecast;
-    RiverStatus observed_array[HYDROGRAPH_COUNT_MAX];
-    RiverStatus forecast_array[HYDROGRAPH_COUNT_MAX];
-    
-
   private:
     void processSite(uint8_t statusflags, char* tagName, char* stuff);
     RiverStatus* nextObserved();
     RiverStatus* nextForecast();
+    void printRiverStatus(const RiverStatus* rs);
+
+    const char* siteCode;
+    const char* baseUrl;
+    XMLcallback xmlCallback;
 
-    String siteCode;
-    char   currentTag[255];
-    TinyXML    xml;
-    char buffer[1000];
+    // Only set while a fetch holds the fetch arena
+    TinyXML* xml = NULL;
+    char*    currentTag = NULL;
 
+    DoubleBuffer<HydrographModel> models;
+    HydrographModel* parsing = NULL;
+    RiverStatus*     inObserved = NULL;
+    RiverStatus*     inForecast = NULL;
 };
+
+#endif
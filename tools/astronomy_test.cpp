@@ -0,0 +1,139 @@
+// Checks the Astronomy module's sun times and moon phases against reference
+// tables.
+//
+//   g++ -std=gnu++17 -Wall -Wextra -I. -Itools/host -o /tmp/astronomy_test tools/astronomy_test.cpp Astronomy.cpp
+//   /tmp/astronomy_test
+//
+// The sun table gives civil dawn, sunrise, sunset and civil dusk on the
+// equinoxes and solstices of 2024 and 2025, local clock time to the minute.
+// The times were worked with the NOAA solar calculator's equations (Meeus,
+// Astronomical Algorithms), with the sun's position taken at each event
+// rather than at noon. The sites are the Little Falls gauge and Sydney,
+// where the local date starts on the previous UTC day. The moon table is the
+// published new and full moons of 2024 and 2025 that fell on eclipses.
+//
+// Checked:
+//   - every sun time is on its local date and within 2 minutes of the table
+//   - above the Arctic Circle the sun does not set at midsummer, and at
+//     midwinter it does not rise but civil twilight still comes and goes
+//   - on the local date of a new moon the phase is "New" and under 3% of the
+//     disc is lit, on a full moon it is "Full" with over 97% lit
+//   - the ephemeris is kept for its date: a restored one is returned until
+//     the date moves, then it is worked out again
+// The exit status is 1 if any check fails.
+#include "Astronomy.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) failures++;
+}
+
+#define TOLERANCE_S 120
+
+typedef struct Site {
+  const char* name;
+  double      latitude;
+  double      longitude;
+} Site;
+
+static const Site littleFalls = { "Little Falls", 38.9494, -77.1278 };
+static const Site sydney      = { "Sydney", -33.8688, 151.2093 };
+static const Site tromso      = { "Tromso", 69.6496, 18.9560 };
+
+typedef struct SunRow {
+  const Site* site;
+  int         year, month, day;
+  int         utcOffsetMinutes;
+  const char* times[4];     // civil dawn, sunrise, sunset, civil dusk
+} SunRow;
+
+static const SunRow sunTable[] = {
+  { &littleFalls, 2024,  3, 20, -240, { "06:45", "07:11", "19:21", "19:48" } },
+  { &littleFalls, 2024,  6, 20, -240, { "05:11", "05:43", "20:37", "21:10" } },
+  { &littleFalls, 2024,  9, 22, -240, { "06:30", "06:57", "19:05", "19:31" } },
+  { &littleFalls, 2024, 12, 21, -300, { "06:54", "07:24", "16:50", "17:20" } },
+  { &littleFalls, 2025,  6, 21, -240, { "05:11", "05:43", "20:38", "21:10" } },
+  { &littleFalls, 2025, 12, 21, -300, { "06:54", "07:24", "16:50", "17:20" } },
+  { &sydney,      2024,  6, 21,  600, { "06:32", "07:00", "16:54", "17:22" } },
+  { &sydney,      2024, 12, 21,  660, { "05:12", "05:41", "20:06", "20:35" } },
+};
+
+static const char* const eventNames[4] = { "civil dawn", "sunrise", "sunset", "civil dusk" };
+
+static void checkSun(const SunRow& row) {
+  Astronomy astronomy(row.site->latitude, row.site->longitude);
+  const Ephemeris* e = astronomy.forDate(row.year, row.month, row.day, row.utcOffsetMinutes);
+  const uint32_t got[4] = { e->civilDawn, e->sunrise, e->sunset, e->civilDusk };
+  int64_t localDay = Astronomy::daysFromCivil(row.year, row.month, row.day);
+  for (int i = 0; i < 4; i++) {
+    int64_t want = localDay * 86400 + atoi(row.times[i]) * 3600 + atoi(row.times[i] + 3) * 60 -
+                   row.utcOffsetMinutes * 60;
+    int64_t local = (int64_t)got[i] + row.utcOffsetMinutes * 60;
+    char what[120];
+    snprintf(what, sizeof(what), "%s %d-%02d-%02d %s %02d:%02d, table %s", row.site->name, row.year, row.month,
+             row.day, eventNames[i], (int)(local % 86400 / 3600), (int)(local % 3600 / 60), row.times[i]);
+    check(got[i] && local / 86400 == localDay && llabs((int64_t)got[i] - want) <= TOLERANCE_S, what);
+  }
+}
+
+typedef struct MoonRow {
+  int         year, month, day;   // Eastern time
+  int         utcOffsetMinutes;
+  bool        full;
+  const char* note;
+} MoonRow;
+
+static const MoonRow moonTable[] = {
+  { 2024,  3, 25, -240, true,  "full, penumbral eclipse" },
+  { 2024,  4,  8, -240, false, "new, total solar eclipse" },
+  { 2024,  9, 17, -240, true,  "full, partial lunar eclipse (02:34 UTC on the 18th)" },
+  { 2024, 10,  2, -240, false, "new, annular eclipse" },
+  { 2025,  3, 14, -240, true,  "full, total lunar eclipse" },
+  { 2025,  3, 29, -240, false, "new, partial solar eclipse" },
+  { 2025,  9,  7, -240, true,  "full, total lunar eclipse" },
+  { 2025,  9, 21, -240, false, "new, partial solar eclipse" },
+};
+
+static void checkMoon(const MoonRow& row) {
+  Astronomy astronomy(littleFalls.latitude, littleFalls.longitude);
+  const Ephemeris* e = astronomy.forDate(row.year, row.month, row.day, row.utcOffsetMinutes);
+  bool ok = row.full ? e->moonPhase == 4 && e->illumination > 97 : e->moonPhase == 0 && e->illumination < 3;
+  char what[120];
+  snprintf(what, sizeof(what), "%d-%02d-%02d %s: phase %u, %u%% lit", row.year, row.month, row.day, row.note,
+           e->moonPhase, e->illumination);
+  check(ok, what);
+}
+
+int main() {
+  for (const SunRow& row : sunTable) {
+    checkSun(row);
+  }
+
+  Astronomy arctic(tromso.latitude, tromso.longitude);
+  const Ephemeris* e = arctic.forDate(2024, 6, 20, 120);
+  check(!e->sunrise && !e->sunset && !e->civilDawn && !e->civilDusk, "Tromso at midsummer: the sun never sets");
+  e = arctic.forDate(2024, 12, 21, 60);
+  check(!e->sunrise && !e->sunset && e->civilDawn && e->civilDusk && e->civilDawn < e->civilDusk,
+        "Tromso at midwinter: no sunrise, civil twilight around noon");
+
+  for (const MoonRow& row : moonTable) {
+    checkMoon(row);
+  }
+
+  // A peer's ephemeris stands until the local date moves past it
+  Astronomy astronomy(littleFalls.latitude, littleFalls.longitude);
+  Ephemeris peer = *astronomy.forDate(2024, 6, 20, -240);
+  peer.sunrise += 60;
+  astronomy.restore(&peer);
+  check(astronomy.forDate(2024, 6, 20, -240)->sunrise == peer.sunrise, "a restored ephemeris is kept for its date");
+  Astronomy fresh(littleFalls.latitude, littleFalls.longitude);
+  check(astronomy.forDate(2024, 6, 21, -240)->sunrise == fresh.forDate(2024, 6, 21, -240)->sunrise,
+        "the next date is worked out afresh");
+
+  printf("%s: %d checks failed\n", failures ? "FAIL" : "PASS", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,223 @@
+// Runs ModelCache's server and its peer client against each other on loopback
+// and checks what a peer display sees.
+//
+//   g++ -std=gnu++17 -Wall -Wextra -I. -Itools/host -o /tmp/cache_test tools/cache_test.cpp
+//       ModelCache.cpp USGSRDB.cpp hydrograph.cpp OneCall.cpp JsonStream.cpp StreamIngest.cpp
+//       FetchArena.cpp Metrics.cpp Astronomy.cpp TextFormat.cpp tools/host/HostTime.cpp
+//   /tmp/cache_test [port]
+//
+// Display A serves its models on 127.0.0.1:port (18765 by default) through the
+// stand-in WebServer in tools/host, which listens on a real socket. The checks
+// GET from it with a plain socket client, and display B pulls from it with
+// fetchFromPeer(), whose stand-in HTTPClient is answered by forwarding the GET
+// to A over the same socket. Both run in this one process: a request is sent,
+// then A's handleClient() answers it, then the answer is read.
+//
+// Checked:
+//   - both paths answer 503 until a source on A has published
+//   - /model.bin is A's encoding with an ETag, and If-None-Match gets a 304
+//   - /model.json is served with its own ETag, and streamed whole at the
+//     length it announces
+//   - B ends up with the same models as A, and a second pull is a 304 that
+//     applies nothing but still reports every section current
+//   - a section that fails validation is dropped on its own and the others
+//     still apply, and a truncated model applies the sections before the cut
+// The exit status is 1 if any check fails.
+#include "ModelCache.h"
+#include "Metrics.h"
+#include <LoopbackHttp.h>
+
+/***************************************************************************************
+**                          Host runtime
+***************************************************************************************/
+static uint64_t monotonicMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static const uint64_t startMs = monotonicMs();
+
+uint32_t millis() { return (uint32_t)(monotonicMs() - startMs); }
+uint32_t micros() { return millis() * 1000; }
+void delay(uint32_t ms) { usleep(ms * 1000); }
+
+HardwareSerial Serial;
+EspClass ESP;
+uint32_t EspClass::getFreeHeap() { return 0; }
+uint32_t EspClass::getMaxAllocHeap() { return 0; }
+uint32_t EspClass::getMinFreeHeap() { return 0; }
+const char* volatile heapTag = NULL;
+
+/***************************************************************************************
+**                          Displays
+***************************************************************************************/
+#define T0 1700000000UL
+
+static void noXml(uint8_t, char*, uint16_t, char*, uint16_t) {}
+
+typedef struct Display {
+  Display() : usgs("01646500", ""), hydrograph("BRKM2", "", &noXml),
+              weather("", "", "38.9", "-77.1", "imperial"), astronomy(38.9, -77.1),
+              cache(&usgs, &hydrograph, &weather, &astronomy) {}
+
+  USGSStation    usgs;
+  Hydrograph     hydrograph;
+  OneCallWeather weather;
+  Astronomy      astronomy;
+  ModelCache     cache;
+} Display;
+
+static void publishReading(Display& d, uint32_t time, float stage) {
+  StationReading* sr = d.usgs.back();
+  sr->time = time;
+  sr->temp = 14.5f;
+  sr->flow = 4210;
+  sr->stage = stage;
+  d.usgs.publish();
+}
+
+static void publishHydrograph(Display& d, uint32_t issued) {
+  HydrographModel* h = d.hydrograph.back();
+  memset(h, 0, sizeof(HydrographModel));
+  strcpy(h->siteName, "Potomac River at Little Falls");
+  strcpy(h->generationTime, "2023-11-14T22:30:00-00:00");
+  strcpy(h->forecastIssued, "2023-11-14T19:27:00-00:00");
+  for (int i = 0; i < 8; i++) {
+    h->observed_array[i] = { issued - i * 900, 3.9f - i * 0.01f, 4.2f };
+  }
+  for (int i = 0; i < 12; i++) {
+    h->forecast_array[i] = { issued + (i + 1) * 6 * 3600, 3.8f + i * 0.05f, NAN };
+  }
+  h->last_observed = 8;
+  h->last_forecast = 12;
+  d.hydrograph.publish();
+}
+
+static void publishWeather(Display& d, uint32_t time) {
+  WeatherModel* m = d.weather.back();
+  memset(m, 0, sizeof(WeatherModel));
+  m->valid = true;
+  m->timezoneOffset = -18000;
+  m->current = { time, time - 4 * 3600, time + 6 * 3600, 51.3f, 6.5f, 1017, 290, 803, 61, 75, "Clouds" };
+  m->days = WEATHER_DAYS;
+  for (int i = 0; i < m->days; i++) {
+    m->daily[i] = { time + i * 86400, time - 4 * 3600 + i * 86400, time + 6 * 3600 + i * 86400, 58.0f + i, 40.0f + i, 800 };
+  }
+  m->hours.start = time;
+  m->hours.count = 24;
+  for (int i = 0; i < 24; i++) {
+    m->hours.temperature[i] = 50 + i / 3;
+    m->hours.windSpeed[i] = 12;
+    m->hours.windSector[i] = 11;
+    m->hours.pop[i] = 10;
+    m->hours.condition[i] = weatherConditionCode(803);
+  }
+  d.weather.publish();
+}
+
+/***************************************************************************************
+**                          Loopback client
+***************************************************************************************/
+static uint16_t port = 18765;
+static Display* serving = NULL;
+
+static void serve() {
+  serving->cache.handleClient();
+}
+
+static bool get(const char* path, const char* headers, LoopbackReply* reply) {
+  return loopbackGet(port, path, headers, reply);
+}
+
+/***************************************************************************************
+**                          Checks
+***************************************************************************************/
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) failures++;
+}
+
+static bool sameModels(ModelCache& a, ModelCache& b) {
+  return a.binaryLength() && a.binaryLength() == b.binaryLength() && !memcmp(a.binary(), b.binary(), a.binaryLength());
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1) port = atoi(argv[1]);
+  HTTPClient::responder = &loopbackResponder;
+  loopbackServe = &serve;
+  WiFiClient::platformHeap = false;
+
+  static Display a, b, c, d;
+  serving = &a;
+  a.cache.update();
+  a.cache.beginServer(port);
+
+  LoopbackReply r;
+  char peer[32];
+  snprintf(peer, sizeof(peer), "127.0.0.1:%d", port);
+  check(get("/model.bin", NULL, &r) && r.code == 503, "/model.bin is 503 before anything has published");
+  check(get("/model.json", NULL, &r) && r.code == 503, "/model.json is 503 before anything has published");
+  check(b.cache.fetchFromPeer(peer) == 0 && loopbackLast.code == 503, "a peer pull before anything has published applies nothing");
+
+  publishReading(a, T0, 3.91f);
+  a.cache.update();
+  char etag[32];
+  snprintf(etag, sizeof(etag), "\"%08xb\"", a.cache.hash());
+  check(get("/model.bin", NULL, &r) && r.code == 200, "/model.bin is 200 once the reading has published");
+  check(r.length == a.cache.binaryLength() && !memcmp(r.body, a.cache.binary(), r.length), "/model.bin is the binary encoding");
+  check(!strcmp(r.etag, etag), "/model.bin has the encoding's ETag");
+  char ifNoneMatch[64];
+  snprintf(ifNoneMatch, sizeof(ifNoneMatch), "If-None-Match: %s\r\n", etag);
+  check(get("/model.bin", ifNoneMatch, &r) && r.code == 304 && !r.length, "/model.bin with its ETag is a 304");
+  check(get("/model.json", ifNoneMatch, &r) && r.code == 200 && strstr(r.body, "\"flow_cfs\":4210"), "/model.json is JSON and does not take the binary ETag");
+  check(r.etag[strlen(r.etag) - 2] == 'j', "/model.json has its own ETag");
+
+  publishHydrograph(a, T0);
+  publishWeather(a, T0);
+  a.cache.update();
+  uint8_t applied = 0;
+  uint8_t current = b.cache.fetchFromPeer(peer, &applied);
+  b.cache.update();
+  check(loopbackLast.code == 200 && current == MODEL_SECTION_ALL, "a peer pull makes every section current");
+  check(applied == (MODEL_SECTION_READING | MODEL_SECTION_HYDROGRAPH | MODEL_SECTION_WEATHER), "it applies the reading, hydrograph and weather");
+  check(sameModels(a.cache, b.cache), "the peer's models encode the same as the server's");
+  applied = 0;
+  current = b.cache.fetchFromPeer(peer, &applied);
+  check(loopbackLast.code == 304 && current == MODEL_SECTION_ALL && !applied, "a second pull is a 304 that applies nothing");
+
+  // The full document runs to many of the encoder's buffers, and its length is
+  // counted before it is written
+  unsigned length = 0;
+  bool got = get("/model.json", NULL, &r) && r.code == 200;
+  const char* header = strcasestr(r.text, "\r\nContent-Length: ");
+  if (header) sscanf(header + 18, "%u", &length);
+  check(got && r.length > 1024 && length == r.length && r.body[r.length - 1] == '}' && strstr(r.body, "\"hourly\":{"),
+        "/model.json is streamed whole, as long as its Content-Length");
+
+  // A forecast row out of range, the hydrograph section alone is dropped
+  uint8_t bad[MODEL_CACHE_BIN_MAX];
+  size_t len = a.cache.binaryLength();
+  memcpy(bad, a.cache.binary(), len);
+  const HydrographModel* h = a.hydrograph.model();
+  size_t stageAt = 5 + 16 + 3 + strlen(h->siteName) + strlen(h->generationTime) + strlen(h->forecastIssued) + 2 +
+                   h->last_observed * 12 + 4;
+  float silly = 500.0f;
+  memcpy(bad + stageAt, &silly, sizeof(silly));
+  applied = 0;
+  current = c.cache.decode(bad, len, &applied);
+  check(current == (MODEL_SECTION_ALL & ~MODEL_SECTION_HYDROGRAPH), "a bad hydrograph section leaves the others current");
+  check(applied == (MODEL_SECTION_READING | MODEL_SECTION_WEATHER) && !c.hydrograph.generation(),
+        "and only the hydrograph is not published");
+
+  // Cut in the middle of the weather, the reading and hydrograph still apply
+  applied = 0;
+  current = d.cache.decode(a.cache.binary(), stageAt + 200, &applied);
+  check(applied == (MODEL_SECTION_READING | MODEL_SECTION_HYDROGRAPH) && !d.weather.generation(),
+        "a truncated model applies the sections before the cut");
+
+  printf("%s: %d checks failed\n", failures ? "FAIL" : "PASS", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,119 @@
+// Checks the gauges' fixed point trig against double precision, and what they
+// leave in the render trace.
+//
+//   g++ -std=gnu++17 -Wall -Wextra -DRENDER_TRACE -I. -Itools/host -o /tmp/gauges_test tools/gauges_test.cpp Gauges.cpp RenderTrace.cpp TextFormat.cpp
+//   /tmp/gauges_test
+//
+// The TFT_eSPI stand-in fills a triangle or a circle with a drawFastHLine a
+// row, as the library does, so a fill made through a TFT_eSPI pointer would
+// record every row as a span of its own and run through the 256 entry ring.
+//
+// Checked:
+//   - isin() and icos() of every whole degree from -720 to 720 are sin and cos
+//     worked in double precision, scaled to Q14 and rounded
+//   - polarX() and polarY() are within half a pixel, plus the table's rounding,
+//     of the double precision point out to a radius of 240
+//   - a 90 degree segment records a span for each of its 45 triangles and
+//     none for their rows
+//   - a wind rose records one span for its disc and one for its arrow, and no
+//     row spans either
+// The exit status is 1 if any check fails.
+#include "Gauges.h"
+#include "FixedTrig.h"
+#include <math.h>
+
+/***************************************************************************************
+**                          Host runtime
+***************************************************************************************/
+static uint32_t nowUs = 0;
+
+uint32_t millis() { return nowUs / 1000; }
+uint32_t micros() { return nowUs++; }
+void delay(uint32_t ms) { nowUs += ms * 1000; }
+
+HardwareSerial Serial;
+EspClass ESP;
+uint32_t EspClass::getFreeHeap() { return 0; }
+uint32_t EspClass::getMaxAllocHeap() { return 0; }
+uint32_t EspClass::getMinFreeHeap() { return 0; }
+const char* volatile heapTag = NULL;
+
+/***************************************************************************************
+**                          Checks
+***************************************************************************************/
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) failures++;
+}
+
+// Counts the spans of one name in the exported trace
+class SpanCounter : public Print {
+  public:
+    SpanCounter(const char* name) {
+      snprintf(this->needle, sizeof(this->needle), "{\"name\":\"%s\"", name);
+    }
+    size_t write(const uint8_t* data, size_t len) override {
+      // Each event is one printf, so a name is never split across writes
+      const char* text = (const char*)data;
+      size_t n = strlen(this->needle);
+      for (size_t i = 0; i + n <= len; i++) {
+        if (!memcmp(text + i, this->needle, n)) this->count++;
+      }
+      return len;
+    }
+    int count = 0;
+
+  private:
+    char needle[48];
+};
+
+static int spans(const char* name) {
+  SpanCounter counter(name);
+  renderTrace.exportChromeJson(counter);
+  return counter.count;
+}
+
+int main() {
+  const double degree = M_PI / 180.0;
+  int wrongSin = 0, wrongCos = 0, firstWrong = 0;
+  for (int a = -720; a <= 720; a++) {
+    int16_t s = (int16_t)lround(sin(a * degree) * FIXED_TRIG_ONE);
+    int16_t c = (int16_t)lround(cos(a * degree) * FIXED_TRIG_ONE);
+    if (isin(a) != s && !wrongSin++ && !wrongCos) firstWrong = a;
+    if (icos(a) != c && !wrongCos++ && !wrongSin) firstWrong = a;
+  }
+  char what[120];
+  snprintf(what, sizeof(what), "isin() is off at %d angles and icos() at %d of -720..720 (first %d)", wrongSin,
+           wrongCos, firstWrong);
+  check(!wrongSin && !wrongCos, what);
+
+  double worst = 0;
+  for (int r = 1; r <= 240; r++) {
+    for (int a = -360; a <= 360; a++) {
+      worst = fmax(worst, fabs(polarX(r, a) - r * sin(a * degree)));
+      worst = fmax(worst, fabs(polarY(r, a) + r * cos(a * degree)));
+    }
+  }
+  // Rounding to the pixel is half of it, the Q14 table adds at most 240 / 32768
+  snprintf(what, sizeof(what), "polarX() and polarY() are at most %.4f pixels out", worst);
+  check(worst <= 0.5 + 240.0 / 32768, what);
+
+  TracedTFT tft;
+  Gauges gauges(&tft);
+  TRACE_CLEAR();
+  gauges.fillSegment(160, 240, 0, 90, 100, TFT_BLUE);
+  snprintf(what, sizeof(what), "a 90 degree segment records %d triangles and %d rows", spans("fillTriangle"),
+           spans("drawFastHLine"));
+  check(spans("fillTriangle") == 90 / GAUGE_ARC_STEP && !spans("drawFastHLine"), what);
+
+  TRACE_CLEAR();
+  gauges.drawWindRose(80, 80, 60, 225, 12, TFT_WHITE);
+  snprintf(what, sizeof(what), "a wind rose records %d spans, %d circle fills and %d rows", renderTrace.recorded(),
+           spans("fillCircle"), spans("drawFastHLine"));
+  check(spans("fillCircle") == 1 && spans("fillTriangle") == 1 && !spans("drawFastHLine"), what);
+
+  printf("%s: %d checks failed\n", failures ? "FAIL" : "PASS", failures);
+  return failures ? 1 : 0;
+}
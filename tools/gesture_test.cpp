@@ -0,0 +1,254 @@
+// Plays scripted touch traces through the FT62XX driver and the gesture
+// recognizer, the way the sketch's touch reader does, and checks the gestures
+// that come out.
+//
+//   g++ -std=gnu++17 -Wall -Wextra -pthread -I. -Itools/host -o /tmp/gesture_test tools/gesture_test.cpp Gestures.cpp
+//   /tmp/gesture_test
+//
+// The stand-in Wire in tools/host is the panel's register file. For each trace
+// the harness sets the touch registers from where the finger is at the current
+// time, holds the INT pin low while it is down, and runs the reader: woken when
+// INT falls, it reads the panel every TOUCH_SAMPLE_MS until the finger is up
+// and the recognizer has finished the contact, then sleeps until INT falls again.
+//
+// Checked:
+//   - each trace gives exactly the gestures listed with it, at the point where
+//     the contact started, with the travel in the right direction
+//   - a lift shorter than GESTURE_RELEASE_MS does not split a contact and one
+//     longer does, a contact shorter than GESTURE_DEBOUNCE_MS gives nothing
+//   - the panel is only read while a finger is down or just lifted
+//   - begin() accepts the panel IDs and puts INT into polling mode
+//   - the event queue drops what does not fit, and hands events from one
+//     thread to another in order
+// The exit status is 1 if any check fails.
+#include "FT62XXTouchScreen.h"
+#include "Gestures.h"
+#include <thread>
+#include <vector>
+
+/***************************************************************************************
+**                          Host runtime
+***************************************************************************************/
+static uint32_t nowMs = 0;
+
+uint32_t millis() { return nowMs; }
+uint32_t micros() { return nowMs * 1000; }
+void delay(uint32_t ms) { nowMs += ms; }
+
+HardwareSerial Serial;
+EspClass ESP;
+uint32_t EspClass::getFreeHeap() { return 0; }
+uint32_t EspClass::getMaxAllocHeap() { return 0; }
+uint32_t EspClass::getMinFreeHeap() { return 0; }
+const char* volatile heapTag = NULL;
+
+/***************************************************************************************
+**                          Panel
+***************************************************************************************/
+// As in RiverWeather.ino
+#define DISPLAY_HEIGHT  480
+#define TOUCH_INT_PIN    39
+#define TOUCH_SAMPLE_MS  15
+#define ISR_WAKE_MS       1   // INT falling to the reader's first read
+
+// A finger on the glass from downMs to upMs, moving in a straight line. Between
+// liftFromMs and liftToMs the panel loses it, as a light touch does.
+typedef struct Contact {
+  uint32_t downMs;
+  uint32_t upMs;
+  uint16_t x0, y0;
+  uint16_t x1, y1;
+  uint32_t liftFromMs;
+  uint32_t liftToMs;
+} Contact;
+
+typedef struct Expected {
+  uint8_t  type;
+  uint16_t x, y;      // where the contact started
+} Expected;
+
+typedef struct Trace {
+  const char*           name;
+  std::vector<Contact>  contacts;
+  std::vector<Expected> gestures;
+} Trace;
+
+static const Trace* playing = NULL;
+
+static const Contact* contactAt(uint32_t t) {
+  for (const Contact& c : playing->contacts) {
+    if (t >= c.downMs && t < c.upMs && !(t >= c.liftFromMs && t < c.liftToMs)) return &c;
+  }
+  return NULL;
+}
+
+// The panel's registers at time t: number of touches, then the first point
+// with Y counted up from the bottom edge
+static void updatePanel(uint32_t t) {
+  const Contact* c = contactAt(t);
+  Wire.registers[0x02] = c ? 1 : 0;
+  if (!c) return;
+  float f = (float)(t - c->downMs) / (c->upMs - c->downMs);
+  uint16_t x = (uint16_t)lroundf(c->x0 + f * (c->x1 - c->x0));
+  uint16_t y = (uint16_t)lroundf(c->y0 + f * (c->y1 - c->y0));
+  uint16_t rawY = DISPLAY_HEIGHT - y;
+  Wire.registers[0x03] = rawY >> 8;
+  Wire.registers[0x04] = rawY & 0xFF;
+  Wire.registers[0x05] = x >> 8;   // touch id 0 in the top nibble
+  Wire.registers[0x06] = x & 0xFF;
+}
+
+void pinMode(uint8_t, uint8_t) {}
+
+int digitalRead(uint8_t pin) {
+  return pin == TOUCH_INT_PIN && contactAt(nowMs) ? LOW : HIGH;
+}
+
+/***************************************************************************************
+**                          Checks
+***************************************************************************************/
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) failures++;
+}
+
+static const char* gestureName(uint8_t type) {
+  static const char* names[] = { "none", "tap", "long press", "swipe left", "swipe right", "swipe up", "swipe down" };
+  return type <= GESTURE_SWIPE_DOWN ? names[type] : "?";
+}
+
+// The reader task in RiverWeather.ino, woken by each INT falling edge
+static void play(const Trace& trace, FT62XXTouchScreen& touch) {
+  playing = &trace;
+  GestureQueue queue;
+  GestureRecognizer recognizer(&queue);
+  uint32_t startTransactions = Wire.transactions;
+  uint32_t awakeMs = 0;
+
+  nowMs = 0;
+  uint32_t endMs = trace.contacts.back().upMs + 1000;
+  bool intLow = false;
+  while (nowMs < endMs) {
+    bool low = digitalRead(TOUCH_INT_PIN) == LOW;
+    bool falling = low && !intLow;
+    intLow = low;
+    if (!falling) {
+      nowMs++;
+      continue;
+    }
+    uint32_t wokeMs = nowMs;
+    nowMs += ISR_WAKE_MS;
+    do {
+      updatePanel(nowMs);
+      TouchPoint p = touch.read();
+      recognizer.update(p.touched != 0, p.xPos, p.yPos, millis());
+      nowMs += TOUCH_SAMPLE_MS;
+    } while (touch.touching() || recognizer.active());
+    awakeMs += nowMs - wokeMs;
+    intLow = digitalRead(TOUCH_INT_PIN) == LOW;
+  }
+
+  std::vector<GestureEvent> got;
+  GestureEvent ev;
+  while (queue.pop(ev)) got.push_back(ev);
+
+  bool same = got.size() == trace.gestures.size();
+  for (size_t i = 0; same && i < got.size(); i++) {
+    const Expected& e = trace.gestures[i];
+    same = got[i].type == e.type && abs(got[i].xPos - e.x) <= 1 && abs(got[i].yPos - e.y) <= 1;
+    // The travel agrees with the direction
+    if (got[i].type == GESTURE_SWIPE_LEFT) same = same && got[i].dx < 0;
+    if (got[i].type == GESTURE_SWIPE_RIGHT) same = same && got[i].dx > 0;
+    if (got[i].type == GESTURE_SWIPE_UP) same = same && got[i].dy < 0;
+    if (got[i].type == GESTURE_SWIPE_DOWN) same = same && got[i].dy > 0;
+  }
+  char what[160];
+  int n = snprintf(what, sizeof(what), "%s gives", trace.name);
+  if (got.empty()) snprintf(what + n, sizeof(what) - n, " nothing");
+  for (const GestureEvent& g : got) {
+    n += snprintf(what + n, sizeof(what) - n, " %s at %u,%u", gestureName(g.type), g.xPos, g.yPos);
+  }
+  check(same, what);
+
+  // Two transactions a read: set the register pointer, then read 16 bytes
+  uint32_t reads = (Wire.transactions - startTransactions) / 2;
+  snprintf(what, sizeof(what), "%s reads the panel %u times, only while awake", trace.name, reads);
+  check(reads <= awakeMs / TOUCH_SAMPLE_MS + 1, what);
+}
+
+int main() {
+  Wire.address = FT62XX_ADDR;
+  FT62XXTouchScreen touch(DISPLAY_HEIGHT, 18, 19);
+
+  Wire.registers[FT62XX_REG_VENDID] = FT62XX_VENDID;
+  Wire.registers[FT62XX_REG_CHIPID] = FT6236U_CHIPID;
+  Wire.registers[FT62XX_REG_GMODE] = 0x01;
+  check(touch.begin(TOUCH_INT_PIN), "begin() accepts an FT6236U");
+  check(Wire.registers[FT62XX_REG_GMODE] == FT62XX_GMODE_POLLING, "and sets INT to stay low while a finger is down");
+  Wire.registers[FT62XX_REG_CHIPID] = 0x99;
+  check(!touch.begin(TOUCH_INT_PIN), "begin() turns down an unknown chip");
+  Wire.registers[FT62XX_REG_CHIPID] = FT6236U_CHIPID;
+  check(touch.interruptPin() == TOUCH_INT_PIN, "the reader waits on the INT pin");
+
+  const uint32_t never = 0;
+  const std::vector<Trace> traces = {
+    { "a tap", { { 100, 180, 160, 240, 161, 241, never, never } }, { { GESTURE_TAP, 160, 240 } } },
+    { "a tap that loses contact for 20 ms", { { 100, 250, 200, 100, 202, 101, 160, 180 } }, { { GESTURE_TAP, 200, 100 } } },
+    { "a lift of 60 ms", { { 100, 300, 200, 100, 200, 100, 160, 220 } },
+      { { GESTURE_TAP, 200, 100 }, { GESTURE_TAP, 200, 100 } } },
+    { "two taps", { { 100, 180, 50, 60, 50, 60, never, never }, { 400, 470, 270, 420, 270, 421, never, never } },
+      { { GESTURE_TAP, 50, 60 }, { GESTURE_TAP, 270, 420 } } },
+    { "a brush of 15 ms", { { 100, 115, 10, 10, 10, 10, never, never } }, {} },
+    { "a long press", { { 100, 1300, 160, 300, 163, 298, never, never } }, { { GESTURE_LONG_PRESS, 160, 300 } } },
+    { "a press that drifts right", { { 100, 1300, 100, 300, 180, 300, never, never } }, { { GESTURE_SWIPE_RIGHT, 100, 300 } } },
+    { "a swipe left", { { 100, 350, 280, 240, 60, 250, never, never } }, { { GESTURE_SWIPE_LEFT, 280, 240 } } },
+    { "a swipe right", { { 100, 300, 40, 200, 250, 190, never, never } }, { { GESTURE_SWIPE_RIGHT, 40, 200 } } },
+    { "a swipe up", { { 100, 400, 160, 420, 165, 150, never, never } }, { { GESTURE_SWIPE_UP, 160, 420 } } },
+    { "a swipe down", { { 100, 400, 160, 320, 150, 460, never, never } }, { { GESTURE_SWIPE_DOWN, 160, 320 } } },
+    { "a diagonal more across than down", { { 100, 300, 100, 100, 180, 150, never, never } }, { { GESTURE_SWIPE_RIGHT, 100, 100 } } },
+    { "a swipe up with a flicker", { { 100, 400, 160, 420, 165, 150, 250, 280 } }, { { GESTURE_SWIPE_UP, 160, 420 } } },
+  };
+  for (const Trace& trace : traces) {
+    play(trace, touch);
+  }
+
+  // Nothing pops, the ninth event is dropped and the first eight kept
+  GestureQueue full;
+  for (int i = 0; i < GESTURE_QUEUE_SIZE + 1; i++) {
+    GestureEvent ev = {};
+    ev.xPos = i;
+    full.push(ev);
+  }
+  GestureEvent ev;
+  int popped = 0;
+  bool inOrder = true;
+  while (full.pop(ev)) inOrder = inOrder && ev.xPos == popped++;
+  check(popped == GESTURE_QUEUE_SIZE && inOrder && full.droppedCount() == 1, "a full queue drops the newest event");
+
+  // The touch task pushes while the scheduler pops
+  GestureQueue handoff;
+  const uint16_t events = 50000;
+  std::thread producer([&] {
+    for (uint16_t i = 0; i < events; i++) {
+      GestureEvent e = {};
+      e.durationMs = i;
+      while (!handoff.push(e)) std::this_thread::yield();
+    }
+  });
+  uint32_t received = 0;
+  inOrder = true;
+  while (received < events) {
+    if (handoff.pop(ev)) {
+      inOrder = inOrder && ev.durationMs == received++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+  check(inOrder && !handoff.pop(ev), "events cross between threads complete and in order");
+
+  printf("%s: %d checks failed\n", failures ? "FAIL" : "PASS", failures);
+  return failures ? 1 : 0;
+}
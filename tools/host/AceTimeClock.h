@@ -0,0 +1,37 @@
+// Just the part of AceTime that SntpClock uses, for tools/sntp_test.cpp. Epoch
+// seconds count from 2050 as in AceTime 2.
+#pragma once
+#include <stdint.h>
+
+typedef int32_t acetime_t;
+
+namespace ace_time {
+
+class LocalDate {
+  public:
+    static const acetime_t kInvalidEpochSeconds = INT32_MIN;
+};
+
+class LocalDateTime {
+  public:
+    static LocalDateTime forUnixSeconds64(int64_t unixSeconds) {
+      LocalDateTime t;
+      t.unixSeconds = unixSeconds;
+      return t;
+    }
+    acetime_t toEpochSeconds() const { return (acetime_t)(this->unixSeconds - 2524608000LL); }
+
+  private:
+    int64_t unixSeconds = 0;
+};
+
+namespace clock {
+
+class Clock {
+  public:
+    virtual ~Clock() {}
+    virtual acetime_t getNow() const = 0;
+};
+
+}  // namespace clock
+}  // namespace ace_time
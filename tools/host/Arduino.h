@@ -0,0 +1,131 @@
+// Just enough of the Arduino core to run the sketch's fetch, parse and draw
+// code on a PC, for tools/soak.cpp. Time is simulated: millis() only moves when
+// the harness or delay() moves it. Serial, ESP and the clock are defined by the
+// harness.
+#pragma once
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <algorithm>
+#include <Print.h>
+
+using std::max;
+using std::min;
+
+typedef bool    boolean;
+typedef uint8_t byte;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define IRAM_ATTR
+#define F(text) (text)
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+
+// GPIO, defined by a harness that drives pins (tools/gesture_test.cpp)
+#define INPUT 0x01
+#define LOW   0
+#define HIGH  1
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+
+inline long random(long howBig) { return howBig > 0 ? ::random() % howBig : 0; }
+inline long random(long howSmall, long howBig) { return howSmall + random(howBig - howSmall); }
+inline uint32_t esp_random() { return (uint32_t)::random() << 16 ^ (uint32_t)::random(); }
+
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+inline size_t strlcpy(char* dst, const char* src, size_t size) {
+  size_t len = strlen(src);
+  if (size) {
+    size_t n = len < size - 1 ? len : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return len;
+}
+#endif
+
+// The serial port, quiet unless the harness says otherwise
+class HardwareSerial : public Print {
+  public:
+    size_t write(const uint8_t* data, size_t len) override { return this->echo ? fwrite(data, 1, len, stdout) : len; }
+    bool echo = false;
+};
+extern HardwareSerial Serial;
+
+// Heap figures come from the harness's allocator
+class EspClass {
+  public:
+    uint32_t getFreeHeap();
+    uint32_t getMaxAllocHeap();
+    uint32_t getMinFreeHeap();
+};
+extern EspClass ESP;
+
+// Names the allocations made while it is in scope, for the harness's hotspot
+// table. The stand-in libraries use it for what they allocate on the sketch's
+// behalf; anything untagged is put down to the sketch function that called.
+// Volatile, the compiler takes it that malloc() reads no globals and would
+// drop the store around a call.
+extern const char* volatile heapTag;
+
+class HeapTag {
+  public:
+    HeapTag(const char* tag) : saved(heapTag) { heapTag = tag; }
+    ~HeapTag() { heapTag = this->saved; }
+
+  private:
+    const char* saved;
+};
+
+// The Arduino String, with the core's small string buffer so short strings
+// stay off the heap the same as on the ESP32
+class String {
+  public:
+    String(const char* text = "") { assign(text, strlen(text)); }
+    String(const String& other) { assign(other.c_str(), other.len); }
+    ~String() { free(this->heap); }
+
+    String& operator=(const String& other) {
+      if (this != &other) assign(other.c_str(), other.len);
+      return *this;
+    }
+    String& operator=(const char* text) { assign(text, strlen(text)); return *this; }
+
+    const char* c_str() const { return this->heap ? this->heap : this->inline_; }
+    unsigned length() const { return this->len; }
+    bool operator==(const char* other) const { return !strcmp(c_str(), other); }
+    bool equalsIgnoreCase(const char* other) const { return !strcasecmp(c_str(), other); }
+    bool equalsIgnoreCase(const String& other) const { return equalsIgnoreCase(other.c_str()); }
+
+  private:
+    void assign(const char* text, unsigned n) {
+      char* old = this->heap;
+      this->heap = NULL;
+      if (n < sizeof(this->inline_)) {
+        memmove(this->inline_, text, n);
+        this->inline_[n] = '\0';
+      } else {
+        this->heap = (char*)malloc(n + 1);
+        if (this->heap) {
+          memcpy(this->heap, text, n);
+          this->heap[n] = '\0';
+        } else {
+          // Out of memory leaves the string empty, as the core does
+          n = 0;
+          this->inline_[0] = '\0';
+        }
+      }
+      free(old);
+      this->len = n;
+    }
+
+    char*    heap = NULL;
+    char     inline_[12] = {};
+    unsigned len = 0;
+};
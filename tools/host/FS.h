@@ -0,0 +1,72 @@
+// The ESP32 file API for the host tools, on the files under data/ in the
+// repository: "/levels/01646500.bin" is data/levels/01646500.bin, as the
+// Sketch Data Upload would put it in SPIFFS. Run the tools from the top of the
+// repository. Read only, which is all the sketch does.
+//
+// What the C library allocates for an open file, the FILE and its buffer, is
+// tagged FS_HEAP_TAG for tools/soak.cpp, as the ESP32's VFS allocates while a
+// file is open.
+#pragma once
+#include <Arduino.h>
+#include <stdio.h>
+
+#define FS_HEAP_TAG "SPIFFS"
+
+namespace fs {
+
+class File {
+  public:
+    File(FILE* f = NULL) : f(f) {}
+
+    size_t read(uint8_t* buf, size_t len) {
+      HeapTag tag(FS_HEAP_TAG);
+      return this->f ? fread(buf, 1, len, this->f) : 0;
+    }
+    int read() {
+      uint8_t c;
+      return read(&c, 1) == 1 ? c : -1;
+    }
+    size_t size() const {
+      if (!this->f) return 0;
+      long at = ftell(this->f);
+      fseek(this->f, 0, SEEK_END);
+      long end = ftell(this->f);
+      fseek(this->f, at, SEEK_SET);
+      return end;
+    }
+    size_t position() const { return this->f ? ftell(this->f) : 0; }
+    bool seek(uint32_t pos) { return this->f && !fseek(this->f, pos, SEEK_SET); }
+    int available() const { return (int)(size() - position()); }
+    void close() {
+      if (this->f) fclose(this->f);
+      this->f = NULL;
+    }
+    operator bool() const { return this->f != NULL; }
+
+  private:
+    FILE* f;
+};
+
+class FS {
+  public:
+    bool begin(bool formatOnFail = false) {
+      (void)formatOnFail;
+      return true;
+    }
+    bool exists(const char* path) {
+      File f = open(path, "r");
+      bool found = f;
+      f.close();
+      return found;
+    }
+    File open(const char* path, const char* mode = "r") {
+      char local[160];
+      snprintf(local, sizeof(local), "%s%s", root, path);
+      HeapTag tag(FS_HEAP_TAG);
+      return File(fopen(local, mode[0] == 'r' ? "rb" : mode));
+    }
+
+    const char* root = "data";
+};
+
+}  // namespace fs
@@ -0,0 +1,234 @@
+// HTTPClient for tools/soak.cpp. A GET is answered by the harness through
+// HTTPClient::responder and the body comes out of the WiFiClient in TCP
+// segments at a simulated rate, so StreamIngest waits on millis() the way it
+// does on the device.
+//
+// Unless WiFiClient::platformHeap is cleared, a fetch also makes the heap
+// allocations the ESP32 libraries make for it, sized after arduino-esp32 2.x
+// with the IDF's mbedTLS defaults:
+//
+//   strings     the URL pieces, the collected header table, the request
+//               header grown by concatenation and each response header line
+//   socket      the WiFiClient's handle and its 1436 byte receive buffer
+//   pbufs       one per segment from its arrival until it has been read, at
+//               most a TCP window (4 segments) in flight
+//   TLS         for https, the context and its 16 KB in and 4 KB out record
+//               buffers for the whole fetch, the peer's certificate chain kept
+//               with the session, and the handshake state and bignum churn
+//               freed once the handshake is done
+//
+// These are models of the libraries, good for the shape of the heap (what is
+// held while what else is allocated) rather than the exact byte count.
+#pragma once
+#include <WiFiClient.h>
+
+#define HTTP_CODE_OK           200
+#define HTTP_CODE_NOT_MODIFIED 304
+
+#define HTTPC_ERROR_CONNECTION_REFUSED  (-1)
+#define HTTPC_ERROR_CONNECTION_LOST     (-5)
+#define HTTPC_ERROR_NO_HTTP_SERVER      (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM        (-8)
+#define HTTPC_ERROR_READ_TIMEOUT        (-11)
+
+#define HOST_TLS_CONTEXT    1540
+#define HOST_TLS_IN_BUFFER 16717   // 16 KB of content plus the record overhead
+#define HOST_TLS_OUT_BUFFER 4429
+#define HOST_TLS_HANDSHAKE  1652
+#define HOST_TLS_CERTS         3
+
+typedef bool (*HostResponder)(const char* url, HostResponse* response);
+
+class HTTPClient {
+  public:
+    ~HTTPClient() { end(); }
+
+    // url must stay put until end(), the sketch's is in the fetch arena
+    bool begin(const char* url) {
+      end();
+      this->url = url;
+      this->secure = !strncmp(url, "https:", 6);
+      if (WiFiClient::platformHeap) {
+        HeapTag tag("HTTPClient strings");
+        const char* host = strstr(url, "://");
+        host = host ? host + 3 : url;
+        const char* path = strchr(host, '/');
+        char hostName[64];
+        strlcpy(hostName, host, path && (size_t)(path - host) < sizeof(hostName) ? path - host + 1 : sizeof(hostName));
+        this->host = hostName;
+        this->uri = path ? path : "/";
+      }
+      return true;
+    }
+
+    void addHeader(const char* name, const char* value) {
+      size_t used = strlen(this->added);
+      snprintf(this->added + used, sizeof(this->added) - used, "%s: %s\r\n", name, value);
+    }
+
+    void collectHeaders(const char* keys[], size_t count) {
+      this->wantedKeys = count;
+      if (WiFiClient::platformHeap && count) {
+        // new RequestArgument[count], a key and a value String each
+        HeapTag tag("HTTPClient strings");
+        free(this->headerTable);
+        this->headerTable = malloc(count * 2 * sizeof(String) + 8);
+        this->headerName = keys[0];
+      }
+    }
+
+    int GET() {
+      if (!responder || !this->url) return HTTPC_ERROR_CONNECTION_REFUSED;
+      if (WiFiClient::platformHeap) {
+        HeapTag tag("socket");
+        this->socket = malloc(48);
+        this->rxBuffer = malloc(HOST_TCP_MSS);
+        if (!this->socket || !this->rxBuffer) return HTTPC_ERROR_TOO_LESS_RAM;
+      }
+      if (this->secure && WiFiClient::platformHeap && !tlsConnect()) {
+        return HTTPC_ERROR_TOO_LESS_RAM;
+      }
+      if (WiFiClient::platformHeap) {
+        requestHeader();
+      }
+
+      memset(&this->response, 0, sizeof(this->response));
+      this->response.cutAt = (size_t)-1;
+      this->response.stallAt = (size_t)-1;
+      this->response.request = this->added;
+      if (!responder(this->url, &this->response)) {
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+      }
+      delay(this->response.latencyMs);
+      if (this->response.code <= 0) {
+        return this->response.code;
+      }
+      if (WiFiClient::platformHeap) {
+        responseHeaders();
+      }
+      this->transferEncoding = this->response.chunked ? "chunked" : "";
+      this->client.open(this->response);
+      return this->response.code;
+    }
+
+    int getSize() { return this->response.chunked ? -1 : (int)this->response.length; }
+    WiFiClient* getStreamPtr() { return &this->client; }
+
+    String header(const char* name) {
+      if (!this->wantedKeys) return String();
+      if (!strcasecmp(name, "Transfer-Encoding")) return this->transferEncoding;
+      if (!strcasecmp(name, "ETag") && this->response.etag) return String(this->response.etag);
+      return String();
+    }
+
+    static String errorToString(int code) {
+      switch (code) {
+        case HTTPC_ERROR_CONNECTION_REFUSED: return "connection refused";
+        case HTTPC_ERROR_CONNECTION_LOST:    return "connection lost";
+        case HTTPC_ERROR_NO_HTTP_SERVER:     return "no HTTP server";
+        case HTTPC_ERROR_TOO_LESS_RAM:       return "too less ram";
+        case HTTPC_ERROR_READ_TIMEOUT:       return "read Timeout";
+      }
+      return String();
+    }
+
+    void end() {
+      this->added[0] = '\0';
+      this->client.stop();
+      tlsClose();
+      free(this->rxBuffer);
+      free(this->socket);
+      free(this->headerTable);
+      this->rxBuffer = NULL;
+      this->socket = NULL;
+      this->headerTable = NULL;
+    }
+
+    static HostResponder responder;
+
+  private:
+    bool tlsConnect() {
+      HeapTag tag("TLS");
+      this->tlsContext = malloc(HOST_TLS_CONTEXT);
+      this->tlsIn = malloc(HOST_TLS_IN_BUFFER);
+      this->tlsOut = malloc(HOST_TLS_OUT_BUFFER);
+      void* handshake = malloc(HOST_TLS_HANDSHAKE);
+      if (!this->tlsContext || !this->tlsIn || !this->tlsOut || !handshake) {
+        free(handshake);
+        return false;
+      }
+      // The peer's chain, a parsed certificate and its raw copy each
+      for (int i = 0; i < HOST_TLS_CERTS; i++) {
+        this->certs[i * 2] = malloc(600);
+        this->certs[i * 2 + 1] = malloc(900 + random(700));
+      }
+      // Key exchange, bignums come and go a few at a time
+      void* limbs[6] = {};
+      for (int i = 0; i < 120; i++) {
+        int k = random(6);
+        free(limbs[k]);
+        limbs[k] = malloc(16 + 8 * random(16));
+      }
+      for (int k = 0; k < 6; k++) {
+        free(limbs[k]);
+      }
+      free(handshake);
+      return true;
+    }
+
+    void tlsClose() {
+      for (int i = 0; i < HOST_TLS_CERTS * 2; i++) {
+        free(this->certs[i]);
+        this->certs[i] = NULL;
+      }
+      free(this->tlsOut);
+      free(this->tlsIn);
+      free(this->tlsContext);
+      this->tlsOut = NULL;
+      this->tlsIn = NULL;
+      this->tlsContext = NULL;
+    }
+
+    // "GET " + uri + " HTTP/1.1\r\n" + ..., the String grows as it is built
+    void requestHeader() {
+      HeapTag tag("HTTPClient strings");
+      size_t need = strlen(this->url) + 160;
+      void* text = NULL;
+      for (size_t size = 32; ; size = size * 3 / 2) {
+        void* grown = realloc(text, size < need ? size : need);
+        if (!grown) break;
+        text = grown;
+        if (size >= need) break;
+      }
+      free(text);
+    }
+
+    // readStringUntil('\n') per header line
+    void responseHeaders() {
+      HeapTag tag("HTTPClient strings");
+      static const uint8_t lineLengths[] = { 17, 37, 30, 24, 44, 20, 58, 26, 33 };
+      for (uint8_t len : lineLengths) {
+        free(malloc(len + 1));
+      }
+    }
+
+    const char* url = NULL;
+    bool   secure = false;
+    String host;
+    String uri;
+    String headerName;
+    String transferEncoding;
+    size_t wantedKeys = 0;
+    char   added[128] = "";
+    void*  headerTable = NULL;
+    void*  socket = NULL;
+    void*  rxBuffer = NULL;
+    void*  tlsContext = NULL;
+    void*  tlsIn = NULL;
+    void*  tlsOut = NULL;
+    void*  certs[HOST_TLS_CERTS * 2] = {};
+    HostResponse response = {};
+    WiFiClient client;
+};
+
+inline HostResponder HTTPClient::responder = NULL;
@@ -0,0 +1,77 @@
+#include "HostTime.h"
+#include "utils.h"
+#include <stdio.h>
+
+static int64_t daysFromCivil(int y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  int64_t era = (y >= 0 ? y : y - 399) / 400;
+  unsigned yoe = (unsigned)(y - era * 400);
+  unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+  unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int64_t)doe - 719468;
+}
+
+// Day of the month of the nth Sunday
+static int nthSunday(int year, int month, int n) {
+  int weekday = (int)((daysFromCivil(year, month, 1) + 4) % 7);   // 1970-01-01 was a Thursday
+  return 1 + (7 - weekday) % 7 + (n - 1) * 7;
+}
+
+int easternOffsetMinutes(uint32_t unixTime) {
+  time_t t = unixTime;
+  struct tm utc;
+  gmtime_r(&t, &utc);
+  int year = utc.tm_year + 1900;
+  // 2:00 local, 7:00 UTC in March and 6:00 UTC in November
+  int64_t start = daysFromCivil(year, 3, nthSunday(year, 3, 2)) * 86400 + 7 * 3600;
+  int64_t end = daysFromCivil(year, 11, nthSunday(year, 11, 1)) * 86400 + 6 * 3600;
+  return (int64_t)unixTime >= start && (int64_t)unixTime < end ? -240 : -300;
+}
+
+struct tm localTime(uint32_t unixTime) {
+  time_t t = (int64_t)unixTime + easternOffsetMinutes(unixTime) * 60;
+  struct tm local;
+  gmtime_r(&t, &local);
+  return local;
+}
+
+void localCalendar(uint32_t unixTime, CalendarTime& out) {
+  struct tm t = localTime(unixTime);
+  out.year = t.tm_year + 1900;
+  out.month = t.tm_mon + 1;
+  out.day = t.tm_mday;
+  out.hour = t.tm_hour;
+  out.minute = t.tm_min;
+  out.dayOfWeek = t.tm_wday + 1;
+  out.offsetMinutes = easternOffsetMinutes(unixTime);
+}
+
+void strLocalTime(uint32_t unixTime, TextBuf& out) {
+  struct tm t = localTime(unixTime);
+  out.unum(t.tm_hour, 2, '0').add(':').unum(t.tm_min, 2, '0');
+}
+
+void strLocalDateTime(uint32_t unixTime, TextBuf& out) {
+  struct tm t = localTime(unixTime);
+  out.unum(t.tm_mon + 1, 2, '0').add('/').unum(t.tm_mday, 2, '0').add(' ');
+  out.unum(t.tm_hour, 2, '0').add(':').unum(t.tm_min, 2, '0');
+}
+
+uint32_t unixTimeForOffset(int year, int month, int day, int hour, int minute, int offsetMinutes) {
+  if (month < 1 || month > 12 || day < 1 || day > 31 || hour < 0 || hour > 23 || minute < 0 || minute > 59) {
+    return 0;
+  }
+  return daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 - offsetMinutes * 60;
+}
+
+uint32_t parseIsoTime(const char* text) {
+  int year, month, day, hour, minute, second, offsetHour = 0, offsetMinute = 0;
+  char sign = '+';
+  int n = sscanf(text, "%d-%d-%dT%d:%d:%d%c%d:%d", &year, &month, &day, &hour, &minute, &second, &sign, &offsetHour, &offsetMinute);
+  if (n < 6 || (n > 6 && sign != '+' && sign != '-' && sign != 'Z')) {
+    return 0;
+  }
+  int offset = (sign == '-' ? -1 : 1) * (offsetHour * 60 + offsetMinute);
+  uint32_t t = unixTimeForOffset(year, month, day, hour, minute, offset);
+  return t ? t + second : 0;
+}
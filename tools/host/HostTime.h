@@ -0,0 +1,9 @@
+// The time functions of utils.cpp for the host tools. utils.cpp needs AceTime,
+// these do the same for US Eastern with the 2007 rules. The harnesses use the
+// zone offset and local time to make up their data.
+#pragma once
+#include <stdint.h>
+#include <time.h>
+
+int easternOffsetMinutes(uint32_t unixTime);
+struct tm localTime(uint32_t unixTime);
@@ -0,0 +1,26 @@
+// IPv4 address as the ESP32 core has it, for the host tools
+#pragma once
+#include <Arduino.h>
+#include <stdio.h>
+
+class IPAddress {
+  public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) {
+      this->bytes[0] = a;
+      this->bytes[1] = b;
+      this->bytes[2] = c;
+      this->bytes[3] = d;
+    }
+
+    uint8_t operator[](int i) const { return this->bytes[i]; }
+    bool operator==(const IPAddress& other) const { return !memcmp(this->bytes, other.bytes, 4); }
+
+    String toString() const {
+      char text[16];
+      snprintf(text, sizeof(text), "%u.%u.%u.%u", this->bytes[0], this->bytes[1], this->bytes[2], this->bytes[3]);
+      return String(text);
+    }
+
+  private:
+    uint8_t bytes[4];
+};
@@ -0,0 +1,27 @@
+// The JPEGDecoder library for the host tools, enough for GfxUi to build. No
+// image decodes, so drawJpeg() prints that the format is not supported and
+// draws nothing. As the library does on the ESP32 it brings in SPIFFS.
+#pragma once
+#include <SPIFFS.h>
+
+class JPEGDecoder {
+  public:
+    bool decodeFsFile(const char*) { return false; }
+    bool read() { return false; }
+    bool readSwappedBytes() { return false; }
+    void abort() {}
+
+    uint16_t* pImage = NULL;
+    int32_t   width = 0;
+    int32_t   height = 0;
+    int32_t   comps = 0;
+    int32_t   MCUSPerRow = 0;
+    int32_t   MCUSPerCol = 0;
+    int32_t   scanType = 0;
+    int32_t   MCUWidth = 16;
+    int32_t   MCUHeight = 16;
+    int32_t   MCUx = 0;
+    int32_t   MCUy = 0;
+};
+
+inline JPEGDecoder JpegDec;
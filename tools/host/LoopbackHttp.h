@@ -0,0 +1,99 @@
+// A plain HTTP/1.1 GET over a real loopback socket, for the host tests that
+// run ModelCache's server on the stand-in WebServer or fetch from
+// tools/upstream_sim.py. loopbackResponder() plugs into HTTPClient::responder
+// so fetchFromPeer() goes over the socket too. A harness whose replies are
+// over 8 KB defines LOOPBACK_REPLY_MAX first.
+//
+// When the server runs in the same process, set loopbackServe to a function
+// that lets it answer; it is called once the request has been sent.
+#pragma once
+#include <HTTPClient.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef LOOPBACK_REPLY_MAX
+#define LOOPBACK_REPLY_MAX 8192
+#endif
+
+typedef struct LoopbackReply {
+  int    code;
+  char   etag[32];
+  char   text[LOOPBACK_REPLY_MAX];
+  char*  body;
+  size_t length;
+  bool   chunked;
+} LoopbackReply;
+
+inline void (*loopbackServe)() = NULL;
+
+// GET path from 127.0.0.1:port with any extra header lines, false if nothing
+// answered within a second
+inline bool loopbackGet(uint16_t port, const char* path, const char* headers, LoopbackReply* reply) {
+  memset(reply, 0, sizeof(LoopbackReply));
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(fd, (sockaddr*)&addr, sizeof(addr))) {
+    close(fd);
+    return false;
+  }
+  char request[384];
+  int n = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: 127.0.0.1:%d\r\n%s\r\n", path, port, headers ? headers : "");
+  send(fd, request, n, MSG_NOSIGNAL);
+  if (loopbackServe) {
+    loopbackServe();
+  }
+
+  size_t len = 0;
+  for (;;) {
+    pollfd p = { fd, POLLIN, 0 };
+    if (poll(&p, 1, 1000) <= 0) break;
+    ssize_t got = recv(fd, reply->text + len, sizeof(reply->text) - 1 - len, 0);
+    if (got <= 0) break;
+    len += got;
+  }
+  close(fd);
+  reply->text[len] = '\0';
+
+  char* end = strstr(reply->text, "\r\n\r\n");
+  if (!end || sscanf(reply->text, "HTTP/1.1 %d", &reply->code) != 1) {
+    return false;
+  }
+  const char* etag = strcasestr(reply->text, "\r\nETag: ");
+  if (etag && etag < end) {
+    size_t n = strcspn(etag + 8, "\r\n");
+    memcpy(reply->etag, etag + 8, n < sizeof(reply->etag) - 1 ? n : sizeof(reply->etag) - 1);
+  }
+  const char* encoding = strcasestr(reply->text, "\r\nTransfer-Encoding: chunked");
+  reply->chunked = encoding && encoding < end;
+  reply->body = end + 4;
+  reply->length = len - (reply->body - reply->text);
+  return true;
+}
+
+// The last answer loopbackResponder() forwarded, its body is what the client reads
+inline LoopbackReply loopbackLast;
+
+// HTTPClient::responder for http://127.0.0.1[:port]/path, port 80 if none given
+inline bool loopbackResponder(const char* url, HostResponse* response) {
+  const char* host = strstr(url, "://");
+  host = host ? host + 3 : url;
+  const char* path = strchr(host, '/');
+  const char* colon = strchr(host, ':');
+  uint16_t port = colon && (!path || colon < path) ? atoi(colon + 1) : 80;
+  if (!path || !loopbackGet(port, path, response->request, &loopbackLast)) {
+    return false;
+  }
+  response->code = loopbackLast.code;
+  response->body = loopbackLast.body;
+  response->length = loopbackLast.length;
+  response->chunked = loopbackLast.chunked;
+  response->etag = loopbackLast.etag[0] ? loopbackLast.etag : NULL;
+  response->bytesPerSecond = 10 * 1000 * 1000;
+  return true;
+}
@@ -0,0 +1,69 @@
+// NVS for the host tools: a namespace is a file of "key value" lines in
+// Preferences::dir, so what a display stores survives its process the way it
+// survives a reboot. Only unsigned values, which is all the sketch keeps.
+#pragma once
+#include <Arduino.h>
+#include <stdio.h>
+
+#define PREFERENCES_KEYS 8
+
+class Preferences {
+  public:
+    bool begin(const char* name, bool readOnly = false) {
+      this->readOnly = readOnly;
+      snprintf(this->path, sizeof(this->path), "%s/%s.nvs", dir, name);
+      this->count = 0;
+      FILE* f = fopen(this->path, "r");
+      if (f) {
+        while (this->count < PREFERENCES_KEYS &&
+               fscanf(f, "%15s %u", this->keys[this->count], &this->values[this->count]) == 2) {
+          this->count++;
+        }
+        fclose(f);
+      }
+      return true;
+    }
+
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0) {
+      int i = find(key);
+      return i < 0 ? defaultValue : this->values[i];
+    }
+
+    size_t putUInt(const char* key, uint32_t value) {
+      if (this->readOnly) return 0;
+      int i = find(key);
+      if (i < 0) {
+        if (this->count == PREFERENCES_KEYS) return 0;
+        i = this->count++;
+        strlcpy(this->keys[i], key, sizeof(this->keys[i]));
+      }
+      this->values[i] = value;
+      FILE* f = fopen(this->path, "w");
+      if (!f) return 0;
+      for (int k = 0; k < this->count; k++) {
+        fprintf(f, "%s %u\n", this->keys[k], this->values[k]);
+      }
+      fclose(f);
+      return sizeof(value);
+    }
+
+    void end() { this->count = 0; }
+
+    static const char* dir;
+
+  private:
+    int find(const char* key) const {
+      for (int i = 0; i < this->count; i++) {
+        if (!strcmp(this->keys[i], key)) return i;
+      }
+      return -1;
+    }
+
+    char     path[256];
+    bool     readOnly = false;
+    char     keys[PREFERENCES_KEYS][16];
+    uint32_t values[PREFERENCES_KEYS];
+    int      count = 0;
+};
+
+inline const char* Preferences::dir = ".";
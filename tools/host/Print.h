@@ -0,0 +1,37 @@
+// Just enough of the Arduino Print class to build the pure policy classes on a PC
+#pragma once
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+class Print {
+  public:
+    virtual ~Print() {}
+
+    // Everything ends up here, stdout unless a subclass says otherwise
+    virtual size_t write(const uint8_t* data, size_t len) { return fwrite(data, 1, len, stdout); }
+    size_t write(uint8_t c) { return write(&c, 1); }
+    virtual void flush() { fflush(stdout); }
+
+    int printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+      char text[256];
+      va_list args;
+      va_start(args, format);
+      int n = vsnprintf(text, sizeof(text), format, args);
+      va_end(args);
+      if (n > 0) {
+        write((const uint8_t*)text, (size_t)n < sizeof(text) ? n : sizeof(text) - 1);
+      }
+      return n;
+    }
+
+    size_t print(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int value) { return printf("%d", value); }
+    size_t print(unsigned value) { return printf("%u", value); }
+    size_t print(double value) { return printf("%.2f", value); }
+    size_t println() { return print("\r\n"); }
+    template <typename T>
+    size_t println(T value) { return print(value) + println(); }
+};
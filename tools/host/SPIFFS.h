@@ -0,0 +1,5 @@
+// SPIFFS for the host tools, the files under data/ (see FS.h)
+#pragma once
+#include <FS.h>
+
+inline fs::FS SPIFFS;
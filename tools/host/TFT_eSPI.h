@@ -0,0 +1,185 @@
+// A TFT_eSPI that draws nothing, for tools/soak.cpp. What it keeps is the
+// library's heap use: a sprite's pixels are allocated by createSprite() and
+// freed by deleteSprite(), and loadFont() allocates the seven glyph metric
+// tables the smooth font code reads from the .vlw file (12 bytes a glyph) plus
+// the open file, all freed by unloadFont().
+//
+// fillRect, drawFastHLine and drawFastVLine are virtual as in the library, so
+// TracedTFT builds against it with RENDER_TRACE, and fillTriangle and
+// fillCircle draw a drawFastHLine a row the way the library's do.
+//
+// readRectRGB reads back from panel, a width x height picture of panel memory
+// the harness can point at, as three bytes a pixel the way the ST7796 sends
+// them. Without one the panel reads back black.
+#pragma once
+#include <Arduino.h>
+#include <stdio.h>
+
+#define TFT_BLACK     0x0000
+#define TFT_NAVY      0x000F
+#define TFT_DARKGREY  0x7BEF
+#define TFT_LIGHTGREY 0xD69A
+#define TFT_BLUE      0x001F
+#define TFT_GREEN     0x07E0
+#define TFT_RED       0xF800
+#define TFT_MAGENTA   0xF81F
+#define TFT_YELLOW    0xFFE0
+#define TFT_WHITE     0xFFFF
+#define TFT_ORANGE    0xFDA0
+
+#define TL_DATUM 0
+#define TC_DATUM 1
+#define TR_DATUM 2
+#define MC_DATUM 4
+#define BC_DATUM 7
+#define BR_DATUM 8
+
+#define TFT_WIDTH  320
+#define TFT_HEIGHT 480
+
+#define TFT_FONT_TABLES   7
+#define TFT_FONT_FILE   256   // the SPIFFS file held open while the font is loaded
+
+class TFT_eSPI {
+  public:
+    TFT_eSPI(int16_t w = TFT_WIDTH, int16_t h = TFT_HEIGHT) : w(w), h(h) {}
+    virtual ~TFT_eSPI() { unloadFont(); }
+
+    int32_t width() const { return this->w; }
+    int32_t height() const { return this->h; }
+
+    void fillScreen(uint32_t) {}
+    virtual void fillRect(int32_t, int32_t, int32_t, int32_t, uint32_t) {}
+    void fillRoundRect(int32_t, int32_t, int32_t, int32_t, int32_t, uint32_t) {}
+    void fillTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color) {
+      int32_t top = std::min(y0, std::min(y1, y2));
+      int32_t bottom = std::max(y0, std::max(y1, y2));
+      int32_t left = std::min(x0, std::min(x1, x2));
+      int32_t right = std::max(x0, std::max(x1, x2));
+      for (int32_t y = top; y <= bottom; y++) drawFastHLine(left, y, right - left + 1, color);
+    }
+    void fillCircle(int32_t x, int32_t y, int32_t r, uint32_t color) {
+      for (int32_t dy = -r; dy <= r; dy++) {
+        int32_t dx = (int32_t)sqrt((double)(r * r - dy * dy));
+        drawFastHLine(x - dx, y + dy, 2 * dx + 1, color);
+      }
+    }
+    void drawRoundRect(int32_t, int32_t, int32_t, int32_t, int32_t, uint32_t) {}
+    void drawCircle(int32_t, int32_t, int32_t, uint32_t) {}
+    void drawLine(int32_t, int32_t, int32_t, int32_t, uint32_t) {}
+    virtual void drawFastVLine(int32_t, int32_t, int32_t, uint32_t) {}
+    virtual void drawFastHLine(int32_t, int32_t, int32_t, uint32_t) {}
+    int16_t drawString(const char*, int32_t, int32_t) { return 0; }
+    int16_t drawString(const char*, int32_t, int32_t, uint8_t) { return 0; }
+    int16_t drawNumber(long, int32_t, int32_t, uint8_t) { return 0; }
+    int16_t fontHeight(uint8_t = 1) const { return 8; }
+    int16_t textWidth(const char* text) const { return 8 * strlen(text); }
+    void setCursor(int16_t, int16_t) {}
+    void setCursor(int16_t, int16_t, uint8_t) {}
+    void pushImage(int32_t, int32_t, int32_t, int32_t, const uint16_t*) {}
+    void setSwapBytes(bool) {}
+    void setTextDatum(uint8_t) {}
+    void setTextPadding(uint16_t) {}
+    void setTextColor(uint16_t, uint16_t) {}
+    void setViewport(int32_t, int32_t, int32_t, int32_t, bool = true) {}
+    void resetViewport() {}
+    void readRectRGB(int32_t x, int32_t y, int32_t w, int32_t h, uint8_t* data) {
+      for (int32_t row = 0; row < h; row++) {
+        for (int32_t col = 0; col < w; col++) {
+          uint16_t c = this->panel ? this->panel[(y + row) * this->w + x + col] : 0;
+          *data++ = (c >> 8) & 0xF8;
+          *data++ = (c >> 3) & 0xFC;
+          *data++ = (c << 3) & 0xF8;
+        }
+      }
+    }
+    void writecommand(uint8_t) {}
+    void writedata(uint8_t) {}
+
+    // name as the sketch gives it ("fonts/NotoSansBold15"), the glyph count is
+    // read from data/<name>.vlw when the harness runs from the repository. The
+    // harness loads each font once before the run, so no file is opened on the
+    // simulated heap.
+    void loadFont(const char* name) {
+      if (this->fontLoaded) unloadFont();
+      uint32_t glyphs = fontGlyphs(name);
+      static const uint8_t bytesPerGlyph[TFT_FONT_TABLES] = { 2, 1, 1, 1, 2, 1, 4 };
+      HeapTag tag("font tables");
+      this->fontFile = malloc(TFT_FONT_FILE);
+      for (int i = 0; i < TFT_FONT_TABLES; i++) {
+        this->fontTables[i] = malloc(glyphs * bytesPerGlyph[i]);
+      }
+      this->fontLoaded = true;
+    }
+    void loadFont(String name, bool) { loadFont(name.c_str()); }
+
+    void unloadFont() {
+      for (int i = 0; i < TFT_FONT_TABLES; i++) {
+        free(this->fontTables[i]);
+        this->fontTables[i] = NULL;
+      }
+      free(this->fontFile);
+      this->fontFile = NULL;
+      this->fontLoaded = false;
+    }
+
+    bool      fontLoaded = false;
+    uint16_t* panel = NULL;
+
+  private:
+    static uint32_t fontGlyphs(const char* name) {
+      static const char* names[4];
+      static uint32_t counts[4];
+      for (int i = 0; i < 4 && names[i]; i++) {
+        if (!strcmp(names[i], name)) return counts[i];
+      }
+      uint32_t glyphs = 95;
+      char path[96];
+      snprintf(path, sizeof(path), "data/%s.vlw", name);
+      FILE* f = fopen(path, "rb");
+      if (f) {
+        uint8_t head[4];
+        if (fread(head, 1, 4, f) == 4) {
+          glyphs = (uint32_t)head[0] << 24 | (uint32_t)head[1] << 16 | (uint32_t)head[2] << 8 | head[3];
+        }
+        fclose(f);
+      }
+      for (int i = 0; i < 4; i++) {
+        if (!names[i]) {
+          names[i] = name;
+          counts[i] = glyphs;
+          break;
+        }
+      }
+      return glyphs;
+    }
+
+    int16_t w;
+    int16_t h;
+    void* fontTables[TFT_FONT_TABLES] = {};
+    void* fontFile = NULL;
+};
+
+class TFT_eSprite : public TFT_eSPI {
+  public:
+    TFT_eSprite(TFT_eSPI* tft) : tft(tft) {}
+    ~TFT_eSprite() { deleteSprite(); }
+
+    void setColorDepth(int8_t bits) { this->bits = bits; }
+    void* createSprite(int16_t w, int16_t h) {
+      HeapTag tag("sprite");
+      if (!this->pixels) this->pixels = malloc((size_t)w * h * this->bits / 8 + 1);
+      return this->pixels;
+    }
+    void deleteSprite() {
+      free(this->pixels);
+      this->pixels = NULL;
+    }
+    bool created() const { return this->pixels != NULL; }
+    void pushSprite(int32_t, int32_t) {}
+
+  private:
+    TFT_eSPI* tft;
+    void*     pixels = NULL;
+    int8_t    bits = 16;
+};
@@ -0,0 +1,235 @@
+// A stand-in for the TinyXML Arduino library with the same callbacks, for
+// tools/soak.cpp. A start tag is reported with its full path ("/site/observed"),
+// then its attributes by name, then its text, then the end tag with the path
+// again. The caller's buffer holds the path in its first half and the text or
+// attribute value being read in the second; nothing is allocated.
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+#define STATUS_START_TAG 0x01
+#define STATUS_TAG_TEXT  0x02
+#define STATUS_ATTR_TEXT 0x04
+#define STATUS_END_TAG   0x08
+#define STATUS_ERROR     0x10
+
+typedef void (*XMLcallback)(uint8_t statusflags, char* tagName, uint16_t tagNameLen, char* data, uint16_t dataLen);
+
+class TinyXML {
+  public:
+    void init(uint8_t* buffer, uint16_t size, XMLcallback callback) {
+      this->path = (char*)buffer;
+      this->pathMax = size / 2;
+      this->text = (char*)buffer + this->pathMax;
+      this->textMax = size - this->pathMax;
+      this->callback = callback;
+      reset();
+    }
+
+    void reset() {
+      this->state = TEXT;
+      this->pathLen = 0;
+      this->textLen = 0;
+      this->nameLen = 0;
+      this->path[0] = '\0';
+      this->text[0] = '\0';
+    }
+
+    void processChar(uint8_t c) {
+      switch (this->state) {
+        case TEXT:
+          if (c == '<') {
+            flushText();
+            this->state = OPEN;
+          } else {
+            addText(c);
+          }
+          break;
+        case OPEN:
+          this->nameLen = 0;
+          if (c == '/') {
+            this->state = END_NAME;
+          } else if (c == '?') {
+            this->state = SKIP;
+          } else if (c == '!') {
+            this->state = BANG;
+          } else {
+            addPath('/');
+            addPath(c);
+            this->state = TAG_NAME;
+          }
+          break;
+        case TAG_NAME:
+          if (isSpace(c) || c == '>' || c == '/') {
+            report(STATUS_START_TAG, this->path, this->pathLen, NULL, 0);
+            this->state = c == '>' ? TEXT : c == '/' ? EMPTY_END : IN_TAG;
+          } else {
+            addPath(c);
+          }
+          break;
+        case IN_TAG:
+          if (c == '>') {
+            this->state = TEXT;
+          } else if (c == '/') {
+            this->state = EMPTY_END;
+          } else if (!isSpace(c)) {
+            this->nameLen = 0;
+            addName(c);
+            this->state = ATTR_NAME;
+          }
+          break;
+        case ATTR_NAME:
+          if (c == '=') {
+            this->state = ATTR_QUOTE;
+          } else if (isSpace(c)) {
+            this->state = ATTR_EQUALS;
+          } else {
+            addName(c);
+          }
+          break;
+        case ATTR_EQUALS:
+          if (c == '=') {
+            this->state = ATTR_QUOTE;
+          } else if (!isSpace(c)) {
+            error();
+          }
+          break;
+        case ATTR_QUOTE:
+          if (c == '"' || c == '\'') {
+            this->quote = c;
+            this->textLen = 0;
+            this->state = ATTR_VALUE;
+          } else if (!isSpace(c)) {
+            error();
+          }
+          break;
+        case ATTR_VALUE:
+          if (c == this->quote) {
+            this->text[this->textLen] = '\0';
+            report(STATUS_ATTR_TEXT, this->name, this->nameLen, this->text, this->textLen);
+            this->textLen = 0;
+            this->state = IN_TAG;
+          } else {
+            addText(c);
+          }
+          break;
+        case EMPTY_END:
+          if (c == '>') {
+            endTag();
+          } else {
+            error();
+          }
+          break;
+        case END_NAME:
+          if (c == '>') {
+            this->name[this->nameLen] = '\0';
+            if (strcmp(this->path + lastTagStart() + 1, this->name)) {
+              error();
+            } else {
+              endTag();
+            }
+          } else if (!isSpace(c)) {
+            addName(c);
+          }
+          break;
+        case BANG:
+          // A comment runs to "-->", a declaration to '>'
+          this->state = c == '-' ? COMMENT : SKIP;
+          this->dashes = 0;
+          break;
+        case COMMENT:
+          if (c == '>' && this->dashes >= 2) {
+            this->state = TEXT;
+          }
+          this->dashes = c == '-' ? this->dashes + 1 : 0;
+          break;
+        case SKIP:
+          if (c == '>') {
+            this->state = TEXT;
+          }
+          break;
+      }
+    }
+
+  private:
+    typedef enum {
+      TEXT, OPEN, TAG_NAME, IN_TAG, ATTR_NAME, ATTR_EQUALS, ATTR_QUOTE, ATTR_VALUE,
+      EMPTY_END, END_NAME, BANG, COMMENT, SKIP
+    } State;
+
+    static bool isSpace(uint8_t c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+    void addPath(uint8_t c) {
+      if (this->pathLen + 1 < this->pathMax) {
+        this->path[this->pathLen++] = c;
+        this->path[this->pathLen] = '\0';
+      } else {
+        error();
+      }
+    }
+
+    void addText(uint8_t c) {
+      if (this->textLen + 1 < this->textMax) {
+        this->text[this->textLen++] = c;
+      } else {
+        error();
+      }
+    }
+
+    void addName(uint8_t c) {
+      if (this->nameLen + 1 < sizeof(this->name)) {
+        this->name[this->nameLen++] = c;
+        this->name[this->nameLen] = '\0';
+      }
+    }
+
+    // Text between tags, without the white space around it
+    void flushText() {
+      size_t start = 0;
+      size_t end = this->textLen;
+      while (start < end && isSpace(this->text[start])) start++;
+      while (end > start && isSpace(this->text[end - 1])) end--;
+      if (end > start && this->pathLen) {
+        memmove(this->text, this->text + start, end - start);
+        this->text[end - start] = '\0';
+        report(STATUS_TAG_TEXT, this->path, this->pathLen, this->text, end - start);
+      }
+      this->textLen = 0;
+    }
+
+    size_t lastTagStart() const {
+      size_t i = this->pathLen;
+      while (i > 0 && this->path[i - 1] != '/') i--;
+      return i ? i - 1 : 0;
+    }
+
+    void endTag() {
+      report(STATUS_END_TAG, this->path, this->pathLen, NULL, 0);
+      this->pathLen = lastTagStart();
+      this->path[this->pathLen] = '\0';
+      this->state = TEXT;
+    }
+
+    void error() {
+      report(STATUS_ERROR, this->path, this->pathLen, NULL, 0);
+      reset();
+      this->state = SKIP;
+    }
+
+    void report(uint8_t status, char* tag, size_t tagLen, char* data, size_t dataLen) {
+      if (this->callback) this->callback(status, tag, tagLen, data, dataLen);
+    }
+
+    XMLcallback callback = NULL;
+    State    state = TEXT;
+    char*    path = NULL;
+    size_t   pathMax = 0;
+    size_t   pathLen = 0;
+    char*    text = NULL;
+    size_t   textMax = 0;
+    size_t   textLen = 0;
+    char     name[32];
+    size_t   nameLen = 0;
+    uint8_t  quote = 0;
+    uint8_t  dashes = 0;
+};
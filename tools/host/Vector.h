@@ -0,0 +1,28 @@
+// Just enough of Janelia's Vector (a fixed array the caller supplies) for tools/soak.cpp
+#pragma once
+#include <stddef.h>
+
+template <typename T>
+class Vector {
+  public:
+    template <size_t MAX_SIZE>
+    void setStorage(T (&values)[MAX_SIZE], size_t size = 0) {
+      this->values = values;
+      this->maxSize = MAX_SIZE;
+      this->count = size;
+    }
+
+    void push_back(const T& value) {
+      if (this->count < this->maxSize) this->values[this->count++] = value;
+    }
+    void clear() { this->count = 0; }
+    size_t size() const { return this->count; }
+    size_t max_size() const { return this->maxSize; }
+    T& operator[](size_t i) { return this->values[i]; }
+    const T& operator[](size_t i) const { return this->values[i]; }
+
+  private:
+    T*     values = NULL;
+    size_t maxSize = 0;
+    size_t count = 0;
+};
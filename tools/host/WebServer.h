@@ -0,0 +1,191 @@
+// The ESP32 WebServer on a real loopback socket, for tools/cache_test.cpp. One
+// request per handleClient() call, read whole and answered before it returns,
+// and the connection is closed after every answer the way the sketch's peers
+// use it. Only what ModelCache needs: GET handlers, collected request headers,
+// extra response headers and a body written after send().
+#pragma once
+#include <Arduino.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <functional>
+
+typedef enum { HTTP_ANY, HTTP_GET } HTTPMethod;
+
+#define WEB_SERVER_HANDLERS  4
+#define WEB_SERVER_HEADERS   4
+#define WEB_SERVER_REQUEST 2048
+
+class WebServerClient : public Print {
+  public:
+    using Print::write;
+    size_t write(const uint8_t* data, size_t len) override {
+      size_t sent = 0;
+      while (this->fd >= 0 && sent < len) {
+        ssize_t n = ::send(this->fd, data + sent, len - sent, MSG_NOSIGNAL);
+        if (n <= 0) break;
+        sent += n;
+      }
+      return sent;
+    }
+
+    int fd = -1;
+};
+
+class WebServer {
+  public:
+    WebServer(uint16_t port) : port(port) {}
+    ~WebServer() {
+      if (this->listenFd >= 0) close(this->listenFd);
+    }
+
+    void collectHeaders(const char* keys[], size_t count) {
+      this->keyCount = count < WEB_SERVER_HEADERS ? count : WEB_SERVER_HEADERS;
+      for (size_t i = 0; i < this->keyCount; i++) {
+        this->keys[i] = keys[i];
+      }
+    }
+
+    void on(const char* uri, HTTPMethod method, std::function<void()> handler) {
+      if (this->handlerCount == WEB_SERVER_HANDLERS) return;
+      this->handlers[this->handlerCount].uri = uri;
+      this->handlers[this->handlerCount].method = method;
+      this->handlers[this->handlerCount++].handler = handler;
+    }
+
+    void begin() {
+      this->listenFd = socket(AF_INET, SOCK_STREAM, 0);
+      int yes = 1;
+      setsockopt(this->listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+      sockaddr_in addr = {};
+      addr.sin_family = AF_INET;
+      addr.sin_port = htons(this->port);
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      if (bind(this->listenFd, (sockaddr*)&addr, sizeof(addr)) || listen(this->listenFd, 4)) {
+        Serial.printf("WebServer: cannot listen on port %d\n", this->port);
+        close(this->listenFd);
+        this->listenFd = -1;
+      }
+    }
+
+    // Answers one waiting request, if there is one
+    void handleClient() {
+      pollfd p = { this->listenFd, POLLIN, 0 };
+      if (this->listenFd < 0 || poll(&p, 1, 0) <= 0) return;
+      this->conn.fd = accept(this->listenFd, NULL, NULL);
+      if (this->conn.fd < 0) return;
+
+      char method[8], uri[64];
+      if (readRequest() && sscanf(this->request, "%7s %63s", method, uri) == 2) {
+        this->contentLength = -1;
+        this->extra[0] = '\0';
+        Handler* h = NULL;
+        for (int i = 0; i < this->handlerCount; i++) {
+          if (!strcmp(this->handlers[i].uri, uri) &&
+              (this->handlers[i].method == HTTP_ANY || !strcmp(method, "GET"))) {
+            h = &this->handlers[i];
+          }
+        }
+        if (h) {
+          h->handler();
+        } else {
+          send(404, "text/plain", "Not found");
+        }
+      }
+      close(this->conn.fd);
+      this->conn.fd = -1;
+    }
+
+    String header(const char* name) {
+      for (size_t i = 0; i < this->keyCount; i++) {
+        if (!strcasecmp(this->keys[i], name)) {
+          return headerValue(name);
+        }
+      }
+      return String();
+    }
+
+    void sendHeader(const char* name, const char* value) {
+      size_t used = strlen(this->extra);
+      snprintf(this->extra + used, sizeof(this->extra) - used, "%s: %s\r\n", name, value);
+    }
+
+    void setContentLength(size_t len) { this->contentLength = len; }
+
+    void send(int code, const char* contentType = NULL, const char* content = "") {
+      char head[512];
+      size_t len = this->contentLength >= 0 ? (size_t)this->contentLength : strlen(content);
+      int n = snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\n%s", code, reason(code), this->extra);
+      if (contentType) {
+        n += snprintf(head + n, sizeof(head) - n, "Content-Type: %s\r\n", contentType);
+      }
+      n += snprintf(head + n, sizeof(head) - n, "Content-Length: %u\r\nConnection: close\r\n\r\n", (unsigned)len);
+      this->conn.write((const uint8_t*)head, n);
+      this->conn.print(content);
+    }
+
+    WebServerClient& client() { return this->conn; }
+
+  private:
+    typedef struct Handler {
+      const char*           uri;
+      HTTPMethod            method;
+      std::function<void()> handler;
+    } Handler;
+
+    // Up to the blank line, a client gets a second to send it
+    bool readRequest() {
+      size_t len = 0;
+      while (len < sizeof(this->request) - 1) {
+        pollfd p = { this->conn.fd, POLLIN, 0 };
+        if (poll(&p, 1, 1000) <= 0) return false;
+        ssize_t n = recv(this->conn.fd, this->request + len, sizeof(this->request) - 1 - len, 0);
+        if (n <= 0) return false;
+        len += n;
+        this->request[len] = '\0';
+        if (strstr(this->request, "\r\n\r\n")) return true;
+      }
+      return false;
+    }
+
+    String headerValue(const char* name) {
+      size_t nameLen = strlen(name);
+      for (const char* line = strstr(this->request, "\r\n"); line; line = strstr(line + 2, "\r\n")) {
+        const char* start = line + 2;
+        if (!strncasecmp(start, name, nameLen) && start[nameLen] == ':') {
+          start += nameLen + 1;
+          while (*start == ' ') start++;
+          char value[128];
+          size_t n = strcspn(start, "\r\n");
+          if (n >= sizeof(value)) n = sizeof(value) - 1;
+          memcpy(value, start, n);
+          value[n] = '\0';
+          return String(value);
+        }
+      }
+      return String();
+    }
+
+    static const char* reason(int code) {
+      switch (code) {
+        case 200: return "OK";
+        case 304: return "Not Modified";
+        case 404: return "Not Found";
+        case 503: return "Service Unavailable";
+      }
+      return "";
+    }
+
+    uint16_t        port;
+    int             listenFd = -1;
+    WebServerClient conn;
+    Handler         handlers[WEB_SERVER_HANDLERS];
+    int             handlerCount = 0;
+    const char*     keys[WEB_SERVER_HEADERS];
+    size_t          keyCount = 0;
+    char            request[WEB_SERVER_REQUEST];
+    char            extra[256];
+    long            contentLength = -1;
+};
@@ -0,0 +1,29 @@
+// The WiFi object, for the host tools. A harness running several displays in
+// separate processes gives each its own MAC address. Names are not looked up,
+// every host is loopback and the harness answers whatever is sent to it. A
+// WiFiServer never has a connection waiting.
+#pragma once
+#include <IPAddress.h>
+#include <WiFiClient.h>
+
+class WiFiClass {
+  public:
+    void macAddress(uint8_t* mac) const { memcpy(mac, this->mac, sizeof(this->mac)); }
+    IPAddress localIP() const { return IPAddress(127, 0, 0, 1); }
+    int hostByName(const char*, IPAddress& ip) const {
+      ip = IPAddress(127, 0, 0, 1);
+      return 1;
+    }
+
+    uint8_t mac[6] = { 0x24, 0x6f, 0x28, 0x00, 0x00, 0x01 };
+};
+
+class WiFiServer {
+  public:
+    WiFiServer(uint16_t) {}
+    void begin() {}
+    void setNoDelay(bool) {}
+    WiFiClient available() { return WiFiClient(); }
+};
+
+inline WiFiClass WiFi;
@@ -0,0 +1,147 @@
+// WiFiClient for the host tools. HTTPClient opens one on the harness's
+// response and the body arrives in TCP segments at a simulated rate, holding a
+// pbuf on the simulated heap from its arrival until it has been read. A client
+// that was never opened is a closed connection: what is written to it goes
+// nowhere, for ScreenServer's viewer.
+#pragma once
+#include <Arduino.h>
+#include <IPAddress.h>
+
+#define HOST_TCP_MSS        1436
+#define HOST_TCP_WINDOW        4   // segments in flight
+#define HOST_PBUF_OVERHEAD    16
+
+// What the harness answers a GET with. The body is sent as it is, with its
+// chunk framing when chunked is set, in segments of segmentBytes (HOST_TCP_MSS
+// when 0). The connection drops after cutAt bytes, and after stallAt bytes it
+// stays open but nothing more arrives.
+typedef struct HostResponse {
+  int         code;
+  const char* body;
+  size_t      length;
+  bool        chunked;
+  size_t      cutAt;
+  size_t      stallAt;
+  uint16_t    segmentBytes;
+  uint32_t    bytesPerSecond;
+  uint32_t    latencyMs;      // connect to the status line
+  const char* etag;           // the ETag header, if any
+  const char* request;        // in: the header lines addHeader() added, for a responder that forwards the GET
+} HostResponse;
+
+class WiFiClient : public Print {
+  public:
+    ~WiFiClient() { stop(); }
+
+    explicit operator bool() const { return this->open_; }
+    void setNoDelay(bool) {}
+    IPAddress remoteIP() const { return IPAddress(127, 0, 0, 1); }
+    size_t write(const uint8_t*, size_t len) override { return len; }
+    using Print::write;
+    void flush() override {}
+
+    void open(const HostResponse& r) {
+      this->data = r.body;
+      this->total = r.cutAt < r.length ? r.cutAt : r.length;
+      this->sendable = r.stallAt < this->total ? r.stallAt : this->total;
+      this->segment = r.segmentBytes ? r.segmentBytes : HOST_TCP_MSS;
+      this->bytesPerSecond = r.bytesPerSecond ? r.bytesPerSecond : 1;
+      this->startMs = millis();
+      this->arrived = 0;
+      this->consumed = 0;
+      this->open_ = true;
+    }
+
+    int available() {
+      arrive();
+      return this->arrived - this->consumed;
+    }
+
+    bool connected() {
+      arrive();
+      return this->open_ && (this->arrived < this->total || this->consumed < this->arrived);
+    }
+
+    // Stream::readBytes, waits up to a second for each piece
+    size_t readBytes(uint8_t* buffer, size_t size) {
+      size_t n = 0;
+      uint32_t startMs = millis();
+      while (n < size && millis() - startMs < 1000) {
+        int got = read(buffer + n, size - n);
+        if (got > 0) {
+          n += got;
+          startMs = millis();
+        } else if (!connected()) {
+          break;
+        } else {
+          delay(1);
+        }
+      }
+      return n;
+    }
+
+    int read() {
+      uint8_t c;
+      return read(&c, 1) == 1 ? c : -1;
+    }
+
+    int read(uint8_t* buffer, size_t size) {
+      arrive();
+      size_t n = this->arrived - this->consumed;
+      if (n > size) n = size;
+      memcpy(buffer, this->data + this->consumed, n);
+      this->consumed += n;
+      // A pbuf goes back to lwIP once all of it has been read
+      while (this->pbufCount && this->pbufEnd[0] <= this->consumed) {
+        free(this->pbufs[0]);
+        memmove(this->pbufs, this->pbufs + 1, (this->pbufCount - 1) * sizeof(this->pbufs[0]));
+        memmove(this->pbufEnd, this->pbufEnd + 1, (this->pbufCount - 1) * sizeof(this->pbufEnd[0]));
+        this->pbufCount--;
+      }
+      return n;
+    }
+
+    void stop() {
+      while (this->pbufCount) {
+        free(this->pbufs[--this->pbufCount]);
+      }
+      this->open_ = false;
+    }
+
+    static bool platformHeap;
+
+  private:
+    // Segments the sender has put on the wire by now, as far as the window allows
+    void arrive() {
+      if (!this->open_) return;
+      uint64_t sent = (uint64_t)(millis() - this->startMs) * this->bytesPerSecond / 1000;
+      if (sent > this->sendable) sent = this->sendable;
+      while (this->arrived < sent && this->pbufCount < HOST_TCP_WINDOW &&
+             (sent == this->sendable || this->arrived + this->segment <= sent)) {
+        size_t n = this->sendable - this->arrived < this->segment ? this->sendable - this->arrived : this->segment;
+        if (platformHeap) {
+          HeapTag tag("pbuf");
+          void* pbuf = malloc(n + HOST_PBUF_OVERHEAD);
+          if (!pbuf) break;   // lwIP drops the segment, the sender tries again
+          this->pbufs[this->pbufCount] = pbuf;
+          this->pbufEnd[this->pbufCount++] = this->arrived + n;
+        }
+        this->arrived += n;
+      }
+    }
+
+    const char* data = NULL;
+    size_t   total = 0;
+    size_t   sendable = 0;     // what arrives before the stall, total without one
+    size_t   segment = HOST_TCP_MSS;
+    size_t   arrived = 0;
+    size_t   consumed = 0;
+    uint32_t bytesPerSecond = 1;
+    uint32_t startMs = 0;
+    bool     open_ = false;
+    void*    pbufs[HOST_TCP_WINDOW];
+    uint32_t pbufEnd[HOST_TCP_WINDOW];
+    uint8_t  pbufCount = 0;
+};
+
+inline bool WiFiClient::platformHeap = true;
@@ -0,0 +1,179 @@
+// WiFiUDP multicast on a real socket, for tools/peer_test.cpp. The group is
+// joined on loopback, so displays run as processes on one host hear each
+// other. Only what PeerPush and SntpClock use.
+//
+// WiFiUDP::sendFilter, when set, sees every packet before it goes out and
+// returning false drops it, the way a packet lost on the LAN would be.
+//
+// Unicast packets go to WiFiUDP::unicast instead of a socket, and the harness
+// answers with deliver(), for tools/sntp_test.cpp.
+//
+// As in the ESP32 core, a packet is held from parsePacket() until it has been
+// read to the end or flushed, and parsePacket() returns 0 meanwhile.
+#pragma once
+#include <IPAddress.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define WIFI_UDP_MAX 1500
+
+#define WIFI_UDP_INBOX  8
+
+class WiFiUDP;
+typedef bool (*HostSendFilter)(const uint8_t* data, size_t len);
+typedef void (*HostUnicast)(WiFiUDP* udp, IPAddress ip, uint16_t port, const uint8_t* data, size_t len);
+
+class WiFiUDP {
+  public:
+    ~WiFiUDP() { stop(); }
+
+    uint8_t beginMulticast(IPAddress group, uint16_t port) {
+      stop();
+      this->fd = socket(AF_INET, SOCK_DGRAM, 0);
+      int yes = 1;
+      setsockopt(this->fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+      sockaddr_in addr = {};
+      addr.sin_family = AF_INET;
+      addr.sin_port = htons(port);
+      addr.sin_addr.s_addr = htonl(INADDR_ANY);
+      ip_mreq join = {};
+      join.imr_multiaddr.s_addr = address(group);
+      join.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+      in_addr loopback = { htonl(INADDR_LOOPBACK) };
+      if (bind(this->fd, (sockaddr*)&addr, sizeof(addr)) ||
+          setsockopt(this->fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &join, sizeof(join)) ||
+          setsockopt(this->fd, IPPROTO_IP, IP_MULTICAST_IF, &loopback, sizeof(loopback)) ||
+          setsockopt(this->fd, IPPROTO_IP, IP_MULTICAST_LOOP, &yes, sizeof(yes))) {
+        stop();
+        return 0;
+      }
+      fcntl(this->fd, F_SETFL, O_NONBLOCK);
+      this->group = group;
+      this->port = port;
+      return 1;
+    }
+
+    int beginMulticastPacket() {
+      this->txLen = 0;
+      this->toHost = false;
+      return this->fd >= 0;
+    }
+
+    uint8_t begin(uint16_t port) {
+      this->port = port;
+      return 1;
+    }
+
+    int beginPacket(IPAddress ip, uint16_t port) {
+      this->txLen = 0;
+      this->toHost = true;
+      this->host = ip;
+      this->hostPort = port;
+      return unicast != NULL;
+    }
+
+    // Queue a packet as if it had arrived from the last unicast destination
+    void deliver(const uint8_t* data, size_t len) {
+      if (this->inboxCount >= WIFI_UDP_INBOX || len > WIFI_UDP_MAX) return;
+      Packet& p = this->inbox[(this->inboxFirst + this->inboxCount++) % WIFI_UDP_INBOX];
+      memcpy(p.data, data, len);
+      p.len = len;
+    }
+
+    size_t write(const uint8_t* data, size_t len) {
+      if (len > sizeof(this->tx) - this->txLen) len = sizeof(this->tx) - this->txLen;
+      memcpy(this->tx + this->txLen, data, len);
+      this->txLen += len;
+      return len;
+    }
+
+    int endPacket() {
+      if (this->toHost) {
+        if (!unicast) return 0;
+        unicast(this, this->host, this->hostPort, this->tx, this->txLen);
+        return 1;
+      }
+      if (this->fd < 0) return 0;
+      if (sendFilter && !sendFilter(this->tx, this->txLen)) return 1;
+      sockaddr_in to = {};
+      to.sin_family = AF_INET;
+      to.sin_port = htons(this->port);
+      to.sin_addr.s_addr = address(this->group);
+      return sendto(this->fd, this->tx, this->txLen, 0, (sockaddr*)&to, sizeof(to)) == (ssize_t)this->txLen;
+    }
+
+    // Size of the next waiting packet, 0 if there is none
+    int parsePacket() {
+      if (this->rxPos < this->rxLen) return 0;
+      this->rxLen = this->rxPos = 0;
+      if (this->inboxCount) {
+        Packet& p = this->inbox[this->inboxFirst];
+        this->inboxFirst = (this->inboxFirst + 1) % WIFI_UDP_INBOX;
+        this->inboxCount--;
+        memcpy(this->rx, p.data, p.len);
+        this->rxLen = p.len;
+        this->remote = this->host;
+        return p.len;
+      }
+      if (this->fd < 0) return 0;
+      sockaddr_in from = {};
+      socklen_t fromLen = sizeof(from);
+      ssize_t n = recvfrom(this->fd, this->rx, sizeof(this->rx), 0, (sockaddr*)&from, &fromLen);
+      if (n <= 0) return 0;
+      uint32_t ip = ntohl(from.sin_addr.s_addr);
+      this->remote = IPAddress(ip >> 24, ip >> 16, ip >> 8, ip);
+      this->rxLen = n;
+      return n;
+    }
+
+    int read(uint8_t* buffer, size_t len) {
+      size_t n = this->rxLen - this->rxPos;
+      if (n > len) n = len;
+      memcpy(buffer, this->rx + this->rxPos, n);
+      this->rxPos += n;
+      return n;
+    }
+
+    void flush() { this->rxPos = this->rxLen; }
+    IPAddress remoteIP() const { return this->remote; }
+
+    void stop() {
+      if (this->fd >= 0) close(this->fd);
+      this->fd = -1;
+    }
+
+    static HostSendFilter sendFilter;
+    static HostUnicast    unicast;
+
+  private:
+    typedef struct Packet {
+      uint8_t data[WIFI_UDP_MAX];
+      size_t  len;
+    } Packet;
+
+    static in_addr_t address(const IPAddress& ip) {
+      return htonl((uint32_t)ip[0] << 24 | (uint32_t)ip[1] << 16 | (uint32_t)ip[2] << 8 | ip[3]);
+    }
+
+    int       fd = -1;
+    IPAddress group;
+    uint16_t  port = 0;
+    IPAddress remote;
+    uint8_t   tx[WIFI_UDP_MAX];
+    size_t    txLen = 0;
+    uint8_t   rx[WIFI_UDP_MAX];
+    size_t    rxLen = 0;
+    size_t    rxPos = 0;
+    bool      toHost = false;
+    IPAddress host;
+    uint16_t  hostPort = 0;
+    Packet    inbox[WIFI_UDP_INBOX];
+    int       inboxFirst = 0;
+    int       inboxCount = 0;
+};
+
+inline HostSendFilter WiFiUDP::sendFilter = NULL;
+inline HostUnicast    WiFiUDP::unicast = NULL;
@@ -0,0 +1,69 @@
+// The Arduino Wire (I2C) master with one device on the bus, for
+// tools/gesture_test.cpp. The device is a register file: a write sets the
+// register pointer and stores any further bytes from there, a read returns
+// bytes from the pointer on. The harness fills the registers the way the
+// device would and counts transactions to see when the bus was used.
+#pragma once
+#include <Arduino.h>
+
+class TwoWire {
+  public:
+    bool begin(int sda = -1, int scl = -1) {
+      (void)sda;
+      (void)scl;
+      return true;
+    }
+
+    void beginTransmission(uint8_t address) {
+      this->target = address;
+      this->sent = 0;
+    }
+
+    size_t write(uint8_t value) {
+      if (this->target != this->address) return 0;
+      if (this->sent++ == 0) {
+        this->pointer = value;
+      } else {
+        this->registers[this->pointer++] = value;
+        this->writes++;
+      }
+      return 1;
+    }
+
+    uint8_t endTransmission(bool stop = true) {
+      (void)stop;
+      this->transactions++;
+      return this->target == this->address ? 0 : 2;   // 2 is a NACK on the address
+    }
+
+    uint8_t requestFrom(uint8_t address, uint8_t count) {
+      this->transactions++;
+      if (address != this->address) {
+        this->pending = 0;
+        return 0;
+      }
+      this->pending = count;
+      return count;
+    }
+
+    int read() {
+      if (!this->pending) return -1;
+      this->pending--;
+      return this->registers[this->pointer++];
+    }
+
+    int available() const { return this->pending; }
+
+    uint8_t  address = 0;          // the one device answering
+    uint8_t  registers[256] = {};
+    uint32_t transactions = 0;     // address phases seen, reads and writes
+    uint32_t writes = 0;           // register bytes written by the master
+
+  private:
+    uint8_t  target = 0;
+    uint8_t  pointer = 0;
+    uint8_t  sent = 0;
+    uint8_t  pending = 0;
+};
+
+inline TwoWire Wire;
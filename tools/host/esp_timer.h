@@ -0,0 +1,6 @@
+// esp_timer_get_time() for the host tools. The harness defines it, on its own
+// simulated timer.
+#pragma once
+#include <stdint.h>
+
+int64_t esp_timer_get_time();
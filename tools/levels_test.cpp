@@ -0,0 +1,189 @@
+// Checks the play level tables: tools/make_levels.py's output, the decoder
+// and classify().
+//
+//   g++ -std=gnu++17 -Wall -Wextra -I. -Itools/host -o /tmp/levels_test tools/levels_test.cpp PlayLevels.cpp
+//   /tmp/levels_test
+//
+// Run from the top of the repository, it runs tools/make_levels.py on
+// tools/levels/01646500.csv and reads the CSV itself for the reference bands.
+//
+// Checked:
+//   - make_levels.py's table decodes, is byte for byte data/levels/01646500.bin,
+//     and load() reads that file through SPIFFS
+//   - every stage from 0 to 10 ft in thousandths, and either side of every
+//     boundary, is in the band the CSV gives it; NaN and -inf are in the first
+//     band and +inf in the last
+//   - a table with a bad magic, a bad checksum, boundaries out of order or NaN,
+//     no bands or a byte past the end is refused, and the loaded table stays
+// The exit status is 1 if any check fails.
+#include "PlayLevels.h"
+#include "ByteCodec.h"
+#include <math.h>
+
+#define CSV_PATH   "tools/levels/01646500.csv"
+#define DATA_PATH  "data/levels/01646500.bin"
+#define BUILT_PATH "/tmp/levels_test.bin"
+
+/***************************************************************************************
+**                          Host runtime
+***************************************************************************************/
+uint32_t millis() { return 0; }
+uint32_t micros() { return 0; }
+void delay(uint32_t) {}
+
+HardwareSerial Serial;
+EspClass ESP;
+uint32_t EspClass::getFreeHeap() { return 0; }
+uint32_t EspClass::getMaxAllocHeap() { return 0; }
+uint32_t EspClass::getMinFreeHeap() { return 0; }
+const char* volatile heapTag = NULL;
+
+/***************************************************************************************
+**                          Reference
+***************************************************************************************/
+typedef struct Band {
+  float below;      // INFINITY for the last
+  char  name[PLAY_LEVELS_NAME_MAX];
+} Band;
+
+static Band bands[PLAY_LEVELS_MAX];
+static int  bandCount = 0;
+
+// The CSV as make_levels.py reads it: "below, colour, name", # comments
+static bool readCsv(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  char line[128];
+  while (fgets(line, sizeof(line), f) && bandCount < PLAY_LEVELS_MAX) {
+    char* p = line + strspn(line, " \t");
+    if (*p == '#' || *p == '\n' || !*p) continue;
+    Band& b = bands[bandCount++];
+    b.below = *p == ',' ? INFINITY : strtof(p, NULL);
+    char* name = strchr(strchr(p, ',') + 1, ',') + 1;
+    name += strspn(name, " \t");
+    name[strcspn(name, "\r\n")] = '\0';
+    snprintf(b.name, sizeof(b.name), "%s", name);
+  }
+  fclose(f);
+  return bandCount > 0;
+}
+
+// The band a stage is in, straight from the CSV
+static int referenceBand(float stage) {
+  int band = 0;
+  while (band < bandCount - 1 && stage >= bands[band].below) band++;
+  return band;
+}
+
+static size_t readFile(const char* path, uint8_t* buf, size_t cap) {
+  FILE* f = fopen(path, "rb");
+  if (!f) return 0;
+  size_t n = fread(buf, 1, cap, f);
+  fclose(f);
+  return n;
+}
+
+/***************************************************************************************
+**                          Checks
+***************************************************************************************/
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) failures++;
+}
+
+// A table in the file layout, the checksum over whatever was written
+static size_t table(uint8_t* buf, const char* magic, uint8_t count, const float* bounds, bool trailing) {
+  ByteWriter w(buf, PLAY_LEVELS_FILE_MAX);
+  w.putBytes(magic, 3);
+  w.put8(PLAY_LEVELS_VERSION);
+  w.put8(count);
+  for (int i = 0; i + 1 < count; i++) w.putFloat(bounds[i]);
+  for (int i = 0; i < count; i++) {
+    w.put16(0x07E0);
+    w.putStr("Band");
+  }
+  if (trailing) w.put8(0);
+  w.put32(fnv1a32(buf, w.length()));
+  return w.length();
+}
+
+int main() {
+  char what[160];
+  check(readCsv(CSV_PATH), "the Little Falls CSV reads");
+  check(system("python3 tools/make_levels.py " CSV_PATH " " BUILT_PATH " > /dev/null") == 0,
+        "make_levels.py builds the Little Falls table");
+
+  uint8_t built[PLAY_LEVELS_FILE_MAX], shipped[PLAY_LEVELS_FILE_MAX];
+  size_t builtLen = readFile(BUILT_PATH, built, sizeof(built));
+  size_t shippedLen = readFile(DATA_PATH, shipped, sizeof(shipped));
+  check(builtLen && builtLen == shippedLen && !memcmp(built, shipped, builtLen),
+        DATA_PATH " is what make_levels.py makes of the CSV");
+
+  PlayLevels levels;
+  bool decoded = levels.decode(built, builtLen);
+  snprintf(what, sizeof(what), "the table decodes to %d bands, the CSV has %d", levels.bandCount(), bandCount);
+  check(decoded && levels.bandCount() == bandCount, what);
+  PlayLevels loaded;
+  check(loaded.load("/levels/01646500.bin") && loaded.bandCount() == bandCount, "load() reads it from SPIFFS");
+
+  // 0 to 10 ft, then just either side of each boundary
+  int wrong = 0, checked = 0;
+  float firstWrong = NAN;
+  auto classifies = [&](float stage) {
+    int want = referenceBand(stage);
+    int got = levels.classify(stage);
+    checked++;
+    if (got != want || strcmp(levels.name(stage), bands[want].name)) {
+      if (!wrong++) firstWrong = stage;
+    }
+  };
+  for (int i = 0; i <= 10000; i++) classifies(i / 1000.0f);
+  for (int i = 0; i < bandCount - 1; i++) {
+    classifies(bands[i].below);
+    classifies(nextafterf(bands[i].below, -INFINITY));
+    classifies(nextafterf(bands[i].below, INFINITY));
+  }
+  int n = snprintf(what, sizeof(what), "%d of %d stages are in the wrong band", wrong, checked);
+  if (wrong) snprintf(what + n, sizeof(what) - n, ", first %.4f ft", firstWrong);
+  check(!wrong, what);
+  check(levels.classify(NAN) == 0 && !strcmp(levels.name(NAN), bands[0].name), "a NaN stage is in the first band");
+  check(levels.classify(-INFINITY) == 0, "-inf is in the first band");
+  check(!strcmp(levels.name(INFINITY), bands[bandCount - 1].name) &&
+        levels.color(INFINITY) == levels.bandColor(bandCount - 1), "+inf is in the last band");
+
+  // Each bad table is refused and the Little Falls one stays
+  uint8_t buf[PLAY_LEVELS_FILE_MAX];
+  const float good[3] = { 1.0f, 2.0f, 3.0f };
+  const float outOfOrder[3] = { 1.0f, 3.0f, 2.0f };
+  const float repeated[3] = { 1.0f, 2.0f, 2.0f };
+  const float withNan[3] = { 1.0f, NAN, 3.0f };
+  check(levels.decode(buf, table(buf, "PLV", 4, good, false)) && levels.bandCount() == 4, "a well formed table decodes");
+  levels.decode(built, builtLen);
+
+  typedef struct Bad {
+    const char* what;
+    size_t      len;
+  } Bad;
+  Bad bad[7];
+  uint8_t bufs[7][PLAY_LEVELS_FILE_MAX];
+  bad[0] = { "a bad magic", table(bufs[0], "PLW", 4, good, false) };
+  bad[1] = { "a bad checksum", table(bufs[1], "PLV", 4, good, false) };
+  bufs[1][6] ^= 0x01;
+  bad[2] = { "boundaries out of order", table(bufs[2], "PLV", 4, outOfOrder, false) };
+  bad[3] = { "a repeated boundary", table(bufs[3], "PLV", 4, repeated, false) };
+  bad[4] = { "a NaN boundary", table(bufs[4], "PLV", 4, withNan, false) };
+  bad[5] = { "no bands", table(bufs[5], "PLV", 0, good, false) };
+  bad[6] = { "a byte past the end", table(bufs[6], "PLV", 4, good, true) };
+  for (int i = 0; i < 7; i++) {
+    bool refused = !levels.decode(bufs[i], bad[i].len);
+    snprintf(what, sizeof(what), "a table with %s is refused and the current one kept", bad[i].what);
+    check(refused && levels.bandCount() == bandCount && !strcmp(levels.name(4.0f), bands[referenceBand(4.0f)].name), what);
+  }
+  shipped[shippedLen] = 0;
+  check(!levels.decode(shipped, shippedLen + 1), "the shipped table with a byte after its checksum is refused");
+
+  printf("%s: %d checks failed\n", failures ? "FAIL" : "PASS", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""Build a play level table for the display from a CSV.
+
+    tools/make_levels.py tools/levels/01646500.csv data/levels/01646500.bin
+
+Each CSV row is "below, colour, name": the band runs up to but not including
+"below" feet, and the last row leaves "below" empty. Colours are TFT_eSPI
+names (green, yellow, ...) or RGB565 hex like 0x07E0. Blank lines and lines
+starting with # are skipped. See PlayLevels.h for the binary layout.
+"""
+
+import csv
+import struct
+import sys
+
+VERSION = 1
+BANDS_MAX = 16
+NAME_MAX = 15
+
+COLOURS = {
+    "black": 0x0000, "navy": 0x000F, "darkgreen": 0x03E0, "darkcyan": 0x03EF,
+    "maroon": 0x7800, "purple": 0x780F, "olive": 0x7BE0, "lightgrey": 0xD69A,
+    "darkgrey": 0x7BEF, "blue": 0x001F, "green": 0x07E0, "cyan": 0x07FF,
+    "red": 0xF800, "magenta": 0xF81F, "yellow": 0xFFE0, "white": 0xFFFF,
+    "orange": 0xFDA0, "greenyellow": 0xB7E0, "pink": 0xFE19,
+}
+
+
+def fnv1a32(data):
+    h = 2166136261
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def colour(text):
+    text = text.strip().lower()
+    if text.startswith("0x"):
+        return int(text, 16)
+    return COLOURS[text]
+
+
+def read_bands(path):
+    bands = []
+    with open(path, newline="") as f:
+        for row in csv.reader(f):
+            if not row or not "".join(row).strip() or row[0].lstrip().startswith("#"):
+                continue
+            below, col, name = (field.strip() for field in row)
+            bands.append((float(below) if below else None, colour(col), name))
+    return bands
+
+
+def check(bands):
+    if not 1 <= len(bands) <= BANDS_MAX:
+        sys.exit("need 1 to %d bands, got %d" % (BANDS_MAX, len(bands)))
+    bounds = [b[0] for b in bands[:-1]]
+    if None in bounds or bands[-1][0] is not None:
+        sys.exit("only the last band may, and must, have no upper boundary")
+    if any(a >= b for a, b in zip(bounds, bounds[1:])):
+        sys.exit("boundaries must be ascending")
+    for _, _, name in bands:
+        if len(name.encode()) > NAME_MAX:
+            sys.exit("name longer than %d bytes: %s" % (NAME_MAX, name))
+
+
+def encode(bands):
+    out = bytearray(b"PLV") + struct.pack("<BB", VERSION, len(bands))
+    for below, _, _ in bands[:-1]:
+        out += struct.pack("<f", below)
+    for _, col, name in bands:
+        raw = name.encode()
+        out += struct.pack("<HB", col, len(raw)) + raw
+    out += struct.pack("<I", fnv1a32(out))
+    return bytes(out)
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    bands = read_bands(sys.argv[1])
+    check(bands)
+    data = encode(bands)
+    with open(sys.argv[2], "wb") as f:
+        f.write(data)
+    print("%s: %d bands, %d bytes" % (sys.argv[2], len(bands), len(data)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,223 @@
+// Runs NetScheduler against a simulated clock and compares its wake windows
+// with the independent fixed-interval tasks it replaced.
+//
+//   g++ -O2 -I. -Itools/host tools/net_sim.cpp NetScheduler.cpp -o /tmp/net_sim && /tmp/net_sim [days] [seeds]
+//
+// The four sources have the sketch's intervals and tolerances, NTP at its
+// shortest poll interval. A fetch takes 1.5 to 4.5 s and one in 20 fails, after
+// which the source tries again a minute later. The fixed tasks each fire on
+// their own interval, and a fetch that comes due while another runs waits for
+// it, so the radio is woken once per run of back to back fetches. The windowed
+// run drives the scheduler the way runNetWindow() does. The clock starts half an
+// hour before millis() wraps.
+//
+// Each run is repeated with seeds 1 to seeds (5 by default). Radio on is the
+// time from the start of a window's first fetch to the end of its last; before
+// the scheduler the radio stayed at full power all hour. 7 days x 5 seeds:
+//
+//                 windows/h  radio on s/h  longest s   USGS/h  NWS/h  OWM/h  NTP/h
+//   fixed tasks     11.24        34.4         16.7      3.14   4.20   2.10   2.10
+//   windowed         5.64        34.5         16.7      3.14   4.19   2.09   2.12
+//
+// Checked:
+//   - the windowed run wakes the radio under 60% as often
+//   - every source polls as often as its fixed task, to within 3%
+//   - no source runs before its due time less its early tolerance
+//   - no source starts later than its due time plus its late tolerance and the
+//     fetches ahead of it in the window
+//   - a source that rode along early keeps its cadence from its due time, and
+//     a requested refresh opens a window at once
+// The exit status is 1 if any check fails.
+#include "NetScheduler.h"
+#include <Print.h>
+#include <stdlib.h>
+
+#define SOURCES       4
+#define RETRY_MS      (60 * 1000)
+#define FETCH_MIN_MS  1500
+#define FETCH_MAX_MS  4500
+#define START_MS      (0xFFFFFFFFu - 30 * 60 * 1000)
+
+typedef struct Config {
+  const char* name;
+  uint32_t    intervalMs;
+  uint32_t    earlyMs;
+  uint32_t    lateMs;
+} Config;
+
+// As in setup() in RiverWeather.ino
+static const Config configs[SOURCES] = {
+  { "USGS",        20 * 60 * 1000,  1 * 60 * 1000,  2 * 60 * 1000 },
+  { "NWS",         15 * 60 * 1000,  5 * 60 * 1000,  2 * 60 * 1000 },
+  { "OpenWeather", 30 * 60 * 1000, 10 * 60 * 1000,  5 * 60 * 1000 },
+  { "NTP",         30 * 60 * 1000, 10 * 60 * 1000, 10 * 60 * 1000 },
+};
+
+static uint32_t uniform(uint32_t lo, uint32_t hi) {
+  return lo + (uint32_t)(rand() % (hi - lo + 1));
+}
+
+// How long a fetch takes, and whether it worked
+static uint32_t fetch(bool* success) {
+  *success = rand() % 20 != 0;
+  return uniform(FETCH_MIN_MS, FETCH_MAX_MS);
+}
+
+typedef struct Result {
+  uint32_t windows;
+  uint64_t onMs;
+  uint32_t longestMs;
+  uint32_t fetches[SOURCES];
+  uint32_t early;       // fetches started before due less the early tolerance
+  uint32_t late;        // started after the deadline and the fetches ahead
+} Result;
+
+static void addWindow(Result& res, uint32_t onMs) {
+  res.windows++;
+  res.onMs += onMs;
+  if (onMs > res.longestMs) res.longestMs = onMs;
+}
+
+// Each source on its own timer, first due at the start
+static Result runFixed(uint32_t durationMs) {
+  Result res = {};
+  uint32_t next[SOURCES];
+  for (int i = 0; i < SOURCES; i++) next[i] = 0;
+  uint32_t t = 0;
+  while (true) {
+    int first = 0;
+    for (int i = 1; i < SOURCES; i++) {
+      if (next[i] < next[first]) first = i;
+    }
+    if (next[first] >= durationMs) break;
+    // The radio wakes for the first and stays up while fetches are waiting
+    t = next[first] > t ? next[first] : t;
+    uint32_t windowStart = t;
+    bool ran = true;
+    while (ran) {
+      ran = false;
+      for (int i = 0; i < SOURCES; i++) {
+        if (next[i] <= t && next[i] < durationMs) {
+          bool success;
+          t += fetch(&success);
+          res.fetches[i]++;
+          next[i] = success ? next[i] + configs[i].intervalMs : t + RETRY_MS;
+          ran = true;
+        }
+      }
+    }
+    addWindow(res, t - windowStart);
+  }
+  return res;
+}
+
+// The scheduler as runNetWindow() drives it
+static Result runWindowed(uint32_t durationMs) {
+  Result res = {};
+  NetScheduler scheduler;
+  for (int i = 0; i < SOURCES; i++) {
+    scheduler.configure(i, configs[i].name, configs[i].intervalMs, configs[i].earlyMs, configs[i].lateMs, START_MS);
+  }
+  uint32_t elapsed = 0;
+  while (elapsed < durationMs) {
+    uint32_t t = START_MS + elapsed;
+    if (!scheduler.beginWindow(t)) {
+      elapsed += scheduler.msUntilWindow(t) ? scheduler.msUntilWindow(t) : 1;
+      continue;
+    }
+    uint32_t windowStart = t;
+    uint8_t id;
+    while ((id = scheduler.nextInWindow()) != NET_SOURCE_NONE) {
+      const Config& c = configs[id];
+      int32_t dueIn = (int32_t)(scheduler.dueMs(id) - t);
+      if (dueIn > (int32_t)c.earlyMs) res.early++;
+      if (scheduler.lateMs(id, t) > c.lateMs + (t - windowStart)) res.late++;
+      bool success;
+      t += fetch(&success);
+      res.fetches[id]++;
+      if (success) {
+        scheduler.completed(id, t);
+      } else {
+        scheduler.schedule(id, t, RETRY_MS);
+      }
+    }
+    addWindow(res, t - windowStart);
+    elapsed = t - START_MS;
+  }
+  return res;
+}
+
+static void add(Result& total, const Result& r) {
+  total.windows += r.windows;
+  total.onMs += r.onMs;
+  if (r.longestMs > total.longestMs) total.longestMs = r.longestMs;
+  for (int i = 0; i < SOURCES; i++) total.fetches[i] += r.fetches[i];
+  total.early += r.early;
+  total.late += r.late;
+}
+
+static void print(const char* name, const Result& r, double hours) {
+  printf("  %-12s %6.2f windows/h  radio on %5.1f s/h  longest %5.1f s ", name, r.windows / hours,
+         r.onMs / 1000.0 / hours, r.longestMs / 1000.0);
+  for (int i = 0; i < SOURCES; i++) printf(" %s %.2f/h", configs[i].name, r.fetches[i] / hours);
+  printf("\n");
+}
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) failures++;
+}
+
+int main(int argc, char** argv) {
+  int days = argc > 1 ? atoi(argv[1]) : 7;
+  int seeds = argc > 2 ? atoi(argv[2]) : 5;
+  uint32_t durationMs = days * 24 * 60 * 60 * 1000u;
+
+  Result fixed = {}, windowed = {};
+  for (int seed = 1; seed <= seeds; seed++) {
+    srand(seed);
+    add(fixed, runFixed(durationMs));
+    srand(seed);
+    add(windowed, runWindowed(durationMs));
+  }
+
+  double hours = 24.0 * days * seeds;
+  printf("%d days x %d seeds\n", days, seeds);
+  print("fixed tasks", fixed, hours);
+  print("windowed", windowed, hours);
+
+  char what[120];
+  snprintf(what, sizeof(what), "the radio wakes %.2f times an hour, %.2f with fixed tasks", windowed.windows / hours,
+           fixed.windows / hours);
+  check(windowed.windows < fixed.windows * 0.6, what);
+  for (int i = 0; i < SOURCES; i++) {
+    snprintf(what, sizeof(what), "%s polls %u times, %u with its own task", configs[i].name, windowed.fetches[i],
+             fixed.fetches[i]);
+    check(windowed.fetches[i] <= fixed.fetches[i] * 1.03 && windowed.fetches[i] >= fixed.fetches[i] * 0.97, what);
+  }
+  snprintf(what, sizeof(what), "%u fetches ran earlier than their tolerance", windowed.early);
+  check(windowed.early == 0, what);
+  snprintf(what, sizeof(what), "%u fetches ran later than their tolerance", windowed.late);
+  check(windowed.late == 0, what);
+
+  // NWS rides along with OpenWeather 3 minutes early, then is due a whole
+  // interval after the time it was due, not after the time it ran
+  NetScheduler scheduler;
+  const uint32_t t0 = 1000;
+  scheduler.configure(0, "OpenWeather", 30 * 60 * 1000, 10 * 60 * 1000, 5 * 60 * 1000, t0);
+  scheduler.configure(1, "NWS", 15 * 60 * 1000, 5 * 60 * 1000, 2 * 60 * 1000, t0 + 8 * 60 * 1000);
+  uint32_t open = t0 + scheduler.msUntilWindow(t0);
+  bool both = scheduler.beginWindow(open) == 2 && scheduler.nextInWindow() == 0 && scheduler.nextInWindow() == 1 &&
+              scheduler.nextInWindow() == NET_SOURCE_NONE;
+  scheduler.completed(1, open + 3000);
+  check(both && scheduler.dueMs(1) == t0 + 23 * 60 * 1000, "a source that ran early keeps its cadence");
+  scheduler.completed(0, open + 6000);
+  scheduler.requestNow(1, open + 60 * 1000);
+  check(scheduler.msUntilWindow(open + 60 * 1000) == 0 && scheduler.beginWindow(open + 60 * 1000) == 1 &&
+        scheduler.nextInWindow() == 1, "a requested refresh opens a window at once");
+
+  printf("%s: %d checks failed\n", failures ? "FAIL" : "PASS", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+"""A local SNTP server with a known error, for checking the display's clock.
+
+    sudo tools/ntp_standin.py --offset 0.3 --drift-ppm 40 --delay 0.02 --jitter 0.05 --drop 0.2
+
+Point SNTP_SERVER in All_Settings.h at this machine. The served time is the
+host clock plus --offset seconds, running --drift-ppm fast, and each reply is
+held back by --delay plus a random part of up to --jitter seconds, all of it
+on the way back, so the round trip filter has something to reject. --drop
+ignores that share of the requests. 'n' on the display's serial monitor then
+shows the offset it measured and the frequency it settled on, which should
+come out near -drift-ppm * 1000 ppb against a host that keeps good time.
+"""
+
+import argparse
+import random
+import socket
+import struct
+import threading
+import time
+
+NTP_UNIX_OFFSET = 2208988800
+
+
+def to_ntp(t):
+    seconds = int(t)
+    fraction = int((t - seconds) * (1 << 32)) & 0xFFFFFFFF
+    return struct.pack("!II", seconds + NTP_UNIX_OFFSET, fraction)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--port", type=int, default=123)
+    parser.add_argument("--offset", type=float, default=0.0, help="seconds added to the host clock")
+    parser.add_argument("--drift-ppm", type=float, default=0.0, help="how fast the served clock runs")
+    parser.add_argument("--delay", type=float, default=0.0, help="seconds each reply is held back")
+    parser.add_argument("--jitter", type=float, default=0.0, help="up to this much more, at random")
+    parser.add_argument("--drop", type=float, default=0.0, help="share of requests left unanswered")
+    parser.add_argument("--stratum", type=int, default=2)
+    args = parser.parse_args()
+
+    start = time.time()
+
+    def served(t):
+        return t + args.offset + (t - start) * args.drift_ppm * 1e-6
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("", args.port))
+    print("Serving on port %d: offset %+.3f s, drift %+.1f ppm, delay %.3f+%.3f s, drop %.0f%%"
+          % (args.port, args.offset, args.drift_ppm, args.delay, args.jitter, args.drop * 100))
+
+    def reply(request, address, received):
+        time.sleep(args.delay + random.uniform(0, args.jitter))
+        version = (request[0] >> 3) & 0x07
+        packet = bytearray(48)
+        packet[0] = (version << 3) | 4          # no leap warning, server
+        packet[1] = args.stratum
+        packet[2] = request[2]                  # poll
+        packet[3] = 0xEC                        # precision, about 60 ns
+        packet[12:16] = b"LOCL"
+        packet[16:24] = to_ntp(served(received))  # reference time
+        packet[24:32] = request[40:48]            # origin is the client's transmit time
+        packet[32:40] = to_ntp(served(received))
+        packet[40:48] = to_ntp(served(time.time()))
+        sock.sendto(bytes(packet), address)
+        print("%s  %s" % (time.strftime("%H:%M:%S"), address[0]))
+
+    while True:
+        request, address = sock.recvfrom(512)
+        received = time.time()
+        if len(request) < 48 or (request[0] & 0x07) != 3:
+            continue
+        if random.random() < args.drop:
+            print("%s  %s dropped" % (time.strftime("%H:%M:%S"), address[0]))
+            continue
+        threading.Thread(target=reply, args=(request, address, received), daemon=True).start()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,432 @@
+// Times the OneCall extractor on weather payloads and measures what it uses
+// while parsing: heap, stack and its own state.
+//
+//   g++ -O2 -std=gnu++17 -Wall -Wextra -pthread -I. -Itools/host -o /tmp/parse_bench tools/parse_bench.cpp
+//       OneCall.cpp JsonStream.cpp StreamIngest.cpp FetchArena.cpp Metrics.cpp
+//   /tmp/parse_bench [dir]
+//
+// The payloads are the OneCall recordings tools/upstream_sim.py --record
+// saves under dir/openweather (tools/upstream by default). Two made up ones
+// are always run as well:
+//   - a response as the sketch asks for it, with minutely and alerts
+//     excluded, 48 hours and 8 days
+//   - the whole document, for a server that ignores exclude, with 61 minutes
+//     and an alert whose text is full of escapes and brackets in strings
+// Each payload is fed in chunks of 1, 7, 128 and 512 bytes (the sketch's
+// read size) and in one piece, repeated for at least 0.2 s.
+//
+// Checked:
+//   - every payload parses to a complete model, the same model whatever the
+//     chunk size
+//   - its hours match a plain double precision decode of the hourly array,
+//     with the strip cut at the first missing hour and at 48
+//   - a payload of edge values gives the expected compass sector, half unit
+//     wind speed and percent pop for each, a strip with hour 20 missing stops
+//     at 20 hours, one with 60 hours stops at 48, and the hours fit 248 bytes
+//   - the parse makes no heap allocations, malloc and operator new are counted
+//   - the stack the parse uses stays under ONE_CALL_STACK_MAX bytes, measured
+//     on a thread whose stack is painted first
+// The exit status is 1 if any check fails.
+#include "OneCall.h"
+#include <dirent.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#define ONE_CALL_STACK_MAX 2048   // most of it is the C library's atof()
+#define ONE_CALL_READ      512   // ONECALL_CHUNK in OneCall.cpp
+#define BENCH_MIN_NS       200000000ULL
+
+/***************************************************************************************
+**                          Host runtime
+***************************************************************************************/
+static uint64_t nowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static const uint64_t startNs = nowNs();
+
+uint32_t millis() { return (uint32_t)((nowNs() - startNs) / 1000000); }
+uint32_t micros() { return (uint32_t)((nowNs() - startNs) / 1000); }
+void delay(uint32_t ms) { usleep(ms * 1000); }
+
+HardwareSerial Serial;
+EspClass ESP;
+uint32_t EspClass::getFreeHeap() { return 0; }
+uint32_t EspClass::getMaxAllocHeap() { return 0; }
+uint32_t EspClass::getMinFreeHeap() { return 0; }
+const char* volatile heapTag = NULL;
+
+// Every allocation while counting is on, operator new included as it comes
+// through malloc
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* p, size_t size);
+}
+
+static volatile bool counting = false;
+static uint64_t allocations = 0;
+
+extern "C" void* malloc(size_t size) noexcept {
+  if (counting) allocations++;
+  return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n, size_t size) noexcept {
+  if (counting) allocations++;
+  return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* p, size_t size) noexcept {
+  if (counting) allocations++;
+  return __libc_realloc(p, size);
+}
+
+/***************************************************************************************
+**                          Payloads
+***************************************************************************************/
+typedef struct Payload {
+  std::string name;
+  std::string body;
+} Payload;
+
+static void appendf(std::string& out, const char* format, ...) __attribute__((format(printf, 2, 3)));
+static void appendf(std::string& out, const char* format, ...) {
+  char text[1024];
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  out.append(text, n < (int)sizeof(text) ? n : sizeof(text) - 1);
+}
+
+#define MADE_UP_NOW 1700000000UL
+
+// Laid out as OpenWeather sends it, with the values soak.cpp uses
+static std::string oneCallBody(bool whole) {
+  uint32_t now = MADE_UP_NOW;
+  int offset = -18000;
+  uint32_t midnight = (now + offset) / 86400 * 86400 - offset;
+  std::string out;
+  appendf(out, "{\"lat\":38.9494,\"lon\":-77.1278,\"timezone\":\"America/New_York\",\"timezone_offset\":%d,", offset);
+  appendf(out, "\"current\":{\"dt\":%u,\"sunrise\":%u,\"sunset\":%u,\"temp\":51.3,\"feels_like\":49.8,\"pressure\":1017,"
+               "\"humidity\":61,\"dew_point\":38.4,\"uvi\":0.9,\"clouds\":75,\"visibility\":10000,\"wind_speed\":6.5,"
+               "\"wind_deg\":290,\"weather\":[{\"id\":803,\"main\":\"Clouds\",\"description\":\"broken clouds\",\"icon\":\"04d\"}]},",
+          now, midnight + 6 * 3600 + 1800, midnight + 17 * 3600);
+  if (whole) {
+    out += "\"minutely\":[";
+    for (int i = 0; i < 61; i++) {
+      appendf(out, "%s{\"dt\":%u,\"precipitation\":%d}", i ? "," : "", now / 60 * 60 + i * 60, i > 40 ? 1 : 0);
+    }
+    out += "],";
+  }
+  out += "\"hourly\":[";
+  uint32_t hour = now / 3600 * 3600;
+  for (int i = 0; i < 48; i++) {
+    uint32_t t = hour + i * 3600;
+    double pop = (i % 17) / 20.0;
+    appendf(out, "%s{\"dt\":%u,\"temp\":%.2f,\"feels_like\":%.2f,\"pressure\":1012,\"humidity\":60,\"dew_point\":40.1,"
+                 "\"uvi\":0,\"clouds\":%d,\"visibility\":10000,\"wind_speed\":%.2f,\"wind_deg\":%d,\"wind_gust\":%.2f,"
+                 "\"weather\":[{\"id\":%d,\"main\":\"Clouds\",\"description\":\"broken clouds\",\"icon\":\"04n\"}],\"pop\":%.2f}",
+            i ? "," : "", t, 48 + 10 * sin(i / 3.8), 46 + 10 * sin(i / 3.8), (int)(pop * 100), 3 + 12 * pop,
+            i * 37 % 360, 8 + 15 * pop, pop > 0.5 ? 500 : 803, pop);
+  }
+  out += "],\"daily\":[";
+  for (int i = 0; i < 8; i++) {
+    uint32_t t = midnight + i * 86400 + 12 * 3600;
+    appendf(out, "%s{\"dt\":%u,\"sunrise\":%u,\"sunset\":%u,\"moonrise\":%u,\"moonset\":%u,\"moon_phase\":0.25,"
+                 "\"summary\":\"Expect a day of partly cloudy with rain\",\"temp\":{\"day\":%.2f,\"min\":%.2f,\"max\":%.2f,"
+                 "\"night\":%.2f,\"eve\":%.2f,\"morn\":%.2f},\"feels_like\":{\"day\":50.1,\"night\":40.2,\"eve\":47.3,"
+                 "\"morn\":39.9},\"pressure\":1015,\"humidity\":55,\"dew_point\":35.6,\"wind_speed\":9.4,\"wind_deg\":300,"
+                 "\"wind_gust\":18.2,\"weather\":[{\"id\":%d,\"main\":\"Rain\",\"description\":\"light rain\",\"icon\":\"10d\"}],"
+                 "\"clouds\":60,\"pop\":0.42,\"rain\":1.3,\"uvi\":2.8}",
+            i ? "," : "", t, t - 5 * 3600 - 1800, t + 5 * 3600, t + 2 * 3600, t - 9 * 3600, 55.0 + i, 40.0 + i, 60.0 + i,
+            44.0 + i, 52.0 + i, 41.0 + i, i % 2 ? 500 : 800);
+  }
+  out += "]";
+  if (whole) {
+    // Brackets, braces, quotes and a \u escape inside strings the extractor skips
+    out += ",\"alerts\":[{\"sender_name\":\"NWS Sterling VA\",\"event\":\"Flood Watch\",\"start\":1700010000,"
+           "\"end\":1700060000,\"description\":\"* WHAT...Flooding caused by \\\"excessive\\\" rainfall is possible.}]\\n"
+           "* WHERE...Portions of Maryland [including] {the} Potomac basin.\\n* WHEN...Through late tonight.\\u00b0\","
+           "\"tags\":[\"Flood\",\"]}\"]}]";
+  }
+  out += "}";
+  return out;
+}
+
+// Hourly values at the edges of the quantization, with what they decode to
+typedef struct HourEdge {
+  const char* windDeg;
+  const char* windSpeed;
+  const char* pop;
+  uint8_t     sector;
+  uint8_t     halfUnits;
+  uint8_t     percent;
+} HourEdge;
+
+static const HourEdge hourEdges[] = {
+  { "0",   "0",     "0",    0,   0,   0 },
+  { "11",  "3.24",  "0.2",  0,   6,  20 },
+  { "12",  "3.25",  "0.57", 1,   7,  57 },
+  { "180", "0.74",  "1",    8,   1, 100 },
+  { "348", "12.5",  "0.01", 15, 25,   1 },
+  { "349", "127.4", "0.99", 0, 255,  99 },
+  { "359", "200",   "0.3",  0, 255,  30 },
+  { "360", "7.75",  "0.05", 0,  16,   5 },
+};
+#define HOUR_EDGES (sizeof(hourEdges) / sizeof(hourEdges[0]))
+
+// The parts of a response the model needs, with hours hours of edge values and
+// the hour at gapAt (if any) missing from the timestamps
+static std::string hourlyEdgeBody(int hours, int gapAt) {
+  uint32_t now = MADE_UP_NOW;
+  uint32_t start = now / 3600 * 3600;
+  std::string out;
+  appendf(out, "{\"timezone_offset\":-18000,\"current\":{\"dt\":%u,\"sunrise\":%u,\"sunset\":%u,\"temp\":51.3,"
+               "\"weather\":[{\"id\":803,\"main\":\"Clouds\"}]},\"hourly\":[",
+          now, now - 3600, now + 3600);
+  for (int i = 0; i < hours; i++) {
+    const HourEdge& e = hourEdges[i % HOUR_EDGES];
+    uint32_t t = start + (gapAt && i >= gapAt ? i + 1 : i) * 3600;
+    appendf(out, "%s{\"dt\":%u,\"temp\":%d.4,\"wind_speed\":%s,\"wind_deg\":%s,\"rain\":{\"1h\":0.3},"
+                 "\"weather\":[{\"id\":500},{\"id\":701}],\"pop\":%s}",
+            i ? "," : "", t, 40 + i, e.windSpeed, e.windDeg, e.pop);
+  }
+  appendf(out, "],\"daily\":[{\"dt\":%u,\"temp\":{\"min\":40.1,\"max\":60.2},\"weather\":[{\"id\":500}]}]}",
+          now);
+  return out;
+}
+
+// The hourly array decoded the plain way, in double precision from the text
+static void referenceHours(const std::string& body, WeatherHours* want) {
+  memset(want, 0, sizeof(WeatherHours));
+  size_t at = body.find("\"hourly\":[");
+  if (at == std::string::npos) return;
+  size_t end = std::min(body.find("\"daily\":", at), body.size());
+  auto number = [&](size_t from, size_t to, const char* key, double* value) {
+    size_t k = body.find(key, from);
+    if (k >= to) return false;
+    *value = strtod(body.c_str() + k + strlen(key), NULL);
+    return true;
+  };
+  int limit = WEATHER_HOURS;
+  int n = 0;
+  for (size_t from = body.find("{\"dt\":", at); from < end && n < WEATHER_HOURS; n++) {
+    size_t to = std::min(body.find("{\"dt\":", from + 1), end);
+    double dt = 0, temp = 0, speed = 0, deg = 0, pop = 0, id = 0;
+    number(from, to, "\"dt\":", &dt);
+    if (!n) want->start = (uint32_t)dt;
+    else if ((uint32_t)dt != want->start + n * 3600UL && limit == WEATHER_HOURS) limit = n;
+    if (number(from, to, "\"temp\":", &temp)) want->temperature[n] = (int8_t)std::max(-128L, std::min(127L, lround(temp)));
+    if (number(from, to, "\"wind_speed\":", &speed)) want->windSpeed[n] = (uint8_t)std::min(255L, lround(speed * 2));
+    if (number(from, to, "\"wind_deg\":", &deg)) want->windSector[n] = (uint8_t)(lround(fmod(deg, 360) / 22.5) % 16);
+    if (number(from, to, "\"pop\":", &pop)) want->pop[n] = (uint8_t)std::min(100L, lround(pop * 100));
+    if (number(from, to, "\"id\":", &id)) want->condition[n] = weatherConditionCode((uint16_t)id);
+    from = to;
+  }
+  want->count = (uint8_t)std::min(n, limit);
+}
+
+static bool sameHours(const WeatherHours* a, const WeatherHours* b) {
+  if (a->count != b->count || (a->count && a->start != b->start)) return false;
+  size_t n = a->count;
+  return !memcmp(a->temperature, b->temperature, n) && !memcmp(a->windSpeed, b->windSpeed, n) &&
+         !memcmp(a->windSector, b->windSector, n) && !memcmp(a->pop, b->pop, n) && !memcmp(a->condition, b->condition, n);
+}
+
+static std::vector<Payload> loadPayloads(const char* root) {
+  std::vector<Payload> payloads;
+  payloads.push_back({ "made up, as the sketch asks", oneCallBody(false) });
+  payloads.push_back({ "made up, whole document", oneCallBody(true) });
+
+  std::string folder = std::string(root) + "/openweather";
+  DIR* dir = opendir(folder.c_str());
+  if (!dir) {
+    return payloads;
+  }
+  std::vector<std::string> names;
+  while (struct dirent* e = readdir(dir)) {
+    size_t n = strlen(e->d_name);
+    if (n > 5 && !strcmp(e->d_name + n - 5, ".body")) {
+      names.push_back(e->d_name);
+    }
+  }
+  closedir(dir);
+  std::sort(names.begin(), names.end());
+  for (const std::string& name : names) {
+    FILE* f = fopen((folder + "/" + name).c_str(), "rb");
+    if (!f) {
+      continue;
+    }
+    std::string body;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+      body.append(buffer, n);
+    }
+    fclose(f);
+    payloads.push_back({ name, body });
+  }
+  return payloads;
+}
+
+/***************************************************************************************
+**                          Parse
+***************************************************************************************/
+static bool parse(const std::string& body, size_t chunk, WeatherModel* model) {
+  memset(model, 0, sizeof(WeatherModel));
+  OneCallExtractor extractor(model);
+  for (size_t at = 0; at < body.size(); at += chunk) {
+    extractor.feed(body.data() + at, min(chunk, body.size() - at));
+  }
+  return extractor.complete();
+}
+
+// One parse on a thread with a painted stack, the bytes it wrote are what it used
+#define PAINT_STACK (64 * 1024)
+#define PAINT       0xA5
+
+typedef struct StackRun {
+  const std::string* body;
+  WeatherModel*      model;
+  bool               ok;
+} StackRun;
+
+static void* parseOnThread(void* arg) {
+  StackRun* run = (StackRun*)arg;
+  if (run->body) {
+    run->ok = parse(*run->body, ONE_CALL_READ, run->model);
+  }
+  return NULL;
+}
+
+static size_t stackUsed(StackRun* run) {
+  static uint8_t stack[PAINT_STACK] __attribute__((aligned(64)));
+  memset(stack, PAINT, sizeof(stack));
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstack(&attr, stack, sizeof(stack));
+  pthread_t thread;
+  pthread_create(&thread, &attr, parseOnThread, run);
+  pthread_join(thread, NULL);
+  pthread_attr_destroy(&attr);
+  size_t untouched = 0;
+  while (untouched < sizeof(stack) && stack[untouched] == PAINT) {
+    untouched++;
+  }
+  return sizeof(stack) - untouched;
+}
+
+/***************************************************************************************
+**                          Checks
+***************************************************************************************/
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) failures++;
+}
+
+static void bench(const Payload& p, size_t threadBase) {
+  static const size_t chunks[] = { 1, 7, 128, ONE_CALL_READ, 0 };
+  printf("%s, %zu bytes\n", p.name.c_str(), p.body.size());
+
+  WeatherModel whole;
+  bool complete = parse(p.body, p.body.size(), &whole);
+  bool same = true;
+  bool quiet = true;
+  for (size_t chunk : chunks) {
+    size_t size = chunk ? chunk : p.body.size();
+    WeatherModel model;
+    uint64_t runs = 0;
+    uint64_t start = nowNs();
+    uint64_t elapsed = 0;
+    allocations = 0;
+    counting = true;
+    do {
+      parse(p.body, size, &model);
+      runs++;
+      elapsed = nowNs() - start;
+    } while (elapsed < BENCH_MIN_NS);
+    counting = false;
+    quiet = quiet && !allocations;
+    same = same && !memcmp(&model, &whole, sizeof(model));
+    double us = elapsed / 1000.0 / runs;
+    char label[16];
+    snprintf(label, sizeof(label), chunk ? "%zu B" : "whole", chunk);
+    printf("  %-8s %9.1f us a document  %7.1f MB/s  %llu allocations\n", label, us,
+           p.body.size() / us, (unsigned long long)allocations);
+  }
+
+  WeatherModel model;
+  StackRun run = { &p.body, &model, false };
+  size_t stack = stackUsed(&run) - threadBase;
+  printf("  stack %zu bytes, %u days and %u hours extracted\n", stack, whole.days, whole.hours.count);
+
+  WeatherHours want;
+  referenceHours(p.body, &want);
+
+  char what[160];
+  snprintf(what, sizeof(what), "%s parses to a complete model", p.name.c_str());
+  check(complete && run.ok, what);
+  snprintf(what, sizeof(what), "%s decodes its %u hours as a double precision reading does", p.name.c_str(), want.count);
+  check(sameHours(&whole.hours, &want), what);
+  snprintf(what, sizeof(what), "%s gives the same model in every chunk size", p.name.c_str());
+  check(same, what);
+  snprintf(what, sizeof(what), "%s makes no heap allocations", p.name.c_str());
+  check(quiet, what);
+  snprintf(what, sizeof(what), "%s uses under %d bytes of stack", p.name.c_str(), ONE_CALL_STACK_MAX);
+  check(stack < ONE_CALL_STACK_MAX, what);
+}
+
+int main(int argc, char** argv) {
+  const char* root = argc > 1 ? argv[1] : "tools/upstream";
+  std::vector<Payload> payloads = loadPayloads(root);
+  printf("%zu payloads, %zu recorded in %s/openweather\n", payloads.size(), payloads.size() - 2, root);
+  printf("Extractor state %zu bytes, model %zu bytes, read buffer %d bytes, heap 0\n", sizeof(OneCallExtractor),
+         sizeof(WeatherModel), ONE_CALL_READ);
+
+  // What a thread uses before the parse starts
+  StackRun empty = { NULL, NULL, false };
+  size_t threadBase = stackUsed(&empty);
+
+  for (const Payload& p : payloads) {
+    bench(p, threadBase);
+  }
+
+  // Quantization edges, one per hour in turn
+  WeatherModel model;
+  bool ok = parse(hourlyEdgeBody(WEATHER_HOURS, 0), ONE_CALL_READ, &model);
+  int sectors = 0, speeds = 0, pops = 0;
+  for (int i = 0; i < model.hours.count; i++) {
+    const HourEdge& e = hourEdges[i % HOUR_EDGES];
+    sectors += model.hours.windSector[i] == e.sector;
+    speeds += model.hours.windSpeed[i] == e.halfUnits;
+    pops += model.hours.pop[i] == e.percent;
+  }
+  char what[160];
+  snprintf(what, sizeof(what), "edge hours: %d of %d sectors, %d half unit speeds and %d pops as expected", sectors,
+           WEATHER_HOURS, speeds, pops);
+  check(ok && model.hours.count == WEATHER_HOURS && sectors == WEATHER_HOURS && speeds == WEATHER_HOURS &&
+        pops == WEATHER_HOURS && model.hours.condition[0] == weatherConditionCode(500), what);
+  ok = parse(hourlyEdgeBody(WEATHER_HOURS, 20), ONE_CALL_READ, &model);
+  snprintf(what, sizeof(what), "a strip missing hour 20 keeps %u hours", model.hours.count);
+  check(ok && model.hours.count == 20, what);
+  ok = parse(hourlyEdgeBody(60, 0), ONE_CALL_READ, &model);
+  snprintf(what, sizeof(what), "a 60 hour strip keeps %u hours, the last at %d degrees", model.hours.count,
+           model.hours.temperature[WEATHER_HOURS - 1]);
+  check(ok && model.hours.count == WEATHER_HOURS && model.hours.temperature[WEATHER_HOURS - 1] == 40 + WEATHER_HOURS - 1, what);
+  snprintf(what, sizeof(what), "48 hours take %zu bytes, within 248", sizeof(WeatherHours));
+  check(sizeof(WeatherHours) <= 248, what);
+
+  printf("%s: %d checks failed\n", failures ? "FAIL" : "PASS", failures);
+  return failures ? 1 : 0;
+}
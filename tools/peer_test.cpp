@@ -0,0 +1,348 @@
+// Runs a small fleet as separate processes on one host, pushing readings to
+// each other with PeerPush over loopback multicast, and checks what each
+// display ends up showing.
+//
+//   g++ -std=gnu++17 -Wall -Wextra -I. -Itools/host -o /tmp/peer_test tools/peer_test.cpp PeerPush.cpp
+//       ModelCache.cpp USGSRDB.cpp hydrograph.cpp OneCall.cpp JsonStream.cpp StreamIngest.cpp
+//       FetchArena.cpp Metrics.cpp Astronomy.cpp TextFormat.cpp tools/host/HostTime.cpp
+//   /tmp/peer_test
+//
+// The stand-in WiFiUDP joins the group on loopback, the stand-in Preferences
+// keeps each display's NVS in a file under a temporary directory and the model
+// cache is served by the stand-in WebServer, so every process is a display
+// with its own MAC address, NVS and HTTP port. The processes share one
+// timeline from the start of the run, and the Unix clock they push with runs
+// CLOCK_RATE times faster so the two minute age limit passes in a few seconds.
+//
+//   seconds  what happens
+//   0.0      receivers R1 and R2 start, the recorder starts listening
+//   0.3      sender S boots (boot 1) and pushes readings 1 to 5 every 0.2 s;
+//            the push of reading 3 is lost on the way
+//   1.8      S reboots (boot 2) and pushes reading 6, then 7 at 3.2
+//   2.5      the recorder plays back what it heard from boot 1, and a copy
+//            with a byte changed
+//   3.0      R3 starts, it has not heard of S before reading 7
+//   5.0      R4 starts, it hears nothing but what the recorder plays back
+//   6.0      the recorder plays back boot 1 again, now four simulated minutes old
+//   7.0      the receivers stop
+//
+// Checked, for the receivers that were up at the time:
+//   - the readings shown only ever move forward and end at reading 7
+//   - the gap after reading 2 is noticed once, reading 4 is shown as soon as
+//     it arrives, and the pull from S's cache that follows still works
+//   - playback from boot 1 is taken for a replay after S rebooted, and for
+//     stale once it is older than PEER_PUSH_MAX_AGE_S; a changed byte fails the MAC
+//   - a display that has never heard from S takes S's current boot, but not a
+//     recording, so R4 shows nothing
+//   - PeerPush does not start with the placeholder key
+// The exit status is 1 if any check fails in any process.
+#include "PeerPush.h"
+#include "Metrics.h"
+#include <LoopbackHttp.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <vector>
+
+/***************************************************************************************
+**                          Host runtime
+***************************************************************************************/
+static uint64_t monotonicMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Taken before the processes fork, so they all share it
+static const uint64_t startMs = monotonicMs();
+
+uint32_t millis() { return (uint32_t)(monotonicMs() - startMs); }
+uint32_t micros() { return millis() * 1000; }
+void delay(uint32_t ms) { usleep(ms * 1000); }
+
+HardwareSerial Serial;
+EspClass ESP;
+uint32_t EspClass::getFreeHeap() { return 0; }
+uint32_t EspClass::getMaxAllocHeap() { return 0; }
+uint32_t EspClass::getMinFreeHeap() { return 0; }
+const char* volatile heapTag = NULL;
+
+#define T0         1700000000UL
+#define CLOCK_RATE 30
+
+static uint32_t unixNow() {
+  return T0 + (uint32_t)((uint64_t)millis() * CLOCK_RATE / 1000);
+}
+
+static void sleepUntil(uint32_t ms) {
+  while (millis() < ms) delay(1);
+}
+
+/***************************************************************************************
+**                          Displays
+***************************************************************************************/
+#define GROUP       IPAddress(239, 77, 46, 50)
+#define PUSH_PORT   14650
+#define SENDER_PORT 18766
+#define FLEET_KEY   "boathouse-test-fleet-key"
+
+static void noXml(uint8_t, char*, uint16_t, char*, uint16_t) {}
+
+typedef struct Display {
+  Display() : usgs("01646500", ""), hydrograph("BRKM2", "", &noXml),
+              weather("", "", "38.9", "-77.1", "imperial"), astronomy(38.9, -77.1),
+              cache(&usgs, &hydrograph, &weather, &astronomy), push(&cache, FLEET_KEY) {}
+
+  USGSStation    usgs;
+  Hydrograph     hydrograph;
+  OneCallWeather weather;
+  Astronomy      astronomy;
+  ModelCache     cache;
+  PeerPush       push;
+} Display;
+
+// Reading k is stamped k quarter hours after T0
+static uint32_t readingTime(int k) {
+  return T0 + k * 900;
+}
+
+static int failures = 0;
+static const char* role = "main";
+
+static void check(bool ok, const char* what) {
+  printf("%-4s %s: %s\n", role, ok ? "ok  " : "FAIL", what);
+  fflush(stdout);
+  if (!ok) failures++;
+}
+
+static void setMac(uint8_t last) {
+  WiFi.mac[5] = last;
+}
+
+/***************************************************************************************
+**                          Sender
+***************************************************************************************/
+static int dropSeq = 0;
+
+// The sequence number is at byte 13 of the header
+static bool lossy(const uint8_t* data, size_t len) {
+  uint32_t seq = len > 16 ? data[13] | data[14] << 8 | data[15] << 16 | (uint32_t)data[16] << 24 : 0;
+  return (int)seq != dropSeq;
+}
+
+static void push(Display& d, int k) {
+  StationReading* sr = d.usgs.back();
+  sr->time = readingTime(k);
+  sr->temp = 12.0f;
+  sr->flow = 4000 + k * 10;
+  sr->stage = 3.5f + k * 0.01f;
+  d.usgs.publish();
+  d.cache.update();
+  d.push.broadcast(PEER_PUSH_READING, unixNow());
+}
+
+// One boot of S: pushes the readings at their times and serves its cache until stopMs
+static int sender(int boot, uint32_t stopMs, const std::vector<std::pair<uint32_t, int>>& schedule) {
+  static Display d;
+  setMac(0x50);
+  if (!d.push.begin(GROUP, PUSH_PORT, NULL)) {
+    check(false, "sender starts");
+    return 1;
+  }
+  Preferences prefs;
+  prefs.begin("peerpush", true);
+  check((int)prefs.getUInt("boot", 0) == boot, boot == 1 ? "the first boot is boot 1" : "a reboot counts up in NVS");
+  d.cache.beginServer(SENDER_PORT);
+  size_t next = 0;
+  while (millis() < stopMs) {
+    if (next < schedule.size() && millis() >= schedule[next].first) {
+      push(d, schedule[next++].second);
+    }
+    d.push.poll(unixNow());
+    d.cache.handleClient();
+    delay(1);
+  }
+  return failures ? 1 : 0;
+}
+
+/***************************************************************************************
+**                          Recorder
+***************************************************************************************/
+// Hears the group with a plain socket and plays back what S sent in boot 1
+static int recorder() {
+  WiFiUDP udp;
+  udp.beginMulticast(GROUP, PUSH_PORT);
+  std::vector<std::vector<uint8_t>> heard;
+  uint8_t packet[WIFI_UDP_MAX];
+  while (millis() < 2400) {
+    int n = udp.parsePacket();
+    if (n > 0) {
+      udp.read(packet, sizeof(packet));
+      uint32_t boot = packet[9] | packet[10] << 8 | packet[11] << 16 | (uint32_t)packet[12] << 24;
+      if (boot == 1) {
+        heard.push_back(std::vector<uint8_t>(packet, packet + n));
+      }
+    }
+    delay(1);
+  }
+  check(heard.size() == 4, "heard the four boot 1 pushes that were not lost");
+
+  for (uint32_t at : { 2500, 6000 }) {
+    sleepUntil(at);
+    for (auto& p : heard) {
+      udp.beginMulticastPacket();
+      udp.write(p.data(), p.size());
+      udp.endPacket();
+    }
+    if (at == 2500 && !heard.empty()) {
+      std::vector<uint8_t> changed = heard.back();
+      changed[30] ^= 0x01;
+      udp.beginMulticastPacket();
+      udp.write(changed.data(), changed.size());
+      udp.endPacket();
+    }
+  }
+  return failures ? 1 : 0;
+}
+
+/***************************************************************************************
+**                          Receivers
+***************************************************************************************/
+static Display* shown = NULL;
+static std::vector<uint32_t> readings;
+
+static void onApplied(uint8_t kind) {
+  if (kind == PEER_PUSH_READING) {
+    readings.push_back(shown->usgs.getLastReading()->time);
+  }
+}
+
+static bool inOrder() {
+  for (size_t i = 1; i < readings.size(); i++) {
+    if (readings[i] <= readings[i - 1]) return false;
+  }
+  return true;
+}
+
+// A display that only listens, from startMs to 7 s. What the sketch does in a
+// wake window after a lost push is done here on the next pass.
+static int receiver(uint8_t mac, uint32_t startMs) {
+  static Display d;
+  shown = &d;
+  sleepUntil(startMs);
+  setMac(mac);
+  d.push.begin(GROUP, PUSH_PORT, &onApplied);
+
+  int resyncs = 0;
+  bool readingFourOnGap = false;
+  while (millis() < 7000) {
+    d.push.poll(unixNow());
+    IPAddress from;
+    if (d.push.takeLost(&from)) {
+      readingFourOnGap = d.usgs.getLastReading()->time == readingTime(4);
+      char peer[32];
+      snprintf(peer, sizeof(peer), "%s:%d", from.toString().c_str(), SENDER_PORT);
+      if (d.cache.fetchFromPeer(peer) & MODEL_SECTION_READING) {
+        resyncs++;
+      }
+    }
+    delay(1);
+  }
+
+  const PeerPushStats& s = d.push.stats();
+  char what[96];
+  printf("%-4s shown:", role);
+  for (uint32_t t : readings) printf(" %u", (unsigned)((t - T0) / 900));
+  printf("; applied %u lost %u bad MAC %u stale %u replayed %u\n", s.applied, s.lost, s.badMac, s.stale, s.replayed);
+  if (startMs < 1000) {
+    check(inOrder() && !readings.empty() && readings.back() == readingTime(7), "readings only move forward, to reading 7");
+    check(s.lost == 1 && readingFourOnGap, "the lost push is noticed once and the next one is still shown");
+    check(resyncs == 1, "the pull from the sender's cache after the gap works");
+    check(s.badMac >= 1, "a changed byte fails the MAC");
+    snprintf(what, sizeof(what), "boot 1 played back after the reboot is a replay (%u)", s.replayed);
+    check(s.replayed >= 4, what);
+    check(s.stale >= 4, "boot 1 played back minutes later is stale");
+  } else if (startMs < 4000) {
+    check(readings.size() == 1 && readings[0] == readingTime(7) && !s.lost, "a sender not heard before is taken from its current push");
+    check(s.stale >= 4 && !s.replayed, "boot 1 played back minutes later is stale");
+  } else {
+    check(readings.empty() && !d.usgs.generation(), "a display that only hears a recording shows nothing");
+    check(s.stale >= 4, "the recording is stale");
+  }
+  return failures ? 1 : 0;
+}
+
+/***************************************************************************************
+**                          Fleet
+***************************************************************************************/
+typedef struct Child {
+  const char* role;
+  pid_t       pid;
+} Child;
+
+int main() {
+  char dir[] = "/tmp/peer_test.XXXXXX";
+  if (!mkdtemp(dir)) {
+    perror("mkdtemp");
+    return 1;
+  }
+  HTTPClient::responder = &loopbackResponder;
+  WiFiClient::platformHeap = false;
+  WiFiUDP::sendFilter = &lossy;
+
+  {
+    ModelCache* none = NULL;
+    PeerPush placeholder(none, PEER_PUSH_PLACEHOLDER_KEY);
+    check(!placeholder.begin(GROUP, PUSH_PORT, NULL), "peer push does not start with the placeholder key");
+  }
+
+  std::vector<Child> children;
+  auto spawn = [&](const char* name, std::function<int()> run) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      // Each display keeps its own NVS, S keeps it through the reboot
+      static char nvs[64];
+      snprintf(nvs, sizeof(nvs), "%s/%s", dir, name);
+      mkdir(nvs, 0700);
+      Preferences::dir = nvs;
+      role = name;
+      exit(run());
+    }
+    children.push_back({ name, pid });
+  };
+  spawn("R1", [] { return receiver(0x11, 0); });
+  spawn("R2", [] { return receiver(0x12, 0); });
+  spawn("R3", [] { return receiver(0x13, 3000); });
+  spawn("R4", [] { return receiver(0x14, 5000); });
+  spawn("rec", [] { return recorder(); });
+  spawn("S", [] {
+    sleepUntil(300);
+    dropSeq = 3;
+    return sender(1, 1800, { { 500, 1 }, { 700, 2 }, { 900, 3 }, { 1100, 4 }, { 1300, 5 } });
+  });
+  // The reboot is a new process with the same NVS
+  sleepUntil(1800);
+  for (Child& c : children) {
+    if (!strcmp(c.role, "S")) waitpid(c.pid, NULL, 0), c.pid = 0;
+  }
+  spawn("S", [] {
+    dropSeq = 0;
+    return sender(2, 3500, { { 2000, 6 }, { 3200, 7 } });
+  });
+
+  // A process that failed a check counts once, the placeholder check counts as main
+  for (Child& c : children) {
+    int status = 0;
+    if (c.pid && (waitpid(c.pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status))) {
+      failures++;
+    }
+  }
+  char command[64];
+  snprintf(command, sizeof(command), "rm -rf %s", dir);
+  if (system(command)) {
+    printf("could not remove %s\n", dir);
+  }
+  printf("%s: %d processes failed\n", failures ? "FAIL" : "PASS", failures);
+  return failures ? 1 : 0;
+}
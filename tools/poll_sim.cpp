@@ -0,0 +1,186 @@
+// Runs PollPlanner against simulated USGS and NWS publication and compares it
+// with polling at a fixed interval.
+//
+//   g++ -O2 -I. -Itools/host tools/poll_sim.cpp PollPlanner.cpp -o /tmp/poll_sim && /tmp/poll_sim [days] [seeds]
+//
+// USGS stamps a row every 15 minutes. A gauge reporting by satellite sends the
+// last hour's rows once an hour, a few minutes either side of the same minute;
+// one on a phone line sends every row 6 to 20 minutes after its time. Either
+// way the odd transmission is an hour late. NWS issues a forecast around 01:30,
+// 07:30, 13:30 and 19:30, give or take half an hour, and it shows up 10 to 40
+// minutes after its issue time. Staleness is how long the screen has been
+// behind the newest published data, averaged over the run.
+//
+// Each source is run with seeds 1 to seeds (5 by default) and fails if the
+// planner polls more, finds nothing new more often, or is more than 10% staler
+// than the fixed interval. 14 days x 5 seeds:
+//
+//                        fetches/day  unchanged  stale min
+//   satellite  fixed         72.0       67.2%      0.83
+//              planned       41.5       43.2%      0.06
+//   phone      fixed         72.0        4.9%      3.90
+//              planned       72.0        4.9%      3.90   (publishes faster than the fixed interval)
+//   NWS        fixed         96.0       95.8%      0.10
+//              planned       29.2       86.0%      0.10
+#include "PollPlanner.h"
+#include <Print.h>
+#include <stdlib.h>
+#include <vector>
+
+typedef struct Record {
+  uint32_t stamp;      // the data's own time
+  uint32_t published;  // when the service starts returning it
+} Record;
+
+static uint32_t uniform(uint32_t lo, uint32_t hi) {
+  return lo + (uint32_t)(rand() % (hi - lo + 1));
+}
+
+static std::vector<Record> usgsRecords(uint32_t start, uint32_t end, bool hourly) {
+  std::vector<Record> r;
+  uint32_t sent = 0;
+  for (uint32_t t = start; t < end; t += 15 * 60) {
+    if (hourly) {
+      // The hour's rows go out together at about 10 past the next hour
+      if (t % 3600 == 0) {
+        sent = t + 70 * 60 + uniform(0, 6 * 60) - 3 * 60 + (rand() % 50 ? 0 : 3600);
+      }
+      r.push_back({t, sent});
+    } else {
+      uint32_t lag = rand() % 50 ? uniform(6 * 60, 20 * 60) : uniform(45 * 60, 75 * 60);
+      r.push_back({t, t + lag});
+    }
+  }
+  return r;
+}
+
+static std::vector<Record> nwsRecords(uint32_t start, uint32_t end) {
+  std::vector<Record> r;
+  for (uint32_t day = start; day < end; day += 24 * 3600) {
+    for (int i = 0; i < 4; i++) {
+      uint32_t issued = day + 90 * 60 + i * 6 * 3600 + uniform(0, 60 * 60) - 30 * 60;
+      r.push_back({issued, issued + uniform(10 * 60, 40 * 60)});
+    }
+  }
+  return r;
+}
+
+// Newest record the service returns at t, NULL before the first
+static const Record* newest(const std::vector<Record>& records, uint32_t t) {
+  const Record* best = NULL;
+  for (const Record& r : records) {
+    if (r.published <= t && (!best || r.stamp > best->stamp)) best = &r;
+  }
+  return best;
+}
+
+typedef struct Result {
+  uint32_t fetches;
+  uint32_t unchanged;
+  double   staleS;     // average time behind the newest published data
+  double   ageS;       // average age of the data on screen
+} Result;
+
+// planner NULL polls every fixedS
+static Result run(const std::vector<Record>& records, uint32_t start, uint32_t end, uint32_t fixedS,
+                  PollPlanner* planner, uint8_t id) {
+  Result res = {};
+  const Record* shown = NULL;
+  uint32_t next = start;
+  double stale = 0, age = 0;
+  for (uint32_t t = start; t < end; t += 10) {
+    if (t >= next) {
+      const Record* got = newest(records, t);
+      res.fetches++;
+      if (got == shown || !got) res.unchanged++;
+      shown = got ? got : shown;
+      next = t + (planner ? planner->fetched(id, t, got ? got->stamp : 0) : fixedS);
+    }
+    const Record* latest = newest(records, t);
+    if (latest && latest != shown) {
+      // Behind since the first record newer than the one on screen was published
+      uint32_t since = latest->published;
+      for (const Record& r : records) {
+        if (r.published <= t && (!shown || r.stamp > shown->stamp) && r.published < since) since = r.published;
+      }
+      stale += t - since;
+    }
+    if (shown) age += t - shown->stamp;
+  }
+  uint32_t steps = (end - start) / 10;
+  res.staleS = stale / steps;
+  res.ageS = age / steps;
+  return res;
+}
+
+static void print(const char* name, const Result& r, double days) {
+  printf("  %-22s %6.1f fetches/day  %5.1f%% unchanged  stale %5.2f min  age %6.1f min\n", name,
+         r.fetches / days, 100.0 * r.unchanged / r.fetches, r.staleS / 60, r.ageS / 60);
+}
+
+static void add(Result& total, const Result& r, int runs) {
+  total.fetches += r.fetches;
+  total.unchanged += r.unchanged;
+  total.staleS += r.staleS / runs;
+  total.ageS += r.ageS / runs;
+}
+
+static int failures = 0;
+
+// The planner may not poll more, find nothing new more often, or leave the
+// screen behind for longer than the fixed interval, staleness to within 10%
+static void compare(const char* source, const Result& fixed, const Result& planned) {
+  bool ok = planned.fetches <= fixed.fetches &&
+            (double)planned.unchanged / planned.fetches <= (double)fixed.unchanged / fixed.fetches &&
+            planned.staleS <= fixed.staleS * 1.1;
+  printf("%s: %s planned is no worse than fixed\n", ok ? "ok  " : "FAIL", source);
+  if (!ok) failures++;
+}
+
+int main(int argc, char** argv) {
+  int days = argc > 1 ? atoi(argv[1]) : 14;
+  int seeds = argc > 2 ? atoi(argv[2]) : 5;
+  uint32_t start = 1700000000 - 1700000000 % 86400;
+  uint32_t end = start + days * 86400;
+
+  Result fixedSat = {}, plannedSat = {}, fixedPhone = {}, plannedPhone = {}, fixedNws = {}, plannedNws = {};
+  PollPlanner planner;
+  for (int seed = 1; seed <= seeds; seed++) {
+    srand(seed);
+    std::vector<Record> satellite = usgsRecords(start - 86400, end, true);
+    std::vector<Record> phone = usgsRecords(start - 86400, end, false);
+    std::vector<Record> nws = nwsRecords(start - 86400, end);
+
+    // The settings the sketch uses
+    planner.configure(0, "USGS hourly", 20 * 60, 3 * 60, 15 * 60, 60 * 60);
+    planner.configure(1, "USGS 15 min", 20 * 60, 3 * 60, 15 * 60, 60 * 60);
+    planner.configure(2, "NWS", 15 * 60, 5 * 60, 60 * 60, 3 * 60 * 60);
+
+    add(fixedSat, run(satellite, start, end, 20 * 60, NULL, 0), seeds);
+    add(plannedSat, run(satellite, start, end, 0, &planner, 0), seeds);
+    add(fixedPhone, run(phone, start, end, 20 * 60, NULL, 1), seeds);
+    add(plannedPhone, run(phone, start, end, 0, &planner, 1), seeds);
+    add(fixedNws, run(nws, start, end, 15 * 60, NULL, 2), seeds);
+    add(plannedNws, run(nws, start, end, 0, &planner, 2), seeds);
+  }
+
+  double total = (double)days * seeds;
+  printf("USGS by satellite, %d days x %d seeds\n", days, seeds);
+  print("every 20 min", fixedSat, total);
+  print("planned", plannedSat, total);
+  printf("USGS by phone line, %d days x %d seeds\n", days, seeds);
+  print("every 20 min", fixedPhone, total);
+  print("planned", plannedPhone, total);
+  printf("NWS, %d days x %d seeds\n", days, seeds);
+  print("every 15 min", fixedNws, total);
+  print("planned", plannedNws, total);
+  printf("Learnt, last seed\n");
+  Print out;
+  planner.report(out, end);
+
+  compare("USGS by satellite", fixedSat, plannedSat);
+  compare("USGS by phone line", fixedPhone, plannedPhone);
+  compare("NWS", fixedNws, plannedNws);
+  printf("%s: %d checks failed\n", failures ? "FAIL" : "PASS", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+// Runs RetryPolicy through failures, probes and recoveries on a simulated clock.
+//
+//   g++ -std=gnu++17 -Wall -Wextra -I. -Itools/host -o /tmp/retry_test tools/retry_test.cpp RetryPolicy.cpp
+//   /tmp/retry_test
+//
+// The policy has USGS's settings from RiverWeather.ino: 15 s backoff base,
+// 5 min backoff cap, 10 min open period doubling to 60 min. The clock starts a
+// minute before millis() wraps, so every wait below crosses the wrap.
+//
+// Checked:
+//   - each backoff before the circuit opens is within the equal jitter bounds,
+//     half its step to the whole step, the step doubling from the base, and
+//     over 2000 seeds the delays reach both ends of the bounds
+//   - a step past the backoff cap is held at the cap
+//   - the circuit stays closed for RETRY_OPEN_AFTER - 1 failures and opens on
+//     the next, refusing requests until the open period is over
+//   - exactly one half-open probe goes out, and nothing else while it is out
+//   - a probe with no result is followed by another one open period later
+//   - each failed probe doubles the open period, up to its cap
+//   - a successful probe closes the circuit, clears the failures and puts
+//     the open period back to its start
+// The exit status is 1 if any check fails.
+#include "RetryPolicy.h"
+#include <stdlib.h>
+
+#define BASE_MS     (15 * 1000)
+#define BACKOFF_MS  (5 * 60 * 1000)
+#define OPEN_MS     (10 * 60 * 1000)
+#define MAX_OPEN_MS (60 * 60 * 1000)
+#define START_MS    (0xFFFFFFFFu - 60 * 1000)
+#define SEEDS       2000
+
+/***************************************************************************************
+**                          Host runtime
+***************************************************************************************/
+static uint32_t nowMs = START_MS;
+
+uint32_t millis() { return nowMs; }
+uint32_t micros() { return nowMs * 1000; }
+void delay(uint32_t ms) { nowMs += ms; }
+
+HardwareSerial Serial;
+EspClass ESP;
+uint32_t EspClass::getFreeHeap() { return 0; }
+uint32_t EspClass::getMaxAllocHeap() { return 0; }
+uint32_t EspClass::getMinFreeHeap() { return 0; }
+const char* volatile heapTag = NULL;
+
+/***************************************************************************************
+**                          Checks
+***************************************************************************************/
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) failures++;
+}
+
+// Requests the policy lets through over the next ms, asking every second
+static int allowedOver(RetryPolicy& policy, uint32_t ms) {
+  int allowed = 0;
+  for (uint32_t t = 0; t < ms; t += 1000) {
+    if (policy.allow(nowMs)) allowed++;
+    delay(1000);
+  }
+  return allowed;
+}
+
+// Waits until a millisecond before the circuit's period is over, then to its end
+static bool opensAfter(RetryPolicy& policy, uint32_t ms) {
+  delay(ms - 1);
+  bool held = !policy.allow(nowMs) && policy.waitMs(nowMs) == 1;
+  delay(1);
+  return held && policy.waitMs(nowMs) == 0 && policy.allow(nowMs);
+}
+
+// Drives a closed circuit to open, returning the open period it gave
+static uint32_t openCircuit(RetryPolicy& policy) {
+  uint32_t wait = 0;
+  for (int i = 0; i < RETRY_OPEN_AFTER; i++) {
+    policy.allow(nowMs);
+    wait = policy.recordFailure(nowMs);
+  }
+  return wait;
+}
+
+int main() {
+  char what[200];
+
+  // Backoff bounds and spread, a fresh policy per seed
+  uint32_t lowest[RETRY_OPEN_AFTER] = {}, highest[RETRY_OPEN_AFTER] = {};
+  int outside = 0;
+  for (int seed = 1; seed <= SEEDS; seed++) {
+    srandom(seed);
+    RetryPolicy policy("USGS", BASE_MS, BACKOFF_MS, OPEN_MS, MAX_OPEN_MS);
+    for (int k = 1; k < RETRY_OPEN_AFTER; k++) {
+      uint32_t step = BASE_MS << (k - 1);
+      uint32_t wait = policy.recordFailure(nowMs);
+      if (wait < step / 2 || wait > step || policy.state() != CIRCUIT_CLOSED) outside++;
+      if (seed == 1 || wait < lowest[k]) lowest[k] = wait;
+      if (wait > highest[k]) highest[k] = wait;
+    }
+  }
+  snprintf(what, sizeof(what), "%d of %d backoffs fall outside half the step to the step", outside,
+           SEEDS * (RETRY_OPEN_AFTER - 1));
+  check(!outside, what);
+  for (int k = 1; k < RETRY_OPEN_AFTER; k++) {
+    uint32_t step = BASE_MS << (k - 1);
+    snprintf(what, sizeof(what), "failure %d backs off %.1f to %.1f s over %d seeds, its step is %u s", k,
+             lowest[k] / 1000.0, highest[k] / 1000.0, SEEDS, step / 1000);
+    check(lowest[k] < step / 2 + step / 50 && highest[k] > step - step / 50, what);
+  }
+
+  // A 2 min base doubles to 8 min by the third failure, past a 5 min cap
+  bool capped = true;
+  for (int seed = 1; seed <= 200; seed++) {
+    srandom(seed);
+    RetryPolicy policy("USGS", 2 * 60 * 1000, BACKOFF_MS, OPEN_MS, MAX_OPEN_MS);
+    policy.recordFailure(nowMs);
+    policy.recordFailure(nowMs);
+    uint32_t wait = policy.recordFailure(nowMs);
+    capped = capped && wait >= BACKOFF_MS / 2 && wait <= BACKOFF_MS;
+  }
+  check(capped, "a step past the backoff cap is held at the cap");
+
+  // Opening, RETRY_OPEN_AFTER failures in a row
+  srandom(1);
+  RetryPolicy policy("USGS", BASE_MS, BACKOFF_MS, OPEN_MS, MAX_OPEN_MS);
+  bool closed = true;
+  for (int i = 1; i < RETRY_OPEN_AFTER; i++) {
+    policy.recordFailure(nowMs);
+    closed = closed && policy.state() == CIRCUIT_CLOSED && policy.allow(nowMs);
+  }
+  uint32_t wait = policy.recordFailure(nowMs);
+  snprintf(what, sizeof(what), "closed for %d failures, open on failure %d for %u min", RETRY_OPEN_AFTER - 1,
+           RETRY_OPEN_AFTER, wait / 60000);
+  check(closed && policy.state() == CIRCUIT_OPEN && wait == OPEN_MS, what);
+  check(opensAfter(policy, OPEN_MS) && policy.state() == CIRCUIT_HALF_OPEN,
+        "requests are refused until the open period is over, then a probe goes out");
+
+  // The probe is out: nothing else for the rest of the open period
+  int extra = allowedOver(policy, OPEN_MS - 1000);
+  snprintf(what, sizeof(what), "%d more requests go out while the probe is out", extra);
+  check(!extra && policy.state() == CIRCUIT_HALF_OPEN, what);
+  delay(1000);
+  check(policy.allow(nowMs) && !policy.allow(nowMs), "a probe with no result is followed by one more an open period later");
+
+  // Failed probes double the open period up to the cap
+  uint32_t expected = OPEN_MS;
+  bool doubled = true;
+  int probes = 0;
+  char periods[80] = "";
+  while (expected < MAX_OPEN_MS || probes < 4) {
+    expected = expected > MAX_OPEN_MS / 2 ? MAX_OPEN_MS : expected * 2;
+    wait = policy.recordFailure(nowMs);
+    size_t used = strlen(periods);
+    snprintf(periods + used, sizeof(periods) - used, "%s%u", used ? ", " : "", wait / 60000);
+    doubled = doubled && wait == expected && policy.state() == CIRCUIT_OPEN && opensAfter(policy, wait);
+    probes++;
+  }
+  snprintf(what, sizeof(what), "failed probes open the circuit for %s min", periods);
+  check(doubled && expected == MAX_OPEN_MS, what);
+
+  // A successful probe closes it and starts over
+  policy.recordSuccess();
+  int through = allowedOver(policy, 60 * 1000);
+  snprintf(what, sizeof(what), "a successful probe closes the circuit, %d of 60 requests go through", through);
+  check(policy.state() == CIRCUIT_CLOSED && !policy.failures() && through == 60, what);
+  wait = policy.recordFailure(nowMs);
+  check(policy.state() == CIRCUIT_CLOSED && wait >= BASE_MS / 2 && wait <= BASE_MS,
+        "the next failure backs off from the base again");
+  policy.recordSuccess();
+  wait = openCircuit(policy);
+  snprintf(what, sizeof(what), "the next time it opens it is for %u min", wait / 60000);
+  check(policy.state() == CIRCUIT_OPEN && wait == OPEN_MS, what);
+
+  printf("%s: %d checks failed\n", failures ? "FAIL" : "PASS", failures);
+  return failures ? 1 : 0;
+}
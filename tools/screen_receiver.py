@@ -0,0 +1,278 @@
+#!/usr/bin/env python3
+"""Rebuilds PNGs from a SCREEN_SERVER display's capture stream.
+
+Uncomment SCREEN_SERVER in RiverWeather.ino, then either connect over TCP,
+which sends the changes every second for as long as it stays connected:
+
+    tools/screen_receiver.py --host 192.168.1.42 --out screens
+
+or over the serial port, asking for the changes every --interval seconds
+(needs pyserial):
+
+    tools/screen_receiver.py --serial /dev/ttyUSB0 --count 1
+
+Only the tiles that changed since the last capture come over the wire, so the
+receiver keeps its own copy of the panel and writes a PNG whenever a frame
+changed it. A frame that fails its check, or a gap in the frame numbers (the
+serial port and a TCP viewer share the display's idea of what was sent), asks
+for a full capture. The stream format is described in ScreenServer.h.
+"""
+
+import argparse
+import os
+import socket
+import struct
+import sys
+import time
+import zlib
+
+MAGIC = b"RWSC"
+VERSION = 1
+HEADER = struct.Struct("<4sBHHBHHHIB")
+TRAILER = struct.Struct("<HHI")
+FLAG_FULL = 0x01
+
+FNV_BASIS = 2166136261
+FNV_PRIME = 16777619
+
+
+def fnv1a32(data, h=FNV_BASIS):
+    for b in data:
+        h = ((h ^ b) * FNV_PRIME) & 0xFFFFFFFF
+    return h
+
+
+class BadFrame(Exception):
+    pass
+
+
+def decode_tile(code, w, h):
+    """The inverse of ScreenServer::encodeTile, a list of w * h RGB565 values."""
+    n = w * h
+    out = []
+    prev = 0
+    i = 0
+    while len(out) < n:
+        if i >= len(code):
+            raise BadFrame("tile ends early")
+        op = code[i] & 0xC0
+        count = (code[i] & 0x3F) + 1
+        i += 1
+        if op == 0x00:
+            out.extend([prev] * count)
+        elif op == 0x40:
+            if len(out) < w:
+                raise BadFrame("copy up on the first row")
+            for _ in range(count):
+                out.append(out[len(out) - w])
+        elif op == 0x80:
+            out.extend(struct.unpack_from("<%dH" % count, code, i))
+            i += 2 * count
+        else:
+            out.extend([struct.unpack_from("<H", code, i)[0]] * count)
+            i += 2
+        prev = out[-1]
+    if len(out) != n or i != len(code):
+        raise BadFrame("tile length does not match its pixels")
+    return out
+
+
+class Panel:
+    """The display's memory as the frames describe it."""
+
+    def __init__(self):
+        self.width = self.height = 0
+        self.pixels = None
+        self.last_frame = None
+
+    def apply(self, header, tiles):
+        _, version, width, height, tile, top, region, start, frame, flags = header
+        if flags & FLAG_FULL:
+            if (width, height) != (self.width, self.height):
+                self.width, self.height = width, height
+                self.pixels = [0] * (width * height)
+        elif self.last_frame is None or frame != self.last_frame + 1 or (width, height) != (self.width, self.height):
+            self.last_frame = None
+            raise BadFrame("missed the frames before %d" % frame)
+        cols = (width + tile - 1) // tile
+        for index, code in tiles:
+            x = (index % cols) * tile
+            y = (index // cols) * tile
+            tw = min(tile, width - x)
+            th = min(tile, height - y)
+            if y >= height:
+                raise BadFrame("tile %d is off the panel" % index)
+            values = decode_tile(code, tw, th)
+            for row in range(th):
+                base = (y + row) * width + x
+                self.pixels[base:base + tw] = values[row * tw:(row + 1) * tw]
+        self.last_frame = frame
+        self.scroll = (top, region, start)
+
+    def visible_rows(self):
+        """Panel memory rows in the order they are on the glass."""
+        top, region, start = self.scroll
+        for y in range(self.height):
+            if top <= y < top + region:
+                yield top + (y - top + start - top) % region
+            else:
+                yield y
+
+    def png(self):
+        raw = bytearray()
+        for y in self.visible_rows():
+            raw.append(0)
+            for v in self.pixels[y * self.width:(y + 1) * self.width]:
+                r, g, b = (v >> 11) & 0x1F, (v >> 5) & 0x3F, v & 0x1F
+                raw += bytes(((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)))
+
+        def chunk(kind, data):
+            body = kind + data
+            return struct.pack(">I", len(data)) + body + struct.pack(">I", zlib.crc32(body) & 0xFFFFFFFF)
+
+        ihdr = struct.pack(">IIBBBBB", self.width, self.height, 8, 2, 0, 0, 0)
+        return (b"\x89PNG\r\n\x1a\n" + chunk(b"IHDR", ihdr) +
+                chunk(b"IDAT", zlib.compress(bytes(raw), 6)) + chunk(b"IEND", b""))
+
+
+class FrameReader:
+    """Finds frames in a byte stream, anything between them is log text."""
+
+    def __init__(self, read, log):
+        self.read = read
+        self.log = log
+        self.buf = bytearray()
+
+    def need(self, n):
+        while len(self.buf) < n:
+            data = self.read()
+            if data is None:
+                raise EOFError
+            self.buf += data
+
+    def take(self, n):
+        self.need(n)
+        out = bytes(self.buf[:n])
+        del self.buf[:n]
+        return out
+
+    def next_frame(self):
+        while True:
+            self.need(len(MAGIC))
+            at = self.buf.find(MAGIC)
+            if at < 0:
+                # Keep what could be the start of a magic, the rest is text
+                keep = len(MAGIC) - 1
+                self.text(self.buf[:-keep])
+                del self.buf[:-keep]
+                self.need(len(self.buf) + 1)
+                continue
+            self.text(self.buf[:at])
+            del self.buf[:at]
+            header = HEADER.unpack(self.take(HEADER.size))
+            if header[1] != VERSION:
+                self.log("unknown version %d" % header[1])
+                continue
+            tile = header[4]
+            longest = tile * tile * 2 + (tile * tile + 63) // 64
+            tiles = []
+            check = FNV_BASIS
+            size = HEADER.size
+            while True:
+                index, length = struct.unpack("<HH", self.take(4))
+                if index == 0xFFFF:
+                    count = length
+                    expected = struct.unpack("<I", self.take(4))[0]
+                    size += TRAILER.size
+                    break
+                if length > longest:
+                    raise BadFrame("tile %d claims %d bytes" % (index, length))
+                record = struct.pack("<HH", index, length)
+                code = self.take(length)
+                check = fnv1a32(code, fnv1a32(record, check))
+                tiles.append((index, code))
+                size += 4 + length
+            if count != len(tiles) or check != expected:
+                raise BadFrame("frame %d fails its check" % header[8])
+            return header, tiles, size
+
+    def text(self, data):
+        for line in bytes(data).decode("utf-8", "replace").splitlines():
+            if line.strip():
+                self.log("display: " + line.strip())
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--host", help="the display's address, for a TCP connection")
+    parser.add_argument("--port", type=int, default=5950)
+    parser.add_argument("--serial", help="serial port instead of TCP")
+    parser.add_argument("--baud", type=int, default=250000)
+    parser.add_argument("--interval", type=float, default=1.0, help="seconds between serial captures")
+    parser.add_argument("--out", default="screens", help="folder for the PNGs")
+    parser.add_argument("--count", type=int, default=0, help="stop after this many PNGs, 0 runs until Ctrl-C")
+    args = parser.parse_args()
+    if not args.host and not args.serial:
+        parser.error("give --host or --serial")
+
+    def log(text):
+        print(text, file=sys.stderr)
+
+    if args.serial:
+        import serial
+        link = serial.Serial(args.serial, args.baud, timeout=0.2)
+        link.reset_input_buffer()
+        send = link.write
+        last_ask = [0.0]
+
+        def read():
+            # Ask for the changes on the interval, the display answers only when asked
+            if time.time() - last_ask[0] >= args.interval:
+                last_ask[0] = time.time()
+                link.write(b"s")
+            return link.read(4096)
+        link.write(b"S")
+        last_ask[0] = time.time()
+    else:
+        link = socket.create_connection((args.host, args.port), timeout=30)
+        send = link.sendall
+
+        def read():
+            data = link.recv(65536)
+            return data or None
+
+    os.makedirs(args.out, exist_ok=True)
+    panel = Panel()
+    reader = FrameReader(read, log)
+    written = 0
+    try:
+        while not args.count or written < args.count:
+            try:
+                started = time.time()
+                header, tiles, size = reader.next_frame()
+                panel.apply(header, tiles)
+            except BadFrame as e:
+                log("%s, asking for a full frame" % e)
+                send(b"S")
+                continue
+            frame, flags = header[8], header[9]
+            width, height = header[2], header[3]
+            print("frame %d  %3d tiles  %6d bytes (%.1f%% of raw)  %.2f s%s" % (
+                frame, len(tiles), size, 100.0 * size / (width * height * 2), time.time() - started,
+                "  full" if flags & FLAG_FULL else ""))
+            if not tiles:
+                continue
+            path = os.path.join(args.out, "screen-%s-%05d.png" % (time.strftime("%Y%m%d-%H%M%S"), frame))
+            with open(path, "wb") as f:
+                f.write(panel.png())
+            written += 1
+    except (KeyboardInterrupt, EOFError):
+        pass
+    finally:
+        link.close()
+    print("%d PNGs in %s" % (written, args.out))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
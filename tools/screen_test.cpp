@@ -0,0 +1,355 @@
+// Encodes tiles and whole captures with ScreenServer and decodes them with
+// tools/screen_receiver.py's own decoder.
+//
+//   g++ -O2 -std=gnu++17 -Wall -Wextra -I. -Itools/host -o /tmp/screen_test tools/screen_test.cpp ScreenServer.cpp
+//   /tmp/screen_test
+//
+// Run from the top of the repository. The tiles and the capture stream are
+// written to /tmp, a Python script imports screen_receiver from tools/ and
+// decodes them with decode_tile(), FrameReader and Panel, and its pixels are
+// compared with what was encoded. The stream is handed to FrameReader 1000
+// bytes at a time with log text between the frames, as the serial port has it.
+//
+// The TFT_eSPI stand-in reads back from a picture in memory, so the capture
+// times ScreenServer::report prints here are the hashing and encoding alone.
+//
+// Checked:
+//   - a black tile is one RUN a 64 pixels and nothing else
+//   - black runs around scattered pixels, rows repeated with UP, noise as
+//     literals, colour runs either side of the 64 pixel op limit and a mix of
+//     them decode to the pixels encoded, and no tile is over SCREEN_TILE_CODE_MAX
+//   - 31 pixel wide and high edge tiles decode, UP reaching a 31 pixel row back
+//   - a full capture of a page decodes to the panel, a change sends just the
+//     tiles it touched and no change sends none
+//   - a 479 x 319 panel, with 31 pixel tiles down its right and bottom edges,
+//     decodes to the panel
+//   - a black panel's full frame is its header, 16 bytes a tile and the trailer
+// The exit status is 1 if any check fails.
+#include "ScreenServer.h"
+#include "ByteCodec.h"
+#include <stdlib.h>
+#include <time.h>
+
+#define TILES_PATH  "/tmp/screen_test.tiles"
+#define STREAM_PATH "/tmp/screen_test.stream"
+#define OUT_PATH    "/tmp/screen_test.out"
+#define SCRIPT_PATH "/tmp/screen_test.py"
+#define STREAM_MAX  (2 * 1024 * 1024)
+#define FRAMES_MAX  8
+
+/***************************************************************************************
+**                          Host runtime
+***************************************************************************************/
+static uint64_t monotonicUs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint32_t millis() { return (uint32_t)(monotonicUs() / 1000); }
+uint32_t micros() { return (uint32_t)monotonicUs(); }
+void delay(uint32_t) {}
+
+HardwareSerial Serial;
+EspClass ESP;
+uint32_t EspClass::getFreeHeap() { return 0; }
+uint32_t EspClass::getMaxAllocHeap() { return 0; }
+uint32_t EspClass::getMinFreeHeap() { return 0; }
+const char* volatile heapTag = NULL;
+
+/***************************************************************************************
+**                          Receiver
+***************************************************************************************/
+// Decodes every tile, then every frame of the stream, with screen_receiver.py.
+// Out: per tile a status byte and its pixels, per frame a status byte, the tile
+// count, width, height and the panel's pixels.
+static const char RECEIVER_SCRIPT[] = R"(
+import struct, sys
+sys.path.insert(0, "tools")
+import screen_receiver as sr
+out = open(sys.argv[3], "wb")
+tiles = open(sys.argv[1], "rb").read()
+i = 0
+while i < len(tiles):
+    w, h, n = struct.unpack_from("<BBH", tiles, i)
+    i += 4
+    try:
+        pixels, ok = sr.decode_tile(tiles[i:i + n], w, h), 1
+    except sr.BadFrame:
+        pixels, ok = [0] * (w * h), 0
+    i += n
+    out.write(bytes([ok]) + struct.pack("<%dH" % (w * h), *pixels))
+stream = open(sys.argv[2], "rb").read()
+at = [0]
+def read():
+    if at[0] >= len(stream):
+        return None
+    at[0] += 1000
+    return stream[at[0] - 1000:at[0]]
+reader = sr.FrameReader(read, lambda text: None)
+panel = sr.Panel()
+while True:
+    try:
+        header, got, size = reader.next_frame()
+        panel.apply(header, got)
+    except EOFError:
+        break
+    except sr.BadFrame:
+        out.write(bytes([0]))
+        break
+    out.write(bytes([1]) + struct.pack("<HHH", len(got), panel.width, panel.height))
+    out.write(struct.pack("<%dH" % len(panel.pixels), *panel.pixels))
+)";
+
+// Collects what is sent, the tiles file and the capture stream
+class ByteSink : public Print {
+  public:
+    ByteSink(size_t cap) : buf((uint8_t*)malloc(cap)), cap(cap) {}
+    ~ByteSink() { free(this->buf); }
+    size_t write(const uint8_t* data, size_t n) override {
+      if (this->len + n > this->cap) n = this->cap - this->len;
+      memcpy(this->buf + this->len, data, n);
+      this->len += n;
+      return n;
+    }
+    using Print::write;
+    void flush() override {}
+    bool save(const char* path) const {
+      FILE* f = fopen(path, "wb");
+      if (!f) return false;
+      bool ok = fwrite(this->buf, 1, this->len, f) == this->len;
+      return fclose(f) == 0 && ok;
+    }
+
+    uint8_t* buf;
+    size_t   cap;
+    size_t   len = 0;
+};
+
+/***************************************************************************************
+**                          Pictures
+***************************************************************************************/
+static uint32_t seed = 12345;
+
+static uint16_t noise() {
+  seed = seed * 1103515245 + 12345;
+  return (uint16_t)(seed >> 12);
+}
+
+typedef enum {
+  PICTURE_BLACK,
+  PICTURE_SCATTERED,   // black with a pixel here and there
+  PICTURE_ROWS,        // one row of noise, repeated down the tile
+  PICTURE_NOISE,
+  PICTURE_COLOURS,     // runs of 63, 64, 65 and 129 of a colour
+  PICTURE_MIXED        // black, a band of rows, text-like noise and a colour bar
+} Picture;
+
+static void paint(uint16_t* pixels, int w, int h, Picture picture) {
+  for (int i = 0; i < w * h; i++) {
+    int x = i % w, y = i / w;
+    switch (picture) {
+      case PICTURE_BLACK:     pixels[i] = TFT_BLACK; break;
+      case PICTURE_SCATTERED: pixels[i] = i % 37 == 5 ? noise() : TFT_BLACK; break;
+      case PICTURE_ROWS:      pixels[i] = y ? pixels[i - w] : noise(); break;
+      case PICTURE_NOISE:     pixels[i] = noise(); break;
+      case PICTURE_COLOURS: {
+        static const int runs[] = { 63, 64, 65, 129 };
+        int at = i, k = 0;
+        while (at >= runs[k % 4]) at -= runs[k++ % 4];
+        pixels[i] = k % 2 ? TFT_ORANGE : TFT_NAVY;
+        break;
+      }
+      case PICTURE_MIXED:
+        if (y < h / 4) pixels[i] = TFT_BLACK;
+        else if (y < h / 2) pixels[i] = y > h / 4 ? pixels[i - w] : (x % 5 ? TFT_DARKGREY : TFT_GREEN);
+        else if (y < h - 4) pixels[i] = noise() % 3 ? TFT_BLACK : TFT_WHITE;
+        else pixels[i] = TFT_BLUE;
+        break;
+    }
+  }
+}
+
+// A page-like picture: black, a striped band, a block of text-like noise and a colour bar
+static void paintPage(uint16_t* panel, int w, int h) {
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      uint16_t c = TFT_BLACK;
+      if (y >= h / 2 && y < h / 2 + 60) c = x % 8 ? TFT_NAVY : TFT_DARKGREY;
+      else if (y >= 20 && y < 60 && x >= 10 && x < 250) c = noise() % 4 ? TFT_BLACK : TFT_WHITE;
+      else if (y >= h - 12) c = TFT_BLUE;
+      panel[y * w + x] = c;
+    }
+  }
+}
+
+/***************************************************************************************
+**                          Checks
+***************************************************************************************/
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) failures++;
+}
+
+// How many of each op a tile's code holds, indexed by op >> 6
+static void countOps(const uint8_t* code, size_t len, int ops[4]) {
+  memset(ops, 0, 4 * sizeof(int));
+  for (size_t i = 0; i < len;) {
+    uint8_t op = code[i] & 0xC0;
+    int count = (code[i] & 0x3F) + 1;
+    ops[op >> 6]++;
+    i += 1 + (op == SCREEN_OP_LIT ? 2 * count : op == SCREEN_OP_COLOUR ? 2 : 0);
+  }
+}
+
+typedef struct Tile {
+  const char* name;
+  uint8_t     w;
+  uint8_t     h;
+  Picture     picture;
+  uint16_t    pixels[SCREEN_TILE * SCREEN_TILE];
+  size_t      len;
+  int         ops[4];
+} Tile;
+
+static Tile tiles[] = {
+  { "a black tile", 32, 32, PICTURE_BLACK, {}, 0, {} },
+  { "black around scattered pixels", 32, 32, PICTURE_SCATTERED, {}, 0, {} },
+  { "a row repeated down the tile", 32, 32, PICTURE_ROWS, {}, 0, {} },
+  { "noise", 32, 32, PICTURE_NOISE, {}, 0, {} },
+  { "colour runs either side of 64", 32, 32, PICTURE_COLOURS, {}, 0, {} },
+  { "a mixed tile", 32, 32, PICTURE_MIXED, {}, 0, {} },
+  { "a 31 wide tile of repeated rows", 31, 32, PICTURE_ROWS, {}, 0, {} },
+  { "a 31 high tile of noise", 32, 31, PICTURE_NOISE, {}, 0, {} },
+  { "a 31 x 31 mixed tile", 31, 31, PICTURE_MIXED, {}, 0, {} },
+  { "a 31 x 31 black tile", 31, 31, PICTURE_BLACK, {}, 0, {} },
+};
+#define TILE_COUNT (int)(sizeof(tiles) / sizeof(tiles[0]))
+
+typedef struct Frame {
+  const char* name;
+  int         width;
+  int         height;
+  uint16_t*   panel;     // a copy of the panel when it was captured
+  uint16_t    sent;
+} Frame;
+
+static Frame frames[FRAMES_MAX];
+static int   frameCount = 0;
+
+// Captures to the stream and keeps what the panel held for the comparison
+static void capture(ScreenServer& server, TFT_eSPI& tft, ByteSink& stream, const char* name, bool full) {
+  stream.print("ScreenServer: log text between frames\n");
+  server.capture(stream, SCREEN_SINK_SERIAL, full);
+  printf("  %-26s ", name);
+  server.report(Serial);
+  Frame& f = frames[frameCount++];
+  f.name = name;
+  f.width = tft.width();
+  f.height = tft.height();
+  f.panel = (uint16_t*)malloc(f.width * f.height * sizeof(uint16_t));
+  memcpy(f.panel, tft.panel, f.width * f.height * sizeof(uint16_t));
+}
+
+int main() {
+  char what[160];
+  Serial.echo = true;
+
+  // Tiles, each as a record the script reads: w, h, length, code
+  ByteSink tileFile(TILE_COUNT * (4 + SCREEN_TILE_CODE_MAX));
+  uint8_t code[SCREEN_TILE_CODE_MAX + 64];
+  for (Tile& t : tiles) {
+    paint(t.pixels, t.w, t.h, t.picture);
+    t.len = ScreenServer::encodeTile(t.pixels, t.w, t.h, code);
+    countOps(code, t.len, t.ops);
+    uint8_t record[4];
+    ByteWriter r(record, sizeof(record));
+    r.put8(t.w);
+    r.put8(t.h);
+    r.put16(t.len);
+    tileFile.write(record, sizeof(record));
+    tileFile.write(code, t.len);
+  }
+
+  // Whole captures of a page, a change to it, no change, and an odd sized panel
+  ByteSink stream(STREAM_MAX);
+  static uint16_t panel[480 * 320];
+  TFT_eSPI tft(480, 320);
+  tft.panel = panel;
+  static ScreenServer server(&tft, NULL);
+  paintPage(panel, 480, 320);
+  capture(server, tft, stream, "a full capture of a page", true);
+  for (int y = 50; y < 70; y++) {
+    for (int x = 100; x < 140; x++) panel[y * 480 + x] = TFT_YELLOW;
+  }
+  capture(server, tft, stream, "a 40 x 20 change", false);
+  capture(server, tft, stream, "no change", false);
+
+  static uint16_t oddPanel[479 * 319];
+  TFT_eSPI odd(479, 319);
+  odd.panel = oddPanel;
+  static ScreenServer oddServer(&odd, NULL);
+  paintPage(oddPanel, 479, 319);
+  for (int y = 288; y < 319; y++) {
+    for (int x = 448; x < 479; x++) oddPanel[y * 479 + x] = noise();
+  }
+  capture(oddServer, odd, stream, "a 479 x 319 panel", true);
+
+  size_t blackStart = stream.len;
+  memset(panel, 0, sizeof(panel));
+  capture(server, tft, stream, "a black panel", true);
+  size_t blackBytes = stream.len - blackStart - strlen("ScreenServer: log text between frames\n");
+
+  FILE* script = fopen(SCRIPT_PATH, "w");
+  bool written = script && fputs(RECEIVER_SCRIPT, script) >= 0;
+  if (script) written = fclose(script) == 0 && written;
+  check(written && tileFile.save(TILES_PATH) && stream.save(STREAM_PATH), "the tiles and the stream are written");
+  check(system("python3 " SCRIPT_PATH " " TILES_PATH " " STREAM_PATH " " OUT_PATH) == 0,
+        "screen_receiver.py decodes them");
+
+  FILE* out = fopen(OUT_PATH, "rb");
+  for (Tile& t : tiles) {
+    uint8_t ok = 0;
+    static uint16_t decoded[SCREEN_TILE * SCREEN_TILE];
+    bool read = out && fread(&ok, 1, 1, out) == 1 &&
+                fread(decoded, sizeof(uint16_t), t.w * t.h, out) == (size_t)(t.w * t.h);
+    bool same = read && ok && !memcmp(decoded, t.pixels, t.w * t.h * sizeof(uint16_t));
+    snprintf(what, sizeof(what), "%s, %zu bytes as %d runs, %d ups, %d literals and %d colours, decodes", t.name, t.len,
+             t.ops[0], t.ops[1], t.ops[2], t.ops[3]);
+    check(same && t.len <= SCREEN_TILE_CODE_MAX, what);
+  }
+  check(tiles[0].len == 16 && tiles[0].ops[0] == 16, "a black tile is 16 RUN ops");
+  check(tiles[9].len == 16 && tiles[9].ops[0] == 16, "a 31 x 31 black tile is 16 RUN ops");
+  check(tiles[1].ops[0] > 0 && tiles[1].len < 200, "scattered pixels are mostly RUN");
+  check(tiles[2].ops[1] == 16 && tiles[2].len == 1 + 64 + 16, "a repeated row is a literal row and 16 UP ops");
+  check(tiles[6].ops[1] > 0 && tiles[6].len == 1 + 62 + 16, "a 31 wide repeated row is a literal row and UP ops");
+  check(tiles[3].ops[2] > 0 && tiles[3].ops[2] + 2 * 1024 <= (int)tiles[3].len + 32, "noise is literals");
+  check(tiles[4].ops[3] > 0 && !tiles[4].ops[2], "colour runs are COLOUR ops, no literals");
+
+  for (int i = 0; i < frameCount; i++) {
+    Frame& f = frames[i];
+    uint8_t ok = 0;
+    uint16_t head[3] = {};
+    bool read = out && fread(&ok, 1, 1, out) == 1 && ok && fread(head, sizeof(uint16_t), 3, out) == 3 &&
+                head[1] == f.width && head[2] == f.height;
+    uint16_t* decoded = (uint16_t*)malloc(f.width * f.height * sizeof(uint16_t));
+    read = read && fread(decoded, sizeof(uint16_t), f.width * f.height, out) == (size_t)(f.width * f.height);
+    f.sent = head[0];
+    snprintf(what, sizeof(what), "%s, %u tiles, decodes to the panel", f.name, f.sent);
+    check(read && !memcmp(decoded, f.panel, f.width * f.height * sizeof(uint16_t)), what);
+    free(decoded);
+    free(f.panel);
+  }
+  if (out) fclose(out);
+  check(frames[0].sent == 150 && frames[1].sent == 4 && frames[2].sent == 0,
+        "a capture after a change sends the 4 tiles it touched, and none after no change");
+  check(frames[3].sent == 150, "the 479 x 319 panel is 15 x 10 tiles");
+  // Header, 150 tiles of a 4 byte record and 16 RUN ops, trailer
+  snprintf(what, sizeof(what), "a black panel's full frame is %zu bytes", blackBytes);
+  check(blackBytes == 21 + 150 * (4 + 16) + 8, what);
+
+  printf("%s: %d checks failed\n", failures ? "FAIL" : "PASS", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,243 @@
+// Runs SntpClock against an in-process SNTP server on a simulated timer.
+//
+//   g++ -std=gnu++17 -Wall -Wextra -I. -Itools/host -o /tmp/sntp_test tools/sntp_test.cpp SntpClock.cpp
+//   /tmp/sntp_test [seed]
+//
+// The server is tools/ntp_standin.py in process: it serves the timer plus an
+// offset, running DRIFT_PPM fast, holds each reply 20 to 24 ms and the network
+// adds up to 3 ms each way. esp_timer_get_time() and millis() are the
+// simulated timer, which only moves when the harness moves it, and the
+// WiFiUDP stand-in hands requests to the server and queues its replies on the
+// clock's socket when they are due. Between syncs the clock is read every
+// second, every 100 ms while a slew runs out.
+//
+// Checked:
+//   - the first sync sets the clock to within 5 ms of the server
+//   - the frequency estimate settles within 0.5 ppm of the server's drift
+//   - over ten days of syncs the time never runs backwards, and the poll
+//     interval doubles while the offsets are small, up to its 48 h cap
+//   - an offset above 128 ms is stepped out at once and halves the interval
+//   - a 100 ms offset is slewed out without the time running backwards
+//   - a runt ahead of each reply, or a reply with extra bytes past its 48,
+//     does not hold up the replies behind it
+// The exit status is 1 if any check fails.
+#include "SntpClock.h"
+#include <esp_timer.h>
+#include <stdlib.h>
+
+#define DRIFT_PPM     40.0
+#define HOLD_US       20000
+#define HOLD_JITTER_US 4000
+#define LEG_JITTER_US 3000
+#define SERVER_UNIX_US 1750000000000000LL   // June 2025
+#define PENDING_MAX   16
+
+/***************************************************************************************
+**                          Host runtime
+***************************************************************************************/
+static int64_t timerUs = 5 * 1000000LL;
+
+int64_t esp_timer_get_time() { return timerUs; }
+uint32_t millis() { return (uint32_t)(timerUs / 1000); }
+uint32_t micros() { return (uint32_t)timerUs; }
+void delay(uint32_t ms) { timerUs += ms * 1000LL; }
+
+HardwareSerial Serial;
+EspClass ESP;
+uint32_t EspClass::getFreeHeap() { return 0; }
+uint32_t EspClass::getMaxAllocHeap() { return 0; }
+uint32_t EspClass::getMinFreeHeap() { return 0; }
+const char* volatile heapTag = NULL;
+
+/***************************************************************************************
+**                          Server
+***************************************************************************************/
+typedef enum {
+  REPLY_PLAIN,
+  REPLY_AFTER_RUNT,   // a 12 byte packet arrives just ahead of each reply
+  REPLY_OVERSIZE      // 20 bytes of MAC after the 48
+} ReplyShape;
+
+static int64_t    serverOffsetUs = 0;
+static ReplyShape replyShape = REPLY_PLAIN;
+
+typedef struct Pending {
+  int64_t  dueUs;
+  uint8_t  data[68];
+  size_t   len;
+} Pending;
+
+static Pending  pending[PENDING_MAX];
+static int      pendingCount = 0;
+static WiFiUDP* clientUdp = NULL;
+
+// The server's time when the timer reads localUs
+static int64_t serverAt(int64_t localUs) {
+  return SERVER_UNIX_US + serverOffsetUs + localUs + (int64_t)(localUs * DRIFT_PPM * 1e-6);
+}
+
+static void putTimestamp(uint8_t* p, int64_t unixUs) {
+  uint32_t seconds = (uint32_t)(unixUs / 1000000 + 2208988800LL);
+  uint32_t fraction = (uint32_t)(((uint64_t)(unixUs % 1000000) << 32) / 1000000);
+  for (int i = 0; i < 4; i++) {
+    p[i] = (uint8_t)(seconds >> (24 - 8 * i));
+    p[4 + i] = (uint8_t)(fraction >> (24 - 8 * i));
+  }
+}
+
+static void queue(int64_t dueUs, const uint8_t* data, size_t len) {
+  if (pendingCount >= PENDING_MAX) return;
+  Pending& p = pending[pendingCount++];
+  p.dueUs = dueUs;
+  memcpy(p.data, data, len);
+  p.len = len;
+}
+
+// As tools/ntp_standin.py answers, the hold on the way back
+static void serve(WiFiUDP* udp, IPAddress, uint16_t port, const uint8_t* request, size_t len) {
+  clientUdp = udp;
+  if (port != SNTP_PORT || len < SNTP_PACKET_LEN || (request[0] & 0x07) != 3) return;
+  int64_t arrived = timerUs + rand() % LEG_JITTER_US;
+  int64_t sent = arrived + HOLD_US + rand() % HOLD_JITTER_US;
+  uint8_t packet[68] = {};
+  packet[0] = (request[0] & 0x38) | 4;
+  packet[1] = 2;
+  packet[3] = 0xEC;
+  memcpy(packet + 12, "LOCL", 4);
+  putTimestamp(packet + 16, serverAt(arrived));
+  memcpy(packet + 24, request + 40, 8);
+  putTimestamp(packet + 32, serverAt(arrived));
+  putTimestamp(packet + 40, serverAt(sent));
+  int64_t due = sent + rand() % LEG_JITTER_US;
+  if (replyShape == REPLY_AFTER_RUNT) {
+    static const uint8_t runt[12] = { 0x24 };
+    queue(due - 500, runt, sizeof(runt));
+  }
+  queue(due, packet, replyShape == REPLY_OVERSIZE ? 68 : SNTP_PACKET_LEN);
+}
+
+// Move the timer on, handing the clock whatever has arrived meanwhile
+static void advance(int64_t us) {
+  timerUs += us;
+  for (int i = 0; i < pendingCount;) {
+    if (pending[i].dueUs <= timerUs) {
+      clientUdp->deliver(pending[i].data, pending[i].len);
+      pending[i] = pending[--pendingCount];
+    } else {
+      i++;
+    }
+  }
+}
+
+/***************************************************************************************
+**                          Checks
+***************************************************************************************/
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) failures++;
+}
+
+static SntpClock sntp("ntp.standin");
+static int64_t   lastRead = 0;
+static int       backwards = 0;
+
+// The clock's error against the server now
+static int64_t errorUs() {
+  return sntp.unixMicros() - serverAt(timerUs);
+}
+
+// Read the clock as the display does, counting any reading before the last
+static void readClock() {
+  int64_t t = sntp.unixMicros();
+  if (t < lastRead) backwards++;
+  lastRead = t;
+}
+
+// A whole sync, polled every millisecond the way pollSntp does it
+static bool syncOnce() {
+  if (!sntp.startSync()) return false;
+  for (int i = 0; i < 60 * 1000 && sntp.poll(); i++) {
+    advance(1000);
+    readClock();
+  }
+  return !sntp.busy() && sntp.lastSyncOk();
+}
+
+// Leave the clock running for ms, reading it every step
+static void idle(uint32_t ms, uint32_t stepMs) {
+  for (uint32_t t = 0; t < ms; t += stepMs) {
+    advance(stepMs * 1000LL);
+    readClock();
+  }
+}
+
+int main(int argc, char** argv) {
+  srand(argc > 1 ? atoi(argv[1]) : 1);
+  WiFiUDP::unicast = &serve;
+  sntp.begin();
+
+  char what[160];
+  bool ok = syncOnce();
+  snprintf(what, sizeof(what), "the first sync sets the clock %+.2f ms from the server", errorUs() / 1000.0);
+  check(ok && sntp.isSet() && llabs(errorUs()) < 5000, what);
+  lastRead = sntp.unixMicros();
+
+  // Ten days on the clock's own schedule
+  int syncs = 0, failed = 0, doubled = 0, halved = 0, unexplained = 0;
+  uint32_t interval = sntp.pollIntervalMs();
+  int64_t endUs = timerUs + 10 * 86400 * 1000000LL;
+  while (timerUs < endUs) {
+    idle(sntp.pollIntervalMs(), 1000);
+    if (!syncOnce()) failed++;
+    syncs++;
+    uint32_t next = sntp.pollIntervalMs();
+    // Either way up to the bound, which is not a power of two from the minimum
+    if (next == (interval < SNTP_POLL_MAX_MS / 2 ? interval * 2 : SNTP_POLL_MAX_MS)) doubled++;
+    else if (next == (interval > SNTP_POLL_MIN_MS * 2 ? interval / 2 : SNTP_POLL_MIN_MS)) halved++;
+    else unexplained++;
+    interval = next;
+  }
+  snprintf(what, sizeof(what), "frequency %d ppb after %d syncs, the server drifts %d ppb", sntp.frequencyPpb(), syncs,
+           (int)(DRIFT_PPM * 1000));
+  check(llabs(sntp.frequencyPpb() - (int64_t)(DRIFT_PPM * 1000)) < 500, what);
+  snprintf(what, sizeof(what), "%d of %d syncs failed, %d readings ran backwards", failed, syncs, backwards);
+  check(!failed && !backwards, what);
+  snprintf(what, sizeof(what), "the interval doubled %d times and halved %d, reaching %u h", doubled, halved,
+           (unsigned)(interval / 3600000));
+  check(doubled > halved && !unexplained && interval == SNTP_POLL_MAX_MS, what);
+  snprintf(what, sizeof(what), "after ten days the clock is %+.2f ms from the server", errorUs() / 1000.0);
+  check(llabs(errorUs()) < 5000, what);
+
+  // The server moves 300 ms ahead: stepped
+  serverOffsetUs += 300000;
+  ok = syncOnce();
+  snprintf(what, sizeof(what), "a 300 ms offset is stepped, %+.2f ms left, interval %u h", errorUs() / 1000.0,
+           (unsigned)(sntp.pollIntervalMs() / 3600000));
+  check(ok && llabs(errorUs()) < 5000 && sntp.pollIntervalMs() == SNTP_POLL_MAX_MS / 2, what);
+  lastRead = sntp.unixMicros();
+
+  // Then 100 ms back: slewed out at 500 ppm over 200 s
+  serverOffsetUs -= 100000;
+  backwards = 0;
+  ok = syncOnce();
+  int64_t before = errorUs();
+  idle(300 * 1000, 100);
+  snprintf(what, sizeof(what), "a 100 ms offset is slewed, %+.2f ms after the sync, %+.2f ms 300 s later", before / 1000.0,
+           errorUs() / 1000.0);
+  check(ok && before > 90000 && llabs(errorUs()) < 5000, what);
+  snprintf(what, sizeof(what), "%d readings ran backwards while it slewed", backwards);
+  check(!backwards, what);
+
+  // Packets the clock cannot use are dropped, not left in the way
+  replyShape = REPLY_AFTER_RUNT;
+  bool runt = syncOnce() && syncOnce();
+  check(runt && llabs(errorUs()) < 5000, "replies behind a runt still arrive");
+  replyShape = REPLY_OVERSIZE;
+  bool oversize = syncOnce() && syncOnce();
+  check(oversize && llabs(errorUs()) < 5000, "a reply longer than 48 bytes does not hold up the next");
+
+  printf("%s: %d checks failed\n", failures ? "FAIL" : "PASS", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,1320 @@
+// Runs the sketch's fetch, parse and draw code for weeks of simulated uptime in
+// a few seconds, on an instrumented stand-in for the ESP32 heap, and fails if
+// the heap leaks or fragments.
+//
+//   g++ -O1 -fno-inline -g -rdynamic -std=gnu++17 -Wall -Wextra -I. -Itools/host -o /tmp/soak tools/soak.cpp
+//       USGSRDB.cpp hydrograph.cpp OneCall.cpp JsonStream.cpp StreamIngest.cpp
+//       FetchArena.cpp Metrics.cpp NetScheduler.cpp RetryPolicy.cpp PollPlanner.cpp
+//       RiverAnalytics.cpp PlayLevels.cpp TextFormat.cpp HourlyStrip.cpp HydrographView.cpp
+//       RiverPages.cpp RiverFetch.cpp GfxUi.cpp Gauges.cpp Astronomy.cpp SntpClock.cpp tools/host/HostTime.cpp
+//   /tmp/soak --days 30
+//
+// Run it from the top of the repository, the font sizes come from data/fonts.
+// -fno-inline and -rdynamic let the hotspot table name the function that asked.
+//
+// The fetches, their retries and poll planning, with the sketch's settings for
+// them, are its own RiverFetch. Only the loop that opens the wake windows is
+// the soak's, RiverWeather.ino runs them as a Task. The fetches are the real
+// USGSStation, Hydrograph and OneCallWeather on the stand-in HTTPClient in
+// tools/host, which also makes the allocations the ESP32 network and TLS
+// stacks would (see HTTPClient.h, --bare leaves them out). The pages are the sketch's own RiverPages, redrawn after
+// each fetch as the sketch does, with the clock redrawn every minute. The
+// SntpClock is synced once at boot from a stand-in server on the simulated
+// time, its later syncs, the model cache and peer push are not run. Every hour
+// or so the user switches pages or scrolls the hydrograph table. The smooth
+// font is loaded at boot and kept, as the sketch does, and both pages are drawn
+// once then.
+//
+// Responses are recordings from tools/upstream_sim.py --record when there are
+// any in tools/upstream/<source> (or --replay), served in turn, otherwise they are made up
+// to follow the simulated clock: a river stage that rises and falls over days,
+// USGS rows every 15 minutes, NWS forecasts four times a day and 48 hours of
+// OneCall weather. Faults are injected at the given rates, as upstream_sim does.
+//
+// Every allocation the sketch makes (and the libraries on its behalf) comes out
+// of a first fit, address ordered heap of --heap KB, 8 bytes a block overhead,
+// so the largest free block behaves like the device's. Each allocation is put
+// down to the phase the harness is in (which fetch or draw) and to a tag from
+// the stand-in libraries or the sketch function that asked. Samples are taken
+// every hour between wake windows, when nothing should be held but what the
+// sketch keeps for good.
+//
+// The run fails when, on its last day against its second (the first is boot,
+// when the weather sprite first gets made):
+//   - the live heap between windows grew by more than --slack bytes
+//   - the largest free block shrank by more than --slack bytes
+//   - fragmentation rose by more than --frag percentage points
+//   - an allocation failed, or a block was freed that was not in use
+//   - any render after boot allocated, every draw of a page, of the clock and
+//     every frame of a scroll is counted. The file system's allocations while
+//     an icon is read from SPIFFS are the exception, the device makes those
+//     too, but they must be freed before the render returns
+// and the allocation sites whose live bytes grew are listed. The exit status
+// is 1 then, so the soak can gate a change.
+#include "USGSRDB.h"
+#include "hydrograph.h"
+#include "OneCall.h"
+#include "FetchArena.h"
+#include "ByteCodec.h"
+#include "Metrics.h"
+#include "NetScheduler.h"
+#include "PollPlanner.h"
+#include "RetryPolicy.h"
+#include "RiverFetch.h"
+#include "RiverAnalytics.h"
+#include "PlayLevels.h"
+#include "HourlyStrip.h"
+#include "HydrographView.h"
+#include "SmoothFont.h"
+#include "RiverPages.h"
+#include "utils.h"
+#include "All_Settings.h"
+#include <HTTPClient.h>
+#include <HostTime.h>
+#include <esp_timer.h>
+#include <stdarg.h>
+#include <cxxabi.h>
+#include <dirent.h>
+#include <errno.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <malloc.h>
+#include <string>
+#include <vector>
+
+/***************************************************************************************
+**                          Simulated clock
+***************************************************************************************/
+#define SOAK_UNIX_START 1700000000UL   // Nov 2023
+
+static uint32_t clockMs = 0;        // millis(), wraps like the device's
+static uint64_t elapsedMs = 0;      // since the start of the run
+
+uint32_t millis() { return clockMs; }
+uint32_t micros() { return clockMs * 1000; }
+int64_t esp_timer_get_time() { return elapsedMs * 1000; }
+void delay(uint32_t ms) {
+  clockMs += ms;
+  elapsedMs += ms;
+}
+
+static uint32_t unixNow() { return SOAK_UNIX_START + elapsedMs / 1000; }
+
+HardwareSerial Serial;
+const char* volatile heapTag = NULL;
+
+/***************************************************************************************
+**                          Heap
+***************************************************************************************/
+extern "C" {
+void* __libc_malloc(size_t size);
+void  __libc_free(void* p);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* p, size_t size);
+void* __libc_memalign(size_t align, size_t size);
+}
+
+#define SOAK_HEAP_MAX   (512 * 1024)
+#define SOAK_BLOCK_HEAD 8
+#define SOAK_BLOCK_MIN  16
+#define SOAK_SITES      1024
+#define SOAK_FRAMES     8
+#define SOAK_DAYS_MAX   400
+
+typedef struct Site {
+  const char* phase;
+  const char* tag;
+  void*       frames[SOAK_FRAMES];   // callers, for untagged allocations
+  uint32_t    allocs;
+  uint64_t    bytes;
+  int64_t     live;
+  int64_t     liveAtMark;            // at the end of the baseline day
+} Site;
+
+// Block header, the same 8 bytes multi_heap keeps per block
+typedef struct Block {
+  uint32_t size;      // whole block, a multiple of 8; bit 0 set while in use
+  uint16_t site;
+  uint16_t slack;     // size - header - requested, for the live byte count
+} Block;
+
+// Free blocks keep the offset of the next free one after the header
+#define NEXT(b) (*(uint32_t*)((uint8_t*)(b) + SOAK_BLOCK_HEAD))
+#define NO_BLOCK 0xFFFFFFFF
+
+alignas(16) static uint8_t arena[SOAK_HEAP_MAX];
+static size_t   arenaSize = 180 * 1024;
+static uint32_t freeList = NO_BLOCK;
+static bool     onDevice = false;       // allocations go to the arena
+static bool     inAllocator = false;    // backtrace() and the like go to libc
+static const char* phase = "boot";
+
+static Site     sites[SOAK_SITES];
+static uint16_t siteCount = 1;          // site 0 is for anything that did not fit
+
+static struct HeapCounters {
+  uint64_t allocs;
+  uint64_t fileAllocs;    // tagged FS_HEAP_TAG, for an open file
+  uint32_t failures;
+  uint32_t freeBytes;
+  uint32_t minFreeBytes;
+  uint64_t liveBytes;
+  uint64_t peakLive;
+} heap;
+
+static inline Block* blockAt(uint32_t offset) { return (Block*)(arena + offset); }
+static inline uint32_t offsetOf(const void* p) { return (const uint8_t*)p - arena; }
+static inline bool inArena(const void* p) { return p >= (const void*)arena && p < (const void*)(arena + arenaSize); }
+
+static void heapInit(size_t size) {
+  arenaSize = size;
+  Block* b = blockAt(0);
+  b->size = arenaSize;
+  NEXT(b) = NO_BLOCK;
+  freeList = 0;
+  heap.freeBytes = arenaSize - SOAK_BLOCK_HEAD;
+  heap.minFreeBytes = heap.freeBytes;
+}
+
+
+// Where blocks are handed out from, for the report's frame names
+void* soakHeapAlloc(size_t size) __attribute__((noinline));
+void  soakHeapFree(void* p) __attribute__((noinline));
+void* soakHeapRealloc(void* p, size_t size) __attribute__((noinline));
+uint16_t soakHeapSite() __attribute__((noinline));
+
+/***************************************************************************************
+**                          Allocation sites
+***************************************************************************************/
+static uint16_t siteSlots[SOAK_SITES * 2];   // open addressing on the site's hash, 0 for empty
+
+// A site is the phase, the tag and for untagged allocations the call stack as
+// it is, the report skips the allocator's own frames when it names one
+uint16_t soakHeapSite() {
+  const char* tag = heapTag;
+  void* frames[SOAK_FRAMES] = {};
+  if (!tag) {
+    backtrace(frames, SOAK_FRAMES);
+  }
+  uint32_t hash = fnv1a32((const uint8_t*)&phase, sizeof(phase));
+  hash = fnv1a32((const uint8_t*)&tag, sizeof(tag), hash);
+  hash = fnv1a32((const uint8_t*)frames, sizeof(frames), hash);
+  for (uint32_t i = 0; i < SOAK_SITES * 2; i++) {
+    uint16_t& slot = siteSlots[(hash + i) % (SOAK_SITES * 2)];
+    if (!slot) {
+      if (siteCount == SOAK_SITES) {
+        return 0;
+      }
+      Site& s = sites[siteCount];
+      s.phase = phase;
+      s.tag = tag;
+      memcpy(s.frames, frames, sizeof(frames));
+      slot = siteCount;
+      return siteCount++;
+    }
+    const Site& s = sites[slot];
+    if (s.phase == phase && s.tag == tag && !memcmp(s.frames, frames, sizeof(frames))) {
+      return slot;
+    }
+  }
+  return 0;
+}
+
+/***************************************************************************************
+**                          First fit heap
+***************************************************************************************/
+static uint32_t corruptions = 0;
+
+static void noteLive(uint16_t site, int64_t bytes) {
+  sites[site].live += bytes;
+  heap.liveBytes += bytes;
+  if (heap.liveBytes > heap.peakLive) {
+    heap.peakLive = heap.liveBytes;
+  }
+}
+
+void* soakHeapAlloc(size_t size) {
+  uint32_t need = size > arenaSize ? UINT32_MAX : (size + SOAK_BLOCK_HEAD + 7) & ~7u;
+  if (need < SOAK_BLOCK_MIN) {
+    need = SOAK_BLOCK_MIN;
+  }
+  uint32_t prev = NO_BLOCK;
+  for (uint32_t at = freeList; at != NO_BLOCK; prev = at, at = NEXT(blockAt(at))) {
+    Block* b = blockAt(at);
+    if (b->size < need) {
+      continue;
+    }
+    uint32_t next = NEXT(b);
+    if (b->size - need >= SOAK_BLOCK_MIN) {
+      Block* rest = blockAt(at + need);
+      rest->size = b->size - need;
+      NEXT(rest) = next;
+      next = at + need;
+      b->size = need;
+      heap.freeBytes -= need;
+    } else {
+      heap.freeBytes -= b->size - SOAK_BLOCK_HEAD;
+    }
+    if (prev == NO_BLOCK) {
+      freeList = next;
+    } else {
+      NEXT(blockAt(prev)) = next;
+    }
+    if (heap.freeBytes < heap.minFreeBytes) {
+      heap.minFreeBytes = heap.freeBytes;
+    }
+
+    b->slack = b->size - SOAK_BLOCK_HEAD - size;
+    b->site = soakHeapSite();
+    b->size |= 1;
+    sites[b->site].allocs++;
+    sites[b->site].bytes += size;
+    heap.allocs++;
+    if (heapTag && !strcmp(heapTag, FS_HEAP_TAG)) {
+      heap.fileAllocs++;
+    }
+    noteLive(b->site, size);
+    return (uint8_t*)b + SOAK_BLOCK_HEAD;
+  }
+  heap.failures++;
+  return NULL;
+}
+
+void soakHeapFree(void* p) {
+  Block* b = (Block*)((uint8_t*)p - SOAK_BLOCK_HEAD);
+  if (((uintptr_t)p & 7) || !(b->size & 1)) {
+    // Freed twice or never handed out, the device would assert
+    corruptions++;
+    return;
+  }
+  b->size &= ~1u;
+  noteLive(b->site, -(int64_t)(b->size - SOAK_BLOCK_HEAD - b->slack));
+  heap.freeBytes += b->size - SOAK_BLOCK_HEAD;
+
+  // Back into the list in address order, merged with its neighbours
+  uint32_t at = offsetOf(b);
+  uint32_t prev = NO_BLOCK;
+  uint32_t next = freeList;
+  while (next != NO_BLOCK && next < at) {
+    prev = next;
+    next = NEXT(blockAt(next));
+  }
+  NEXT(b) = next;
+  if (prev == NO_BLOCK) {
+    freeList = at;
+  } else {
+    NEXT(blockAt(prev)) = at;
+  }
+  if (next != NO_BLOCK && at + b->size == next) {
+    b->size += blockAt(next)->size;
+    NEXT(b) = NEXT(blockAt(next));
+    heap.freeBytes += SOAK_BLOCK_HEAD;
+  }
+  if (prev != NO_BLOCK && prev + blockAt(prev)->size == at) {
+    blockAt(prev)->size += b->size;
+    NEXT(blockAt(prev)) = NEXT(b);
+    heap.freeBytes += SOAK_BLOCK_HEAD;
+  }
+}
+
+// Shrinks in place, grows by moving, as multi_heap does when the next block is taken
+void* soakHeapRealloc(void* p, size_t size) {
+  Block* b = (Block*)((uint8_t*)p - SOAK_BLOCK_HEAD);
+  uint32_t blockSize = b->size & ~1u;
+  uint32_t held = blockSize - SOAK_BLOCK_HEAD - b->slack;
+  if (size + SOAK_BLOCK_HEAD <= blockSize) {
+    uint32_t need = (size + SOAK_BLOCK_HEAD + 7) & ~7u;
+    if (need < SOAK_BLOCK_MIN) {
+      need = SOAK_BLOCK_MIN;
+    }
+    noteLive(b->site, (int64_t)size - held);
+    if (blockSize - need >= SOAK_BLOCK_MIN) {
+      // The tail becomes a block of its own, handed out empty and freed
+      Block* tail = blockAt(offsetOf(b) + need);
+      tail->size = (blockSize - need) | 1;
+      tail->site = 0;
+      tail->slack = blockSize - need - SOAK_BLOCK_HEAD;
+      b->size = need | 1;
+      blockSize = need;
+      soakHeapFree((uint8_t*)tail + SOAK_BLOCK_HEAD);
+    }
+    b->slack = blockSize - SOAK_BLOCK_HEAD - size;
+    return p;
+  }
+  void* moved = soakHeapAlloc(size);
+  if (moved) {
+    memcpy(moved, p, held);
+    soakHeapFree(p);
+  }
+  return moved;
+}
+
+static uint32_t largestFree() {
+  uint32_t largest = 0;
+  for (uint32_t at = freeList; at != NO_BLOCK; at = NEXT(blockAt(at))) {
+    largest = max(largest, blockAt(at)->size);
+  }
+  return largest ? largest - SOAK_BLOCK_HEAD : 0;
+}
+
+EspClass ESP;
+uint32_t EspClass::getFreeHeap() { return heap.freeBytes; }
+uint32_t EspClass::getMaxAllocHeap() { return largestFree(); }
+uint32_t EspClass::getMinFreeHeap() { return heap.minFreeBytes; }
+
+/***************************************************************************************
+**                          malloc and friends
+***************************************************************************************/
+// The sketch's allocations, and the C++ runtime's on its behalf, go to the
+// simulated heap while a DeviceScope is open. Everything else, the harness
+// and backtrace() among it, stays on the host's.
+static inline bool toDevice() { return onDevice && !inAllocator; }
+
+extern "C" void* malloc(size_t size) noexcept {
+  if (!toDevice()) {
+    return __libc_malloc(size);
+  }
+  inAllocator = true;
+  void* p = soakHeapAlloc(size);
+  inAllocator = false;
+  return p;
+}
+
+extern "C" void free(void* p) noexcept {
+  if (!inArena(p)) {
+    __libc_free(p);
+    return;
+  }
+  inAllocator = true;
+  soakHeapFree(p);
+  inAllocator = false;
+}
+
+extern "C" void* calloc(size_t n, size_t size) noexcept {
+  if (!toDevice()) {
+    return __libc_calloc(n, size);
+  }
+  if (size && n > SIZE_MAX / size) {
+    return NULL;
+  }
+  void* p = malloc(n * size);
+  if (p) {
+    memset(p, 0, n * size);
+  }
+  return p;
+}
+
+extern "C" void* realloc(void* p, size_t size) noexcept {
+  if (!p) {
+    return malloc(size);
+  }
+  if (!inArena(p)) {
+    return __libc_realloc(p, size);
+  }
+  if (!size) {
+    free(p);
+    return NULL;
+  }
+  bool nested = inAllocator;
+  inAllocator = true;
+  void* moved = soakHeapRealloc(p, size);
+  inAllocator = nested;
+  return moved;
+}
+
+// Blocks are 8 byte aligned, anything stricter is left to the host
+extern "C" void* memalign(size_t align, size_t size) noexcept {
+  return align <= 8 && toDevice() ? malloc(size) : __libc_memalign(align, size);
+}
+
+extern "C" void* aligned_alloc(size_t align, size_t size) noexcept { return memalign(align, size); }
+
+extern "C" int posix_memalign(void** out, size_t align, size_t size) noexcept {
+  void* p = memalign(align, size);
+  if (!p) {
+    return ENOMEM;
+  }
+  *out = p;
+  return 0;
+}
+
+extern "C" void* valloc(size_t size) noexcept { return __libc_memalign(4096, size); }
+extern "C" void* pvalloc(size_t size) noexcept { return __libc_memalign(4096, (size + 4095) & ~(size_t)4095); }
+
+class DeviceScope {
+  public:
+    DeviceScope() : saved(onDevice) { onDevice = true; }
+    ~DeviceScope() { onDevice = this->saved; }
+
+  private:
+    bool saved;
+};
+
+class HostScope {
+  public:
+    HostScope() : saved(onDevice) { onDevice = false; }
+    ~HostScope() { onDevice = this->saved; }
+
+  private:
+    bool saved;
+};
+
+// Names the part of the sketch that is running, for the hotspot table
+class Phase {
+  public:
+    Phase(const char* name) : saved(phase) { phase = name; }
+    ~Phase() { phase = this->saved; }
+
+  private:
+    const char* saved;
+};
+
+/***************************************************************************************
+**                          Options
+***************************************************************************************/
+static struct Options {
+  int         days = 30;
+  unsigned    seed = 1;
+  size_t      heapKB = 180;         // what the sketch has once WiFi and TLS are up
+  const char* replay = "tools/upstream";
+  double      error = 0.02;
+  double      disconnect = 0.02;
+  double      garbage = 0.02;
+  double      chunked = 0.5;
+  uint32_t    bandwidth = 20000;    // bytes per second
+  uint32_t    slack = 512;          // bytes
+  uint32_t    fragPoints = 2;       // percentage points
+  int         top = 15;
+  bool        bare = false;
+  bool        verbose = false;
+  bool        wrap = false;
+  bool        metricsDump = false;
+} opt;
+
+/***************************************************************************************
+**                          Upstream
+***************************************************************************************/
+typedef enum {
+  UPSTREAM_USGS = 0,
+  UPSTREAM_NWS,
+  UPSTREAM_OPENWEATHER,
+  UPSTREAM_COUNT
+} Upstream;
+
+// Folder names as upstream_sim.py records them
+static const char* const upstreamNames[UPSTREAM_COUNT] = { "usgs", "nws", "openweather" };
+
+static std::vector<std::string> recordings[UPSTREAM_COUNT];
+static size_t      nextRecording[UPSTREAM_COUNT];
+static std::string responseBody;     // the body being sent, until the next GET
+
+static struct UpstreamStats {
+  uint32_t requests;
+  uint32_t errors;
+  uint32_t disconnects;
+  uint32_t garbled;
+  uint32_t chunked;
+} upstreamStats[UPSTREAM_COUNT];
+
+static bool chance(double rate) {
+  return rate > 0 && ::random() < rate * RAND_MAX;
+}
+
+static void loadRecordings(const char* root) {
+  for (int src = 0; src < UPSTREAM_COUNT; src++) {
+    std::string folder = std::string(root) + "/" + upstreamNames[src];
+    DIR* dir = opendir(folder.c_str());
+    if (!dir) {
+      continue;
+    }
+    std::vector<std::string> names;
+    while (struct dirent* e = readdir(dir)) {
+      size_t n = strlen(e->d_name);
+      if (n > 5 && !strcmp(e->d_name + n - 5, ".body")) {
+        names.push_back(e->d_name);
+      }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+    for (const std::string& name : names) {
+      FILE* f = fopen((folder + "/" + name).c_str(), "rb");
+      if (!f) {
+        continue;
+      }
+      std::string body;
+      char buffer[4096];
+      size_t n;
+      while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        body.append(buffer, n);
+      }
+      fclose(f);
+      recordings[src].push_back(body);
+    }
+  }
+}
+
+// The river rises and falls over about a week, with a daily ripple
+static float riverStage(uint32_t t) {
+  double days = (double)(t - SOAK_UNIX_START) / 86400.0;
+  return 3.8 + 1.2 * sin(days * 2 * M_PI / 6.5) + 0.15 * sin(days * 2 * M_PI);
+}
+
+static int riverFlow(float stage) {
+  return (int)(1200 * pow(stage, 1.8));
+}
+
+static float airTemperature(uint32_t t) {
+  double days = (double)(t - SOAK_UNIX_START) / 86400.0;
+  return 50 + 12 * sin((days - 0.6) * 2 * M_PI) + 8 * sin(days * 2 * M_PI / 9);
+}
+
+static float rainChance(uint32_t t) {
+  double days = (double)(t - SOAK_UNIX_START) / 86400.0;
+  return constrain(sin(days * 2 * M_PI / 3.7) * 1.2 - 0.3, 0.0, 1.0);
+}
+
+static void appendf(std::string& out, const char* format, ...) __attribute__((format(printf, 2, 3)));
+static void appendf(std::string& out, const char* format, ...) {
+  char text[512];
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  out.append(text, n < (int)sizeof(text) ? n : sizeof(text) - 1);
+}
+
+static std::string isoTime(uint32_t t) {
+  time_t tt = t;
+  struct tm utc;
+  gmtime_r(&tt, &utc);
+  char text[32];
+  strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S-00:00", &utc);
+  return text;
+}
+
+// A day of 15 minute rows, the last one 10 to 25 minutes old, in local time
+static std::string usgsBody(uint32_t now) {
+  std::string out;
+  out += "# ---------------------------------- WARNING ----------------------------------------\n";
+  out += "# Some of the data that you have obtained from this U.S. Geological Survey database\n";
+  out += "# may not have received Director's approval.\n#\n";
+  out += "agency_cd\tsite_no\tdatetime\ttz_cd\t69928_00065\t69928_00065_cd\t69929_00060\t69929_00060_cd\t69930_00010\t69930_00010_cd\n";
+  out += "5s\t15s\t20d\t6s\t14n\t10s\t14n\t10s\t14n\t10s\n";
+  uint32_t last = (now - 10 * 60) / 900 * 900;
+  for (uint32_t t = last - 95 * 900; t <= last; t += 900) {
+    struct tm local = localTime(t);
+    float stage = riverStage(t);
+    appendf(out, "USGS\t%s\t%04d-%02d-%02d %02d:%02d\t%s\t%.2f\tP\t%d\tP\t%.1f\tP\n", USGS_STATION,
+            local.tm_year + 1900, local.tm_mon + 1, local.tm_mday, local.tm_hour, local.tm_min,
+            easternOffsetMinutes(t) == -240 ? "EDT" : "EST", stage, riverFlow(stage), (airTemperature(t) - 32) / 1.8 + 4);
+  }
+  return out;
+}
+
+// Forecasts go out at 01:30, 07:30, 13:30 and 19:30 UTC and show up half an
+// hour later, observations are hourly, newest first
+static std::string nwsBody(uint32_t now) {
+  uint32_t issued = (now - 7200) / 21600 * 21600 + 5400;
+  std::string out;
+  appendf(out, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<site timezone=\"UTC\" originator=\"NWS\" "
+               "name=\"Potomac River at Little Falls\" id=\"%s\" generationtime=\"%s\">\n",
+          NWIS_STATION, isoTime(now).c_str());
+  out += "<disclaimers><AHPSXMLversion>2.2</AHPSXMLversion><status>No Flooding</status></disclaimers>\n";
+  out += "<sigstages><low units=\"ft\"></low><action units=\"ft\">8</action><flood units=\"ft\">10</flood></sigstages>\n";
+  out += "<rating>";
+  for (int i = 0; i < 40; i++) {
+    appendf(out, "<datum stage=\"%.2f\" flow=\"%.2f\"/>", 1.0 + i * 0.5, riverFlow(1.0 + i * 0.5) / 1000.0);
+  }
+  out += "</rating>\n<observed>\n";
+  uint32_t last = (now - 20 * 60) / 3600 * 3600;
+  for (int i = 0; i < 48; i++) {
+    uint32_t t = last - i * 3600;
+    appendf(out, "<datum><valid timezone=\"UTC\">%s</valid><primary name=\"Stage\" units=\"ft\">%.2f</primary>"
+                 "<secondary name=\"Flow\" units=\"kcfs\">%.2f</secondary><pedts>HGIRG</pedts></datum>\n",
+            isoTime(t).c_str(), riverStage(t), riverFlow(riverStage(t)) / 1000.0);
+  }
+  appendf(out, "</observed>\n<forecast timezone=\"UTC\" issued=\"%s\">\n", isoTime(issued).c_str());
+  uint32_t first = (issued + 21599) / 21600 * 21600;
+  for (int i = 0; i < 14; i++) {
+    uint32_t t = first + i * 21600;
+    float stage = riverStage(t) + 0.1f * sin(issued / 21600.0 + i);
+    appendf(out, "<datum><valid timezone=\"UTC\">%s</valid><primary name=\"Stage\" units=\"ft\">%.2f</primary>"
+                 "<secondary name=\"Flow\" units=\"kcfs\">%.2f</secondary><pedts>HGIFF</pedts></datum>\n",
+            isoTime(t).c_str(), stage, riverFlow(stage) / 1000.0);
+  }
+  out += "</forecast>\n</site>\n";
+  return out;
+}
+
+static int conditionId(float pop) {
+  return pop > 0.6f ? 501 : pop > 0.3f ? 500 : pop > 0.15f ? 803 : 800;
+}
+
+static std::string weatherBody(uint32_t now) {
+  int offset = easternOffsetMinutes(now) * 60;
+  uint32_t midnight = (now + offset) / 86400 * 86400 - offset;
+  std::string out;
+  appendf(out, "{\"lat\":%s,\"lon\":%s,\"timezone\":\"America/New_York\",\"timezone_offset\":%d,", WEATHER_LAT, WEATHER_LON, offset);
+  appendf(out, "\"current\":{\"dt\":%u,\"sunrise\":%u,\"sunset\":%u,\"temp\":%.2f,\"feels_like\":%.2f,\"pressure\":%d,"
+               "\"humidity\":%d,\"dew_point\":%.2f,\"uvi\":0,\"clouds\":%d,\"visibility\":10000,\"wind_speed\":%.2f,"
+               "\"wind_deg\":%d,\"weather\":[{\"id\":%d,\"main\":\"%s\",\"description\":\"scattered clouds\",\"icon\":\"03d\"}]},",
+          now, midnight + 6 * 3600 + 1800, midnight + 17 * 3600, airTemperature(now), airTemperature(now) - 2,
+          1000 + (int)(rainChance(now) * -20) + 20, 40 + (int)(rainChance(now) * 50), airTemperature(now) - 10,
+          (int)(rainChance(now) * 100), 3 + 10 * rainChance(now), (int)(now / 600 % 360),
+          conditionId(rainChance(now)), rainChance(now) > 0.3f ? "Rain" : "Clouds");
+  out += "\"hourly\":[";
+  uint32_t hour = now / 3600 * 3600;
+  for (int i = 0; i < 48; i++) {
+    uint32_t t = hour + i * 3600;
+    float pop = rainChance(t);
+    appendf(out, "%s{\"dt\":%u,\"temp\":%.2f,\"feels_like\":%.2f,\"pressure\":1012,\"humidity\":60,\"clouds\":%d,"
+                 "\"wind_speed\":%.2f,\"wind_deg\":%d,\"wind_gust\":%.2f,\"weather\":[{\"id\":%d,\"main\":\"Clouds\","
+                 "\"description\":\"broken clouds\",\"icon\":\"04n\"}],\"pop\":%.2f}",
+            i ? "," : "", t, airTemperature(t), airTemperature(t) - 2, (int)(pop * 100), 3 + 12 * pop,
+            (int)(t / 3600 * 37 % 360), 8 + 15 * pop, conditionId(pop), pop);
+  }
+  out += "],\"daily\":[";
+  for (int i = 0; i < 8; i++) {
+    uint32_t t = midnight + i * 86400 + 12 * 3600;
+    appendf(out, "%s{\"dt\":%u,\"sunrise\":%u,\"sunset\":%u,\"moon_phase\":0.25,\"temp\":{\"day\":%.2f,\"min\":%.2f,"
+                 "\"max\":%.2f,\"night\":%.2f,\"eve\":%.2f,\"morn\":%.2f},\"weather\":[{\"id\":%d,\"main\":\"Clouds\","
+                 "\"description\":\"overcast clouds\",\"icon\":\"04d\"}],\"pop\":%.2f}",
+            i ? "," : "", t, t - 5 * 3600 - 1800, t + 5 * 3600, airTemperature(t), airTemperature(t) - 12,
+            airTemperature(t) + 3, airTemperature(t) - 9, airTemperature(t), airTemperature(t) - 10,
+            conditionId(rainChance(t)), rainChance(t));
+  }
+  out += "]}";
+  return out;
+}
+
+// "%x\r\n" framing in chunks of 1 to 512 bytes, as upstream_sim sends it
+static std::string chunk(const std::string& body) {
+  std::string out;
+  for (size_t sent = 0; sent < body.size(); ) {
+    size_t n = min(body.size() - sent, (size_t)(1 + ::random() % 512));
+    appendf(out, "%zx\r\n", n);
+    out.append(body, sent, n);
+    out += "\r\n";
+    sent += n;
+  }
+  out += "0\r\n\r\n";
+  return out;
+}
+
+// Answers the stand-in HTTPClient's GET, on the host heap
+static bool respond(const char* url, HostResponse* response) {
+  HostScope host;
+  int src = strstr(url, "/nwis/") ? UPSTREAM_USGS :
+            strstr(url, "hydrograph_to_xml") ? UPSTREAM_NWS :
+            strstr(url, "/onecall") ? UPSTREAM_OPENWEATHER : -1;
+  if (src < 0) {
+    return false;
+  }
+  UpstreamStats& stats = upstreamStats[src];
+  stats.requests++;
+  response->latencyMs = 150 + ::random() % 600;
+  response->bytesPerSecond = opt.bandwidth;
+  if (chance(opt.error)) {
+    stats.errors++;
+    response->code = 503;
+    responseBody.clear();
+    response->body = responseBody.data();
+    response->length = 0;
+    return true;
+  }
+
+  std::string body;
+  if (!recordings[src].empty()) {
+    body = recordings[src][nextRecording[src]++ % recordings[src].size()];
+  } else if (src == UPSTREAM_USGS) {
+    body = usgsBody(unixNow());
+  } else if (src == UPSTREAM_NWS) {
+    body = nwsBody(unixNow());
+  } else {
+    body = weatherBody(unixNow());
+  }
+  if (chance(opt.garbage) && !body.empty()) {
+    stats.garbled++;
+    size_t start = ::random() % body.size();
+    size_t end = min(body.size(), start + 1 + ::random() % 64);
+    for (size_t i = start; i < end; i++) {
+      body[i] = ::random() % 256;
+    }
+  }
+  response->code = 200;
+  if (chance(opt.chunked)) {
+    stats.chunked++;
+    response->chunked = true;
+    body = chunk(body);
+  }
+  responseBody.swap(body);
+  response->body = responseBody.data();
+  response->length = responseBody.size();
+  if (chance(opt.disconnect) && response->length) {
+    stats.disconnects++;
+    response->cutAt = ::random() % response->length;
+  }
+  return true;
+}
+
+/***************************************************************************************
+**                          Time server
+***************************************************************************************/
+static void putTimestamp(uint8_t* p, uint64_t unixUs) {
+  uint32_t seconds = (uint32_t)(unixUs / 1000000 + 2208988800ULL);
+  uint32_t fraction = (uint32_t)(((unixUs % 1000000) << 32) / 1000000);
+  for (int i = 0; i < 4; i++) {
+    p[i] = (uint8_t)(seconds >> (24 - 8 * i));
+    p[4 + i] = (uint8_t)(fraction >> (24 - 8 * i));
+  }
+}
+
+// Answers SntpClock at once with the simulated time, so the clock is set and
+// the pages have a time and date to draw
+static void answerSntp(WiFiUDP* udp, IPAddress, uint16_t, const uint8_t* request, size_t len) {
+  if (len < SNTP_PACKET_LEN) {
+    return;
+  }
+  uint8_t reply[SNTP_PACKET_LEN] = {};
+  reply[0] = 0x24;                        // no leap warning, version 4, server
+  reply[1] = 2;                           // stratum
+  memcpy(reply + 24, request + 40, 8);    // the request's transmit time is the origin
+  uint64_t nowUs = (uint64_t)SOAK_UNIX_START * 1000000 + elapsedMs * 1000;
+  putTimestamp(reply + 32, nowUs);
+  putTimestamp(reply + 40, nowUs);
+  udp->deliver(reply, sizeof(reply));
+}
+
+/***************************************************************************************
+**                          The sketch, as RiverWeather.ino wires it
+***************************************************************************************/
+#define AA_FONT_SMALL "fonts/NotoSansBold15"
+
+void XML_callback(uint8_t statusflags, char* tagName, uint16_t tagNameLen, char* data, uint16_t dataLen);
+
+static TFT_eSPI tft;
+static SmoothFont smallFont(&tft, AA_FONT_SMALL);
+static GfxUi ui(&tft);
+static OneCallWeather oneCall(OPENWEATHER_BASE_URL, ONECALLKEY, WEATHER_LAT, WEATHER_LON, units.c_str());
+static Hydrograph hydrograph(NWIS_STATION, NWS_BASE_URL, &XML_callback);
+static HydrographView hydrographView(&tft, &hydrograph, &smallFont);
+static SntpClock systemClock(SNTP_SERVER);
+static USGSStation usgs(USGS_STATION, USGS_BASE_URL);
+static Astronomy astronomy(atof(WEATHER_LAT), atof(WEATHER_LON));
+
+// Loaded from PLAY_LEVELS_FILE as the sketch does, data/levels/01646500.bin here
+static PlayLevels playLevels;
+static RiverAnalytics riverAnalytics(playLevels.boundaries(), playLevels.boundaryCount());
+static RiverPages pages(&tft, &smallFont, &ui, &oneCall, &usgs, &hydrographView, &astronomy, &riverAnalytics,
+                        &playLevels, &systemClock);
+
+static NetScheduler netScheduler;
+static PollPlanner pollPlanner;
+static RiverFetch riverFetch(&usgs, &hydrograph, &oneCall, &riverAnalytics, &pages, &systemClock, &netScheduler,
+                             &pollPlanner);
+
+// The functions below are not static, so the hotspot table can name them
+
+void XML_callback(uint8_t statusflags, char* tagName, uint16_t tagNameLen, char* data, uint16_t dataLen) {
+  hydrograph.processXML(statusflags, tagName, tagNameLen, data, dataLen);
+}
+
+// Heap allocations made while the pages draw. Once boot has drawn both pages
+// the only ones allowed are the file system's while an icon is read, and
+// those have to be freed before the draw returns.
+static struct RenderCounters {
+  uint32_t renders;
+  uint64_t allocs;        // other than the file system's
+  uint32_t allocating;    // renders that made them
+  uint64_t fileAllocs;
+  uint32_t holding;       // renders that left more live bytes than they found
+} render;
+
+class RenderScope {
+  public:
+    RenderScope() : allocsBefore(heap.allocs), fileAllocsBefore(heap.fileAllocs), liveBefore(heap.liveBytes) {}
+    ~RenderScope() {
+      uint64_t fileAllocs = heap.fileAllocs - this->fileAllocsBefore;
+      uint64_t allocs = heap.allocs - this->allocsBefore - fileAllocs;
+      render.renders++;
+      render.allocs += allocs;
+      render.allocating += allocs != 0;
+      render.fileAllocs += fileAllocs;
+      render.holding += heap.liveBytes > this->liveBefore;
+    }
+
+  private:
+    uint64_t allocsBefore;
+    uint64_t fileAllocsBefore;
+    uint64_t liveBefore;
+};
+
+// The fetch's redraw, counted
+bool redrawFetched(uint8_t source) {
+  RenderScope r;
+  return riverFetch.refresh(source);
+}
+
+// All the sources of a window back to back, the display task's turns in
+// between allocate nothing
+void runNetWindow() {
+  if (!netScheduler.beginWindow(millis())) {
+    return;
+  }
+  for (uint8_t source = netScheduler.nextInWindow(); source != NET_SOURCE_NONE; source = netScheduler.nextInWindow()) {
+    switch (source) {
+      case NET_USGS: {
+        Phase p("USGS fetch");
+        riverFetch.fetchUSGSStation();
+        break;
+      }
+      case NET_NWS: {
+        Phase p("NWS fetch");
+        riverFetch.fetchHydrograph();
+        break;
+      }
+      case NET_WEATHER: {
+        Phase p("OpenWeather fetch");
+        riverFetch.fetchWeather();
+        break;
+      }
+      default:
+        // The clock was set at boot and there are no peers
+        netScheduler.completed(source, millis());
+        break;
+    }
+  }
+}
+
+void showPage(int page) {
+  RenderScope r;
+  pages.show(page);
+}
+
+// A tap or swipe: most often a page change, otherwise a drag of the table
+// run through to the end of its animation
+void touch() {
+  Phase p("touch");
+  if (pages.page() == SHOW_CURRENT || ::random() % 3) {
+    showPage(pages.page() == SHOW_FORECAST ? SHOW_CURRENT : SHOW_FORECAST);
+    return;
+  }
+  int16_t dy = (::random() % 2 ? 1 : -1) * (40 + ::random() % 200);
+  if (hydrographView.scrollBy(dy)) {
+    bool more = true;
+    while (more) {
+      {
+        RenderScope r;
+        more = hydrographView.step();
+      }
+      delay(HYDROGRAPH_VIEW_FRAME_MS);
+    }
+  }
+}
+
+/***************************************************************************************
+**                          Samples
+***************************************************************************************/
+#define DAY_MS  (24 * 60 * 60 * 1000ULL)
+#define HOUR_MS (60 * 60 * 1000ULL)
+
+typedef struct DayStats {
+  uint32_t fetches;
+  uint32_t failures;
+  uint64_t allocs;
+  uint64_t minLive;       // at the hourly samples, between windows
+  uint64_t maxLive;
+  uint64_t peakLive;      // at any time, windows included
+  uint32_t minFree;
+  uint32_t minLargest;
+  uint32_t maxFragTenths; // 1000 - largest * 1000 / free
+  uint32_t samples;
+} DayStats;
+
+static DayStats dayStats[SOAK_DAYS_MAX];
+
+static uint32_t fragTenths(uint32_t free, uint32_t largest) {
+  return free ? 1000 - (uint64_t)largest * 1000 / free : 0;
+}
+
+static void sample(int day) {
+  DayStats& d = dayStats[day];
+  uint32_t free = ESP.getFreeHeap();
+  uint32_t largest = ESP.getMaxAllocHeap();
+  if (!d.samples++) {
+    d.minLive = d.maxLive = heap.liveBytes;
+    d.minFree = free;
+    d.minLargest = largest;
+  }
+  d.minLive = min(d.minLive, heap.liveBytes);
+  d.maxLive = max(d.maxLive, heap.liveBytes);
+  d.minFree = min(d.minFree, free);
+  d.minLargest = min(d.minLargest, largest);
+  d.maxFragTenths = max(d.maxFragTenths, fragTenths(free, largest));
+}
+
+// USGS, NWS and OpenWeather fetches so far, or the ones of them that failed,
+// as the fetches count them for the metrics
+static uint32_t fetchCount(bool failed) {
+  uint32_t count = 0;
+  for (int source = METRIC_SOURCE_USGS; source <= METRIC_SOURCE_OPENWEATHER; source++) {
+    count += failed ? metrics.fetches[source].failures : metrics.fetches[source].fetches;
+  }
+  return count;
+}
+
+static void endDay(int day) {
+  static uint64_t allocsBefore = 0;
+  static uint32_t fetchesBefore = 0;
+  static uint32_t failuresBefore = 0;
+  DayStats& d = dayStats[day];
+  uint32_t fetches = fetchCount(false), failures = fetchCount(true);
+  d.fetches = fetches - fetchesBefore;
+  d.failures = failures - failuresBefore;
+  fetchesBefore = fetches;
+  failuresBefore = failures;
+  d.allocs = heap.allocs - allocsBefore;
+  d.peakLive = heap.peakLive;
+  allocsBefore = heap.allocs;
+  heap.peakLive = heap.liveBytes;
+  // The second day is the baseline, boot has made what the sketch keeps by then
+  if (day == 1) {
+    for (int i = 0; i < siteCount; i++) {
+      sites[i].liveAtMark = sites[i].live;
+    }
+  }
+  if (opt.verbose) {
+    HostScope host;
+    printf("Day %d done: %llu bytes live, %u free, %u largest\n", day + 1,
+           (unsigned long long)heap.liveBytes, ESP.getFreeHeap(), ESP.getMaxAllocHeap());
+  }
+}
+
+/***************************************************************************************
+**                          Report
+***************************************************************************************/
+static std::string frameName(void* address) {
+  Dl_info info;
+  if (!dladdr(address, &info) || !info.dli_sname) {
+    return "";
+  }
+  int status = -1;
+  char* demangled = abi::__cxa_demangle(info.dli_sname, NULL, NULL, &status);
+  std::string name = status == 0 && demangled ? demangled : info.dli_sname;
+  free(demangled);
+  size_t paren = name.find('(');
+  if (paren != std::string::npos) {
+    name.resize(paren);
+  }
+  return name;
+}
+
+// The allocator, the C++ runtime and String are how an allocation is made,
+// not who made it
+static bool plumbing(const std::string& name) {
+  static const char* const prefixes[] = {
+    "malloc", "calloc", "realloc", "free", "soakHeap", "operator new", "String::", "std::", "__gnu_cxx", "__libc", "void std::"
+  };
+  for (const char* prefix : prefixes) {
+    if (!name.compare(0, strlen(prefix), prefix)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static std::string siteName(const Site& s) {
+  if (s.tag) {
+    return s.tag;
+  }
+  for (void* frame : s.frames) {
+    if (!frame) {
+      break;
+    }
+    std::string name = frameName(frame);
+    if (!name.empty() && !plumbing(name)) {
+      return name;
+    }
+  }
+  return "?";
+}
+
+typedef struct Hotspot {
+  std::string phase;
+  std::string what;
+  uint64_t    allocs = 0;
+  uint64_t    bytes = 0;
+  int64_t     live = 0;
+  int64_t     growth = 0;
+} Hotspot;
+
+static std::vector<Hotspot> hotspots() {
+  std::vector<Hotspot> list;
+  for (int i = 1; i < siteCount; i++) {
+    const Site& s = sites[i];
+    std::string what = siteName(s);
+    auto it = std::find_if(list.begin(), list.end(), [&](const Hotspot& h) { return h.phase == s.phase && h.what == what; });
+    if (it == list.end()) {
+      list.push_back(Hotspot());
+      it = list.end() - 1;
+      it->phase = s.phase;
+      it->what = what;
+    }
+    it->allocs += s.allocs;
+    it->bytes += s.bytes;
+    it->live += s.live;
+    it->growth += s.live - s.liveAtMark;
+  }
+  if (sites[0].allocs) {
+    Hotspot other;
+    other.phase = "-";
+    other.what = "(site table full)";
+    other.allocs = sites[0].allocs;
+    other.bytes = sites[0].bytes;
+    other.live = sites[0].live;
+    other.growth = sites[0].live - sites[0].liveAtMark;
+    list.push_back(other);
+  }
+  return list;
+}
+
+static bool report(int days) {
+  printf("\n Day  Fetches  Failed    Allocs  Live min  Live max      Peak  Min free  Largest  Frag%%\n");
+  for (int day = 0; day < days; day++) {
+    const DayStats& d = dayStats[day];
+    printf("%4d  %7u  %6u  %8llu  %8llu  %8llu  %8llu  %8u  %7u  %5.1f\n", day + 1, d.fetches, d.failures,
+           (unsigned long long)d.allocs, (unsigned long long)d.minLive, (unsigned long long)d.maxLive,
+           (unsigned long long)d.peakLive, d.minFree, d.minLargest, d.maxFragTenths / 10.0);
+  }
+
+  std::vector<Hotspot> list = hotspots();
+  std::sort(list.begin(), list.end(), [](const Hotspot& a, const Hotspot& b) { return a.allocs > b.allocs; });
+  printf("\nHotspots, by allocations a day\n");
+  printf("  %-18s %-36s %9s %10s %8s\n", "Phase", "Site", "Allocs/d", "Bytes/d", "Live");
+  for (int i = 0; i < (int)list.size() && i < opt.top; i++) {
+    const Hotspot& h = list[i];
+    printf("  %-18s %-36.36s %9llu %10llu %8lld\n", h.phase.c_str(), h.what.c_str(),
+           (unsigned long long)(h.allocs / days), (unsigned long long)(h.bytes / days), (long long)h.live);
+  }
+
+  printf("\nHeld at the end\n");
+  for (const Hotspot& h : list) {
+    if (h.live > 0) {
+      printf("  %-18s %-36.36s %8lld\n", h.phase.c_str(), h.what.c_str(), (long long)h.live);
+    }
+  }
+
+  std::vector<Hotspot> growing;
+  for (const Hotspot& h : list) {
+    if (h.growth > 0) {
+      growing.push_back(h);
+    }
+  }
+  std::sort(growing.begin(), growing.end(), [](const Hotspot& a, const Hotspot& b) { return a.growth > b.growth; });
+  if (!growing.empty() && days >= 3) {
+    printf("\nLive bytes grown since day 2\n");
+    for (const Hotspot& h : growing) {
+      printf("  %-18s %-36.36s %+8lld\n", h.phase.c_str(), h.what.c_str(), (long long)h.growth);
+    }
+  }
+
+  printf("\nUpstream   Requests  503s  Cut  Garbled  Chunked   (%zu, %zu and %zu recordings)\n",
+         recordings[UPSTREAM_USGS].size(), recordings[UPSTREAM_NWS].size(), recordings[UPSTREAM_OPENWEATHER].size());
+  for (int src = 0; src < UPSTREAM_COUNT; src++) {
+    const UpstreamStats& s = upstreamStats[src];
+    printf("  %-11s %7u %5u %4u %8u %8u\n", upstreamNames[src], s.requests, s.errors, s.disconnects, s.garbled, s.chunked);
+  }
+
+  bool pass = true;
+  printf("\n");
+  if (heap.failures) {
+    printf("FAIL: %u allocations failed\n", heap.failures);
+    pass = false;
+  }
+  if (corruptions) {
+    printf("FAIL: %u frees of blocks not in use\n", corruptions);
+    pass = false;
+  }
+  if (fetchCount(false) == fetchCount(true)) {
+    printf("FAIL: no fetch was parsed, nothing was exercised\n");
+    pass = false;
+  }
+  if (render.allocs) {
+    printf("FAIL: %u of %u renders after boot made %llu allocations\n", render.allocating, render.renders,
+           (unsigned long long)render.allocs);
+    pass = false;
+  } else {
+    printf("%u renders after boot, none allocated but the file system's %llu while reading icons\n",
+           render.renders, (unsigned long long)render.fileAllocs);
+  }
+  if (render.holding) {
+    printf("FAIL: %u renders after boot left more of the heap in use than they found\n", render.holding);
+    pass = false;
+  }
+  if (days < 3) {
+    printf("%d days is too short to compare against day 2\n", days);
+    return pass;
+  }
+  const DayStats& base = dayStats[1];
+  const DayStats& last = dayStats[days - 1];
+  if (last.maxLive > base.maxLive + opt.slack) {
+    printf("FAIL: live heap between windows grew from %llu to %llu bytes\n",
+           (unsigned long long)base.maxLive, (unsigned long long)last.maxLive);
+    pass = false;
+  }
+  if (last.minLargest + opt.slack < base.minLargest) {
+    printf("FAIL: largest free block shrank from %u to %u bytes\n", base.minLargest, last.minLargest);
+    pass = false;
+  }
+  if (last.maxFragTenths > base.maxFragTenths + opt.fragPoints * 10) {
+    printf("FAIL: fragmentation rose from %.1f%% to %.1f%%\n", base.maxFragTenths / 10.0, last.maxFragTenths / 10.0);
+    pass = false;
+  }
+  if (pass) {
+    printf("PASS: %d days, live heap %llu -> %llu bytes, largest block %u -> %u, fragmentation %.1f%% -> %.1f%%\n",
+           days, (unsigned long long)base.maxLive, (unsigned long long)last.maxLive, base.minLargest, last.minLargest,
+           base.maxFragTenths / 10.0, last.maxFragTenths / 10.0);
+  }
+  return pass;
+}
+
+/***************************************************************************************
+**                          Run
+***************************************************************************************/
+static void usage() {
+  printf("usage: soak [--days N] [--seed N] [--heap KB] [--replay DIR] [--error R] [--disconnect R]\n"
+         "            [--garbage R] [--chunked R] [--bandwidth B/s] [--slack BYTES] [--frag POINTS]\n"
+         "            [--top N] [--bare] [--wrap] [--verbose] [--metrics]\n");
+}
+
+static bool parseOptions(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    const char* a = argv[i];
+    if (!strcmp(a, "--bare")) { opt.bare = true; continue; }
+    if (!strcmp(a, "--wrap")) { opt.wrap = true; continue; }
+    if (!strcmp(a, "--verbose")) { opt.verbose = true; continue; }
+    if (!strcmp(a, "--metrics")) { opt.metricsDump = true; continue; }
+    if (i + 1 == argc) {
+      return false;
+    }
+    const char* v = argv[++i];
+    if (!strcmp(a, "--days")) opt.days = atoi(v);
+    else if (!strcmp(a, "--seed")) opt.seed = strtoul(v, NULL, 10);
+    else if (!strcmp(a, "--heap")) opt.heapKB = strtoul(v, NULL, 10);
+    else if (!strcmp(a, "--replay")) opt.replay = v;
+    else if (!strcmp(a, "--error")) opt.error = atof(v);
+    else if (!strcmp(a, "--disconnect")) opt.disconnect = atof(v);
+    else if (!strcmp(a, "--garbage")) opt.garbage = atof(v);
+    else if (!strcmp(a, "--chunked")) opt.chunked = atof(v);
+    else if (!strcmp(a, "--bandwidth")) opt.bandwidth = strtoul(v, NULL, 10);
+    else if (!strcmp(a, "--slack")) opt.slack = strtoul(v, NULL, 10);
+    else if (!strcmp(a, "--frag")) opt.fragPoints = strtoul(v, NULL, 10);
+    else if (!strcmp(a, "--top")) opt.top = atoi(v);
+    else return false;
+  }
+  return opt.days > 0 && opt.days <= SOAK_DAYS_MAX && opt.heapKB >= 32 && opt.heapKB * 1024 <= SOAK_HEAP_MAX;
+}
+
+int main(int argc, char** argv) {
+  if (!parseOptions(argc, argv)) {
+    usage();
+    return 2;
+  }
+  srandom(opt.seed);
+  srand(opt.seed);
+  Serial.echo = opt.verbose;
+  WiFiClient::platformHeap = !opt.bare;
+  HTTPClient::responder = respond;
+  uint64_t endMs = opt.days * DAY_MS;
+  // --wrap puts the millis() rollover half way through the run
+  clockMs = opt.wrap ? (uint32_t)(0x100000000ULL - (endMs / 2) % 0x100000000ULL) : 0;
+
+  loadRecordings(opt.replay);
+  printf("Soaking %d days on a %zu KB heap, %s responses%s\n", opt.days, opt.heapKB,
+         recordings[UPSTREAM_USGS].size() + recordings[UPSTREAM_NWS].size() + recordings[UPSTREAM_OPENWEATHER].size()
+           ? "recorded and made up" : "made up",
+         opt.bare ? ", without the platform's allocations" : "");
+  fflush(stdout);
+
+  // What backtrace(), dladdr(), the libc time zone and the font files
+  // allocate the first time, on the host's heap
+  void* warm[2];
+  backtrace(warm, 2);
+  frameName((void*)&main);
+  localTime(SOAK_UNIX_START);
+  tft.loadFont(AA_FONT_SMALL);
+  tft.unloadFont();
+  if (!playLevels.load(PLAY_LEVELS_FILE)) {
+    printf("No play levels in data%s, run from the top of the repository\n", PLAY_LEVELS_FILE);
+    return 2;
+  }
+  riverAnalytics.setLevels(playLevels.boundaries(), playLevels.boundaryCount());
+
+  // The clock is set once, before the heap is watched. Its later syncs are not run.
+  WiFiUDP::unicast = answerSntp;
+  systemClock.begin();
+  systemClock.startSync();
+  while (systemClock.poll()) {
+    delay(10);
+  }
+  if (!systemClock.isSet()) {
+    printf("The clock did not sync with the soak's time server\n");
+    return 2;
+  }
+
+  heapInit(opt.heapKB * 1024);
+  riverFetch.begin(millis(), &redrawFetched);
+
+  {
+    DeviceScope device;
+    // setup(): the font tables and the weather sprite are made here and kept
+    smallFont.begin();
+    showPage(SHOW_CURRENT);
+    showPage(SHOW_FORECAST);
+    render = {};
+
+    uint64_t nextMinute = 60 * 1000;
+    uint64_t nextTouch = (20 + ::random() % 100) * 60 * 1000ULL;
+    int day = 0;
+    while (elapsedMs < endMs) {
+      uint64_t netAt = elapsedMs + netScheduler.msUntilWindow(millis());
+      uint64_t next = min(min(netAt, nextMinute), nextTouch);
+      if (next > elapsedMs) {
+        delay(next - elapsedMs);
+      }
+      if ((int)(elapsedMs / DAY_MS) > day) {
+        endDay(day++);
+      }
+      if (elapsedMs >= netAt) {
+        runNetWindow();
+      }
+      if (elapsedMs >= nextTouch) {
+        touch();
+        nextTouch = elapsedMs + (20 + ::random() % 100) * 60 * 1000ULL;
+      }
+      if (elapsedMs >= nextMinute) {
+        {
+          RenderScope r;
+          pages.displayTime();
+        }
+        metrics.sampleHeap();
+        if (nextMinute % HOUR_MS == 0) {
+          sample(min((int)(elapsedMs / DAY_MS), opt.days - 1));
+        }
+        nextMinute += 60 * 1000;
+      }
+    }
+    while (day < opt.days) {
+      endDay(day++);
+    }
+  }
+
+  bool pass = report(opt.days);
+  if (opt.metricsDump) {
+    Print out;
+    printf("\n");
+    metrics.dump(out);
+    fetchArena.report(out);
+  }
+  return pass ? 0 : 1;
+}
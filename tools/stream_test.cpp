@@ -0,0 +1,376 @@
+// Feeds StreamIngest through the HTTPClient stand-in, then times it on bodies
+// served by tools/upstream_sim.py.
+//
+//   g++ -O2 -std=gnu++17 -Wall -Wextra -I. -Itools/host -o /tmp/stream_test tools/stream_test.cpp StreamIngest.cpp
+//   /tmp/stream_test [fetches]
+//
+// The checks run on a simulated clock. The stand-in hands the body over in
+// segments of a set size, one a millisecond, and StreamIngest reads whatever
+// has arrived, so sweeping the segment size moves every read boundary across
+// every byte of the framing.
+//
+// The benchmark runs from the top of the repository. It writes a made up
+// USGS RDB body of about 175 KB as the only recording, starts upstream_sim.py
+// on two loopback ports, one plain and one --chunked (chunks of 1 to 512
+// bytes), and fetches the body from each over a real socket the given number
+// of times (20 by default). The time is StreamIngest's alone, readLine() with
+// USGSRDB's 1000 byte buffer and read() with hydrograph's 512, in MB/s of body.
+//
+// Checked:
+//   - a chunked body comes out whole, by read() and by readLine(), whatever
+//     the read boundaries, chunk size lines split across reads included
+//   - a line spanning two chunks, and a CRLF split between them, comes out as
+//     one line without its CR
+//   - a line longer than the buffer is skipped and counted, the lines either
+//     side of it are kept, and the longest line the buffer holds comes through
+//   - chunk extensions and trailer fields are dropped, bytes after the last
+//     chunk are ignored and the body is complete
+//   - a body cut short of its Content-Length, or before its last chunk, is
+//     not complete
+//   - a connection that stalls ends the body after one STREAM_INGEST_TIMEOUT_MS,
+//     not complete, without the piece of a line it stopped in
+//   - the bodies from upstream_sim.py come out as recorded, plain and chunked
+// The exit status is 1 if any check fails.
+#define LOOPBACK_REPLY_MAX (256 * 1024)
+#include "StreamIngest.h"
+#include "USGSRDB.h"
+#include "hydrograph.h"
+#include <LoopbackHttp.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+#define SIM_DIR          "/tmp/stream_test_upstream"
+#define SIM_PLAIN_PORT   18480
+#define SIM_CHUNKED_PORT 18481
+#define BENCH_ROWS       3600
+
+/***************************************************************************************
+**                          Host runtime
+***************************************************************************************/
+static uint32_t nowMs = 0;
+
+uint32_t millis() { return nowMs; }
+uint32_t micros() { return nowMs * 1000; }
+void delay(uint32_t ms) { nowMs += ms; }
+
+HardwareSerial Serial;
+EspClass ESP;
+uint32_t EspClass::getFreeHeap() { return 0; }
+uint32_t EspClass::getMaxAllocHeap() { return 0; }
+uint32_t EspClass::getMinFreeHeap() { return 0; }
+const char* volatile heapTag = NULL;
+
+static uint64_t monotonicUs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/***************************************************************************************
+**                          Responses
+***************************************************************************************/
+static HostResponse canned;
+
+static bool cannedResponder(const char*, HostResponse* response) {
+  const char* request = response->request;
+  *response = canned;
+  response->request = request;
+  return true;
+}
+
+// Chunked framing around body, chunk sizes taken in turn from sizes
+static std::string chunked(const std::string& body, const std::vector<size_t>& sizes, const char* extension = "",
+                           const char* trailer = "") {
+  std::string out;
+  char line[48];
+  size_t at = 0;
+  for (int i = 0; at < body.size(); i++) {
+    size_t n = std::min(sizes[i % sizes.size()], body.size() - at);
+    // Upper and lower case hex in turn
+    snprintf(line, sizeof(line), i % 2 ? "%zX%s\r\n" : "%zx%s\r\n", n, extension);
+    out += line;
+    out.append(body, at, n);
+    out += "\r\n";
+    at += n;
+  }
+  snprintf(line, sizeof(line), "0%s\r\n", extension);
+  return out + line + trailer + "\r\n";
+}
+
+typedef struct Result {
+  std::string body;       // what came out, lines joined with \n
+  int         lines;
+  bool        complete;
+  uint16_t    longLines;
+  uint32_t    bytes;
+  uint32_t    elapsedMs;
+} Result;
+
+// One GET of the canned response, read to the end by lines or by spans
+static Result ingest(const std::string& wire, bool isChunked, size_t bodyLength, uint16_t segment, size_t bufferSize,
+                     bool byLine, size_t cutAt = (size_t)-1, size_t stallAt = (size_t)-1) {
+  memset(&canned, 0, sizeof(canned));
+  canned.code = 200;
+  canned.body = wire.data();
+  canned.length = isChunked ? wire.size() : bodyLength;
+  canned.chunked = isChunked;
+  canned.cutAt = cutAt;
+  canned.stallAt = stallAt;
+  canned.segmentBytes = segment;
+  canned.bytesPerSecond = segment * 1000;
+
+  Result res = {};
+  std::vector<char> buffer(bufferSize);
+  HTTPClient http;
+  http.begin("http://upstream/body");
+  StreamIngest::collectHeaders(&http);
+  http.GET();
+  StreamIngest body(buffer.data(), buffer.size());
+  body.begin(&http);
+  uint32_t startMs = millis();
+  if (byLine) {
+    size_t n;
+    char* line;
+    while ((line = body.readLine(&n))) {
+      res.body.append(line, n);
+      res.body += '\n';
+      res.lines++;
+    }
+  } else {
+    const char* data;
+    size_t n;
+    while ((n = body.read(&data))) res.body.append(data, n);
+  }
+  res.complete = body.complete();
+  res.longLines = body.longLines();
+  res.bytes = body.bytes();
+  res.elapsedMs = millis() - startMs;
+  http.end();
+  return res;
+}
+
+// Lines of the given lengths, each a run of one letter
+static std::string lines(const std::vector<size_t>& lengths, const char* ending = "\n") {
+  std::string out;
+  for (size_t i = 0; i < lengths.size(); i++) {
+    out.append(lengths[i], (char)('a' + i % 26));
+    out += ending;
+  }
+  return out;
+}
+
+/***************************************************************************************
+**                          Upstream simulator
+***************************************************************************************/
+// A USGS RDB response: comments, the two header rows, then a reading a row
+static std::string rdbBody() {
+  std::string out = "# Made up for tools/stream_test.cpp\n#\n";
+  out += "agency_cd\tsite_no\tdatetime\ttz_cd\t59213_00065\t59213_00065_cd\t59214_00060\t59214_00060_cd\n";
+  out += "5s\t15s\t20d\t6s\t14n\t10s\t14n\t10s\n";
+  char row[128];
+  for (int i = 0; i < BENCH_ROWS; i++) {
+    snprintf(row, sizeof(row), "USGS\t01646500\t2025-06-%02d %02d:%02d\tEDT\t%.2f\tP\t%d\tP\n", 1 + i / 96,
+             i / 4 % 24, i % 4 * 15, 3.0 + (i % 200) / 100.0, 4000 + i % 1000);
+    out += row;
+  }
+  return out;
+}
+
+static pid_t startSim(uint16_t port, bool isChunked) {
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    freopen("/dev/null", "w", stdout);
+    char portArg[8];
+    snprintf(portArg, sizeof(portArg), "%u", port);
+    if (isChunked) {
+      execlp("python3", "python3", "tools/upstream_sim.py", "--port", portArg, "--dir", SIM_DIR, "--chunked", "--seed",
+             "1", (char*)NULL);
+    } else {
+      execlp("python3", "python3", "tools/upstream_sim.py", "--port", portArg, "--dir", SIM_DIR, (char*)NULL);
+    }
+    _exit(127);
+  }
+  return pid;
+}
+
+// Waits up to 5 s for the simulator to take connections
+static bool simListening(uint16_t port) {
+  for (int i = 0; i < 500; i++) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bool up = !connect(fd, (sockaddr*)&addr, sizeof(addr));
+    close(fd);
+    if (up) return true;
+    usleep(10 * 1000);
+  }
+  return false;
+}
+
+typedef struct Bench {
+  bool     same;
+  bool     framed;       // the wire had chunk framing
+  uint64_t lineUs;
+  uint64_t spanUs;
+  uint64_t bytes;
+} Bench;
+
+// Fetches from the simulator, timing StreamIngest once by lines and once by spans
+static Bench bench(uint16_t port, const std::string& recorded, int fetches) {
+  Bench b = { true, false, 0, 0, 0 };
+  char url[64];
+  snprintf(url, sizeof(url), "http://127.0.0.1:%u/usgs/iv", port);
+  static char lineBuffer[USGS_LINE_MAX];
+  static char spanBuffer[HYDROGRAPH_READ_MAX];
+  for (int i = 0; i < fetches * 2; i++) {
+    bool byLine = i % 2 == 0;
+    HTTPClient http;
+    http.begin(url);
+    StreamIngest::collectHeaders(&http);
+    if (http.GET() != HTTP_CODE_OK) {
+      b.same = false;
+      break;
+    }
+    b.framed = b.framed || loopbackLast.chunked;
+    StreamIngest body(byLine ? lineBuffer : spanBuffer, byLine ? sizeof(lineBuffer) : sizeof(spanBuffer));
+    std::string out;
+    out.reserve(recorded.size());
+    uint64_t startUs = monotonicUs();
+    body.begin(&http);
+    if (byLine) {
+      size_t n;
+      char* line;
+      while ((line = body.readLine(&n))) {
+        out.append(line, n);
+        out += '\n';
+      }
+    } else {
+      const char* data;
+      size_t n;
+      while ((n = body.read(&data))) out.append(data, n);
+    }
+    (byLine ? b.lineUs : b.spanUs) += monotonicUs() - startUs;
+    b.bytes += byLine ? body.bytes() : 0;
+    b.same = b.same && body.complete() && out == recorded;
+    http.end();
+  }
+  return b;
+}
+
+/***************************************************************************************
+**                          Checks
+***************************************************************************************/
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+  if (!ok) failures++;
+}
+
+int main(int argc, char** argv) {
+  int fetches = argc > 1 ? atoi(argv[1]) : 20;
+  char what[200];
+  HTTPClient::responder = &cannedResponder;
+  WiFiClient::platformHeap = false;
+
+  // Every read boundary across the framing, with chunk sizes of one to three hex digits
+  std::string text = lines({ 5, 0, 17, 40, 3, 300, 1, 0, 64, 25, 2, 90, 31, 7 });
+  std::string wire = chunked(text, { 1, 26, 255, 7, 0x1a3, 16, 3 });
+  int wrongSpans = 0, wrongLines = 0;
+  for (uint16_t segment = 1; segment <= 40; segment++) {
+    Result spans = ingest(wire, true, 0, segment, 64, false);
+    Result byLine = ingest(wire, true, 0, segment, 512, true);
+    if (spans.body != text || !spans.complete) wrongSpans++;
+    if (byLine.body != text || !byLine.complete || byLine.lines != 14) wrongLines++;
+  }
+  snprintf(what, sizeof(what), "a chunked body read in segments of 1 to 40 bytes is wrong %d times by read(), %d by readLine()",
+           wrongSpans, wrongLines);
+  check(!wrongSpans && !wrongLines, what);
+
+  // Chunks of 7 over lines of 20 and more, so most lines span chunks; CRLF
+  // line endings, one of them split between two chunks
+  std::string crlf = lines({ 20, 33, 5, 48 }, "\r\n");
+  bool spanning = true;
+  for (size_t size : { (size_t)7, (size_t)22, (size_t)1 }) {
+    for (uint16_t segment : { 1, 3, 64 }) {
+      Result r = ingest(chunked(crlf, { size }), true, 0, segment, 128, true);
+      spanning = spanning && r.body == lines({ 20, 33, 5, 48 }) && r.lines == 4 && r.complete;
+    }
+  }
+  check(spanning, "lines spanning chunks, and a CRLF split across two, come out whole without the CR");
+
+  // 64 byte buffer: 62 characters and the newline fill the 63 it reads into
+  std::string longText = lines({ 10, 62, 200, 12, 63, 9 });
+  Result skipped = ingest(chunked(longText, { 50 }), true, 0, 16, 64, true);
+  std::string kept = longText.substr(0, 74) + longText.substr(275, 13) + longText.substr(352);
+  snprintf(what, sizeof(what), "lines of 200 and 63 in a 64 byte buffer are skipped, %d counted, %d lines kept",
+           skipped.longLines, skipped.lines);
+  check(skipped.body == kept && skipped.longLines == 2 && skipped.complete, what);
+  Result identity = ingest(longText, false, longText.size(), 1436, 64, true);
+  check(identity.body == kept && identity.longLines == 2 && identity.complete, "the same without chunking");
+
+  // Extensions on every size line and trailer fields after the last chunk
+  std::string extended = chunked(text, { 9, 40 }, ";name=value; q=\"1\"", "Expires: never\r\nX-Trailer: 1\r\n");
+  extended += "after the end";
+  bool stripped = true;
+  for (uint16_t segment : { 1, 2, 5, 1436 }) {
+    Result r = ingest(extended, true, 0, segment, 64, false);
+    stripped = stripped && r.body == text && r.complete && r.bytes == text.size();
+  }
+  check(stripped, "chunk extensions, trailer fields and bytes after the last chunk are dropped");
+
+  // Cut short
+  std::string plain = lines({ 30, 30, 30, 30, 30, 30 });
+  Result cut = ingest(plain, false, plain.size(), 8, 64, false, 100);
+  snprintf(what, sizeof(what), "a body cut at 100 of its %zu byte Content-Length ends with %u bytes, not complete",
+           plain.size(), cut.bytes);
+  check(!cut.complete && cut.bytes == 100 && cut.body == plain.substr(0, 100), what);
+  std::string wireCut = chunked(plain, { 40 });
+  Result cutChunked = ingest(wireCut, true, 0, 8, 64, false, wireCut.size() - 5);
+  check(!cutChunked.complete && cutChunked.body == plain, "a chunked body cut before its last chunk is not complete");
+
+  // The server stops sending but keeps the connection open
+  Result stalled = ingest(plain, false, plain.size(), 8, 64, true, (size_t)-1, 70);
+  snprintf(what, sizeof(what), "a connection that stalls after 70 bytes gives up %u ms later with %d whole lines",
+           stalled.elapsedMs, stalled.lines);
+  check(!stalled.complete && stalled.bytes == 70 && stalled.lines == 2 && stalled.elapsedMs > STREAM_INGEST_TIMEOUT_MS &&
+        stalled.elapsedMs < STREAM_INGEST_TIMEOUT_MS + 100, what);
+
+  // Throughput on the simulator's bodies
+  std::string recorded = rdbBody();
+  mkdir(SIM_DIR, 0700);
+  mkdir(SIM_DIR "/usgs", 0700);
+  FILE* f = fopen(SIM_DIR "/usgs/0001.body", "wb");
+  bool written = f && fwrite(recorded.data(), 1, recorded.size(), f) == recorded.size();
+  if (f) written = fclose(f) == 0 && written;
+  pid_t plainSim = startSim(SIM_PLAIN_PORT, false);
+  pid_t chunkedSim = startSim(SIM_CHUNKED_PORT, true);
+  bool up = written && simListening(SIM_PLAIN_PORT) && simListening(SIM_CHUNKED_PORT);
+  check(up, "upstream_sim.py is serving the recording on both ports");
+  HTTPClient::responder = &loopbackResponder;
+  if (up) {
+    Bench p = bench(SIM_PLAIN_PORT, recorded, fetches);
+    Bench c = bench(SIM_CHUNKED_PORT, recorded, fetches);
+    printf("%d fetches of %zu bytes, StreamIngest alone:\n", fetches, recorded.size());
+    printf("  plain      readLine %7.1f MB/s  read %7.1f MB/s\n", p.bytes / (double)p.lineUs,
+           p.bytes / (double)p.spanUs);
+    printf("  chunked    readLine %7.1f MB/s  read %7.1f MB/s\n", c.bytes / (double)c.lineUs,
+           c.bytes / (double)c.spanUs);
+    check(p.same && !p.framed, "the plain body comes out as recorded");
+    check(c.same && c.framed, "the chunked body comes out as recorded");
+  }
+  kill(plainSim, SIGTERM);
+  kill(chunkedSim, SIGTERM);
+  waitpid(plainSim, NULL, 0);
+  waitpid(chunkedSim, NULL, 0);
+
+  printf("%s: %d checks failed\n", failures ? "FAIL" : "PASS", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,228 @@
+#!/usr/bin/env python3
+"""Stand-in for USGS, NWS and OpenWeather that replays recorded responses.
+
+Record a few real responses first, then replay them with faults:
+
+    tools/upstream_sim.py --record
+    tools/upstream_sim.py --latency 0.8 --bandwidth 4000 --chunked --disconnect 0.1 --garbage 0.1
+
+and point the base URLs in All_Settings.h at it, one path prefix per source:
+
+    #define USGS_BASE_URL        "http://<this machine>:8080/usgs"
+    #define NWS_BASE_URL         "http://<this machine>:8080/nws"
+    #define OPENWEATHER_BASE_URL "http://<this machine>:8080/openweather"
+
+In record mode every request is passed on to the real service and the body is
+saved as <dir>/<source>/<time>.body. In replay mode the recordings of a source
+are served in turn, with each fault applied at random at the given rate:
+
+    --latency      seconds before the status line
+    --bandwidth    bytes per second for the body
+    --chunked      chunked transfer encoding in random chunk sizes
+    --disconnect   close the connection part way through the body
+    --garbage      overwrite a random run of the body with random bytes
+    --error        answer 503 instead
+
+With --serial the display's metrics are read back over its serial port on
+Ctrl-C and the fetch-to-pixels latency percentiles printed for each refresh
+path (needs pyserial).
+"""
+
+import argparse
+import os
+import random
+import sys
+import threading
+import time
+import urllib.request
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+UPSTREAMS = {
+    "usgs": "https://waterservices.usgs.gov",
+    "nws": "https://water.weather.gov",
+    "openweather": "https://api.openweathermap.org",
+}
+
+CONTENT_TYPES = {
+    "usgs": "text/plain",
+    "nws": "text/xml",
+    "openweather": "application/json",
+}
+
+
+class Recordings:
+    def __init__(self, root):
+        self.root = root
+        self.next = {}
+        self.lock = threading.Lock()
+
+    def save(self, source, body):
+        folder = os.path.join(self.root, source)
+        os.makedirs(folder, exist_ok=True)
+        path = os.path.join(folder, time.strftime("%Y%m%d-%H%M%S") + ".body")
+        with open(path, "wb") as f:
+            f.write(body)
+        return path
+
+    def take(self, source):
+        folder = os.path.join(self.root, source)
+        names = sorted(n for n in os.listdir(folder) if n.endswith(".body")) if os.path.isdir(folder) else []
+        if not names:
+            return None, None
+        with self.lock:
+            i = self.next.get(source, 0) % len(names)
+            self.next[source] = i + 1
+        path = os.path.join(folder, names[i])
+        with open(path, "rb") as f:
+            return names[i], f.read()
+
+
+def make_handler(args, recordings, stats):
+    rng = random.Random(args.seed)
+
+    def chance(rate):
+        return rate > 0 and rng.random() < rate
+
+    class Handler(BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"
+
+        def log_message(self, fmt, *a):
+            pass
+
+        def do_GET(self):
+            started = time.time()
+            parts = self.path.split("/", 2)
+            source = parts[1] if len(parts) > 1 else ""
+            if source not in UPSTREAMS:
+                self.send_error(404, "unknown source")
+                return
+            rest = "/" + (parts[2] if len(parts) > 2 else "")
+
+            if args.record:
+                with urllib.request.urlopen(UPSTREAMS[source] + rest, timeout=30) as r:
+                    body = r.read()
+                name = os.path.basename(recordings.save(source, body))
+                faults = []
+            else:
+                name, body = recordings.take(source)
+                if body is None:
+                    self.send_error(404, "nothing recorded for " + source)
+                    return
+                faults = []
+                if chance(args.error):
+                    faults.append("503")
+                if chance(args.garbage):
+                    faults.append("garbage")
+                    body = bytearray(body)
+                    start = rng.randrange(len(body))
+                    for i in range(start, min(len(body), start + rng.randint(1, 64))):
+                        body[i] = rng.randrange(256)
+                    body = bytes(body)
+
+            if args.latency and not args.record:
+                time.sleep(args.latency)
+            if "503" in faults:
+                self.send_response(503)
+                self.send_header("Content-Length", "0")
+                self.send_header("Connection", "close")
+                self.end_headers()
+                self.report(source, name, faults, 0, started)
+                return
+
+            cut = len(body)
+            if not args.record and chance(args.disconnect):
+                cut = rng.randrange(len(body)) if body else 0
+                faults.append("disconnect@%d" % cut)
+            chunked = args.chunked and not args.record
+            if chunked:
+                faults.append("chunked")
+
+            self.send_response(200)
+            self.send_header("Content-Type", CONTENT_TYPES[source])
+            self.send_header("Connection", "close")
+            if chunked:
+                self.send_header("Transfer-Encoding", "chunked")
+            else:
+                self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+
+            sent = 0
+            try:
+                while sent < cut:
+                    n = min(cut - sent, rng.randint(1, 512) if chunked else 1024)
+                    piece = body[sent:sent + n]
+                    self.wfile.write(b"%x\r\n%s\r\n" % (n, piece) if chunked else piece)
+                    self.wfile.flush()
+                    sent += n
+                    if args.bandwidth and not args.record:
+                        time.sleep(n / args.bandwidth)
+                if chunked and cut == len(body):
+                    self.wfile.write(b"0\r\n\r\n")
+            except (BrokenPipeError, ConnectionResetError):
+                faults.append("client closed")
+            self.close_connection = True
+            self.report(source, name, faults, sent, started)
+
+        def report(self, source, name, faults, sent, started):
+            elapsed = time.time() - started
+            stats.setdefault(source, []).append(elapsed)
+            print("%s  %-11s %-22s %7d bytes %6.2f s  %s" % (time.strftime("%H:%M:%S"), source, name,
+                  sent, elapsed, ", ".join(faults) or "clean"))
+
+    return Handler
+
+
+def percentile(values, pct):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, (len(ordered) * pct + 99) // 100 - 1)]
+
+
+def read_refresh_table(port):
+    """Ask the display for its metrics and return the refresh latency table."""
+    import serial
+    with serial.Serial(port, 250000, timeout=2) as s:
+        s.reset_input_buffer()
+        s.write(b"m")
+        lines = s.read(16384).decode("utf-8", "replace").splitlines()
+    for i, line in enumerate(lines):
+        if line.startswith("Refresh"):
+            return lines[i:]
+    return []
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--dir", default=os.path.join(os.path.dirname(os.path.abspath(__file__)), "upstream"))
+    parser.add_argument("--record", action="store_true", help="pass requests on and save the responses")
+    parser.add_argument("--latency", type=float, default=0.0)
+    parser.add_argument("--bandwidth", type=float, default=0.0, help="bytes per second, 0 for no limit")
+    parser.add_argument("--chunked", action="store_true")
+    parser.add_argument("--disconnect", type=float, default=0.0, help="share of responses cut short")
+    parser.add_argument("--garbage", type=float, default=0.0, help="share of responses corrupted")
+    parser.add_argument("--error", type=float, default=0.0, help="share of requests answered with 503")
+    parser.add_argument("--seed", type=int, default=None)
+    parser.add_argument("--serial", help="the display's serial port, for its refresh latency on exit")
+    args = parser.parse_args()
+
+    stats = {}
+    server = ThreadingHTTPServer(("", args.port), make_handler(args, Recordings(args.dir), stats))
+    print("%s on port %d, recordings in %s" % ("Recording" if args.record else "Replaying", args.port, args.dir))
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+    print("\nServed            count   p50 s   p90 s   max s")
+    for source, times in sorted(stats.items()):
+        print("%-15s %7d %7.2f %7.2f %7.2f" % (source, len(times), percentile(times, 50),
+              percentile(times, 90), max(times)))
+    if args.serial:
+        print("\nDisplay, fetch start to pixels")
+        for line in read_refresh_table(args.serial):
+            print(line)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
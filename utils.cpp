@@ -8,15 +8,9 @@ static BasicZoneProcessor timeZoneProcessor;
 ***************************************************************************************/
 String strTime(time_t unixTime)
 {
-  auto localTz = TimeZone::forZoneInfo(&zonedb::kZoneAmerica_New_York, &timeZoneProcessor);
-  acetime_t nowSeconds = unixTime;
-  ZonedDateTime dateTime = ZonedDateTime::forEpochSeconds(nowSeconds, localTz);
-
-  String localTime = "";
-  char timeChar[40] = {};
-  snprintf(timeChar, sizeof(timeChar), "%02d:%02d", dateTime.hour(), dateTime.minute());
-  
-  return timeChar;
+  TextStack<8> text;
+  strLocalTime(unixTime, text);
+  return text.c_str();
 }
 
 /***************************************************************************************
@@ -25,8 +19,7 @@ String strTime(time_t unixTime)
 String strDate(time_t unixTime)
 {
   auto localTz = TimeZone::forZoneInfo(&zonedb::kZoneAmerica_New_York, &timeZoneProcessor);
-  acetime_t nowSeconds = unixTime;
-  ZonedDateTime dateTime = ZonedDateTime::forEpochSeconds(nowSeconds, localTz);
+  ZonedDateTime dateTime = ZonedDateTime::forUnixSeconds64(unixTime, localTz);
   char timeChar[40] = {};
   snprintf(timeChar, sizeof(timeChar), "%d/%d %02d:%02d", dateTime.month(), dateTime.day(), dateTime.hour(), dateTime.minute());
   String localDate = timeChar;
@@ -35,7 +28,64 @@ String strDate(time_t unixTime)
 }
 
 
-void printWeatherCurrent(OpenWeatherOneCall::nowData *current){
+/***************************************************************************************
+**             Split Unix time into the local date, time of day and offset
+***************************************************************************************/
+void localCalendar(uint32_t unixTime, CalendarTime& out)
+{
+  auto localTz = TimeZone::forZoneInfo(&zonedb::kZoneAmerica_New_York, &timeZoneProcessor);
+  ZonedDateTime dateTime = ZonedDateTime::forUnixSeconds64(unixTime, localTz);
+  out.year = dateTime.year();
+  out.month = dateTime.month();
+  out.day = dateTime.day();
+  out.hour = dateTime.hour();
+  out.minute = dateTime.minute();
+  // AceTime counts Monday as 1
+  out.dayOfWeek = dateTime.dayOfWeek() % 7 + 1;
+  out.offsetMinutes = dateTime.timeOffset().toMinutes();
+}
+
+/***************************************************************************************
+**             Append Unix time as a local "17:18" or "06/01 17:18"
+***************************************************************************************/
+// For the draw functions, these go through TextBuf instead of String or printf
+void strLocalTime(uint32_t unixTime, TextBuf& out)
+{
+  auto localTz = TimeZone::forZoneInfo(&zonedb::kZoneAmerica_New_York, &timeZoneProcessor);
+  ZonedDateTime dateTime = ZonedDateTime::forUnixSeconds64(unixTime, localTz);
+  out.unum(dateTime.hour(), 2, '0').add(':').unum(dateTime.minute(), 2, '0');
+}
+
+void strLocalDateTime(uint32_t unixTime, TextBuf& out)
+{
+  auto localTz = TimeZone::forZoneInfo(&zonedb::kZoneAmerica_New_York, &timeZoneProcessor);
+  ZonedDateTime dateTime = ZonedDateTime::forUnixSeconds64(unixTime, localTz);
+  out.unum(dateTime.month(), 2, '0').add('/').unum(dateTime.day(), 2, '0').add(' ');
+  out.unum(dateTime.hour(), 2, '0').add(':').unum(dateTime.minute(), 2, '0');
+}
+
+/***************************************************************************************
+**     "2021-06-01T12:00:00-04:00" to Unix time, 0 when the text is not a date
+***************************************************************************************/
+uint32_t parseIsoTime(const char* text)
+{
+  OffsetDateTime dateTime = OffsetDateTime::forDateString(text);
+  if (dateTime.isError()) {
+    return 0;
+  }
+  return (uint32_t)dateTime.toUnixSeconds64();
+}
+
+uint32_t unixTimeForOffset(int year, int month, int day, int hour, int minute, int offsetMinutes)
+{
+  OffsetDateTime dateTime = OffsetDateTime::forComponents(year, month, day, hour, minute, 0, TimeOffset::forMinutes(offsetMinutes));
+  if (dateTime.isError()) {
+    return 0;
+  }
+  return (uint32_t)dateTime.toUnixSeconds64();
+}
+
+void printWeatherCurrent(WeatherNow *current){
     Serial.println("Weather from OpenWeather\n");
 
   Serial.println("############### Current weather ###############\n");
@@ -56,9 +106,9 @@ void printWeatherCurrent(OpenWeatherOneCall::nowData *current){
   Serial.println();
 
 }
-void printWeatherForecast(OpenWeatherOneCall::futureData *forecast){
+void printWeatherForecast(WeatherDay *forecast, uint8_t days){
   
-  for (int i = 0; i < 5; i++)
+  for (int i = 0; i < days; i++)
   {
     Serial.print("dt (time)          : "); Serial.println(strDate(forecast[i].dayTime));
     Serial.print("id                 : "); Serial.println(forecast[i].id);
@@ -1,9 +1,27 @@
 #ifndef _RIVER_WEATHER_UTILS_H_FILE
 #define _RIVER_WEATHER_UTILS_H_FILE
-#include <OpenWeatherOneCall.h>
+#include "OneCall.h"
+#include "TextFormat.h"
 String strTime(time_t unixTime);
 String strDate(time_t unixTime);
-void printWeatherCurrent(OpenWeatherOneCall::nowData *current);
-void printWeatherForecast(OpenWeatherOneCall::futureData *forecast);
+
+// A Unix time on the local calendar, for the draw functions
+typedef struct CalendarTime {
+  int16_t year;
+  uint8_t month;          // 1-12
+  uint8_t day;
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t dayOfWeek;      // 1 for Sunday to 7 for Saturday, as shortDOW
+  int16_t offsetMinutes;  // the zone's offset from UTC then
+} CalendarTime;
+
+void localCalendar(uint32_t unixTime, CalendarTime& out);
+void strLocalTime(uint32_t unixTime, TextBuf& out);
+void strLocalDateTime(uint32_t unixTime, TextBuf& out);
+uint32_t parseIsoTime(const char* text);
+uint32_t unixTimeForOffset(int year, int month, int day, int hour, int minute, int offsetMinutes);
+void printWeatherCurrent(WeatherNow *current);
+void printWeatherForecast(WeatherDay *forecast, uint8_t days);
 
 #endif